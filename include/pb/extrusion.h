@@ -1,8 +1,10 @@
 #ifndef PB_EXTRUSION_H
 #define PB_EXTRUSION_H
 
+#include <stdint.h>
 #include <pb/util/geom/types.h>
 #include <pb/floor_plan.h>
+#include <pb/util/thread_pool/thread_pool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,6 +20,7 @@ extern "C" {
  * doors:   The set of doors in the room, corresponding to the doors in a pb_room.
  * ground:  The ground. If the corresponding pb_room has has_ground set to 0, then this will be NULL.
  * ceiling: The room's ceiling. If the corresponding pb_room has has_ceiling set to 0, then this will be NULL.
+ * bounds:  The bounds of every shape in the room. Only filled in when extruded with PB_EXTRUDE_BOUNDS.
  */
 typedef struct {
     pb_shape3D** walls;
@@ -35,6 +38,8 @@ typedef struct {
 
     pb_shape3D* ceiling;
     size_t num_ceiling_shapes;
+
+    pb_bounds3D bounds;
 } pb_extruded_room;
 
 /**
@@ -46,6 +51,8 @@ typedef struct {
  *          contains the shapes for the wall from floor.shape[0] to floor.shape[1], etc.
  * windows: The set of windows on the floor, corresponding to the windows in a pb_floor.
  * doors:   The set of doors on the floor, corresponding to the doors in a pb_floor.
+ * bounds:  The bounds of the floor's exterior and all of its rooms. Only filled in when extruded with
+ *          PB_EXTRUDE_BOUNDS.
  */
 typedef struct {
     pb_extruded_room** rooms;
@@ -60,8 +67,143 @@ typedef struct {
 
     pb_shape3D* doors;
     size_t num_doors;
+
+    pb_bounds3D bounds;
 } pb_extruded_floor;
 
+/**
+ * The kinds of shape produced by extrusion. Used to index the per-category shape ranges in contiguous rooms and floors.
+ */
+typedef enum pb_extruded_category {
+    PB_EXTRUDED_WALL = 0,
+    PB_EXTRUDED_DOOR = 1,
+    PB_EXTRUDED_WINDOW = 2,
+    PB_EXTRUDED_FLOOR = 3,
+    PB_EXTRUDED_CEILING = 4,
+    PB_EXTRUDED_NUM_CATEGORIES = 5
+} pb_extruded_category;
+
+/* The room reported for shapes that belong to the exterior of a floor rather than one of its rooms. */
+#define PB_EXTRUDED_EXTERIOR ((size_t)-1)
+
+/**
+ * A range of elements in one of the arrays of a pb_contiguous_building.
+ */
+typedef struct {
+    size_t start;
+    size_t count;
+} pb_range;
+
+/**
+ * A shape whose vertices are stored in the vertex buffer of a pb_contiguous_building.
+ *
+ * verts:  The shape's vertices (three per triangle), relative to pos like the tris of a pb_shape3D.
+ * pos:    The shape's position.
+ * bounds: The shape's bounds. Only filled in when extruded with PB_EXTRUDE_BOUNDS; cleared otherwise.
+ */
+typedef struct {
+    pb_range verts;
+    pb_point3D pos;
+    pb_bounds3D bounds;
+} pb_contiguous_shape;
+
+/**
+ * A room in a pb_contiguous_building. All ranges index the arrays of the building.
+ *
+ * wall_lists: The room's wall lists, one per side of the room's shape like pb_extruded_room.walls. Each wall list is a
+ *             range of shapes; sides without a wall have an empty range.
+ * shapes:     The room's shapes, indexed by pb_extruded_category. The ranges are laid out one after the other in
+ *             category order.
+ * verts:      Every vertex belonging to the room.
+ * bounds:     The bounds of every shape in the room. Only filled in when extruded with PB_EXTRUDE_BOUNDS; cleared
+ *             otherwise.
+ */
+typedef struct {
+    pb_range wall_lists;
+    pb_range shapes[PB_EXTRUDED_NUM_CATEGORIES];
+    pb_range verts;
+    pb_bounds3D bounds;
+} pb_contiguous_room;
+
+/**
+ * A floor in a pb_contiguous_building. All ranges index the arrays of the building.
+ *
+ * rooms:      The floor's rooms.
+ * wall_lists: The wall lists of the floor's exterior, one per side of the floor's shape.
+ * shapes:     The shapes of the floor's exterior (walls, doors and windows), indexed by pb_extruded_category.
+ * verts:      Every vertex belonging to the floor, including its rooms. The exterior's vertices come first.
+ * bounds:     The bounds of the floor's exterior and all of its rooms. Only filled in when extruded with
+ *             PB_EXTRUDE_BOUNDS; cleared otherwise.
+ */
+typedef struct {
+    pb_range rooms;
+    pb_range wall_lists;
+    pb_range shapes[PB_EXTRUDED_NUM_CATEGORIES];
+    pb_range verts;
+    pb_bounds3D bounds;
+} pb_contiguous_floor;
+
+/**
+ * An extruded building stored in a single allocation. Every vertex lives in one buffer, in floor order, so the whole
+ * building can be uploaded with one copy, and the shapes, rooms and floors refer to it through ranges.
+ */
+typedef struct {
+    pb_vert3D* verts;
+    size_t num_verts;
+
+    pb_contiguous_shape* shapes;
+    size_t num_shapes;
+
+    pb_range* wall_lists;
+    size_t num_wall_lists;
+
+    pb_contiguous_room* rooms;
+    size_t num_rooms;
+
+    pb_contiguous_floor* floors;
+    size_t num_floors;
+} pb_contiguous_building;
+
+/**
+ * The formats in which a vertex attribute can be written.
+ */
+typedef enum pb_vertex_component_type {
+    PB_VERTEX_FLOAT32 = 0,
+    PB_VERTEX_FLOAT16 = 1,
+    /* Signed normalised integers, for attributes in [-1, 1] such as normals. Other values are clamped. */
+    PB_VERTEX_SNORM16 = 2,
+    PB_VERTEX_SNORM8 = 3
+} pb_vertex_component_type;
+
+/**
+ * Where and how to write one attribute of each vertex. Vertex i's attribute is written to data + offset + i * stride.
+ *
+ * data:   The start of the stream holding the attribute, or NULL to skip it.
+ * offset: The byte offset of the attribute within each vertex of the stream.
+ * stride: The number of bytes between consecutive vertices of the stream.
+ * type:   The format of each component of the attribute.
+ */
+typedef struct {
+    void* data;
+    size_t offset;
+    size_t stride;
+    pb_vertex_component_type type;
+} pb_vertex_attribute;
+
+/**
+ * A description of the vertex format used by an engine. Attributes sharing a stream (the same data, different
+ * offsets) are interleaved, while attributes with their own streams are laid out as separate arrays.
+ *
+ * position: 3 components, relative to the shape's position like the tris of a pb_shape3D.
+ * normal:   3 components.
+ * uv:       2 components.
+ */
+typedef struct {
+    pb_vertex_attribute position;
+    pb_vertex_attribute normal;
+    pb_vertex_attribute uv;
+} pb_vertex_layout;
+
 /**
  * Determines how many new shapes will result from calling the extrusion function.
  *
@@ -93,8 +235,11 @@ typedef void (PB_CALL * pb_wall_structure_count_func)(pb_line2D const* wall, pb_
  * @param struct_height  The requested height for the window/door. The function choose not to respect this.
  * @param start_height   The height at which each extruded shape must start.
  * @param param          The supplied parameter, if any.
- * @param walls_out      On success, holds a pointer to the list of wall shapes.
- * @param structures_out On success, holds a pointer to the list of wall structure shapes.
+ * @param walls_out      On success, holds a pointer to the list of wall shapes. Each shape's bounds should be filled
+ *                       in, or left cleared (as pb_shape3D_init leaves them) to have them worked out from the shape's
+ *                       vertices when they're needed.
+ * @param structures_out On success, holds a pointer to the list of wall structure shapes, with their bounds like
+ *                       walls_out.
  *
  * @return 0 on success, -1 on failure.
  */
@@ -103,18 +248,124 @@ typedef int (PB_CALL * pb_wall_structure_extrusion_func)(pb_line2D const* wall,
                                                          float struct_height, float start_height,
                                                          void* param, pb_shape3D** walls_out, pb_shape3D** structures_out);
 
+/**
+ * Determines how many triangles will be produced by calling the extrusion function. Like the count function, this
+ * MUST be deterministic.
+ *
+ * @param wall               The line representing this wall.
+ * @param wall_structure     The line representing the wall structure.
+ * @param normal             This wall's (2D) normal vector.
+ * @param floor_height       The height to which each floor will be extruded.
+ * @param struct_height      The requested height for the window/door.
+ * @param start_height       The height at which each extruded shape must start.
+ * @param param              The supplied parameter, if any.
+ * @param num_wall_tris      The total number of triangles in the wall shapes.
+ * @param num_structure_tris The total number of triangles in the wall structure shapes.
+ */
+typedef void (PB_CALL * pb_wall_structure_tri_count_func)(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                                          pb_point2D const* bottom_floor_centre, float floor_height,
+                                                          float struct_height, float start_height,
+                                                          void* param, size_t* num_wall_tris, size_t* num_structure_tris);
+
+/**
+ * Extrudes the given wall structure into memory provided by the caller instead of allocating it. Must produce the same
+ * shapes as the extrusion function.
+ *
+ * @param wall            The line representing this wall.
+ * @param wall_structure  The line representing the wall structure.
+ * @param normal          This wall's (2D) normal vector.
+ * @param floor_height    The height to which each floor will be extruded. The produced shapes must occupy this height.
+ * @param struct_height   The requested height for the window/door. The function choose not to respect this.
+ * @param start_height    The height at which each extruded shape must start.
+ * @param param           The supplied parameter, if any.
+ * @param walls_out       Room for as many wall shapes as reported by the count function. Their tris must point into
+ *                        wall_verts, one after the other. Their bounds are cleared, and are worked out from their
+ *                        vertices when they're needed unless the function fills them in.
+ * @param wall_verts      Room for the wall shapes' vertices (three per triangle reported by the tri count function).
+ * @param structures_out  Room for as many wall structure shapes as reported by the count function. Their tris must
+ *                        point into structure_verts, one after the other.
+ * @param structure_verts Room for the wall structure shapes' vertices.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+typedef int (PB_CALL * pb_wall_structure_fill_func)(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                                    pb_point2D const* bottom_floor_centre, float floor_height,
+                                                    float struct_height, float start_height,
+                                                    void* param,
+                                                    pb_shape3D* walls_out, pb_vert3D* wall_verts,
+                                                    pb_shape3D* structures_out, pb_vert3D* structure_verts);
+
+/**
+ * Extrudes the given wall structure straight into the streams of a pb_vertex_layout. Must produce the same shapes as
+ * the extrusion function.
+ *
+ * @param wall            The line representing this wall.
+ * @param wall_structure  The line representing the wall structure.
+ * @param normal          This wall's (2D) normal vector.
+ * @param floor_height    The height to which each floor will be extruded. The produced shapes must occupy this height.
+ * @param struct_height   The requested height for the window/door. The function choose not to respect this.
+ * @param start_height    The height at which each extruded shape must start.
+ * @param param           The supplied parameter, if any.
+ * @param layout          The layout to write the vertices to.
+ * @param walls_out       Room for as many wall shapes as reported by the count function. Their num_tris, pos and
+ *                        bounds must be filled in (the vertices can't be read back from the layout to bound them) and
+ *                        their tris set to NULL. Their vertices are written one after the other, starting at vertex
+ *                        wall_vert of the layout.
+ * @param wall_vert       The index of the vertex at which to write the walls.
+ * @param structures_out  Room for as many wall structure shapes as reported by the count function, filled in like
+ *                        walls_out. NULL if the wall structures aren't wanted, in which case only the walls are
+ *                        written.
+ * @param structure_vert  The index of the vertex at which to write the wall structures.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+typedef int (PB_CALL * pb_wall_structure_fill_layout_func)(pb_line2D const* wall, pb_line2D const* wall_structure,
+                                                           pb_point2D const* normal,
+                                                           pb_point2D const* bottom_floor_centre, float floor_height,
+                                                           float struct_height, float start_height,
+                                                           void* param, pb_vertex_layout const* layout,
+                                                           pb_shape3D* walls_out, size_t wall_vert,
+                                                           pb_shape3D* structures_out, size_t structure_vert);
+
+/**
+ * A door or window extruder.
+ *
+ * tri_count and fill are optional and may be left NULL. When an extruder provides both, measuring and extruding into
+ * caller-provided memory doesn't allocate anything per door or window; otherwise the extrusion function is used and
+ * its output is copied.
+ *
+ * fill_layout is optional too, and also needs tri_count. Without it, extruding into a pb_vertex_layout builds the
+ * extruder's vertices as pb_vert3D first and converts them.
+ */
 typedef struct {
     pb_wall_structure_count_func count;
     pb_wall_structure_extrusion_func extrude;
+    pb_wall_structure_tri_count_func tri_count;
+    pb_wall_structure_fill_func fill;
+    pb_wall_structure_fill_layout_func fill_layout;
 } pb_wall_structure_extruder;
 
 /**
- * Extrudes a wall with the given doors and windows.
+ * The number of shapes and triangles that extrusion produces for a room or the exterior of a floor.
+ *
+ * num_shapes:     The number of shapes, indexed by pb_extruded_category.
+ * num_tris:       The number of triangles, indexed by pb_extruded_category.
+ * num_wall_lists: The number of wall lists (one per side of the room or floor's shape).
+ */
+typedef struct {
+    size_t num_shapes[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t num_tris[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t num_wall_lists;
+} pb_extrusion_counts;
+
+/**
+ * Extrudes a wall with the given doors and windows. The bounds of the walls are filled in, and the doors and windows
+ * have whatever bounds their extruders gave them.
  *
  * @param wall                  The wall to extrude.
- * @param doors                 The doors in this wall as a list of lines. Note that this will be sorted by this function.
+ * @param doors                 The doors in this wall as a list of lines. Not modified: the function sorts a copy.
  * @param num_doors             The number od doors in the doors list.
- * @param windows               The windows in this wall as a list of lines. Note that this will be sorted by this function.
+ * @param windows               The windows in this wall as a list of lines. Not modified: the function sorts a copy.
  * @param num_windows           The number of windows contained in the windows list.
  * @param bottom_floor_centre   The centre point of the bottom floor.
  * @param normal                This parent wall's normal vector.
@@ -154,7 +405,7 @@ PB_DECLSPEC int PB_CALL pb_extrude_wall(pb_line2D const* wall,
                                         pb_shape3D** windows_out, size_t* num_windows_out);
 
 /**
- * Extrudes the floor and ceiling for the given room.
+ * Extrudes the floor and ceiling for the given room, filling in their bounds.
  *
  * @param room                   The room for which the floor and ceiling should be extruded.
  * @param bottom_floor_centre    The bottom floor's centre point.
@@ -250,6 +501,563 @@ PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building(pb_building* buildin
                                                             void* window_extruder_param);
 
 
+/**
+ * Extrudes a building into a single allocation. The shapes are the same as the ones produced by pb_extrude_building,
+ * but they are stored in a pb_contiguous_building instead of a tree of lists.
+ *
+ * @param building              The building to extrude. Its doors and windows will be sorted.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors. Must be < floor height.
+ * @param window_height         The height for windows. Must be < window height.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ *
+ * @return The extruded building on success, to be freed with pb_contiguous_building_free. NULL on failure.
+ */
+PB_DECLSPEC pb_contiguous_building* PB_CALL pb_extrude_building_contiguous(pb_building* building,
+                                                                         float floor_height,
+                                                                         float door_height,
+                                                                         float window_height,
+                                                                         pb_wall_structure_extruder const* door_extruder,
+                                                                         pb_wall_structure_extruder const* window_extruder,
+                                                                         void* door_extruder_param,
+                                                                         void* window_extruder_param);
+
+/**
+ * Determines exactly how much memory pb_extrude_building_into will need for a building, without extruding anything
+ * (unless an extruder has no tri_count function, in which case it has to be run to find out).
+ *
+ * @param building              The building to measure.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors.
+ * @param window_height         The height for windows.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ * @param floor_counts          Optional. Holds building->num_floors counts, one for the exterior of each floor.
+ * @param room_counts           Optional. Holds one count per room in the building, floor by floor.
+ * @param sizes                 Holds the number of elements in each array of the extruded building. The array pointers
+ *                              are set to NULL.
+ *
+ * @return 0 on success, -1 on failure (an extruder failed).
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_measure(pb_building const* building,
+                                                    float floor_height,
+                                                    float door_height,
+                                                    float window_height,
+                                                    pb_wall_structure_extruder const* door_extruder,
+                                                    pb_wall_structure_extruder const* window_extruder,
+                                                    void* door_extruder_param,
+                                                    void* window_extruder_param,
+                                                    pb_extrusion_counts* floor_counts,
+                                                    pb_extrusion_counts* room_counts,
+                                                    pb_contiguous_building* sizes);
+
+/**
+ * Extrudes a building into memory provided by the caller, laid out like the result of pb_extrude_building_contiguous.
+ * Apart from triangulating floors and ceilings and running extruders without a fill function, this does not allocate,
+ * so one set of buffers can be reused for many buildings.
+ *
+ * @param building              The building to extrude. Its doors and windows will be sorted.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors. Must be < floor height.
+ * @param window_height         The height for windows. Must be < window height.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ * @param out                   The array pointers must point to buffers, and the num_ fields must hold their
+ *                              capacities (e.g. from pb_extrude_building_measure). On success, the num_ fields hold
+ *                              the number of elements used.
+ *
+ * @return 0 on success, -1 on failure (an extruder failed or a buffer was too small). The buffers' contents are
+ *         unspecified on failure.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_into(pb_building* building,
+                                                 float floor_height,
+                                                 float door_height,
+                                                 float window_height,
+                                                 pb_wall_structure_extruder const* door_extruder,
+                                                 pb_wall_structure_extruder const* window_extruder,
+                                                 void* door_extruder_param,
+                                                 void* window_extruder_param,
+                                                 pb_contiguous_building* out);
+
+/**
+ * Flags that change how pb_extrude_building_contiguous_ex and friends extrude a building.
+ *
+ * PB_EXTRUDE_SHARED_WALLS_ONCE: Where two rooms on a floor have walls along the same stretch, the first of the two
+ *                               rooms extrudes the stretch (along with any doors in it) and the other leaves it out.
+ *                               Shared walls have to be drawn double-sided, with the first room's normals. The
+ *                               other room's wall lists only hold the parts of its walls that it doesn't share.
+ * PB_EXTRUDE_INSTANCE_STRUCTURES: Doors and windows themselves are left out (their ranges are empty), though the walls
+ *                                 around them are still extruded. Draw them from pb_extrude_building_instances.
+ *                                 Without PB_EXTRUDE_SHARED_WALLS_ONCE, a door between two rooms gets an instance
+ *                                 for each room, in the same place, just as it would have been extruded twice.
+ * PB_EXTRUDE_BOUNDS: Fills in the bounds of every shape, room and floor. Each shape is bounded from the quad or
+ *                    outline it is made from as it is extruded, and rooms and floors from their shapes, so the
+ *                    vertices are never gone through a second time. Streamed batches are bounded as their vertices
+ *                    are moved into place.
+ */
+typedef enum pb_extrusion_flags {
+    PB_EXTRUDE_SHARED_WALLS_ONCE = 1,
+    PB_EXTRUDE_INSTANCE_STRUCTURES = 2,
+    PB_EXTRUDE_BOUNDS = 4
+} pb_extrusion_flags;
+
+/**
+ * Same as pb_extrude_building, but with pb_extrusion_flags.
+ * @return As for pb_extrude_building. Also returns NULL if flags contains PB_EXTRUDE_SHARED_WALLS_ONCE or
+ *         PB_EXTRUDE_INSTANCE_STRUCTURES, which are only supported by the contiguous extrusion functions.
+ */
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_ex(pb_building* building,
+                                                               float floor_height,
+                                                               float door_height,
+                                                               float window_height,
+                                                               pb_wall_structure_extruder const* door_extruder,
+                                                               pb_wall_structure_extruder const* window_extruder,
+                                                               void* door_extruder_param,
+                                                               void* window_extruder_param,
+                                                               unsigned flags);
+
+/**
+ * Same as pb_extrude_building_measure, but with pb_extrusion_flags. The flags must match the ones given to
+ * pb_extrude_building_into_ex.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_measure_ex(pb_building const* building,
+                                                       float floor_height,
+                                                       float door_height,
+                                                       float window_height,
+                                                       pb_wall_structure_extruder const* door_extruder,
+                                                       pb_wall_structure_extruder const* window_extruder,
+                                                       void* door_extruder_param,
+                                                       void* window_extruder_param,
+                                                       unsigned flags,
+                                                       pb_extrusion_counts* floor_counts,
+                                                       pb_extrusion_counts* room_counts,
+                                                       pb_contiguous_building* sizes);
+
+/**
+ * Same as pb_extrude_building_into, but with pb_extrusion_flags.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_ex(pb_building* building,
+                                                    float floor_height,
+                                                    float door_height,
+                                                    float window_height,
+                                                    pb_wall_structure_extruder const* door_extruder,
+                                                    pb_wall_structure_extruder const* window_extruder,
+                                                    void* door_extruder_param,
+                                                    void* window_extruder_param,
+                                                    unsigned flags,
+                                                    pb_contiguous_building* out);
+
+/**
+ * Same as pb_extrude_building_contiguous, but with pb_extrusion_flags.
+ */
+PB_DECLSPEC pb_contiguous_building* PB_CALL pb_extrude_building_contiguous_ex(pb_building* building,
+                                                                            float floor_height,
+                                                                            float door_height,
+                                                                            float window_height,
+                                                                            pb_wall_structure_extruder const* door_extruder,
+                                                                            pb_wall_structure_extruder const* window_extruder,
+                                                                            void* door_extruder_param,
+                                                                            void* window_extruder_param,
+                                                                            unsigned flags);
+
+/**
+ * Extrudes a building like pb_extrude_building_into, except that each vertex is written straight into the caller's
+ * streams in the given layout as its shape is produced, rather than into out->verts as a pb_vert3D.
+ *
+ * @param building              The building to extrude. Its doors and windows will be sorted.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors. Must be < floor height.
+ * @param window_height         The height for windows. Must be < window height.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ * @param layout                The layout of the vertices. Each stream must have room for out->num_verts vertices.
+ * @param out                   As for pb_extrude_building_into, except that out->verts isn't used.
+ *
+ * @return 0 on success, -1 on failure (an extruder failed or a buffer was too small). The buffers' contents are
+ *         unspecified on failure.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_layout(pb_building* building,
+                                                        float floor_height,
+                                                        float door_height,
+                                                        float window_height,
+                                                        pb_wall_structure_extruder const* door_extruder,
+                                                        pb_wall_structure_extruder const* window_extruder,
+                                                        void* door_extruder_param,
+                                                        void* window_extruder_param,
+                                                        pb_vertex_layout const* layout,
+                                                        pb_contiguous_building* out);
+
+/**
+ * Same as pb_extrude_building_into_layout, but with pb_extrusion_flags.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_layout_ex(pb_building* building,
+                                                           float floor_height,
+                                                           float door_height,
+                                                           float window_height,
+                                                           pb_wall_structure_extruder const* door_extruder,
+                                                           pb_wall_structure_extruder const* window_extruder,
+                                                           void* door_extruder_param,
+                                                           void* window_extruder_param,
+                                                           unsigned flags,
+                                                           pb_vertex_layout const* layout,
+                                                           pb_contiguous_building* out);
+
+/**
+ * A batch of triangles produced by pb_extrude_building_stream. Unlike the other extrusion functions, the vertices
+ * are not relative to a shape's position: they have already been moved into place.
+ *
+ * floor:     The index of the floor the triangles belong to.
+ * room:      The index of the room in the floor, or PB_EXTRUDED_EXTERIOR for the floor's exterior.
+ * category:  What kind of shapes the triangles came from.
+ * verts:     The vertices, three per triangle. Only valid until the sink returns.
+ * num_verts: The number of vertices.
+ * bounds:    The bounds of the vertices, whose sphere encloses their box. Only filled in when streamed with
+ *            PB_EXTRUDE_BOUNDS; cleared otherwise.
+ */
+typedef struct {
+    size_t floor;
+    size_t room;
+    pb_extruded_category category;
+    pb_vert3D const* verts;
+    size_t num_verts;
+    pb_bounds3D bounds;
+} pb_extrusion_batch;
+
+/**
+ * Receives the triangles produced by pb_extrude_building_stream.
+ *
+ * @param batch The next batch of triangles.
+ * @param user  The user parameter passed to pb_extrude_building_stream.
+ * @return 0 to continue, -1 to stop extrusion.
+ */
+typedef int (PB_CALL * pb_extrusion_sink_func)(pb_extrusion_batch const* batch, void* user);
+
+/**
+ * Extrudes a building and passes its triangles to a sink in small batches instead of storing them, so the memory used
+ * doesn't grow with the number of floors and rooms. It isn't fixed either: each room's floor and ceiling are
+ * triangulated and extruded in one go, so peak memory still grows with the number of sides of the largest room (and
+ * with the largest set of shapes produced for one door or window). For every floor, the exterior is sent first,
+ * followed by each room. Within a room, the triangles of each category arrive in the same order as in
+ * pb_extrude_building_contiguous, but batches of different categories may be interleaved.
+ *
+ * @param building              The building to extrude. Its doors and windows will be sorted.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors. Must be < floor height.
+ * @param window_height         The height for windows. Must be < window height.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ * @param sink                  The function receiving each batch.
+ * @param user                  An optional parameter to pass to the sink.
+ *
+ * @return 0 on success, -1 on failure (out of memory, an extruder failed or the sink stopped extrusion).
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_stream(pb_building* building,
+                                                   float floor_height,
+                                                   float door_height,
+                                                   float window_height,
+                                                   pb_wall_structure_extruder const* door_extruder,
+                                                   pb_wall_structure_extruder const* window_extruder,
+                                                   void* door_extruder_param,
+                                                   void* window_extruder_param,
+                                                   pb_extrusion_sink_func sink,
+                                                   void* user);
+
+/**
+ * Same as pb_extrude_building_stream, but with pb_extrusion_flags. The triangles sent with each flag are the same as
+ * the ones stored by pb_extrude_building_contiguous_ex.
+ */
+PB_DECLSPEC int PB_CALL pb_extrude_building_stream_ex(pb_building* building,
+                                                      float floor_height,
+                                                      float door_height,
+                                                      float window_height,
+                                                      pb_wall_structure_extruder const* door_extruder,
+                                                      pb_wall_structure_extruder const* window_extruder,
+                                                      void* door_extruder_param,
+                                                      void* window_extruder_param,
+                                                      unsigned flags,
+                                                      pb_extrusion_sink_func sink,
+                                                      void* user);
+
+/* Frees everything produced by pb_extrude_building_contiguous in one go. */
+PB_DECLSPEC void PB_CALL pb_contiguous_building_free(pb_contiguous_building* b);
+
+/**
+ * A shape in a pb_indexed_building.
+ *
+ * verts:   The shape's welded vertices, relative to pos.
+ * indices: The shape's indices (three per triangle). They're relative to verts.start, so the shape can be drawn with
+ *          verts.start as the base vertex.
+ * pos:     The shape's position.
+ */
+typedef struct {
+    pb_range verts;
+    pb_range indices;
+    pb_point3D pos;
+} pb_indexed_shape;
+
+/**
+ * An indexed copy of a pb_contiguous_building in which each shape's coincident vertices have been welded.
+ *
+ * Since indices are relative to their shape, 16-bit indices are used unless a single shape has more than 65536
+ * vertices. The shapes are in the same order as the shapes of the contiguous building, so the building's floors,
+ * rooms and wall lists can be used to find them (but not its vertex ranges, which refer to the unwelded vertices).
+ */
+typedef struct {
+    pb_vert3D* verts;
+    size_t num_verts;
+
+    /* uint16_t if index_size is 2, uint32_t if it's 4 */
+    void* indices;
+    size_t num_indices;
+    size_t index_size;
+
+    pb_indexed_shape* shapes;
+    size_t num_shapes;
+} pb_indexed_building;
+
+/**
+ * Welds the vertices of each shape in a contiguous building and stores the result in a single allocation. See
+ * pb_weld_verts for when vertices are welded.
+ *
+ * @param b         The building to index.
+ * @param fuzz_bits The number of bits to ignore at the end of each vertex component's mantissa when welding.
+ * @return The indexed building on success, to be freed with pb_indexed_building_free. NULL on out of memory.
+ */
+PB_DECLSPEC pb_indexed_building* PB_CALL pb_contiguous_building_index(pb_contiguous_building const* b,
+                                                                      size_t fuzz_bits);
+
+/**
+ * Optimises an indexed building for the GPU. Each shape's triangles are reordered for post-transform vertex cache
+ * locality with pb_optimize_vertex_cache, then its vertices are reordered for fetch locality with
+ * pb_optimize_vertex_fetch. The shapes' ranges are unchanged.
+ *
+ * @param b           The building to optimise in place.
+ * @param cache_size  The number of vertices held by the cache being optimised for (e.g. 16 or 32).
+ * @param acmr_before Out: the average cache miss ratio over every shape before optimising. May be NULL.
+ * @param acmr_after  Out: the average cache miss ratio over every shape after optimising. May be NULL.
+ * @return 0 on success, -1 on out of memory, in which case some shapes may have been optimised but the building is
+ *         still valid.
+ */
+PB_DECLSPEC int PB_CALL pb_indexed_building_optimize(pb_indexed_building* b, size_t cache_size,
+                                                     float* acmr_before, float* acmr_after);
+
+/* Frees everything produced by pb_contiguous_building_index in one go. */
+PB_DECLSPEC void PB_CALL pb_indexed_building_free(pb_indexed_building* b);
+
+/**
+ * A 12-byte vertex, quantised relative to the bounds of the floor to which it belongs. Use pb_dequantize_vert3D, or
+ * the same arithmetic in a shader, to recover a pb_vert3D.
+ *
+ * x, y, z: The position in building space (i.e. with the shape's pos already added), as a fraction of the floor's
+ *          bounds: pos = pos_min + x * pos_scale.
+ * nx, ny:  The normal in octahedral encoding, as signed fractions of 127.
+ * u, v:    The uv coordinates as a fraction of the floor's uv bounds: uv = uv_min + u * uv_scale.
+ */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t z;
+    int8_t nx;
+    int8_t ny;
+    uint16_t u;
+    uint16_t v;
+} pb_quantized_vert3D;
+
+/**
+ * The constants with which to dequantise the vertices of a floor.
+ */
+typedef struct {
+    pb_point3D pos_min;
+    pb_point3D pos_scale;
+    pb_point2D uv_min;
+    pb_point2D uv_scale;
+} pb_dequantization;
+
+/**
+ * A pb_contiguous_building whose vertices have been quantised.
+ *
+ * verts:  The quantised vertices, in the same order as the vertices of the contiguous building, so its shapes, rooms
+ *         and floors can be used to find them. The shapes' positions have been added to the vertices.
+ * floors: The dequantisation constants for each floor of the contiguous building.
+ */
+typedef struct {
+    pb_quantized_vert3D* verts;
+    size_t num_verts;
+
+    pb_dequantization* floors;
+    size_t num_floors;
+} pb_quantized_building;
+
+/**
+ * Quantises the vertices of a contiguous building into a single allocation. Positions and uvs are quantised to 16 bits
+ * over the bounds of each floor, and normals are octahedral-encoded in 8 bits per component.
+ *
+ * @param b The building to quantise.
+ * @return The quantised building on success, to be freed with pb_quantized_building_free. NULL on out of memory.
+ */
+PB_DECLSPEC pb_quantized_building* PB_CALL pb_contiguous_building_quantize(pb_contiguous_building const* b);
+
+/**
+ * Recovers a vertex from its quantised form.
+ *
+ * @param v   The quantised vertex.
+ * @param d   The dequantisation constants of the vertex's floor.
+ * @param out Out: the vertex. Its position is in building space, and its normal has unit length.
+ */
+PB_DECLSPEC void PB_CALL pb_dequantize_vert3D(pb_quantized_vert3D const* v, pb_dequantization const* d,
+                                             pb_vert3D* out);
+
+/* Frees everything produced by pb_contiguous_building_quantize in one go. */
+PB_DECLSPEC void PB_CALL pb_quantized_building_free(pb_quantized_building* b);
+
+/**
+ * The walls of a pb_contiguous_building after coplanar quads have been merged. Since a merged quad can span several
+ * rooms or floors, the shapes aren't grouped: draw them instead of every wall range of the building.
+ *
+ * verts:  The shapes' vertices, relative to their positions.
+ * shapes: The walls. Merged quads are positioned at their centres like the quads produced by pb_extrude_wall, and
+ *         have their bounds filled in; the other walls keep the bounds they had in the building.
+ */
+typedef struct {
+    pb_vert3D* verts;
+    size_t num_verts;
+
+    pb_contiguous_shape* shapes;
+    size_t num_shapes;
+} pb_merged_walls;
+
+/**
+ * Merges the wall quads of a contiguous building. Quads that are vertical rectangles facing the same way in the same
+ * plane are merged greedily, first along each wall (e.g. collinear walls of adjacent rooms), then across floors (e.g.
+ * facade strips stacked on top of each other). Walls that aren't single quads, such as those produced by custom
+ * extruders, are copied unchanged.
+ *
+ * Quads are only merged if their uvs line up: they must cover the same range of uvs per unit of length, and each must
+ * start where the one before it ends, give or take a whole number of repeats. Each original quad then covers the same
+ * range of uvs it covered before, possibly offset by whole repeats, so a repeating texture looks the same as it did
+ * before merging.
+ *
+ * @param b The building whose walls should be merged.
+ * @return The merged walls on success, to be freed with pb_merged_walls_free. NULL on out of memory.
+ */
+PB_DECLSPEC pb_merged_walls* PB_CALL pb_contiguous_building_merge_walls(pb_contiguous_building const* b);
+
+/* Frees everything produced by pb_contiguous_building_merge_walls in one go. */
+PB_DECLSPEC void PB_CALL pb_merged_walls_free(pb_merged_walls* w);
+
+/**
+ * One door or window, to be drawn as an instance of a unit quad rather than extruded.
+ *
+ * pos:    The centre of the opening, positioned like the shapes of an extruded building.
+ * normal: The normal of the wall that the opening is in. With y up, this fixes the quad's orientation.
+ * width:  The width of the opening along the wall.
+ * height: The height of the opening, which is the door or window height capped like the simple extruders cap it.
+ * floor:  The index of the floor the opening is on.
+ * room:   The index of the room in the floor, or PB_EXTRUDED_EXTERIOR for the floor's exterior.
+ */
+typedef struct {
+    pb_point3D pos;
+    pb_point3D normal;
+    float width;
+    float height;
+    size_t floor;
+    size_t room;
+} pb_wall_structure_instance;
+
+/**
+ * The doors and windows of a building as instances, each in floor order and then in the order of the extruded parts
+ * (the exterior of a floor, followed by its rooms).
+ */
+typedef struct {
+    pb_wall_structure_instance* doors;
+    size_t num_doors;
+
+    pb_wall_structure_instance* windows;
+    size_t num_windows;
+} pb_wall_structure_instances;
+
+/**
+ * Gets an instance for every door and window that extruding the building would produce, without running any
+ * extruders. Each instance has the position and size of the quad that pb_simple_door_extruder or
+ * pb_simple_window_extruder would produce: doors stand on the floor and windows are centred on it, and neither is
+ * taller than those extruders allow. Combined with PB_EXTRUDE_INSTANCE_STRUCTURES, every door and window of a
+ * building can be drawn with one instanced draw each.
+ *
+ * Like extrusion, this produces a door between two rooms once per room unless PB_EXTRUDE_SHARED_WALLS_ONCE is given,
+ * so without it each such door has two coincident instances (one facing into each room).
+ *
+ * @param building      The building.
+ * @param floor_height  The height for each floor.
+ * @param door_height   The height for doors. Must be < floor height.
+ * @param window_height The height for windows. Must be < floor height.
+ * @param flags         The pb_extrusion_flags that the rest of the building is extruded with, so that shared doors
+ *                      are only produced once when they are.
+ *
+ * @return The instances on success, to be freed with pb_wall_structure_instances_free. NULL on out of memory.
+ */
+PB_DECLSPEC pb_wall_structure_instances* PB_CALL pb_extrude_building_instances(pb_building const* building,
+                                                                             float floor_height,
+                                                                             float door_height,
+                                                                             float window_height,
+                                                                             unsigned flags);
+
+/* Frees everything produced by pb_extrude_building_instances in one go. */
+PB_DECLSPEC void PB_CALL pb_wall_structure_instances_free(pb_wall_structure_instances* instances);
+
+/**
+ * Extrudes a building like pb_extrude_building, but extrudes the exterior of every floor and every room as a separate
+ * task on the given thread pool. The result is identical to pb_extrude_building's. The door and window extruders
+ * will be called from several threads at once, so they must be thread safe.
+ *
+ * @param building              The building to extrude.
+ * @param floor_height          The height for each floor.
+ * @param door_height           The height for doors. Must be < floor height.
+ * @param window_height         The height for windows. Must be < window height.
+ * @param door_extruder         The function to extrude doors.
+ * @param window_extruder       The function to extrude windows.
+ * @param door_extruder_param   An optional parameter to pass to the door extruder.
+ * @param window_extruder_param An optional parameter to pass to the window extruder.
+ * @param pool                  The thread pool to run on. If NULL, the building is extruded on the calling thread.
+ *
+ * @return The same as pb_extrude_building.
+ */
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_parallel(pb_building* building,
+                                                                     float floor_height,
+                                                                     float door_height,
+                                                                     float window_height,
+                                                                     pb_wall_structure_extruder const* door_extruder,
+                                                                     pb_wall_structure_extruder const* window_extruder,
+                                                                     void* door_extruder_param,
+                                                                     void* window_extruder_param,
+                                                                     pb_thread_pool* pool);
+
+/**
+ * Same as pb_extrude_building_parallel, but with pb_extrusion_flags. With PB_EXTRUDE_BOUNDS, each task bounds the room
+ * it extrudes, and the floors are bounded once every task has finished.
+ * @return As for pb_extrude_building_ex.
+ */
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_parallel_ex(pb_building* building,
+                                                                        float floor_height,
+                                                                        float door_height,
+                                                                        float window_height,
+                                                                        pb_wall_structure_extruder const* door_extruder,
+                                                                        pb_wall_structure_extruder const* window_extruder,
+                                                                        void* door_extruder_param,
+                                                                        void* window_extruder_param,
+                                                                        unsigned flags,
+                                                                        pb_thread_pool* pool);
+
 PB_DECLSPEC void PB_CALL pb_extruded_room_free(pb_extruded_room* r);
 PB_DECLSPEC void PB_CALL pb_extruded_floor_free(pb_extruded_floor* f);
 
@@ -3,6 +3,7 @@
 
 #include <pb/exports.h>
 #include <pb/util/geom/types.h>
+#include <pb/util/arena/arena.h>
 
 #include <stddef.h>
 #include <stdint.h>
@@ -79,6 +80,13 @@ typedef struct {
      * 
      * The floor plan generation algorithm must set this variable. */
     int has_names;
+
+    /* If non-NULL, every array owned by the building (floors, rooms, shapes, walls, doors and windows) lives in this
+     * arena, and pb_building_free releases all of them in one call. A generator can allocate from the arena as it
+     * builds the plan (as pb_sq_house does), or build the plan with malloc and then call pb_building_pack.
+     *
+     * The floor plan generation algorithm must set this variable. */
+    pb_arena* arena;
 } pb_building;
 
 /* Floor plan generators can clean up their data by defining cleanup functions for rooms, floors and the building.
@@ -103,7 +111,7 @@ typedef void (*pb_floor_free_func)(pb_floor const* f);
 typedef void (*pb_building_free_func)(pb_building const* building);
 
 /**
- * Frees a single room on a floor.
+ * Frees a single room on a floor. Must not be used on a room in a packed building (see pb_building_pack).
  * @param room   The room to free.
  * @param r_free A function that frees room metadata allocated by the floor plan generation algorithm.
  */
@@ -111,7 +119,7 @@ PB_DECLSPEC void pb_room_free(pb_room* room, pb_room_free_func r_free);
 
 /**
  * Frees a single floor in a building. Note that the floor pointer itself will still be valid, but all of its members
- * will no longer be usable.
+ * will no longer be usable. Must not be used on a floor in a packed building (see pb_building_pack).
  *
  * @param f      The floor to free.
  * @param f_free A function that frees floor metadata allocated by the floor plan generation algorithm.
@@ -130,6 +138,21 @@ PB_DECLSPEC void pb_floor_free(pb_floor* f, pb_floor_free_func f_free, pb_room_f
  */
 PB_DECLSPEC void PB_CALL pb_building_free(pb_building* building, pb_building_free_func b_free, pb_floor_free_func f_free,
                                           pb_room_free_func r_free);
+
+/**
+ * Moves every array owned by a building built with malloc into a single arena, laid out in the order in which a plan is
+ * normally traversed (floors, then each floor's rooms, shape, doors and windows, then each room's shape, walls, doors
+ * and windows). The arena is sized up front, so this requires exactly one allocation, and pb_building_free then
+ * releases the whole building with one call instead of walking every room.
+ *
+ * After packing, the building's shape and wall vectors must be treated as read-only; they can't be grown. Algorithm
+ * data and room names are left untouched. Packing a building that's already backed by an arena (including any building
+ * generated by pb_sq_house) does nothing.
+ *
+ * @param building The building to pack.
+ * @return 0 on success, -1 on failure (out of memory), in which case the building is unchanged.
+ */
+PB_DECLSPEC int PB_CALL pb_building_pack(pb_building* building);
 #ifdef __cplusplus
 }
 #endif
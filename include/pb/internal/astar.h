@@ -1,14 +1,89 @@
 #ifndef PB_ASTAR_H
 #define PB_ASTAR_H
 
+#include <pb/util/arena/arena.h>
+#include <pb/util/hashmap/typed_map.h>
+#include <pb/util/heap/handle_heap.h>
 #include <pb/util/vector/vector.h>
 #include <pb/util/graph/graph.h>
+#include <pb/util/graph/graph_csr.h>
 
 /* Function prototype for an A* heuristic function */
 typedef float(*pb_astar_heuristic)(pb_vertex const* vertex, pb_vertex const* goal);
 
+/* Function prototype for an A* heuristic function on a frozen graph */
+typedef float(*pb_astar_csr_heuristic)(pb_graph_csr const* graph, size_t vert, size_t goal);
+
+typedef struct pb_astar_csr_node pb_astar_csr_node;
+
+/**
+ * Everything that an A* search needs besides the graph. A context can be used for any number of searches; it's reset
+ * at the start of each one rather than reallocated, so once it has grown to fit the graph, searches don't allocate.
+ */
+typedef struct {
+    pb_arena*      nodes;     /* The search nodes, one per vertex that has been reached. */
+    size_t         num_nodes; /* The number of nodes allocated by the current (or last) search. */
+    size_t         nodes_cap; /* The number of nodes that fit in the arena's first block. */
+    pb_handle_heap frontier;  /* The nodes that haven't been expanded yet, by estimated total cost. */
+    pb_ptr_map     visited;   /* A map of vertices => nodes for every vertex that has been reached. */
+
+    /* Searches on frozen graphs keep their nodes in a list indexed by vertex instead. A node belongs to the current
+     * search if its search ID matches, so the list doesn't need to be cleared between searches. */
+    pb_astar_csr_node* csr_nodes;
+    size_t             csr_nodes_cap;
+    unsigned           search_id;
+} pb_astar_ctx;
+
+/**
+ * Initialises an A* context.
+ *
+ * @param ctx The context to initialise.
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+int pb_astar_ctx_init(pb_astar_ctx* ctx);
+
+/**
+ * Frees the context's internal structures (but not the context itself).
+ *
+ * @param ctx The context to free.
+ */
+void pb_astar_ctx_free(pb_astar_ctx* ctx);
+
+/**
+ * Finds the least-cost path between two vertices using the given context.
+ *
+ * @param ctx       The context to use for the search.
+ * @param start     The start vertex.
+ * @param goal      The goal vertex.
+ * @param heuristic The heuristic function used to estimate a vertex's distance from the goal.
+ * @param path      An initialised vector of pb_vertex*. It's cleared, and then if a path was found, filled with the
+ *                  vertices making up the path.
+ *
+ * @return 0 if a path was found, -1 if not. Note that -1 will be also be returned if the function runs out of memory.
+ */
+int pb_astar_search(pb_astar_ctx* ctx, pb_vertex const* start, pb_vertex const* goal, pb_astar_heuristic heuristic,
+                    pb_vector* path);
+
+/**
+ * Finds the least-cost path between two vertices of a frozen graph using the given context. Since the vertices are
+ * numbered, the search's nodes are kept in a list indexed by vertex rather than looked up in a map.
+ *
+ * @param ctx       The context to use for the search.
+ * @param graph     The frozen graph to search.
+ * @param start     The index of the start vertex.
+ * @param goal      The index of the goal vertex.
+ * @param heuristic The heuristic function used to estimate a vertex's distance from the goal.
+ * @param path      An initialised vector of size_t. It's cleared, and then if a path was found, filled with the
+ *                  indices of the vertices making up the path.
+ *
+ * @return 0 if a path was found, -1 if not. Note that -1 will be also be returned if the function runs out of memory.
+ */
+int pb_astar_csr_search(pb_astar_ctx* ctx, pb_graph_csr const* graph, size_t start, size_t goal,
+                        pb_astar_csr_heuristic heuristic, pb_vector* path);
+
 /**
- * An implementation of A* pathfinding for the pb_sq_house algorithm.
+ * An implementation of A* pathfinding for the pb_sq_house algorithm. This creates a context for a single search; use
+ * pb_astar_search to run several.
  * @param start     The start vertex.
  * @param goal      The goal vertex.
  * @param heuristic The heuristic function used to estimate a vertex's distance from the goal.
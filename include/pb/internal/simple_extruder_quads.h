@@ -0,0 +1,36 @@
+#ifndef PB_SIMPLE_EXTRUDER_QUADS_H
+#define PB_SIMPLE_EXTRUDER_QUADS_H
+
+#include <pb/util/geom/types.h>
+#include <pb/internal/vertex_kernels.h>
+
+/*
+ * The quads that pb_simple_door_extruder and pb_simple_window_extruder are made of, so that other parts of the
+ * library (such as pb_extrude_building_instances) can place doors and windows exactly where the extruders would.
+ * The parameters are the same as the extruders', and every quad is positioned at its centre.
+ */
+
+/**
+ * Works out the quads of a door and the wall above it. The door's height is struct_height, capped to leave some
+ * space at the top of the floor.
+ */
+void pb_simple_door_quads(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                          pb_point2D const* bottom_floor_centre, float floor_height,
+                          float struct_height, float start_height,
+                          pb_quad_verts* door_quad, pb_point3D* door_pos,
+                          pb_quad_verts* wall_quad, pb_point3D* wall_pos);
+
+/**
+ * Works out the quads of a window and the walls below and above it. The window is centred on the floor, and its
+ * height is struct_height, capped to leave some space at the top and bottom of the floor.
+ *
+ * @param wall_quads Receives the quads below and above the window, in that order.
+ * @param wall_pos   Receives the positions of the quads below and above the window, in that order.
+ */
+void pb_simple_window_quads(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                            pb_point2D const* bottom_floor_centre, float floor_height,
+                            float struct_height, float start_height,
+                            pb_quad_verts* window_quad, pb_point3D* window_pos,
+                            pb_quad_verts* wall_quads, pb_point3D* wall_pos);
+
+#endif /* PB_SIMPLE_EXTRUDER_QUADS_H */
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <pb/sq_house.h>
+#include <pb/util/arena/arena.h>
 #include <pb/util/graph/graph.h>
 #include <pb/util/hashmap/hashmap.h>
 #include <pb/util/vector/vector.h>
@@ -114,11 +115,13 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
  * @param floor_graph    The floor graph representing the given floor.
  * @param internal_graph The graph of the floor's internal points.
  * @param hallways       The list of hallways returned by pb_sq_house_get_hallways.
+ * @param arena          The arena from which the floor's rooms and walls were allocated, or NULL if they came from
+ *                       malloc. The hallways are allocated in the same way.
  *
  * @return 0 on succcess, -1 on failure.
  */
 int pb_sq_house_place_hallways(pb_floor* floor, pb_sq_house_house_spec* hspec, pb_hashmap* room_specs,
-                               pb_graph* floor_graph, pb_graph* internal_graph, pb_vector* hallways);
+                               pb_graph* floor_graph, pb_graph* internal_graph, pb_vector* hallways, pb_arena* arena);
 
 /**
  * Places doors on each wall that has them. Also places a door leading outside if on the first floor.
@@ -127,9 +130,11 @@ int pb_sq_house_place_hallways(pb_floor* floor, pb_sq_house_house_spec* hspec, p
  * @param hspec          The house specification, which stores door sizes.
  * @param floor_graph    The graph representing connections between rooms.
  * @param is_first_floor Whether this is the first floor.
+ * @param arena          The arena from which to allocate the doors, or NULL to use malloc.
  * @return 0 on success, -1 on failure (out of memory).
  */
-int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph* floor_graph, int is_first_floor);
+int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph* floor_graph, int is_first_floor,
+                            pb_arena* arena);
 
 /**
  * Places windows on each exterior wall on the floor, except for the bottom wall of the first room on the first floor
@@ -139,8 +144,9 @@ int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph
  * @param f              The floor to which to add windows.
  * @param hspec          The house specification storing the window size.
  * @param is_first_floor Whether we're placing windows on the first floor.
+ * @param arena          The arena from which to allocate the windows, or NULL to use malloc.
  * @return 0 on success, -1 on failure (out of memory).
  */
-int pb_sq_house_place_windows(pb_floor* f, pb_sq_house_house_spec* hspec, int is_first_floor);
+int pb_sq_house_place_windows(pb_floor* f, pb_sq_house_house_spec* hspec, int is_first_floor, pb_arena* arena);
 
 #endif /* PB_SQ_HOUSE_GRAPH_H */
@@ -3,15 +3,80 @@
 
 #include <pb/sq_house.h>
 #include <pb/internal/squarify.h>
+#include <pb/util/arena/arena.h>
 #include <pb/util/hashmap/hashmap.h>
+#include <pb/util/rng/rng.h>
+#include <pb/util/vector/vector.h>
+
+/* Every stage of the algorithm allocates the arrays that end up in the building (floors, rooms, walls, doors and
+ * windows) through the functions below. If the arena is NULL they use malloc, and everything must be freed
+ * individually; otherwise everything comes from the arena and freeing it is a no-op. */
+
+/**
+ * Allocates part of a floor plan.
+ *
+ * @param arena The arena from which to allocate, or NULL to use malloc.
+ * @param size  The number of chars to allocate.
+ * @return The allocated memory on success, NULL on failure (out of memory).
+ */
+void* pb_sq_house_plan_alloc(pb_arena* arena, size_t size);
+
+/**
+ * Resizes part of a floor plan allocated by pb_sq_house_plan_alloc.
+ *
+ * @param arena    The arena from which ptr was allocated, or NULL if it came from malloc.
+ * @param ptr      The memory to resize. May be NULL.
+ * @param old_size The current size of ptr (in chars).
+ * @param size     The new size (in chars).
+ * @return The resized memory on success, NULL on failure (out of memory), in which case ptr is still valid.
+ */
+void* pb_sq_house_plan_realloc(pb_arena* arena, void* ptr, size_t old_size, size_t size);
+
+/**
+ * Frees part of a floor plan allocated by pb_sq_house_plan_alloc. Does nothing if arena is non-NULL.
+ *
+ * @param arena The arena from which ptr was allocated, or NULL if it came from malloc.
+ * @param ptr   The memory to free. May be NULL.
+ */
+void pb_sq_house_plan_free(pb_arena* arena, void* ptr);
+
+/**
+ * Initialises a room's walls vector with the given capacity and a size of 0. Must be used instead of pb_vector_init
+ * for walls, which can't be grown with pb_vector's functions since they may live in an arena.
+ *
+ * @param arena The arena from which to allocate, or NULL to use malloc.
+ * @param walls The vector to initialise.
+ * @param cap   The vector's initial capacity.
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+int pb_sq_house_init_walls(pb_arena* arena, pb_vector* walls, size_t cap);
+
+/**
+ * Changes the capacity of a walls vector initialised by pb_sq_house_init_walls. Its size is left unchanged.
+ *
+ * @param arena The arena from which the walls were allocated, or NULL if they came from malloc.
+ * @param walls The vector to resize.
+ * @param cap   The vector's new capacity.
+ * @return 0 on success, -1 on failure (out of memory), in which case the vector is unchanged.
+ */
+int pb_sq_house_resize_walls(pb_arena* arena, pb_vector* walls, size_t cap);
+
+/**
+ * Frees a walls vector initialised by pb_sq_house_init_walls. Does nothing if arena is non-NULL.
+ *
+ * @param arena The arena from which the walls were allocated, or NULL if they came from malloc.
+ * @param walls The vector to free.
+ */
+void pb_sq_house_free_walls(pb_arena* arena, pb_vector* walls);
 
 /**
  * Determines which rooms will go be in the house.
  *
  * @param room_specs The specifications for each room type.
  * @param house_spec The specifications for the house.
+ * @param rng        The generator used to pick the number of instances of each room and their order.
  */
-char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec* house_spec);
+char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec* house_spec, pb_rng* rng);
 
 /**
  * Determines the number of floors in the house, allocates an appropriately sized pb_room list for each, and inserts
@@ -21,10 +86,13 @@ char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec*
  * @param room_specs The hash map containing the room specification for each room.
  * @param h_spec     The house specification (containing the total number of rooms).
  * @param house      The floor plan for the building.
+ * @param rng        The generator used to pick the side of each floor on which stairs are placed.
+ * @param arena      The arena from which to allocate the floors, rooms and walls, or NULL to use malloc.
  *
  * @returns A list of rectangles indicating the free space on each corresponding floor.
  */
-pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, pb_sq_house_house_spec* h_spec, pb_building* house);
+pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, pb_sq_house_house_spec* h_spec, pb_building* house,
+                                  pb_rng* rng, pb_arena* arena);
 
 /**
  * Lays out the specified number of rooms on the given floor using pb_squarify.
@@ -35,12 +103,13 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
  * @param floor             The floor on which the rooms will be placed.
  * @param floor_rect        The rectangle of available space on the floor.
  * @param should_swap_room0 Whether to swap room 0 with room 1. Should be true if a house has > 1 floors.
+ * @param arena             The arena from which to allocate the rooms' walls, or NULL to use malloc.
  *
  * @return 0 on success, -1 on failure (out of memory). Note that on returning -1, all shapes allocated on this floor will have been freed;
  *         the caller must clean up all preceding floors.
  */
 int pb_sq_house_layout_floor(char const** rooms, pb_hashmap* room_specs, pb_floor* floor, size_t num_rooms,
-                             pb_rect* floor_rect, int should_swap_room0);
+                             pb_rect* floor_rect, int should_swap_room0, pb_arena* arena);
 
 /**
  * Fills in any remaining space after pb_squarify has run.
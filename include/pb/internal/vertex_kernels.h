@@ -0,0 +1,125 @@
+#ifndef PB_VERTEX_KERNELS_H
+#define PB_VERTEX_KERNELS_H
+
+#include <stddef.h>
+#include <pb/util/geom/types.h>
+#include <pb/extrusion.h>
+
+/*
+ * Kernels that fill in batches of pb_vert3D for extrusion. Each kernel has a vectorised version, which uses AVX when
+ * the library is built with it (see PB_USE_AVX) and SSE2 otherwise, and a scalar version that is used on other
+ * architectures. Both versions produce bit-identical vertices.
+ *
+ * The pb_write_ functions produce the same vertices, but write each attribute straight into a pb_vertex_layout in the
+ * attribute's format instead of building pb_vert3Ds. They are scalar, since the layout isn't known until run time.
+ */
+
+/**
+ * The corners of an axis-aligned quad standing on its bottom edge, such as a wall. The quad's vertices are
+ * (start, bottom), (end, top), (start, top), (start, bottom), (end, bottom), (end, top).
+ *
+ * start_x, start_z: The position of the quad's start edge.
+ * end_x, end_z:     The position of the quad's end edge.
+ * bottom, top:      The heights of the bottom and top edges.
+ * nx, nz:           The quad's normal (which is horizontal).
+ * start_u, end_u:   The u coordinates of the start and end edges.
+ * bottom_v, top_v:  The v coordinates of the bottom and top edges.
+ */
+typedef struct {
+    float start_x, start_z;
+    float end_x, end_z;
+    float bottom, top;
+    float nx, nz;
+    float start_u, end_u;
+    float bottom_v, top_v;
+} pb_quad_verts;
+
+/**
+ * Fills in the six vertices of a quad.
+ *
+ * @param q   The quad.
+ * @param out Holds 6 vertices.
+ */
+void pb_fill_quad_verts(pb_quad_verts const* q, pb_vert3D* out);
+void pb_fill_quad_verts_scalar(pb_quad_verts const* q, pb_vert3D* out);
+
+/**
+ * Fills in the vertices of a horizontal surface (a floor or ceiling) from a triangulation of its outline.
+ * Vertex i is made from points[indices[i]] (or points[indices[num_verts - 1 - i]] if reversed, which flips the
+ * winding), with:
+ *   x = point.x - centre.x, y = 0, z = centre.y - point.y, normal = (0, ny, 0),
+ *   u = (point.x - uv_start.x) / uv_size.x, v = (point.y - uv_start.y) / uv_size.y
+ *
+ * @param points    The outline's points.
+ * @param indices   The triangulation, num_verts indices into points.
+ * @param num_verts The number of vertices to fill in.
+ * @param reverse   Whether to go through the indices backwards.
+ * @param centre    The point that the vertices are relative to.
+ * @param uv_start  The point at which u and v are 0.
+ * @param uv_size   How far u and v have to go to get to 1.
+ * @param ny        The y component of the normal.
+ * @param out       Holds num_verts vertices.
+ */
+void pb_fill_surface_verts(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                           pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                           float ny, pb_vert3D* out);
+void pb_fill_surface_verts_scalar(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                                  pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                                  float ny, pb_vert3D* out);
+
+/**
+ * Writes the six vertices of a quad into a layout, as pb_fill_quad_verts would fill them in.
+ *
+ * @param q      The quad.
+ * @param layout The layout to write to.
+ * @param first  The index of the vertex at which to start writing.
+ */
+void pb_write_quad_verts(pb_quad_verts const* q, pb_vertex_layout const* layout, size_t first);
+
+/**
+ * Writes the vertices of a horizontal surface into a layout, as pb_fill_surface_verts would fill them in.
+ *
+ * @param layout The layout to write to.
+ * @param first  The index of the vertex at which to start writing.
+ * See pb_fill_surface_verts for the other parameters.
+ */
+void pb_write_surface_verts(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                            pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                            float ny, pb_vertex_layout const* layout, size_t first);
+
+/**
+ * Converts vertices that have already been built into a layout. This is only for vertices that come from elsewhere,
+ * such as a door or window extruder that can't write to a layout itself.
+ *
+ * @param verts     The vertices.
+ * @param num_verts The number of vertices.
+ * @param layout    The layout to write to.
+ * @param first     The index of the vertex at which to start writing.
+ */
+void pb_write_verts(pb_vert3D const* verts, size_t num_verts, pb_vertex_layout const* layout, size_t first);
+
+/**
+ * Computes the bounds of a quad's vertices from its corners, as pb_shape3D_get_bounds would from the vertices that
+ * pb_fill_quad_verts fills in.
+ *
+ * @param q      The quad.
+ * @param pos    The position of the quad's shape.
+ * @param bounds Holds the bounds.
+ */
+void pb_get_quad_bounds(pb_quad_verts const* q, pb_point3D const* pos, pb_bounds3D* bounds);
+
+/**
+ * Computes the bounds of a horizontal surface from its outline, as pb_shape3D_get_bounds would from the vertices that
+ * pb_fill_surface_verts fills in. A triangulation of the outline uses every one of its points, so the outline has
+ * the same bounds as the vertices.
+ *
+ * @param points     The outline's points.
+ * @param num_points The number of points, which may be 0 for a surface with no vertices.
+ * @param centre     The point that the vertices are relative to.
+ * @param pos        The position of the surface's shape.
+ * @param bounds     Holds the bounds.
+ */
+void pb_get_surface_bounds(pb_point2D const* points, size_t num_points, pb_point2D const* centre,
+                           pb_point3D const* pos, pb_bounds3D* bounds);
+
+#endif /* PB_VERTEX_KERNELS_H */
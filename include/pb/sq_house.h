@@ -3,8 +3,11 @@
 
 #include <pb/exports.h>
 #include <pb/floor_plan.h>
+#include <pb/extrusion.h>
 #include <pb/util/hashmap/hashmap.h>
 #include <pb/util/geom/types.h>
+#include <pb/util/rng/rng.h>
+#include <pb/util/thread_pool/thread_pool.h>
 
 #include <stddef.h>
 #include <stdint.h>
@@ -58,8 +61,84 @@ typedef struct {
     float window_size;
 } pb_sq_house_house_spec;
 
+/**
+ * Generates a house using the C library's rand(); seed it with srand for repeatable output. Equivalent to calling
+ * pb_sq_house_ex with a generator seeded from rand().
+ *
+ * @param house_spec The specifications for the house.
+ * @param room_specs A map of room names => pb_sq_house_room_spec* for every room that can appear in the house.
+ * @return The generated building on success, NULL on failure.
+ */
 PB_DECLSPEC pb_building* PB_CALL pb_sq_house(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs);
 
+/**
+ * Generates a house using the given random number generator. No global state is touched, so any number of houses may
+ * be generated concurrently as long as each call has its own generator.
+ *
+ * Each call draws a single value from rng to key the house, then derives an independent stream for each stage of the
+ * algorithm (room selection and stair layout) with pb_rng_split. The output therefore depends only on the
+ * state of rng when the call is made, and successive calls with the same generator produce different houses.
+ *
+ * The house is allocated from an arena as it's generated (see pb_building's arena member), so pb_building_free releases
+ * it in one call. Its rooms and floors must not be freed individually, and its shape and wall vectors can't be grown.
+ *
+ * @param house_spec The specifications for the house.
+ * @param room_specs A map of room names => pb_sq_house_room_spec* for every room that can appear in the house.
+ * @param rng        The generator from which the house is keyed. It is advanced by one value.
+ * @return The generated building on success, NULL on failure.
+ */
+PB_DECLSPEC pb_building* PB_CALL pb_sq_house_ex(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs, pb_rng* rng);
+
+/**
+ * Generates a house in the same way as pb_sq_house_ex, but once the stairs have been placed, lays out each floor
+ * (rooms, hallways, doors and windows) as a separate task on the given pool. Floors share no state, so the result is
+ * identical to pb_sq_house_ex's for the same generator, and a house takes about as long as its most expensive floor.
+ *
+ * @param house_spec The specifications for the house.
+ * @param room_specs A map of room names => pb_sq_house_room_spec* for every room that can appear in the house.
+ * @param rng        The generator from which the house is keyed. It is advanced by one value.
+ * @param pool       The pool on which to lay out the floors. If NULL, they are laid out on the calling thread.
+ * @return The generated building on success, NULL on failure.
+ */
+PB_DECLSPEC pb_building* PB_CALL pb_sq_house_parallel(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs,
+                                                      pb_rng* rng, pb_thread_pool* pool);
+
+/**
+ * The extrusion settings used by pb_sq_house_batch. See pb_extrude_building for a description of each member.
+ */
+typedef struct {
+    float floor_height;
+    float door_height;
+    float window_height;
+    pb_wall_structure_extruder const* door_extruder;
+    pb_wall_structure_extruder const* window_extruder;
+    void* door_extruder_param;
+    void* window_extruder_param;
+} pb_sq_house_batch_extrusion;
+
+/**
+ * Generates (and optionally extrudes) a batch of houses in parallel on a work-stealing pool with one worker per
+ * hardware thread. House i is generated by pb_sq_house_ex with a generator seeded from seeds[i], so the output for
+ * each house depends only on its spec and seed, regardless of how the work is scheduled.
+ *
+ * Each house in out_buildings must be freed with pb_building_free and free, and each mesh in out_meshes with
+ * pb_extruded_building_free.
+ *
+ * @param specs         The specification for each house (n elements).
+ * @param room_specs    A map of room names => pb_sq_house_room_spec* shared by all houses. It isn't modified.
+ * @param seeds         The seed for each house (n elements).
+ * @param n             The number of houses to generate.
+ * @param extrusion     The settings with which to extrude each house. May be NULL if out_meshes is NULL.
+ * @param out_buildings Out: the generated houses (n elements). An element is NULL if that house failed.
+ * @param out_meshes    Out: the extruded houses (n elements). An element is NULL if that house failed, in which case
+ *                      the corresponding building is freed and also set to NULL. Pass NULL to skip extrusion.
+ * @return 0 if every house was generated, -1 if at least one failed or out_meshes was given without extrusion
+ *         (in which case nothing is generated).
+ */
+PB_DECLSPEC int PB_CALL pb_sq_house_batch(pb_sq_house_house_spec* specs, pb_hashmap* room_specs, uint64_t const* seeds,
+                                          size_t n, pb_sq_house_batch_extrusion const* extrusion,
+                                          pb_building** out_buildings, pb_extruded_floor*** out_meshes);
+
 /* Hooks for freeing building data. Currently, these do nothing since the algorithm allocates no metadata. */
 PB_DECLSPEC void PB_CALL pb_sq_house_free_room(pb_room const* room);
 PB_DECLSPEC void PB_CALL pb_sq_house_free_floor(pb_floor const* f);
@@ -0,0 +1,86 @@
+#ifndef PB_ARENA_H
+#define PB_ARENA_H
+
+#include <stddef.h>
+#include <pb/util/util_exports.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The alignment of every allocation made from an arena */
+#define PB_ARENA_ALIGNMENT 16
+
+typedef struct pb_arena_block pb_arena_block;
+
+/**
+ * A growable region of memory from which allocations are made by bumping a pointer. Individual allocations can't be
+ * freed; instead, the whole arena is released at once. When the current block is full, a new block at least twice
+ * its size is chained on, so the number of blocks stays logarithmic in the total size.
+ */
+typedef struct {
+    pb_arena_block* head;    /* The block currently being allocated from */
+    size_t next_block_size;  /* The minimum size of the next block to be allocated */
+} pb_arena;
+
+/**
+ * Creates an arena. The arena and its first block are allocated together, so an arena whose contents fit within
+ * init_size requires exactly one allocation.
+ *
+ * @param init_size The size (in chars) of the first block. Pass 0 to use a default size.
+ * @return The new arena on success, NULL on failure (out of memory).
+ */
+PB_UTIL_DECLSPEC pb_arena* PB_UTIL_CALL pb_arena_create(size_t init_size);
+
+/**
+ * Allocates memory from the arena. The memory is aligned to PB_ARENA_ALIGNMENT and is valid until the arena is
+ * reset or freed.
+ *
+ * @param arena The arena from which to allocate.
+ * @param size  The number of chars to allocate.
+ * @return A pointer to the allocated memory on success, NULL on failure (out of memory).
+ */
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_arena_alloc(pb_arena* arena, size_t size);
+
+/**
+ * Resizes an allocation made from the arena. The most recent allocation is grown in place if its block has room;
+ * otherwise a new allocation is made and the old contents are copied into it. The old memory isn't reclaimed until the
+ * arena is reset or freed. Shrinking an allocation returns it unchanged.
+ *
+ * @param arena    The arena from which ptr was allocated.
+ * @param ptr      The allocation to resize. If NULL, this is equivalent to pb_arena_alloc.
+ * @param old_size The size (in chars) with which ptr was allocated.
+ * @param size     The new size (in chars).
+ * @return A pointer to the resized allocation on success, NULL on failure (out of memory), in which case ptr is still
+ *         valid.
+ */
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_arena_realloc(pb_arena* arena, void* ptr, size_t old_size, size_t size);
+
+/**
+ * Moves everything allocated from src into dst, so that it's released along with dst. src must not be used afterwards
+ * (not even to free it). No memory is allocated or copied; dst continues allocating from src's most recent block.
+ *
+ * @param dst The arena that takes ownership of src's memory.
+ * @param src The arena to merge into dst.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_merge(pb_arena* dst, pb_arena* src);
+
+/**
+ * Releases everything allocated from the arena while keeping its first block for reuse.
+ *
+ * @param arena The arena to reset.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_reset(pb_arena* arena);
+
+/**
+ * Frees the arena and everything allocated from it.
+ *
+ * @param arena The arena to free.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_free(pb_arena* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PB_ARENA_H */
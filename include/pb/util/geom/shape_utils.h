@@ -37,7 +37,7 @@ PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_shape2D_free(pb_shape2D* shape);
 PB_UTIL_DECLSPEC pb_shape3D* pb_shape3D_create(unsigned int num_tris);
 
 /**
- * Initialises the given shape to have num_tris.
+ * Initialises the given shape to have num_tris. Its bounds are cleared, as they are until something fills them in.
  *
  * @param shape    The shape to initialise.
  * @param num_tris The number of triangles that the shape should have.
@@ -53,6 +53,89 @@ PB_UTIL_DECLSPEC int pb_shape3D_init(pb_shape3D* shape, unsigned int num_points)
  */
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_shape3D_free(pb_shape3D* shape);
 
+/**
+ * Sets bounds to contain nothing, ready for pb_bounds3D_add_point.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_bounds3D_clear(pb_bounds3D* bounds);
+
+/**
+ * Grows the box of the given bounds to contain a point. The sphere is left alone.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_bounds3D_add_point(pb_bounds3D* bounds, pb_point3D const* p);
+
+/**
+ * Computes the bounds of a shape's triangles, offset by its position. The sphere is centred on the box, with the
+ * smallest radius that contains every vertex.
+ *
+ * @param shape  The shape.
+ * @param bounds Holds the bounds.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_shape3D_get_bounds(pb_shape3D const* shape, pb_bounds3D* bounds);
+
+/**
+ * Welds coincident vertices into an indexed vertex buffer. Two vertices are welded when their positions, normals and
+ * uvs are all equal according to pb_float_approx_eq with the given fuzz_bits (positive and negative zero are treated
+ * as equal). Unique vertices are written in the order in which they first appear.
+ *
+ * @param verts         The vertices to weld, e.g. the tris of a pb_shape3D.
+ * @param num_verts     The number of vertices in verts.
+ * @param fuzz_bits     The number of bits to ignore at the end of each component's mantissa.
+ * @param out_verts     Out: the unique vertices. Must have room for num_verts vertices.
+ * @param out_indices   Out: the index in out_verts of each vertex in verts (num_verts elements), as uint16_t if
+ *                      index_size is 2 or uint32_t if it's 4.
+ * @param index_size    The size of each index in bytes: 2 or 4. If it's 2, num_verts can't exceed 65536.
+ * @param out_num_verts Out: the number of unique vertices.
+ * @return 0 on success, -1 on failure (out of memory or an invalid index size).
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_weld_verts(pb_vert3D const* verts, size_t num_verts, size_t fuzz_bits,
+                                                pb_vert3D* out_verts, void* out_indices, size_t index_size,
+                                                size_t* out_num_verts);
+
+/**
+ * Counts the misses in a FIFO post-transform vertex cache when drawing an indexed triangle list. Dividing the result
+ * by the number of triangles gives the average cache miss ratio (ACMR), which ranges from 0.5 at best to 3 at worst.
+ *
+ * @param indices     The triangle list's indices, as uint16_t if index_size is 2 or uint32_t if it's 4.
+ * @param num_indices The number of indices (three per triangle).
+ * @param index_size  The size of each index in bytes: 2 or 4.
+ * @param num_verts   The number of vertices referred to by the indices.
+ * @param cache_size  The number of vertices held by the cache.
+ * @param out_misses  Out: the number of cache misses.
+ * @return 0 on success, -1 on out of memory.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_vertex_cache_misses(void const* indices, size_t num_indices, size_t index_size,
+                                                         size_t num_verts, size_t cache_size, size_t* out_misses);
+
+/**
+ * Reorders the triangles of an indexed triangle list to improve post-transform vertex cache locality, using the
+ * Tipsify algorithm from Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007).
+ * Each triangle keeps its winding.
+ *
+ * @param indices     The triangle list's indices, as uint16_t if index_size is 2 or uint32_t if it's 4. They're
+ *                    reordered in place.
+ * @param num_indices The number of indices (three per triangle).
+ * @param index_size  The size of each index in bytes: 2 or 4.
+ * @param num_verts   The number of vertices referred to by the indices.
+ * @param cache_size  The number of vertices held by the cache being optimised for.
+ * @return 0 on success, -1 on out of memory.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_optimize_vertex_cache(void* indices, size_t num_indices, size_t index_size,
+                                                           size_t num_verts, size_t cache_size);
+
+/**
+ * Reorders vertices so that they're stored in the order in which an indexed triangle list first uses them, which
+ * improves locality when the GPU fetches them. Unused vertices are moved to the end. The indices are updated to match.
+ *
+ * @param verts       The vertices to reorder in place.
+ * @param num_verts   The number of vertices.
+ * @param indices     The triangle list's indices, as uint16_t if index_size is 2 or uint32_t if it's 4.
+ * @param num_indices The number of indices.
+ * @param index_size  The size of each index in bytes: 2 or 4.
+ * @return 0 on success, -1 on out of memory.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_optimize_vertex_fetch(pb_vert3D* verts, size_t num_verts, void* indices,
+                                                           size_t num_indices, size_t index_size);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -55,6 +55,18 @@ typedef struct {
     float v;
 } pb_vert3D;
 
+/**
+ * An axis-aligned bounding box and a bounding sphere around the same geometry. Bounds that contain nothing have min
+ * set to INFINITY, max set to -INFINITY and a radius of 0.
+ */
+typedef struct {
+    pb_point3D min;
+    pb_point3D max;
+
+    pb_point3D centre;
+    float radius;
+} pb_bounds3D;
+
 typedef struct {
     /* A buffer of triangles. Winding order is CCW. */
     pb_vert3D* tris;
@@ -64,6 +76,9 @@ typedef struct {
 
     /* This shape's position relative to some origin. */
     pb_point3D pos;
+
+    /* The shape's bounds, relative to the same origin as pos. Only filled in by functions that say so. */
+    pb_bounds3D bounds;
 } pb_shape3D;
 
 #ifdef __cplusplus
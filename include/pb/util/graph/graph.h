@@ -22,6 +22,8 @@
 #include <stddef.h>
 #include <pb/util/util_exports.h>
 #include <pb/util/hashmap/hashmap.h>
+#include <pb/util/hashmap/ordered_map.h>
+#include <pb/util/hashmap/typed_map.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -95,11 +97,35 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_vertex_add_edge(pb_vertex *vert, pb_edge* e
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_vertex_remove_edge(pb_vertex *vert, pb_edge* edge);
 
 /**
- * A graph, which is basically a collection of vertices and adjacency lists.
+ * Identifies an edge by the vertices that it connects.
  */
 typedef struct {
-    pb_hashmap* vertices;
-    pb_hashmap* edges;
+    pb_vertex const* from;
+    pb_vertex const* to;
+} pb_edge_key;
+
+PB_UTIL_INLINE uint32_t pb_edge_key_hash(pb_edge_key key) {
+    return pb_mix_ptr(key.from) * 31 + pb_mix_ptr(key.to);
+}
+
+PB_UTIL_INLINE int pb_edge_key_eq(pb_edge_key key1, pb_edge_key key2) {
+    return key1.from == key2.from && key1.to == key2.to;
+}
+
+/* A map of (from, to) vertices => edges. */
+PB_DEFINE_TYPED_MAP(pb_edge_map, pb_edge_key, pb_edge*, pb_edge_key_hash, pb_edge_key_eq)
+
+/* Slabs from which a pooled graph allocates its vertices, edges and edge lists (see pb_graph_create_pooled) */
+typedef struct pb_graph_pool pb_graph_pool;
+
+/**
+ * A graph, which is basically a collection of vertices and adjacency lists. The vertices are kept in the order that
+ * they were added, so iterating over the graph doesn't depend on where the vertices were allocated.
+ */
+typedef struct {
+    pb_ordered_map* vertices;
+    pb_edge_map edges;
+    pb_graph_pool* pool; /* NULL unless the graph was created with pb_graph_create_pooled */
 } pb_graph;
 
 /**
@@ -112,6 +138,20 @@ typedef struct {
  */
 PB_UTIL_DECLSPEC pb_graph* pb_graph_create(pb_hash_func id_hash, pb_hash_eq_func id_eq);
 
+/**
+ * Allocates and initialises a new, empty graph whose vertices, edges and edge lists come from slabs owned by the
+ * graph rather than from individual mallocs. Removed vertices and edges are recycled within the graph, and
+ * everything is released at once by pb_graph_clear or pb_graph_free.
+ *
+ * The graph's vertices must not be passed to pb_vertex_free or pb_vertex_add_edge.
+ *
+ * @param id_hash The hash function to use for vertex ID's.
+ * @param id_eq   The equality function to use for vertex ID's.
+ *
+ * @return An empty graph or NULL if out of memory.
+ */
+PB_UTIL_DECLSPEC pb_graph* PB_UTIL_CALL pb_graph_create_pooled(pb_hash_func id_hash, pb_hash_eq_func id_eq);
+
 /**
  * Adds a vertex to the graph.
  * @param graph   The graph to which the vertex will be added.
@@ -210,6 +250,14 @@ PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_free_vertex_data(void const* vert_id
  */
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_free_edge_data(pb_edge const* edge, void* unused);
 
+/**
+ * Removes every vertex and edge from the graph, leaving it empty but ready for reuse. Vertex and edge data aren't
+ * freed (see pb_graph_free_vertex_data and pb_graph_free_edge_data).
+ *
+ * @param graph The graph to clear.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_clear(pb_graph* graph);
+
 /**
  * Frees the graph and its vertices.
  * The graph will be unusable after this operation.
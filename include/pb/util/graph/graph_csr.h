@@ -0,0 +1,104 @@
+#ifndef PB_GRAPH_CSR_H
+#define PB_GRAPH_CSR_H
+
+#include <stddef.h>
+#include <pb/util/util_exports.h>
+#include <pb/util/graph/graph.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Returned by pb_graph_csr_get_index and pb_graph_csr_get_edge when there's no such vertex or edge. */
+#define PB_GRAPH_CSR_NONE ((size_t)-1)
+
+/**
+ * An immutable, compressed sparse row copy of a pb_graph's structure. Vertices are numbered 0 to num_vertices - 1 in
+ * the order that they were added to the graph, and vertex i's out-edges are edges edge_offsets[i] up to (but not
+ * including) edge_offsets[i + 1], in the order that they were added. Each edge is spread across edge_targets,
+ * edge_weights and edge_data, so walking a vertex's neighbours reads a few contiguous lists rather than following
+ * pointers.
+ *
+ * The view doesn't own the vertices' IDs or data, nor the edges' data; those still belong to the graph. Changing the
+ * graph afterwards doesn't change the view.
+ */
+typedef struct {
+    size_t       num_vertices;
+    size_t       num_edges;
+    void const** vert_ids;     /* The ID of each vertex. */
+    void**       vert_data;    /* The data of each vertex. */
+    size_t*      edge_offsets; /* num_vertices + 1 offsets into the edge lists. */
+    size_t*      edge_targets; /* The index of the vertex that each edge goes to. */
+    float*       edge_weights; /* The weight of each edge. */
+    void**       edge_data;    /* The data of each edge. */
+    pb_hashmap*  id_index;     /* A map of vertex IDs => pointers into vert_ids. */
+} pb_graph_csr;
+
+/*
+ * Function type for processing each vertex in a frozen graph. Use with pb_graph_csr_for_each_vertex.
+ */
+typedef void(*pb_graph_csr_vertex_func)(pb_graph_csr const* graph, size_t vert, void* param);
+
+/*
+ * Function type for processing each edge in a frozen graph. Use with pb_graph_csr_for_each_edge.
+ */
+typedef void(*pb_graph_csr_edge_func)(pb_graph_csr const* graph, size_t from, size_t edge, void* param);
+
+/**
+ * Builds a compressed sparse row view of the graph, for read-heavy work once the graph has been built.
+ *
+ * @param graph The graph to freeze.
+ * @return The frozen graph, or NULL if out of memory.
+ */
+PB_UTIL_DECLSPEC pb_graph_csr* PB_UTIL_CALL pb_graph_freeze(pb_graph const* graph);
+
+/**
+ * Frees a frozen graph. The original graph is left alone.
+ *
+ * @param graph The frozen graph to free.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_free(pb_graph_csr* graph);
+
+/**
+ * Gets the index of the vertex with the given ID.
+ *
+ * @param graph   The frozen graph.
+ * @param vert_id The vertex's ID in the original graph.
+ * @return The vertex's index, or PB_GRAPH_CSR_NONE if there's no such vertex.
+ */
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_graph_csr_get_index(pb_graph_csr const* graph, void const* vert_id);
+
+/**
+ * Gets the index of the edge from one vertex to another.
+ *
+ * @param graph The frozen graph.
+ * @param from  The index of the edge's start vertex.
+ * @param to    The index of the edge's end vertex.
+ * @return The edge's index, or PB_GRAPH_CSR_NONE if there's no such edge.
+ */
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_graph_csr_get_edge(pb_graph_csr const* graph, size_t from, size_t to);
+
+/**
+ * Calls the given function on every vertex in the frozen graph, in index order.
+ *
+ * @param graph The frozen graph.
+ * @param func  The function to call for every vertex.
+ * @param param The (optional) parameter to supply to the given function.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_for_each_vertex(pb_graph_csr const* graph,
+                                                               pb_graph_csr_vertex_func func, void* param);
+
+/**
+ * Calls the given function on every edge in the frozen graph, grouped by start vertex in index order.
+ *
+ * @param graph The frozen graph.
+ * @param func  The function to call for every edge.
+ * @param param The (optional) parameter to supply to the given function.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_for_each_edge(pb_graph_csr const* graph, pb_graph_csr_edge_func func,
+                                                             void* param);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PB_GRAPH_CSR_H */
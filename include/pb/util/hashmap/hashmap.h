@@ -4,16 +4,14 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <pb/util/util_exports.h>
+#include <pb/util/hashmap/map_ctrl.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-typedef enum pb_hashmap_entry_state {
-    EMPTY,
-    DELETED,
-    FULL
-} pb_hashmap_entry_state;
+/* The number of control bytes that are checked at once when probing. */
+#define PB_HASHMAP_GROUP_WIDTH PB_MAP_GROUP_WIDTH
 
 typedef uint32_t (*pb_hash_func)(void const*);
 
@@ -25,14 +23,22 @@ typedef struct {
     void* val;   /* The value stored with this key. */
 } pb_hashmap_entry;
 
+/**
+ * An open addressing hash map. Each entry has a control byte, which is either empty, deleted, or (for full entries)
+ * 7 bits of the key's hash (see map_ctrl.h). Probing checks PB_HASHMAP_GROUP_WIDTH control bytes at once (with SSE2
+ * where it's available) and only calls key_eq on entries whose hash bits match.
+ *
+ * For maps whose key type is known up front, PB_DEFINE_TYPED_MAP makes maps that don't call through function pointers.
+ */
 typedef struct {
-    pb_hashmap_entry*       entries;    /* A list of entries in the map. */
-    pb_hashmap_entry_state* states;     /* Stores the state (EMPTY, DELETED, FULL) of the corresponding entry in the entries array. */
-    size_t                  cap;        /* The entry list's capacity. */
-	size_t                  expand_num; /* The size after which the hash map will expand (determined by load factor). */
-    size_t                  size;       /* The number of items actually in the list. */
-    pb_hash_func            hash;       /* The function for computing a key's hash value. */
-    pb_hash_eq_func         key_eq;     /* The function to compare keys for equality. */
+    pb_hashmap_entry* entries;     /* A list of entries in the map. */
+    uint8_t*          ctrl;        /* The control bytes, cap of them followed by copies of the first PB_HASHMAP_GROUP_WIDTH so that groups never wrap. */
+    size_t            cap;         /* The entry list's capacity. Always a power of two. */
+    size_t            expand_num;  /* The number of full and deleted entries after which the map will be rehashed (determined by load factor). */
+    size_t            size;        /* The number of items actually in the list. */
+    size_t            num_deleted; /* The number of entries marked as deleted. */
+    pb_hash_func      hash;        /* The function for computing a key's hash value. */
+    pb_hash_eq_func   key_eq;      /* The function to compare keys for equality. */
 } pb_hashmap;
 
 /* Used to iterate over the hash map's entries. */
@@ -85,7 +91,8 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_hashmap_put(pb_hashmap* map, void const* ke
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_hashmap_get(pb_hashmap* map, void const* key, void** out);
 
 /**
- * Removes the item associated with the given key from the map (if it's there).
+ * Removes the item associated with the given key from the map (if it's there). If the map becomes mostly empty, it
+ * shrinks, so entries must not be removed while iterating over the map.
  * 
  * @param map The map from which the item will be removed.
  * @param key The key associated with the item to remove.
@@ -93,6 +100,23 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_hashmap_get(pb_hashmap* map, void const* ke
  */
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_hashmap_remove(pb_hashmap* map, void const* key);
 
+/**
+ * Grows the map so that it can hold at least num_items items without being rehashed. Removing items may shrink it
+ * again.
+ *
+ * @param map       The map to grow.
+ * @param num_items The number of items that the map should be able to hold.
+ * @return 0 on success, -1 on OOM.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_hashmap_reserve(pb_hashmap* map, size_t num_items);
+
+/**
+ * Removes every item from the map (without freeing them), keeping its capacity.
+ *
+ * @param map The map to clear.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_hashmap_clear(pb_hashmap* map);
+
 /**
  * Calls the specified function on every entry in the hash map.
  *
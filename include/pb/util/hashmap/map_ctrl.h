@@ -0,0 +1,318 @@
+#ifndef PB_MAP_CTRL_H
+#define PB_MAP_CTRL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <pb/util/util_exports.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PB_MAP_CTRL_SSE2
+#endif
+
+/*
+ * The pieces shared by pb_hashmap, pb_ordered_map and the maps made by PB_DEFINE_TYPED_MAP. Every entry has a control
+ * byte, which is either empty, deleted, or (for full entries) the top 7 bits of the key's hash. The control bytes are
+ * followed by a copy of the first PB_MAP_GROUP_WIDTH of them, so a group can be loaded from any entry without wrapping.
+ *
+ * The maps keep their entries in whatever form suits them, so the probing helpers below see them as a list of
+ * entries that are stride chars apart and use callbacks to compare and hash them. The callbacks are usually known at
+ * compile time, so they get inlined along with the helpers.
+ */
+
+/* The number of control bytes that are checked at once when probing. */
+#define PB_MAP_GROUP_WIDTH 16
+
+/* Every map has at least one group's worth of entries, so that a group never covers an entry twice. */
+#define PB_MAP_MIN_CAP PB_MAP_GROUP_WIDTH
+
+#define PB_MAP_CTRL_EMPTY   0x80
+#define PB_MAP_CTRL_DELETED 0xFE
+
+/* Returned by pb_map_find when a key isn't in the map. */
+#define PB_MAP_NO_SLOT ((size_t)-1)
+
+/* Compares the key held by an entry with the given key; non-zero when they're equal. ctx is the map. */
+typedef int (*pb_map_entry_eq_func)(void const* ctx, void const* entry, void const* key);
+
+/* Gets the mixed hash of the key held by an entry. ctx is the map. */
+typedef uint32_t (*pb_map_entry_hash_func)(void const* ctx, void const* entry);
+
+PB_UTIL_INLINE int pb_map_ctrl_is_full(uint8_t ctrl) {
+    return !(ctrl & 0x80);
+}
+
+/* Gets the bits of a (mixed) hash that are stored in a full entry's control byte. */
+PB_UTIL_INLINE uint8_t pb_map_hash_bits(uint32_t hash) {
+    return (uint8_t)(hash >> 25);
+}
+
+/**
+ * Gets the number of full and deleted entries that a map with the given capacity can hold before it's rehashed.
+ * This is a load factor of 7/8; since probing checks a whole group at once, long probe sequences are cheap.
+ */
+PB_UTIL_INLINE size_t pb_map_expand_num(size_t cap) {
+    return cap - cap / 8;
+}
+
+/* Gets a mask with bit i set for each byte group[i] that's equal to b. */
+PB_UTIL_INLINE unsigned pb_map_match_byte(uint8_t const* group, uint8_t b) {
+#if defined(PB_MAP_CTRL_SSE2)
+    __m128i ctrl = _mm_loadu_si128((__m128i const*)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)b)));
+#else
+    unsigned mask = 0;
+    unsigned i;
+    for (i = 0; i < PB_MAP_GROUP_WIDTH; ++i) {
+        mask |= (unsigned)(group[i] == b) << i;
+    }
+    return mask;
+#endif
+}
+
+/* Gets a mask with bit i set for each entry in the group that's empty or deleted. */
+PB_UTIL_INLINE unsigned pb_map_match_free(uint8_t const* group) {
+#if defined(PB_MAP_CTRL_SSE2)
+    return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((__m128i const*)group));
+#else
+    unsigned mask = 0;
+    unsigned i;
+    for (i = 0; i < PB_MAP_GROUP_WIDTH; ++i) {
+        mask |= (unsigned)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+PB_UTIL_INLINE unsigned pb_map_lowest_bit(unsigned mask) {
+#if defined(__GNUC__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned i = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+PB_UTIL_INLINE unsigned pb_map_highest_bit(unsigned mask) {
+    unsigned i = 0;
+    while (mask >>= 1) {
+        ++i;
+    }
+    return i;
+}
+
+/* Fills in a new list of control bytes for a map with the given capacity. */
+PB_UTIL_INLINE void pb_map_clear_ctrl(uint8_t* ctrl, size_t cap) {
+    memset(ctrl, PB_MAP_CTRL_EMPTY, cap + PB_MAP_GROUP_WIDTH);
+}
+
+/* Sets the control byte for entry i, along with its copy at the end if it has one. */
+PB_UTIL_INLINE void pb_map_set_ctrl(uint8_t* ctrl, size_t cap, size_t i, uint8_t c) {
+    ctrl[i] = c;
+    if (i < PB_MAP_GROUP_WIDTH) {
+        ctrl[cap + i] = c;
+    }
+}
+
+/**
+ * Finds the first empty or deleted entry along a hash's probe sequence. Groups are probed quadratically, which
+ * visits every group since the capacity is a power of two.
+ */
+PB_UTIL_INLINE size_t pb_map_find_free(uint8_t const* ctrl, size_t cap, uint32_t hash) {
+    size_t mask = cap - 1;
+    size_t pos = hash & mask;
+    size_t stride;
+
+    for (stride = 0; ; stride += PB_MAP_GROUP_WIDTH, pos = (pos + stride) & mask) {
+        unsigned free_entries = pb_map_match_free(ctrl + pos);
+        if (free_entries) {
+            return (pos + pb_map_lowest_bit(free_entries)) & mask;
+        }
+    }
+}
+
+/**
+ * Marks a free entry as full with the given hash.
+ *
+ * @return 1 if the entry had been marked as deleted, 0 if it was empty.
+ */
+PB_UTIL_INLINE int pb_map_fill_ctrl(uint8_t* ctrl, size_t cap, size_t pos, uint32_t hash) {
+    int was_deleted = ctrl[pos] == PB_MAP_CTRL_DELETED;
+    pb_map_set_ctrl(ctrl, cap, pos, pb_map_hash_bits(hash));
+    return was_deleted;
+}
+
+/**
+ * Finds the entry holding the given key.
+ *
+ * @param ctrl    The map's control bytes.
+ * @param cap     The map's capacity.
+ * @param hash    The key's mixed hash.
+ * @param entries The map's entries.
+ * @param stride  The distance between entries in chars.
+ * @param eq      Compares an entry's key with key.
+ * @param ctx     Passed to eq.
+ * @param key     The key for which to search.
+ * @return The key's position, or PB_MAP_NO_SLOT if the key wasn't found.
+ */
+PB_UTIL_INLINE size_t pb_map_find(uint8_t const* ctrl, size_t cap, uint32_t hash, void const* entries, size_t stride,
+                                  pb_map_entry_eq_func eq, void const* ctx, void const* key) {
+    size_t mask = cap - 1;
+    size_t pos = hash & mask;
+    uint8_t hash_bits = pb_map_hash_bits(hash);
+    size_t stride_groups;
+
+    for (stride_groups = 0; stride_groups <= cap;
+         stride_groups += PB_MAP_GROUP_WIDTH, pos = (pos + stride_groups) & mask) {
+        uint8_t const* group = ctrl + pos;
+        unsigned matches = pb_map_match_byte(group, hash_bits);
+
+        for (; matches; matches &= matches - 1) {
+            size_t i = (pos + pb_map_lowest_bit(matches)) & mask;
+            if (eq(ctx, (char const*)entries + i * stride, key)) {
+                return i;
+            }
+        }
+
+        /* The key would have been put in the first empty entry along the way, so it's not here */
+        if (pb_map_match_byte(group, PB_MAP_CTRL_EMPTY)) {
+            break;
+        }
+    }
+
+    return PB_MAP_NO_SLOT;
+}
+
+/**
+ * Fills in the control bytes for a new key in a map that's being rebuilt, which has no deleted entries.
+ *
+ * @return The key's position.
+ */
+PB_UTIL_INLINE size_t pb_map_insert_new(uint8_t* ctrl, size_t cap, uint32_t hash) {
+    size_t pos = pb_map_find_free(ctrl, cap, hash);
+    pb_map_set_ctrl(ctrl, cap, pos, pb_map_hash_bits(hash));
+    return pos;
+}
+
+/**
+ * Moves every full entry from one list into a new, empty one with its own control bytes, which also gets rid of the
+ * deleted entries.
+ *
+ * @param new_ctrl    The new list's control bytes, all empty.
+ * @param new_cap     The new list's capacity.
+ * @param new_entries The new list.
+ * @param ctrl        The current control bytes.
+ * @param cap         The current capacity.
+ * @param entries     The current list.
+ * @param stride      The distance between entries in chars.
+ * @param hash        Gets an entry's mixed hash.
+ * @param ctx         Passed to hash.
+ */
+PB_UTIL_INLINE void pb_map_rehash(uint8_t* new_ctrl, size_t new_cap, void* new_entries,
+                                  uint8_t const* ctrl, size_t cap, void const* entries, size_t stride,
+                                  pb_map_entry_hash_func hash, void const* ctx) {
+    size_t i;
+    for (i = 0; i < cap; ++i) {
+        if (pb_map_ctrl_is_full(ctrl[i])) {
+            void const* entry = (char const*)entries + i * stride;
+            size_t pos = pb_map_insert_new(new_ctrl, new_cap, hash(ctx, entry));
+            memcpy((char*)new_entries + pos * stride, entry, stride);
+        }
+    }
+}
+
+/**
+ * Gets the capacity to which a map that has run out of entries should be rehashed. If the map is mostly deleted
+ * entries, clearing those out (by rehashing at the same capacity) is enough.
+ */
+PB_UTIL_INLINE size_t pb_map_grow_cap(size_t cap, size_t size, size_t expand_num) {
+    return size + 1 > expand_num / 2 ? cap * 2 : cap;
+}
+
+/**
+ * Gets the capacity to which a map has to be rehashed before putting a new key in the given free entry, since using
+ * up an empty entry may leave too few for probing to stop quickly.
+ *
+ * @return The capacity to rehash to, or 0 if the key can go straight in.
+ */
+PB_UTIL_INLINE size_t pb_map_insert_rehash_cap(uint8_t const* ctrl, size_t cap, size_t pos, size_t size,
+                                               size_t num_deleted, size_t expand_num) {
+    if (ctrl[pos] != PB_MAP_CTRL_EMPTY || size + num_deleted < expand_num) {
+        return 0;
+    }
+
+    return pb_map_grow_cap(cap, size, expand_num);
+}
+
+/* Gets the capacity to which a map should shrink after a removal; maps shrink once they're less than a quarter full. */
+PB_UTIL_INLINE size_t pb_map_shrink_cap(size_t cap, size_t size) {
+    return cap > PB_MAP_MIN_CAP && size < cap / 4 ? cap / 2 : cap;
+}
+
+/* Gets the capacity that a map needs to hold num_items without being rehashed. */
+PB_UTIL_INLINE size_t pb_map_reserve_cap(size_t cap, size_t num_items) {
+    while (pb_map_expand_num(cap) < num_items) {
+        cap *= 2;
+    }
+    return cap;
+}
+
+/**
+ * Marks a full entry as no longer used. If every group that covers the entry also has an empty entry, then no probe
+ * sequence ever went past it without stopping, so it can go straight back to being empty. Otherwise, it has to be
+ * marked as deleted.
+ *
+ * @return 1 if the entry was marked as deleted, 0 if it was marked as empty.
+ */
+PB_UTIL_INLINE int pb_map_erase_ctrl(uint8_t* ctrl, size_t cap, size_t pos) {
+    unsigned empty_after = pb_map_match_byte(ctrl + pos, PB_MAP_CTRL_EMPTY);
+    unsigned empty_before = pb_map_match_byte(ctrl + ((pos - PB_MAP_GROUP_WIDTH) & (cap - 1)), PB_MAP_CTRL_EMPTY);
+
+    if (empty_after && empty_before &&
+        pb_map_lowest_bit(empty_after) + (PB_MAP_GROUP_WIDTH - 1 - pb_map_highest_bit(empty_before)) <
+        PB_MAP_GROUP_WIDTH) {
+        pb_map_set_ctrl(ctrl, cap, pos, PB_MAP_CTRL_EMPTY);
+        return 0;
+    }
+
+    pb_map_set_ctrl(ctrl, cap, pos, PB_MAP_CTRL_DELETED);
+    return 1;
+}
+
+/**
+ * Mixes the bits of a hash (this is MurmurHash3's finaliser). Capacities are powers of two, so only the low bits
+ * choose where a key goes.
+ */
+PB_UTIL_INLINE uint32_t pb_mix32(uint32_t hash) {
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/* Hashes a pointer. Much cheaper than running pb_pointer_hash through MurmurHash3, and uses all of the pointer. */
+PB_UTIL_INLINE uint32_t pb_mix_ptr(void const* p) {
+    uint64_t x = (uint64_t)(uintptr_t)p;
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ULL;
+    x ^= x >> 32;
+    return (uint32_t)x;
+}
+
+/* Hashes a string with FNV-1a, which is quick for short strings like room names. */
+PB_UTIL_INLINE uint32_t pb_mix_str(char const* s) {
+    uint32_t hash = 2166136261u;
+    for (; *s; ++s) {
+        hash = (hash ^ (uint8_t)*s) * 16777619u;
+    }
+    return pb_mix32(hash);
+}
+
+#endif /* PB_MAP_CTRL_H */
@@ -0,0 +1,114 @@
+#ifndef PB_ORDERED_MAP_H
+#define PB_ORDERED_MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pb/util/util_exports.h>
+#include <pb/util/hashmap/hashmap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    pb_hashmap_entry entry;   /* The key and value. */
+    uint32_t         hash;    /* The key's mixed hash, so that the index can be rebuilt without hashing every key. */
+    int              removed; /* Whether the item has been removed from the map. */
+} pb_ordered_map_item;
+
+/**
+ * A hash map that keeps its items in a dense list in the order that they were put into the map, with a separate
+ * index (laid out like pb_hashmap's entries, see map_ctrl.h) holding each item's position in the list. Iterating
+ * over the map only visits the items, in insertion order, so the order doesn't depend on the keys' hashes (which for
+ * pointer keys means their addresses).
+ *
+ * Removed items stay in the list until the index is next rebuilt, at which point the list is compacted.
+ */
+typedef struct {
+    pb_ordered_map_item* items;       /* The items in insertion order, including removed ones. Holds expand_num items. */
+    size_t               num_items;   /* The number of items in the list, including removed ones. */
+    uint32_t*            index;       /* For each full slot, the position of its item in items. */
+    uint8_t*             ctrl;        /* The slots' control bytes, cap of them followed by copies of the first PB_MAP_GROUP_WIDTH. */
+    size_t               cap;         /* The number of slots. Always a power of two. */
+    size_t               expand_num;  /* The number of items after which the index will be rebuilt (determined by load factor). */
+    size_t               size;        /* The number of items actually in the map. */
+    size_t               num_deleted; /* The number of slots marked as deleted. */
+    pb_hash_func         hash;        /* The function for computing a key's hash value. */
+    pb_hash_eq_func      key_eq;      /* The function to compare keys for equality. */
+} pb_ordered_map;
+
+/**
+ * Creates a new, empty ordered map with the given hash and equals functions.
+ * @param hash   A hash function to determine where an item's slot will go.
+ * @param key_eq A function that compares two keys for equality.
+ * @return An empty map with the given hash and equals functions or NULL if out of memory.
+ */
+PB_UTIL_DECLSPEC pb_ordered_map* PB_UTIL_CALL pb_ordered_map_create(pb_hash_func hash, pb_hash_eq_func key_eq);
+
+/**
+ * Frees the given map, but not its contents (the actual keys and values).
+ *
+ * @param map The map to be freed.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_free(pb_ordered_map* map);
+
+/**
+ * Places an item in the map. If there's already a value associated with the given key, it will be over-written (not
+ * freed) and the item keeps its place in the order.
+ *
+ * @param map The map into which to insert the item.
+ * @param key The key to associate with the item.
+ * @param val The item to insert into the map.
+ * @return 0 on success, -1 on OOM.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_put(pb_ordered_map* map, void const* key, void const* val);
+
+/**
+ * Gets the value associated with the given key, if any.
+ *
+ * @param map The map to search for the key.
+ * @param key The key for which to search.
+ * @param out A variable to hold the associated value on success.
+ * @return 0 if the key is found, -1 otherwise.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_get(pb_ordered_map const* map, void const* key, void** out);
+
+/**
+ * Removes the item associated with the given key from the map (if it's there). The other items keep their order.
+ * Items must not be removed while iterating over the map.
+ *
+ * @param map The map from which the item will be removed.
+ * @param key The key associated with the item to remove.
+ * @return 0 if the key was removed, -1 if there was no matching key in the map.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_remove(pb_ordered_map* map, void const* key);
+
+/**
+ * Grows the map so that it can hold at least num_items items without its index being rebuilt.
+ *
+ * @param map       The map to grow.
+ * @param num_items The number of items that the map should be able to hold.
+ * @return 0 on success, -1 on OOM.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_reserve(pb_ordered_map* map, size_t num_items);
+
+/**
+ * Removes every item from the map (without freeing them), keeping its capacity.
+ *
+ * @param map The map to clear.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_clear(pb_ordered_map* map);
+
+/**
+ * Calls the specified function on every item in the map, in the order that they were put into the map.
+ * pb_hashmap_free_entry_data can be used to free the items' data.
+ *
+ * @param func  The function to call for every item in the map.
+ * @param param The (optional) parameter to supply to the given function.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_for_each(pb_ordered_map* map, pb_hash_iterator_func func, void* param);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PB_ORDERED_MAP_H */
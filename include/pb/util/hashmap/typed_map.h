@@ -0,0 +1,182 @@
+#ifndef PB_TYPED_MAP_H
+#define PB_TYPED_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pb/util/util_exports.h>
+#include <pb/util/hashmap/map_ctrl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Defines a hash map type called name that stores keys and values of the given types inline, along with inline
+ * functions to use it. The map works like pb_hashmap (see map_ctrl.h), but hashes and compares keys without calling
+ * through function pointers, so it's meant for the hot paths of the library.
+ *
+ * hash_key(key) must give a well mixed uint32_t (e.g. pb_mix_ptr or pb_mix_str) and key_eq(k1, k2) must be non-zero
+ * when two keys are equal. Either can be a macro.
+ *
+ * The following are defined:
+ *   name##_entry: { key_type key; val_type val; }
+ *   name:         { name##_entry* entries; uint8_t* ctrl; size_t cap; size_t expand_num; size_t size;
+ *                   size_t num_deleted; }
+ *   int       name##_init(name* map):                        0 on success, -1 on OOM.
+ *   void      name##_destroy(name* map):                     Frees the map's lists, but not its keys and values.
+ *   val_type* name##_get(name const* map, key_type key):     The key's value, or NULL if it's not in the map. The
+ *                                                            pointer is valid until the map is next changed.
+ *   int       name##_put(name* map, key_type key, val_type val): 0 on success, -1 on OOM.
+ *   int       name##_remove(name* map, key_type key):        0 if the key was removed, -1 if it wasn't there. May
+ *                                                            shrink the map.
+ *   int       name##_reserve(name* map, size_t num_items):   0 on success, -1 on OOM.
+ *   void      name##_clear(name* map):                       Removes every item, keeping the capacity.
+ *
+ * To iterate over a map, go through entries[0, cap) and skip the ones for which pb_map_ctrl_is_full(ctrl[i]) is 0.
+ */
+#define PB_DEFINE_TYPED_MAP(name, key_type, val_type, hash_key, key_eq)                                \
+typedef struct {                                                                                       \
+    key_type key;                                                                                      \
+    val_type val;                                                                                      \
+} name##_entry;                                                                                        \
+                                                                                                       \
+typedef struct {                                                                                       \
+    name##_entry* entries;                                                                             \
+    uint8_t* ctrl;                                                                                     \
+    size_t cap;                                                                                        \
+    size_t expand_num;                                                                                 \
+    size_t size;                                                                                       \
+    size_t num_deleted;                                                                                \
+} name;                                                                                                \
+                                                                                                       \
+PB_UTIL_INLINE int name##_alloc(name* map, size_t cap) {                                               \
+    name##_entry* entries = (name##_entry*)malloc(sizeof(name##_entry) * cap);                         \
+    uint8_t* ctrl = (uint8_t*)malloc(cap + PB_MAP_GROUP_WIDTH);                                        \
+    if (!entries || !ctrl) {                                                                           \
+        free(entries);                                                                                 \
+        free(ctrl);                                                                                    \
+        return -1;                                                                                     \
+    }                                                                                                  \
+    pb_map_clear_ctrl(ctrl, cap);                                                                      \
+    map->entries = entries;                                                                            \
+    map->ctrl = ctrl;                                                                                  \
+    map->cap = cap;                                                                                    \
+    map->expand_num = pb_map_expand_num(cap);                                                          \
+    map->num_deleted = 0;                                                                              \
+    return 0;                                                                                          \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_init(name* map) {                                                            \
+    map->size = 0;                                                                                     \
+    return name##_alloc(map, PB_MAP_MIN_CAP);                                                          \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE void name##_destroy(name* map) {                                                        \
+    free(map->entries);                                                                                \
+    free(map->ctrl);                                                                                   \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_entry_eq(void const* map, void const* entry, void const* key) {              \
+    (void)map;                                                                                         \
+    return key_eq(((name##_entry const*)entry)->key, *(key_type const*)key);                           \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE uint32_t name##_entry_hash(void const* map, void const* entry) {                        \
+    (void)map;                                                                                         \
+    return hash_key(((name##_entry const*)entry)->key);                                                \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE size_t name##_find(name const* map, key_type key, uint32_t hash) {                      \
+    return pb_map_find(map->ctrl, map->cap, hash, map->entries, sizeof(name##_entry), name##_entry_eq, \
+                       map, &key);                                                                     \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE val_type* name##_get(name const* map, key_type key) {                                   \
+    size_t pos = name##_find(map, key, hash_key(key));                                                 \
+    return pos == PB_MAP_NO_SLOT ? NULL : &map->entries[pos].val;                                      \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_resize(name* map, size_t new_cap) {                                          \
+    name##_entry* cur_entries = map->entries;                                                          \
+    uint8_t* cur_ctrl = map->ctrl;                                                                     \
+    size_t cur_cap = map->cap;                                                                         \
+    if (name##_alloc(map, new_cap) == -1) {                                                            \
+        return -1;                                                                                     \
+    }                                                                                                  \
+    pb_map_rehash(map->ctrl, map->cap, map->entries, cur_ctrl, cur_cap, cur_entries,                   \
+                  sizeof(name##_entry), name##_entry_hash, map);                                       \
+    free(cur_entries);                                                                                 \
+    free(cur_ctrl);                                                                                    \
+    return 0;                                                                                          \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_put(name* map, key_type key, val_type val) {                                 \
+    uint32_t hash = hash_key(key);                                                                     \
+    size_t pos = name##_find(map, key, hash);                                                          \
+    size_t next_cap;                                                                                   \
+    if (pos != PB_MAP_NO_SLOT) {                                                                       \
+        map->entries[pos].val = val;                                                                   \
+        return 0;                                                                                      \
+    }                                                                                                  \
+    pos = pb_map_find_free(map->ctrl, map->cap, hash);                                                 \
+    next_cap = pb_map_insert_rehash_cap(map->ctrl, map->cap, pos, map->size, map->num_deleted,         \
+                                        map->expand_num);                                              \
+    if (next_cap) {                                                                                    \
+        if (name##_resize(map, next_cap) == -1) {                                                      \
+            return -1;                                                                                 \
+        }                                                                                              \
+        pos = pb_map_find_free(map->ctrl, map->cap, hash);                                             \
+    }                                                                                                  \
+    map->num_deleted -= pb_map_fill_ctrl(map->ctrl, map->cap, pos, hash);                              \
+    map->entries[pos].key = key;                                                                       \
+    map->entries[pos].val = val;                                                                       \
+    map->size++;                                                                                       \
+    return 0;                                                                                          \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_remove(name* map, key_type key) {                                            \
+    size_t pos = name##_find(map, key, hash_key(key));                                                 \
+    size_t new_cap;                                                                                    \
+    if (pos == PB_MAP_NO_SLOT) {                                                                       \
+        return -1;                                                                                     \
+    }                                                                                                  \
+    map->num_deleted += pb_map_erase_ctrl(map->ctrl, map->cap, pos);                                   \
+    map->size--;                                                                                       \
+    new_cap = pb_map_shrink_cap(map->cap, map->size);                                                  \
+    if (new_cap != map->cap) {                                                                         \
+        name##_resize(map, new_cap);                                                                   \
+    }                                                                                                  \
+    return 0;                                                                                          \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE int name##_reserve(name* map, size_t num_items) {                                       \
+    size_t new_cap = pb_map_reserve_cap(map->cap, num_items);                                          \
+    return new_cap == map->cap ? 0 : name##_resize(map, new_cap);                                      \
+}                                                                                                      \
+                                                                                                       \
+PB_UTIL_INLINE void name##_clear(name* map) {                                                          \
+    pb_map_clear_ctrl(map->ctrl, map->cap);                                                            \
+    map->size = 0;                                                                                     \
+    map->num_deleted = 0;                                                                              \
+}
+
+#define PB_TYPED_MAP_PTR_EQ(p1, p2) ((p1) == (p2))
+
+/* Strings are compared by pointer first, so interned strings (like room names that point at their spec's name)
+ * rarely need a strcmp. */
+#define PB_TYPED_MAP_STR_EQ(s1, s2) ((s1) == (s2) || strcmp((s1), (s2)) == 0)
+
+/* Pointer to pointer, e.g. A* nodes for each vertex. */
+PB_DEFINE_TYPED_MAP(pb_ptr_map, void const*, void*, pb_mix_ptr, PB_TYPED_MAP_PTR_EQ)
+
+/* Pointer to index, e.g. the position of each item in a heap. */
+PB_DEFINE_TYPED_MAP(pb_ptr_index_map, void const*, size_t, pb_mix_ptr, PB_TYPED_MAP_PTR_EQ)
+
+/* String to pointer, e.g. room specs by name. The map doesn't copy its keys. */
+PB_DEFINE_TYPED_MAP(pb_str_map, char const*, void*, pb_mix_str, PB_TYPED_MAP_STR_EQ)
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PB_TYPED_MAP_H */
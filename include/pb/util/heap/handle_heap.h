@@ -0,0 +1,109 @@
+#ifndef PB_HANDLE_HEAP_H
+#define PB_HANDLE_HEAP_H
+
+#include <stddef.h>
+#include <pb/util/util_exports.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The number of children of each item in the heap. A wider heap is shallower, and a node's children share a cache line. */
+#define PB_HANDLE_HEAP_ARITY 4
+
+/* Identifies an item in a pb_handle_heap. Handles are given out in order starting from 0. */
+typedef size_t pb_heap_handle;
+
+/* The position of an item that's no longer in the heap, and the handle returned when an insert fails. */
+#define PB_HEAP_NO_HANDLE ((size_t)-1)
+
+/**
+ * A 4-ary min-heap that gives each inserted item a handle, so that decreasing an item's priority doesn't need to look
+ * it up. The heap itself is two lists, one of handles and one of their priorities, so comparisons only touch the
+ * priorities. Handles stay valid (and aren't reused) until the heap is cleared.
+ */
+typedef struct {
+    pb_heap_handle* heap;      /* The handles of the items in the heap, in heap order. */
+    float*          priority;  /* The priority of each item in the heap, in heap order. */
+    size_t          size;      /* The number of items in the heap. */
+    size_t          cap;       /* The capacity of heap and priority. */
+    size_t*         pos;       /* For each handle, its item's position in the heap or PB_HEAP_NO_HANDLE. */
+    void**          data;      /* For each handle, its item. */
+    size_t          num_handles;
+    size_t          handles_cap;
+} pb_handle_heap;
+
+/**
+ * Initialises an empty heap.
+ *
+ * @param heap     The heap to initialise.
+ * @param init_cap The number of items to make space for. If 0, PB_HEAP_DEFAULT_CAP is used.
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_handle_heap_init(pb_handle_heap* heap, size_t init_cap);
+
+/**
+ * Frees the heap's internal lists (but not the heap itself or its items).
+ *
+ * @param heap The heap to free.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_free(pb_handle_heap* heap);
+
+/**
+ * Removes every item from the heap, keeping its capacity. Every handle given out so far becomes invalid.
+ *
+ * @param heap The heap to clear.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_clear(pb_handle_heap* heap);
+
+/**
+ * Adds the given item to the heap.
+ *
+ * @param heap     The heap to which the item should be added.
+ * @param item     The item to add to the heap.
+ * @param priority The item's priority.
+ * @return The item's handle on success, PB_HEAP_NO_HANDLE if out of memory.
+ */
+PB_UTIL_DECLSPEC pb_heap_handle PB_UTIL_CALL pb_handle_heap_insert(pb_handle_heap* heap, void* item, float priority);
+
+/**
+ * Decreases the priority of the item with the given handle to new_priority. Nothing happens if the item has already
+ * been removed from the heap.
+ *
+ * @param heap         The heap containing the item.
+ * @param handle       The handle returned when the item was inserted.
+ * @param new_priority The item's new priority. Precondition: this is <= the current priority.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_decrease_key(pb_handle_heap* heap, pb_heap_handle handle,
+                                                              float new_priority);
+
+/**
+ * Checks whether the item with the given handle is still in the heap.
+ *
+ * @param heap   The heap to check.
+ * @param handle The handle returned when the item was inserted.
+ * @return 1 if the item is in the heap, 0 otherwise.
+ */
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_handle_heap_contains(pb_handle_heap const* heap, pb_heap_handle handle);
+
+/**
+ * Retrieves the item with the lowest priority in the heap but does not remove it.
+ *
+ * @param heap The heap from which to retrieve the item.
+ * @return The item with the lowest priority or NULL if the heap is empty.
+ */
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_handle_heap_peek_min(pb_handle_heap const* heap);
+
+/**
+ * Retrieves the item with the lowest priority from the heap and removes it. Its handle can still be passed to
+ * pb_handle_heap_contains and pb_handle_heap_decrease_key.
+ *
+ * @param heap The heap from which to remove the item.
+ * @return The item with the lowest priority or NULL if the heap is empty.
+ */
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_handle_heap_get_min(pb_handle_heap* heap);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* PB_HANDLE_HEAP_H */
@@ -4,7 +4,7 @@
 #include <stddef.h>
 #include <pb/util/util_exports.h>
 #include <pb/util/vector/vector.h>
-#include <pb/util/hashmap/hashmap.h>
+#include <pb/util/hashmap/typed_map.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,8 +21,8 @@ typedef struct {
  * A min-heap containing a list of partially sorted items.
  */
 typedef struct {
-    pb_vector   items;     /* The items contained in the heap */
-    pb_hashmap* index_map; /* A map of items=>indices for quicker decrease-key operation */
+    pb_vector        items;     /* The items contained in the heap */
+    pb_ptr_index_map index_map; /* A map of items=>indices for quicker decrease-key operation */
 } pb_heap;
 
 /**
@@ -54,7 +54,7 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_heap_insert(pb_heap* heap, void* item, floa
  * @param heap         The heap containing the item to decrease.
  * @param key          The item whose priority should be lowered.
  * @param new_priority The new priority to assign to item. Precondition: this is < the current priority.
- * @return 0 on success, -1 if the item wasn't found in the heap.
+ *                     Nothing happens if the item isn't in the heap.
  */
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_heap_decrease_key(pb_heap* heap, void* item, float new_priority);
 
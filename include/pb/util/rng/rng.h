@@ -0,0 +1,73 @@
+#ifndef PB_RNG_H
+#define PB_RNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pb/util/util_exports.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A small, reentrant, counter-based random number generator.
+ *
+ * Each value is a pure function of the stream's key and the number of values drawn from the stream so far, so a
+ * generator can be copied, split into independent child streams, and replayed without any shared state. This makes
+ * it safe to give each thread (or each stage of a generator) its own stream while keeping the output identical
+ * regardless of scheduling.
+ */
+typedef struct {
+    uint64_t key;     /* Identifies the stream; derived from the seed and any splits */
+    uint64_t counter; /* The number of values drawn from this stream so far */
+} pb_rng;
+
+/**
+ * Initialises the generator from a seed. Generators initialised from the same seed produce the same sequence.
+ *
+ * @param rng  The generator to initialise.
+ * @param seed The seed.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_rng_seed(pb_rng* rng, uint64_t seed);
+
+/**
+ * Initialises child as an independent stream derived from parent. The child depends only on the parent's key and
+ * stream_id, never on how many values have been drawn from the parent, so the same (parent, stream_id) pair always
+ * yields the same child. Different stream_ids yield statistically independent streams.
+ *
+ * @param parent    The generator from which the stream is derived. It is not modified.
+ * @param stream_id The identifier of the child stream (e.g. a floor or stage number).
+ * @param child     The generator to initialise. May be the same as parent.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_rng_split(pb_rng const* parent, uint64_t stream_id, pb_rng* child);
+
+/**
+ * Draws the next 64-bit value from the generator.
+ *
+ * @param rng The generator.
+ * @return A uniformly distributed 64-bit value.
+ */
+PB_UTIL_DECLSPEC uint64_t PB_UTIL_CALL pb_rng_next64(pb_rng* rng);
+
+/**
+ * Draws the next 32-bit value from the generator.
+ *
+ * @param rng The generator.
+ * @return A uniformly distributed 32-bit value.
+ */
+PB_UTIL_DECLSPEC uint32_t PB_UTIL_CALL pb_rng_next(pb_rng* rng);
+
+/**
+ * Draws a value in the range [0, bound).
+ *
+ * @param rng   The generator.
+ * @param bound The exclusive upper bound. Must be greater than 0.
+ * @return A uniformly distributed value in [0, bound).
+ */
+PB_UTIL_DECLSPEC uint32_t PB_UTIL_CALL pb_rng_range(pb_rng* rng, uint32_t bound);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PB_RNG_H */
@@ -0,0 +1,79 @@
+#ifndef PB_THREAD_POOL_H
+#define PB_THREAD_POOL_H
+
+#include <stddef.h>
+#include <pb/util/util_exports.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A task run by the pool.
+ *
+ * @param index  The index of the task, in [0, num_tasks).
+ * @param worker The index of the worker running the task, in [0, pb_thread_pool_num_workers(pool)). No two tasks
+ *               run concurrently on the same worker, so this can be used to index per-worker scratch state.
+ * @param param  The parameter passed to pb_thread_pool_run.
+ */
+typedef void (PB_UTIL_CALL * pb_thread_pool_task)(size_t index, size_t worker, void* param);
+
+/**
+ * A fixed-size pool of worker threads that runs batches of indexed tasks.
+ *
+ * Each worker owns a contiguous range of task indices. A worker takes tasks from the front of its own range, and
+ * once it runs out it steals the back half of another worker's remaining range, so uneven task costs are balanced
+ * without a shared queue. The thread that calls pb_thread_pool_run acts as worker 0, so a pool with one worker
+ * creates no threads at all.
+ */
+typedef struct pb_thread_pool pb_thread_pool;
+
+/**
+ * Gets the number of hardware threads available on this machine.
+ *
+ * @return The number of hardware threads, or 1 if it can't be determined.
+ */
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_thread_pool_hardware_threads(void);
+
+/**
+ * Creates a thread pool.
+ *
+ * @param num_workers The number of workers (including the calling thread). Pass 0 to use
+ *                    pb_thread_pool_hardware_threads().
+ * @return The new pool on success, NULL on failure (out of memory or unable to create threads).
+ */
+PB_UTIL_DECLSPEC pb_thread_pool* PB_UTIL_CALL pb_thread_pool_create(size_t num_workers);
+
+/**
+ * Stops the pool's threads and frees the pool. Must not be called while pb_thread_pool_run is executing.
+ *
+ * @param pool The pool to free.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_thread_pool_free(pb_thread_pool* pool);
+
+/**
+ * Gets the number of workers in the pool.
+ *
+ * @param pool The pool.
+ * @return The number of workers, including the thread that calls pb_thread_pool_run.
+ */
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_thread_pool_num_workers(pb_thread_pool const* pool);
+
+/**
+ * Runs task once for each index in [0, num_tasks) and waits for all of them to finish. The order in which tasks run
+ * and the worker on which each one runs are unspecified. Only one thread may call this on a given pool at a time,
+ * and tasks must not call it on the pool that is running them.
+ *
+ * @param pool      The pool on which to run the tasks.
+ * @param num_tasks The number of tasks.
+ * @param task      The function to run for each task.
+ * @param param     A parameter passed to each task.
+ */
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_thread_pool_run(pb_thread_pool* pool, size_t num_tasks, pb_thread_pool_task task,
+                                                      void* param);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PB_THREAD_POOL_H */
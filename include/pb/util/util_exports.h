@@ -41,4 +41,13 @@
 #endif
 #endif /* PBCALL */
 
+/* Small helpers defined in headers (MSVC's C compiler only knows __inline) */
+#ifndef PB_UTIL_INLINE
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define PB_UTIL_INLINE static __inline
+#else
+#define PB_UTIL_INLINE static inline
+#endif
+#endif
+
 #endif /* PB_UTIL_EXPORTS_H */
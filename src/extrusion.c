@@ -8,40 +8,62 @@
 #include <pb/util/geom/line_utils.h>
 #include <pb/util/geom/triangulate.h>
 #include <pb/util/geom/rect_utils.h>
+#include <pb/internal/vertex_kernels.h>
+#include <pb/internal/simple_extruder_quads.h>
 
 /* Assumes that the points are actually on the line, and thus that the t values
  * for x and y are interchangeable (unless one of them is INFINITY). */
-static pb_line2D const* cmp_line = NULL;
-int pb_line2D_sort(void const* struct1, void const* struct2) {
-    pb_wall_structure* s1 = (pb_wall_structure*)struct1;
-    pb_wall_structure* s2 = (pb_wall_structure*)struct2;
-
-    pb_point2D p1_t = pb_line2D_get_t(cmp_line, &s1->start);
-    pb_point2D p2_t = pb_line2D_get_t(cmp_line, &s2->start);
+static int pb_line2D_structure_less(pb_line2D const* line, pb_wall_structure const* s1, pb_wall_structure const* s2) {
+    pb_point2D p1_t = pb_line2D_get_t(line, &s1->start);
+    pb_point2D p2_t = pb_line2D_get_t(line, &s2->start);
 
     if (p1_t.x != INFINITY) {
-        return p1_t.x < p2_t.x ? -1 : 1;
+        return p1_t.x < p2_t.x;
     } else {
-        return p1_t.y < p2_t.y ? -1 : 1;
+        return p1_t.y < p2_t.y;
     }
 }
 
 /**
- * Extrudes a wall and stores it in the provided shape parameter (which must be
- * allocated to hold two triangles).
+ * Sorts wall structures according to how far they are along the given line. This used to be a qsort with the line
+ * stored in a global, which made extrusion unsafe to run on multiple threads; walls rarely have more than a handful
+ * of doors or windows, so an insertion sort is just as fast.
+ *
+ * @param line           The line along which the structures lie.
+ * @param structures     The structures to sort.
+ * @param num_structures The number of structures.
+ */
+static void sort_structures_along_line(pb_line2D const* line, pb_wall_structure* structures, size_t num_structures) {
+    size_t i;
+    for (i = 1; i < num_structures; ++i) {
+        pb_wall_structure cur = structures[i];
+        size_t j = i;
+
+        while (j > 0 && pb_line2D_structure_less(line, &cur, structures + j - 1)) {
+            structures[j] = structures[j - 1];
+            --j;
+        }
+        structures[j] = cur;
+    }
+}
+
+/**
+ * Works out the quad of a wall and where it goes, ready to be filled in by pb_fill_quad_verts or written to a layout
+ * by pb_write_quad_verts.
  *
  * @param parent_wall  The wall of which this wall is a subsection.
  * @param wall         The wall to extrude.
  * @param start_height The wall's starting height.
  * @param height       The wall's height.
  * @param normal       The normal vector for the 2D wall.
- * @param dest         A shape that will hold the extruded wall.
+ * @param pos          Holds the wall's position.
+ * @param quad         Holds the wall's quad.
  */
-static void extrude_wall_internal(pb_line2D const* parent_wall, pb_line2D const* wall,
-                                  pb_point2D const* bottom_floor_centre,
-                                  float start_height, float height,
-                                  pb_point2D const* normal,
-                                  pb_shape3D* dest) {
+static void get_wall_quad(pb_line2D const* parent_wall, pb_line2D const* wall,
+                          pb_point2D const* bottom_floor_centre,
+                          float start_height, float height,
+                          pb_point2D const* normal,
+                          pb_point3D* pos, pb_quad_verts* quad) {
 
     pb_point2D parent_wall_vec = {parent_wall->end.x - parent_wall->start.x,
                                   parent_wall->end.y - parent_wall->start.y};
@@ -64,60 +86,56 @@ static void extrude_wall_internal(pb_line2D const* parent_wall, pb_line2D const*
     parent_wall_start_to_end.x = parent_wall_end_to_start.x * -1.f;
     parent_wall_start_to_end.y = parent_wall_end_to_start.y * -1.f;
 
-    dest->pos.x = wall_centre.x - bottom_floor_centre->x;
-    dest->pos.y = start_height + (height / 2.f);
-    dest->pos.z = (wall_centre.y - bottom_floor_centre->y) * -1.f;
-
-    pb_vert3D* tris = dest->tris;
-    tris[0].x = wall_len.x / 2.f * parent_wall_end_to_start.x;
-    tris[0].y = height / 2.f * -1.f;
-    tris[0].z = wall_len.y / 2.f * parent_wall_end_to_start.y;
-    tris[0].nx = normal->x;
-    tris[0].ny = 0.f;
-    tris[0].nz = -normal->y;
-    tris[0].v = 1.f;
-
-    pb_point2D s = {wall_centre.x + tris[0].x, wall_centre.y - tris[0].z};
+    pos->x = wall_centre.x - bottom_floor_centre->x;
+    pos->y = start_height + (height / 2.f);
+    pos->z = (wall_centre.y - bottom_floor_centre->y) * -1.f;
+
+    quad->start_x = wall_len.x / 2.f * parent_wall_end_to_start.x;
+    quad->start_z = wall_len.y / 2.f * parent_wall_end_to_start.y;
+    quad->end_x = wall_len.x / 2.f * parent_wall_start_to_end.x;
+    quad->end_z = wall_len.y / 2.f * parent_wall_start_to_end.y;
+    quad->bottom = height / 2.f * -1.f;
+    quad->top = height / 2.f;
+    quad->nx = normal->x;
+    quad->nz = -normal->y;
+    quad->bottom_v = 1.f;
+    quad->top_v = 0.f;
+
+    pb_point2D s = {wall_centre.x + quad->start_x, wall_centre.y - quad->start_z};
     pb_point2D start_t = pb_line2D_get_t(parent_wall, &s);
-    float start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
-    tris[0].u = start_u;
-
-    tris[1].x = wall_len.x / 2.f * parent_wall_start_to_end.x;
-    tris[1].y = height / 2.f;
-    tris[1].z = wall_len.y / 2.f * parent_wall_start_to_end.y;
-    tris[1].nx = normal->x;
-    tris[1].ny = 0.f;
-    tris[1].nz = -normal->y;
-    tris[1].v = 0.f;
-
-    pb_point2D e = {wall_centre.x + tris[1].x, wall_centre.y - tris[1].z};
-    pb_point2D end_t = pb_line2D_get_t(parent_wall, &e);
-    float end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
-    tris[1].u = end_u;
+    quad->start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
 
-    tris[2].x = wall_len.x / 2.f * parent_wall_end_to_start.x;
-    tris[2].y = height / 2.f;
-    tris[2].z = wall_len.y / 2.f * parent_wall_end_to_start.y;
-    tris[2].nx = normal->x;
-    tris[2].ny = 0.f;
-    tris[2].nz = normal->y * -1.f;
-    tris[2].u = start_u;
-    tris[2].v = 0.f;
-
-    tris[3] = tris[0];
+    pb_point2D e = {wall_centre.x + quad->end_x, wall_centre.y - quad->end_z};
+    pb_point2D end_t = pb_line2D_get_t(parent_wall, &e);
+    quad->end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
+}
 
-    tris[4].x = wall_len.x / 2.f * parent_wall_start_to_end.x;
-    tris[4].y = height / 2.f * -1.f;
-    tris[4].z = wall_len.y / 2.f * parent_wall_start_to_end.y;
-    tris[4].nx = normal->x;
-    tris[4].ny = 0.f;
-    tris[4].nz = normal->y * -1.f;
-    tris[4].u = end_u;
-    tris[4].v = 1.f;
+/**
+ * Extrudes a wall and stores it in the provided shape parameter (which must be
+ * allocated to hold two triangles), along with its bounds.
+ *
+ * @param parent_wall  The wall of which this wall is a subsection.
+ * @param wall         The wall to extrude.
+ * @param start_height The wall's starting height.
+ * @param height       The wall's height.
+ * @param normal       The normal vector for the 2D wall.
+ * @param dest         A shape that will hold the extruded wall.
+ */
+static void extrude_wall_internal(pb_line2D const* parent_wall, pb_line2D const* wall,
+                                  pb_point2D const* bottom_floor_centre,
+                                  float start_height, float height,
+                                  pb_point2D const* normal,
+                                  pb_shape3D* dest) {
+    pb_quad_verts quad;
 
-    tris[5] = tris[1];
+    get_wall_quad(parent_wall, wall, bottom_floor_centre, start_height, height, normal, &dest->pos, &quad);
+    pb_fill_quad_verts(&quad, dest->tris);
+    pb_get_quad_bounds(&quad, &dest->pos, &dest->bounds);
 }
 
+/* Walls rarely have more than a handful of doors and windows, so their sorted copies usually fit on the stack */
+#define SORTED_STRUCTURES_STACK_SIZE 16
+
 PB_DECLSPEC int PB_CALL pb_extrude_wall(pb_line2D const* wall,
                                         pb_wall_structure const* doors, size_t num_doors,
                                         pb_wall_structure const* windows, size_t num_windows,
@@ -195,6 +213,9 @@ PB_DECLSPEC int PB_CALL pb_extrude_wall(pb_line2D const* wall,
     pb_shape3D* wall_list = NULL;
     pb_shape3D* door_list = NULL;
     pb_shape3D* window_list = NULL;
+    pb_wall_structure stack_structures[SORTED_STRUCTURES_STACK_SIZE];
+    pb_wall_structure* sorted_structures = NULL;
+    size_t num_structures = num_doors + num_windows;
 
     /* calloc so freeing later is easier if necessary */
     /* That probably doesn't justify the performance hit... but there's a lot of other stuff that's probably
@@ -202,23 +223,33 @@ PB_DECLSPEC int PB_CALL pb_extrude_wall(pb_line2D const* wall,
     wall_list = calloc(sizeof(pb_shape3D),  wall_list_size);
     door_list = door_list_size == 0 ? NULL : calloc(sizeof(pb_shape3D), door_list_size);
     window_list = window_list_size == 0 ? NULL : calloc(sizeof(pb_shape3D), window_list_size);
+    sorted_structures = num_structures <= SORTED_STRUCTURES_STACK_SIZE
+                            ? stack_structures
+                            : malloc(sizeof(pb_wall_structure) * num_structures);
 
-    if (!wall_list || (door_list_size != 0 && !door_list) || (window_list_size != 0 && !window_list)) {
+    if (!wall_list || (door_list_size != 0 && !door_list) || (window_list_size != 0 && !window_list) ||
+        !sorted_structures) {
         free(wall_list);
         free(door_list);
         free(window_list);
+        if (sorted_structures != stack_structures) {
+            free(sorted_structures);
+        }
         return -1;
     }
 
-    /* Sort the door and window lists according to how far they are along the wall.
-     * sizeof(pb_point2D) * 2 because we want to skip the end points. */
-    cmp_line = wall;
+    /* Sort copies of the door and window lists according to how far they are along the wall, since the caller's
+     * lists are read-only */
     if (num_doors) {
-        qsort(doors, num_doors, sizeof(pb_wall_structure), pb_line2D_sort);
+        memcpy(sorted_structures, doors, sizeof(pb_wall_structure) * num_doors);
     }
     if (num_windows) {
-        qsort(windows, num_windows, sizeof(pb_wall_structure), pb_line2D_sort);
+        memcpy(sorted_structures + num_doors, windows, sizeof(pb_wall_structure) * num_windows);
     }
+    sort_structures_along_line(wall, sorted_structures, num_doors);
+    sort_structures_along_line(wall, sorted_structures + num_doors, num_windows);
+    doors = sorted_structures;
+    windows = sorted_structures + num_doors;
 
     int end_is_start = 0;
     if (num_doors) {
@@ -464,9 +495,15 @@ PB_DECLSPEC int PB_CALL pb_extrude_wall(pb_line2D const* wall,
     *windows_out = num_windows ? window_list : NULL;
     *num_windows_out = window_list_size;
 
+    if (sorted_structures != stack_structures) {
+        free(sorted_structures);
+    }
     return 0;
 
 err_return:
+    if (sorted_structures != stack_structures) {
+        free(sorted_structures);
+    }
     for (i = 0; i < cur_wall_count; ++i) {
         pb_shape3D_free(wall_list + i);
     }
@@ -494,14 +531,98 @@ err_return:
     return -1;
 }
 
+/**
+ * How a room's floor and ceiling are made from its triangulation, ready to be filled in by pb_fill_surface_verts or
+ * written to a layout by pb_write_surface_verts. The floor is index 0 and the ceiling is index 1; the ceiling goes
+ * through the triangulation backwards, with its normal facing down.
+ */
+typedef struct {
+    pb_point2D centre;
+    pb_point2D uv_start[2];
+    pb_point2D uv_size[2];
+    pb_point3D pos[2];
+} room_surfaces;
+
+static void get_room_surfaces(pb_room const* room, pb_point2D const* bottom_floor_centre,
+                              float start_height, float floor_height, room_surfaces* out) {
+    pb_point2D const* room_points = (pb_point2D*)room->shape.points.items;
+
+    pb_rect room_bounding;
+    pb_shape2D_get_bounding_rect(&room->shape, &room_bounding);
+
+    // Get the room's centre point so that we can offset things properly
+    size_t i;
+    pb_point2D room_centre = {0.f, 0.f};
+    for (i = 0; i < room->shape.points.size; ++i) {
+        room_centre.x += room_points[i].x;
+        room_centre.y += room_points[i].y;
+    }
+    room_centre.x /= room->shape.points.size;
+    room_centre.y /= room->shape.points.size;
+    out->centre = room_centre;
+
+    out->uv_start[0].x = room_bounding.bottom_left.x;
+    out->uv_start[0].y = room_bounding.bottom_left.y + room_bounding.h;
+    out->uv_size[0].x = room_bounding.w;
+    out->uv_size[0].y = room_bounding.h * -1.f;
+
+    out->uv_start[1].x = room_bounding.bottom_left.x + room_bounding.w;
+    out->uv_start[1].y = room_bounding.bottom_left.y + room_bounding.h;
+    out->uv_size[1].x = room_bounding.w * -1.f;
+    out->uv_size[1].y = room_bounding.h * -1.f;
+
+    for (i = 0; i < 2; ++i) {
+        out->pos[i].x = room_centre.x - bottom_floor_centre->x;
+        out->pos[i].y = i == 0 ? start_height : start_height + floor_height;
+        out->pos[i].z = bottom_floor_centre->y - room_centre.y;
+    }
+}
+
+/**
+ * Fills in a room's floor and ceiling from its triangulation, along with their bounds.
+ *
+ * @param room                The room.
+ * @param floor_indices       The triangulation of the room's shape.
+ * @param num_verts           The number of indices in floor_indices.
+ * @param bottom_floor_centre The bottom floor's centre point.
+ * @param start_height        The height at which this floor starts.
+ * @param floor_height        The height of the current floor.
+ * @param floor_shape         The shape to hold the floor, with room for num_verts vertices. NULL to skip the floor.
+ * @param ceiling_shape       The shape to hold the ceiling, with room for num_verts vertices. NULL to skip the ceiling.
+ */
+static void fill_floor_ceiling(pb_room const* room, size_t const* floor_indices, size_t num_verts,
+                               pb_point2D const* bottom_floor_centre,
+                               float start_height, float floor_height,
+                               pb_shape3D* floor_shape, pb_shape3D* ceiling_shape) {
+    pb_point2D const* room_points = (pb_point2D*)room->shape.points.items;
+    size_t num_points = num_verts ? room->shape.points.size : 0;
+    room_surfaces surfaces;
+
+    get_room_surfaces(room, bottom_floor_centre, start_height, floor_height, &surfaces);
+
+    if (floor_shape) {
+        pb_fill_surface_verts(room_points, floor_indices, num_verts, 0, &surfaces.centre,
+                              &surfaces.uv_start[0], &surfaces.uv_size[0], 1.f, floor_shape->tris);
+        floor_shape->pos = surfaces.pos[0];
+        pb_get_surface_bounds(room_points, num_points, &surfaces.centre, &floor_shape->pos, &floor_shape->bounds);
+    }
+
+    if (ceiling_shape) {
+        /* Reversed to face downwards */
+        pb_fill_surface_verts(room_points, floor_indices, num_verts, 1, &surfaces.centre,
+                              &surfaces.uv_start[1], &surfaces.uv_size[1], -1.f, ceiling_shape->tris);
+        ceiling_shape->pos = surfaces.pos[1];
+        pb_get_surface_bounds(room_points, num_points, &surfaces.centre, &ceiling_shape->pos,
+                              &ceiling_shape->bounds);
+    }
+}
+
 PB_DECLSPEC int PB_CALL pb_extrude_room_floor_ceiling(pb_room const* room,
                                                       pb_point2D const* bottom_floor_centre,
                                                       float start_height, float floor_height,
                                                       pb_shape3D** floor_shapes_out, size_t* num_floor_shapes_out,
                                                       pb_shape3D** ceiling_shapes_out, size_t* num_ceiling_shapes_out) {
     if (room->has_floor || room->has_ceiling) {
-        pb_point2D const* room_points = (pb_point2D*)room->shape.points.items;
-
         size_t* floor_indices = pb_triangulate(&room->shape);
         if (!floor_indices) {
             return -1;
@@ -534,62 +655,8 @@ PB_DECLSPEC int PB_CALL pb_extrude_room_floor_ceiling(pb_room const* room,
             return -1;
         }
 
-        pb_rect room_bounding;
-        pb_shape2D_get_bounding_rect(&room->shape, &room_bounding);
-
-        // Get the room's centre point so that we can offset things properly
-        size_t i;
-        pb_point2D room_centre = {0.f, 0.f};
-        for (i = 0; i < room->shape.points.size; ++i) {
-            room_centre.x += room_points[i].x;
-            room_centre.y += room_points[i].y;
-        }
-        room_centre.x /= room->shape.points.size;
-        room_centre.y /= room->shape.points.size;
-
-        if (room->has_floor) {
-            pb_point2D start = {room_bounding.bottom_left.x, room_bounding.bottom_left.y + room_bounding.h};
-            pb_point2D dist = {room_bounding.w, room_bounding.h * -1.f};
-
-            for (i = 0; i < num_verts; ++i) {
-                size_t idx = floor_indices[i];
-                floor_shape->tris[i].x = room_points[idx].x - room_centre.x;
-                floor_shape->tris[i].y = 0.f;
-                floor_shape->tris[i].z = room_centre.y - room_points[idx].y;
-                floor_shape->tris[i].nx = 0.f;
-                floor_shape->tris[i].ny = 1.f;
-                floor_shape->tris[i].nz = 0.f;
-                floor_shape->tris[i].u = (room_points[idx].x - start.x) / dist.x;
-                floor_shape->tris[i].v = (room_points[idx].y - start.y) / dist.y;
-            }
-
-            floor_shape->pos.x = room_centre.x - bottom_floor_centre->x;
-            floor_shape->pos.y = start_height;
-            floor_shape->pos.z = bottom_floor_centre->y - room_centre.y;
-        }
-
-        if (room->has_ceiling) {
-            pb_point2D start = {room_bounding.bottom_left.x + room_bounding.w,
-                                room_bounding.bottom_left.y + room_bounding.h};
-            pb_point2D dist = {room_bounding.w * -1.f, room_bounding.h * -1.f};
-
-            for (i = num_verts; i > 0; --i) {
-                size_t idx = floor_indices[i - 1];
-                size_t ceil_idx = num_verts - i;
-                ceiling_shape->tris[ceil_idx].x = room_points[idx].x - room_centre.x;
-                ceiling_shape->tris[ceil_idx].y = 0.f;
-                ceiling_shape->tris[ceil_idx].z = room_centre.y - room_points[idx].y;
-                ceiling_shape->tris[ceil_idx].nx = 0.f;
-                ceiling_shape->tris[ceil_idx].ny = -1.f;
-                ceiling_shape->tris[ceil_idx].nz = 0.f;
-                ceiling_shape->tris[ceil_idx].u = (room_points[idx].x - start.x) / dist.x;
-                ceiling_shape->tris[ceil_idx].v = (room_points[idx].y - start.y) / dist.y;
-            }
-
-            ceiling_shape->pos.x = room_centre.x - bottom_floor_centre->x;
-            ceiling_shape->pos.y = start_height + floor_height;
-            ceiling_shape->pos.z = bottom_floor_centre->y - room_centre.y;
-        }
+        fill_floor_ceiling(room, floor_indices, num_verts, bottom_floor_centre, start_height, floor_height,
+                           floor_shape, ceiling_shape);
 
         *floor_shapes_out = floor_shape;
         *num_floor_shapes_out = (size_t)room->has_floor;
@@ -799,24 +866,32 @@ err_return:
     }
     pb_vector_free(&windows_out);
 
+    free(wall_counts);
+    free(out);
+
     /* Don't need to free the ceiling and ground - they're done after all other operations that might fail
      * and have already been freed by this point */
     return NULL;
 };
 }
 
-PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
-                                                         pb_point2D const* bottom_floor_centre,
-                                                         float start_height,
-                                                         float floor_height,
-                                                         float door_height,
-                                                         float window_height,
-                                                         pb_wall_structure_extruder const* door_extruder,
-                                                         pb_wall_structure_extruder const* window_extruder,
-                                                         void* door_extruder_param,
-                                                         void* window_extruder_param) {
-    pb_extruded_floor* out = NULL;
-    pb_extruded_room** rooms_out = NULL;
+/**
+ * Extrudes the exterior walls, doors and windows of a floor. The floor's rooms are left alone so that they can be
+ * extruded at the same time.
+ *
+ * @return 0 on success, -1 on failure (out of memory). On failure, out is left untouched.
+ */
+static int extrude_floor_exterior(pb_floor const* f,
+                                  pb_point2D const* bottom_floor_centre,
+                                  float start_height,
+                                  float floor_height,
+                                  float door_height,
+                                  float window_height,
+                                  pb_wall_structure_extruder const* door_extruder,
+                                  pb_wall_structure_extruder const* window_extruder,
+                                  void* door_extruder_param,
+                                  void* window_extruder_param,
+                                  pb_extruded_floor* out) {
     pb_shape3D** walls_out = NULL;
     size_t* wall_counts = NULL;
 
@@ -832,21 +907,17 @@ PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
     int doors_init_result = f->num_doors != 0 ? pb_vector_init(&doors_out, sizeof(pb_shape3D), f->num_doors) : 0;
     int windows_init_result = f->num_windows != 0 ? pb_vector_init(&windows_out, sizeof(pb_shape3D), f->num_windows) : 0;
 
-    out = malloc(sizeof(pb_extruded_floor));
-    rooms_out = malloc(sizeof(pb_extruded_room*) * f->num_rooms);
     walls_out = calloc(sizeof(pb_shape3D*), f->shape.points.size);
     wall_counts = malloc(sizeof(size_t) * f->shape.points.size);
 
-    if (!out || !rooms_out || !walls_out || !wall_counts ||
+    if (!walls_out || !wall_counts ||
             (f->num_doors != 0 && doors_init_result == -1) ||
             (f->num_windows != 0 && windows_init_result == -1)) {
-        free(out);
-        free(rooms_out);
         free(walls_out);
         free(wall_counts);
         pb_vector_free(&doors_out);
         pb_vector_free(&windows_out);
-        return NULL;
+        return -1;
     }
 
     if (f->num_doors != 0) {
@@ -862,10 +933,6 @@ PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
     size_t cur_door = 0;
     size_t cur_window = 0;
 
-    /* We use this when freeing, so it needs to be initialised to 0 to avoid accidentally freeing uninitialised rooms */
-    /* Would be nicer to put it by the actual loop that uses it though */
-    size_t cur_room = 0;
-
     for (cur_wall = 0; cur_wall < f->shape.points.size; ++cur_wall) {
         /* Find the list of doors and windows for this wall, if any */
         while(cur_door < f->num_doors && f->doors[cur_door].wall < cur_wall) ++cur_door;
@@ -946,18 +1013,6 @@ PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
         }
     }
 
-    for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
-        pb_extruded_room* room_out = pb_extrude_room(f->rooms + cur_room,
-                                                     bottom_floor_centre,
-                                                     start_height, floor_height, door_height, window_height,
-                                                     door_extruder, window_extruder,
-                                                     door_extruder_param, window_extruder_param);
-        if (!room_out) {
-            goto err_return;
-        }
-        rooms_out[cur_room] = room_out;
-    }
-
     out->walls = walls_out;
     out->wall_counts = wall_counts;
     out->num_wall_lists = f->shape.points.size;
@@ -965,10 +1020,8 @@ PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
     out->num_doors = doors_out.size;
     out->windows = (pb_shape3D*)windows_out.items;
     out->num_windows = windows_out.size;
-    out->rooms = rooms_out;
-    out->num_rooms = f->num_rooms;
 
-    return out;
+    return 0;
 
 err_return:
 {
@@ -993,13 +1046,199 @@ err_return:
     }
     pb_vector_free(&windows_out);
 
-    for (i = 0; i < cur_room; ++i) {
-        pb_extruded_room_free(rooms_out[i]);
+    return -1;
+}
+}
+
+PB_DECLSPEC pb_extruded_floor* PB_CALL pb_extrude_floor(pb_floor const* f,
+                                                         pb_point2D const* bottom_floor_centre,
+                                                         float start_height,
+                                                         float floor_height,
+                                                         float door_height,
+                                                         float window_height,
+                                                         pb_wall_structure_extruder const* door_extruder,
+                                                         pb_wall_structure_extruder const* window_extruder,
+                                                         void* door_extruder_param,
+                                                         void* window_extruder_param) {
+    pb_extruded_floor* out = malloc(sizeof(pb_extruded_floor));
+    pb_extruded_room** rooms_out = f->num_rooms ? malloc(sizeof(pb_extruded_room*) * f->num_rooms) : NULL;
+    size_t cur_room;
+
+    if (!out || (f->num_rooms && !rooms_out)) {
+        free(out);
+        free(rooms_out);
+        return NULL;
+    }
+
+    if (extrude_floor_exterior(f, bottom_floor_centre,
+                               start_height, floor_height, door_height, window_height,
+                               door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                               out) == -1) {
+        free(out);
+        free(rooms_out);
+        return NULL;
     }
-    free(rooms_out);
 
-    return NULL;
+    out->rooms = NULL;
+    out->num_rooms = 0;
+
+    for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+        pb_extruded_room* room_out = pb_extrude_room(f->rooms + cur_room,
+                                                     bottom_floor_centre,
+                                                     start_height, floor_height, door_height, window_height,
+                                                     door_extruder, window_extruder,
+                                                     door_extruder_param, window_extruder_param);
+        if (!room_out) {
+            size_t i;
+            for (i = 0; i < cur_room; ++i) {
+                pb_extruded_room_free(rooms_out[i]);
+                free(rooms_out[i]);
+            }
+            free(rooms_out);
+
+            pb_extruded_floor_free(out);
+            free(out);
+            return NULL;
+        }
+        rooms_out[cur_room] = room_out;
+    }
+
+    out->rooms = rooms_out;
+    out->num_rooms = f->num_rooms;
+
+    return out;
+}
+
+/* Every floor is positioned relative to the centre of the bottom floor. */
+static pb_point2D get_bottom_floor_centre(pb_building const* building) {
+    pb_point2D bottom_centre = {0.f, 0.f};
+    pb_point2D const* bottom_floor_points = (pb_point2D const*)building->floors[0].shape.points.items;
+    size_t i;
+    for (i = 0; i < building->floors[0].shape.points.size; ++i) {
+        bottom_centre.x += bottom_floor_points[i].x;
+        bottom_centre.y += bottom_floor_points[i].y;
+    }
+    bottom_centre.x /= building->floors[0].shape.points.size;
+    bottom_centre.y /= building->floors[0].shape.points.size;
+
+    return bottom_centre;
+}
+
+/**
+ * Works out the bounds of a shape from its vertices if whatever made it left them cleared, as extruders that don't
+ * know about bounds do. Everything else fills them in from what it knows of the shape as it goes.
+ */
+static void ensure_bounds(pb_shape3D* shape) {
+    if (shape->tris && shape->num_tris && shape->bounds.min.x > shape->bounds.max.x) {
+        pb_shape3D_get_bounds(shape, &shape->bounds);
+    }
+}
+
+/* Grows the box of bounds to contain the box of inner. */
+static void grow_box(pb_bounds3D* bounds, pb_bounds3D const* inner) {
+    if (inner->min.x <= inner->max.x) {
+        pb_bounds3D_add_point(bounds, &inner->min);
+        pb_bounds3D_add_point(bounds, &inner->max);
+    }
+}
+
+/* Makes sure that each shape has its bounds and grows the box of bounds to fit them. */
+static void bound_shapes(pb_shape3D* shapes, size_t num_shapes, pb_bounds3D* bounds) {
+    size_t i;
+    for (i = 0; i < num_shapes; ++i) {
+        ensure_bounds(shapes + i);
+        grow_box(bounds, &shapes[i].bounds);
+    }
+}
+
+/* Centres the sphere of bounds on its box, ready for enclose_bounds. */
+static void centre_bounds(pb_bounds3D* bounds) {
+    if (bounds->min.x <= bounds->max.x) {
+        bounds->centre.x = (bounds->min.x + bounds->max.x) / 2.f;
+        bounds->centre.y = (bounds->min.y + bounds->max.y) / 2.f;
+        bounds->centre.z = (bounds->min.z + bounds->max.z) / 2.f;
+    }
+}
+
+/* Grows the sphere of bounds to contain the sphere of inner. */
+static void enclose_bounds(pb_bounds3D* bounds, pb_bounds3D const* inner) {
+    float dx = inner->centre.x - bounds->centre.x;
+    float dy = inner->centre.y - bounds->centre.y;
+    float dz = inner->centre.z - bounds->centre.z;
+    float radius;
+
+    if (inner->min.x > inner->max.x) {
+        return;
+    }
+
+    radius = sqrtf(dx * dx + dy * dy + dz * dz) + inner->radius;
+    bounds->radius = radius > bounds->radius ? radius : bounds->radius;
+}
+
+static void enclose_shapes(pb_shape3D const* shapes, size_t num_shapes, pb_bounds3D* bounds) {
+    size_t i;
+    for (i = 0; i < num_shapes; ++i) {
+        enclose_bounds(bounds, &shapes[i].bounds);
+    }
+}
+
+/**
+ * Fills in the bounds of a room from the bounds of its shapes. The room's sphere is made from its shapes' spheres
+ * rather than their vertices, so that the vertices don't have to be gone through again.
+ */
+static void compute_room_bounds(pb_extruded_room* r) {
+    size_t i;
+
+    pb_bounds3D_clear(&r->bounds);
+    for (i = 0; i < r->num_wall_lists; ++i) {
+        if (r->walls[i]) {
+            bound_shapes(r->walls[i], r->wall_counts[i], &r->bounds);
+        }
+    }
+    bound_shapes(r->windows, r->num_windows, &r->bounds);
+    bound_shapes(r->doors, r->num_doors, &r->bounds);
+    bound_shapes(r->floor, r->num_floor_shapes, &r->bounds);
+    bound_shapes(r->ceiling, r->num_ceiling_shapes, &r->bounds);
+
+    centre_bounds(&r->bounds);
+    for (i = 0; i < r->num_wall_lists; ++i) {
+        if (r->walls[i]) {
+            enclose_shapes(r->walls[i], r->wall_counts[i], &r->bounds);
+        }
+    }
+    enclose_shapes(r->windows, r->num_windows, &r->bounds);
+    enclose_shapes(r->doors, r->num_doors, &r->bounds);
+    enclose_shapes(r->floor, r->num_floor_shapes, &r->bounds);
+    enclose_shapes(r->ceiling, r->num_ceiling_shapes, &r->bounds);
 }
+
+/* Fills in the bounds of a floor from its exterior's shapes and its rooms, which must already have their bounds. */
+static void compute_floor_bounds(pb_extruded_floor* f) {
+    size_t i;
+
+    pb_bounds3D_clear(&f->bounds);
+    for (i = 0; i < f->num_wall_lists; ++i) {
+        if (f->walls[i]) {
+            bound_shapes(f->walls[i], f->wall_counts[i], &f->bounds);
+        }
+    }
+    bound_shapes(f->windows, f->num_windows, &f->bounds);
+    bound_shapes(f->doors, f->num_doors, &f->bounds);
+    for (i = 0; i < f->num_rooms; ++i) {
+        grow_box(&f->bounds, &f->rooms[i]->bounds);
+    }
+
+    centre_bounds(&f->bounds);
+    for (i = 0; i < f->num_wall_lists; ++i) {
+        if (f->walls[i]) {
+            enclose_shapes(f->walls[i], f->wall_counts[i], &f->bounds);
+        }
+    }
+    enclose_shapes(f->windows, f->num_windows, &f->bounds);
+    enclose_shapes(f->doors, f->num_doors, &f->bounds);
+    for (i = 0; i < f->num_rooms; ++i) {
+        enclose_bounds(&f->bounds, &f->rooms[i]->bounds);
+    }
 }
 
 PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building(pb_building* building,
@@ -1010,22 +1249,33 @@ PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building(pb_building* buildin
                                                             pb_wall_structure_extruder const* window_extruder,
                                                             void* door_extruder_param,
                                                             void* window_extruder_param) {
+    return pb_extrude_building_ex(building, floor_height, door_height, window_height,
+                                  door_extruder, window_extruder, door_extruder_param, window_extruder_param, 0);
+}
+
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_ex(pb_building* building,
+                                                               float floor_height,
+                                                               float door_height,
+                                                               float window_height,
+                                                               pb_wall_structure_extruder const* door_extruder,
+                                                               pb_wall_structure_extruder const* window_extruder,
+                                                               void* door_extruder_param,
+                                                               void* window_extruder_param,
+                                                               unsigned flags) {
+
+    /* Shared walls and instancing are handled by the walker used for contiguous buildings, which doesn't build
+     * pb_extruded_floors */
+    if (flags & (PB_EXTRUDE_SHARED_WALLS_ONCE | PB_EXTRUDE_INSTANCE_STRUCTURES)) {
+        return NULL;
+    }
 
     pb_extruded_floor** result = malloc(sizeof(pb_extruded_floor*) * building->num_floors);
     if (!result) {
         return NULL;
     }
 
-    pb_point2D bottom_centre = {0.f, 0.f};
-    pb_point2D const* bottom_floor_points = (pb_point2D const*)building->floors[0].shape.points.items;
+    pb_point2D bottom_centre = get_bottom_floor_centre(building);
     size_t i;
-    for (i = 0; i < building->floors[0].shape.points.size; ++i) {
-        bottom_centre.x += bottom_floor_points[i].x;
-        bottom_centre.y += bottom_floor_points[i].y;
-    }
-    bottom_centre.x /= building->floors[0].shape.points.size;
-    bottom_centre.y /= building->floors[0].shape.points.size;
-
     for (i = 0; i < building->num_floors; ++i) {
         float cur_height = i * floor_height; // Could actually allow people to specify this for things like basements
         result[i] = pb_extrude_floor(building->floors + i, &bottom_centre,
@@ -1034,6 +1284,15 @@ PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building(pb_building* buildin
         if (result[i] == NULL) {
             break;
         }
+
+        /* The shapes already have their bounds, which only have to be merged into the rooms and the floor */
+        if (flags & PB_EXTRUDE_BOUNDS) {
+            size_t j;
+            for (j = 0; j < result[i]->num_rooms; ++j) {
+                compute_room_bounds(result[i]->rooms[j]);
+            }
+            compute_floor_bounds(result[i]);
+        }
     }
 
     if (i == building->num_floors) {
@@ -1041,14 +1300,2558 @@ PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building(pb_building* buildin
     } else {
         size_t j;
         for (j = 0; j < i; ++j) {
-            pb_extruded_floor_free(result[i]);
-            free(result[i]);
+            pb_extruded_floor_free(result[j]);
+            free(result[j]);
         }
         free(result);
         return NULL;
     }
 }
 
+/**
+ * A building being extruded on a thread pool. Each task extrudes one part of the building: either the exterior of a
+ * floor or one of its rooms.
+ */
+typedef struct {
+    pb_building* building;
+    pb_point2D bottom_floor_centre;
+    float floor_height;
+    float door_height;
+    float window_height;
+    pb_wall_structure_extruder const* door_extruder;
+    pb_wall_structure_extruder const* window_extruder;
+    void* door_extruder_param;
+    void* window_extruder_param;
+    int bounds; /* See PB_EXTRUDE_BOUNDS */
+
+    pb_extruded_floor** floors;
+    size_t* part_floors;  /* The floor that each task belongs to */
+    size_t* part_rooms;   /* The room that each task extrudes, or PB_EXTRUDED_EXTERIOR */
+    int* part_results;
+} parallel_extrusion;
+
+static void extrude_part_task(size_t index, size_t worker, void* param) {
+    parallel_extrusion* p = (parallel_extrusion*)param;
+    size_t floor_index = p->part_floors[index];
+    size_t room_index = p->part_rooms[index];
+    pb_floor* f = p->building->floors + floor_index;
+    pb_extruded_floor* out = p->floors[floor_index];
+    float start_height = floor_index * p->floor_height;
+    (void)worker;
+
+    if (room_index == PB_EXTRUDED_EXTERIOR) {
+        p->part_results[index] = extrude_floor_exterior(f, &p->bottom_floor_centre,
+                                                        start_height, p->floor_height,
+                                                        p->door_height, p->window_height,
+                                                        p->door_extruder, p->window_extruder,
+                                                        p->door_extruder_param, p->window_extruder_param,
+                                                        out);
+    } else {
+        out->rooms[room_index] = pb_extrude_room(f->rooms + room_index, &p->bottom_floor_centre,
+                                                 start_height, p->floor_height,
+                                                 p->door_height, p->window_height,
+                                                 p->door_extruder, p->window_extruder,
+                                                 p->door_extruder_param, p->window_extruder_param);
+        p->part_results[index] = out->rooms[room_index] ? 0 : -1;
+
+        /* The floors are bounded once all of their rooms are, after every task has finished */
+        if (out->rooms[room_index] && p->bounds) {
+            compute_room_bounds(out->rooms[room_index]);
+        }
+    }
+}
+
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_parallel(pb_building* building,
+                                                                     float floor_height,
+                                                                     float door_height,
+                                                                     float window_height,
+                                                                     pb_wall_structure_extruder const* door_extruder,
+                                                                     pb_wall_structure_extruder const* window_extruder,
+                                                                     void* door_extruder_param,
+                                                                     void* window_extruder_param,
+                                                                     pb_thread_pool* pool) {
+    return pb_extrude_building_parallel_ex(building, floor_height, door_height, window_height,
+                                           door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                           0, pool);
+}
+
+PB_DECLSPEC pb_extruded_floor** PB_CALL pb_extrude_building_parallel_ex(pb_building* building,
+                                                                        float floor_height,
+                                                                        float door_height,
+                                                                        float window_height,
+                                                                        pb_wall_structure_extruder const* door_extruder,
+                                                                        pb_wall_structure_extruder const* window_extruder,
+                                                                        void* door_extruder_param,
+                                                                        void* window_extruder_param,
+                                                                        unsigned flags,
+                                                                        pb_thread_pool* pool) {
+    if (!pool || (flags & (PB_EXTRUDE_SHARED_WALLS_ONCE | PB_EXTRUDE_INSTANCE_STRUCTURES))) {
+        return pb_extrude_building_ex(building, floor_height, door_height, window_height,
+                                      door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                      flags);
+    }
+
+    parallel_extrusion p;
+    size_t num_parts = 0;
+    size_t i, j;
+
+    for (i = 0; i < building->num_floors; ++i) {
+        num_parts += 1 + building->floors[i].num_rooms;
+    }
+
+    p.building = building;
+    p.bottom_floor_centre = get_bottom_floor_centre(building);
+    p.floor_height = floor_height;
+    p.door_height = door_height;
+    p.window_height = window_height;
+    p.door_extruder = door_extruder;
+    p.window_extruder = window_extruder;
+    p.door_extruder_param = door_extruder_param;
+    p.window_extruder_param = window_extruder_param;
+    p.bounds = (flags & PB_EXTRUDE_BOUNDS) != 0;
+
+    /* calloc so that everything can be freed safely if some of it fails */
+    p.floors = calloc(sizeof(pb_extruded_floor*), building->num_floors);
+    p.part_floors = malloc(sizeof(size_t) * num_parts);
+    p.part_rooms = malloc(sizeof(size_t) * num_parts);
+    p.part_results = malloc(sizeof(int) * num_parts);
+
+    int result = p.floors && p.part_floors && p.part_rooms && p.part_results ? 0 : -1;
+    size_t cur_part = 0;
+
+    for (i = 0; i < building->num_floors && result == 0; ++i) {
+        size_t num_rooms = building->floors[i].num_rooms;
+        pb_extruded_floor* f = calloc(sizeof(pb_extruded_floor), 1);
+        pb_extruded_room** rooms = num_rooms ? calloc(sizeof(pb_extruded_room*), num_rooms) : NULL;
+
+        if (!f || (num_rooms && !rooms)) {
+            free(f);
+            free(rooms);
+            result = -1;
+            break;
+        }
+
+        f->rooms = rooms;
+        p.floors[i] = f;
+
+        for (j = 0; j <= num_rooms; ++j) {
+            p.part_floors[cur_part] = i;
+            p.part_rooms[cur_part] = j == 0 ? PB_EXTRUDED_EXTERIOR : j - 1;
+            cur_part++;
+        }
+    }
+
+    if (result == 0) {
+        pb_thread_pool_run(pool, num_parts, extrude_part_task, &p);
+
+        for (i = 0; i < num_parts; ++i) {
+            if (p.part_results[i] == -1) {
+                result = -1;
+            }
+        }
+    }
+
+    /* The rooms are filled in by the tasks, so a floor only knows how many it has once they've all finished */
+    for (i = 0; i < building->num_floors && p.floors && p.floors[i]; ++i) {
+        p.floors[i]->num_rooms = building->floors[i].num_rooms;
+    }
+
+    for (i = 0; i < building->num_floors && result == 0 && p.bounds; ++i) {
+        compute_floor_bounds(p.floors[i]);
+    }
+
+    if (result == -1 && p.floors) {
+        for (i = 0; i < building->num_floors && p.floors[i]; ++i) {
+            pb_extruded_floor* f = p.floors[i];
+
+            /* Only free what was actually extruded */
+            for (j = 0; j < f->num_rooms; ++j) {
+                if (f->rooms[j]) {
+                    pb_extruded_room_free(f->rooms[j]);
+                    free(f->rooms[j]);
+                }
+            }
+            free(f->rooms);
+            f->rooms = NULL;
+            f->num_rooms = 0;
+
+            pb_extruded_floor_free(f);
+            free(f);
+        }
+        free(p.floors);
+        p.floors = NULL;
+    }
+
+    free(p.part_floors);
+    free(p.part_rooms);
+    free(p.part_results);
+    return p.floors;
+}
+
+/**
+ * Receives the shapes produced while walking a building. Extrusion is split into parts: the exterior of each floor,
+ * followed by each of the floor's rooms (the room is PB_EXTRUDED_EXTERIOR for the exterior). The shapes handed to add
+ * are only valid for the duration of the call.
+ *
+ * If needs_counts is set, begin_part is given the number of shapes and triangles that the part will produce;
+ * otherwise the counts are NULL. If needs_bounds is set, the shapes handed to add have their bounds filled in.
+ *
+ * If layout is set, the sink stores vertices in that layout, and shapes are written straight into it where possible:
+ * reserve gets the index of the vertex at which the next shape of a category goes, the shape's vertices are written
+ * there, and the shape is then added with NULL tris. Shapes that are added with tris are converted by the sink.
+ */
+typedef struct extrusion_sink extrusion_sink;
+struct extrusion_sink {
+    int needs_counts;
+    int needs_bounds;
+    pb_vertex_layout const* layout;
+    int (*begin_part)(extrusion_sink* sink, size_t floor, size_t room, pb_extrusion_counts const* counts);
+    int (*begin_wall_list)(extrusion_sink* sink);
+    int (*reserve)(extrusion_sink* sink, pb_extruded_category category, size_t num_verts, size_t* first);
+    int (*add)(extrusion_sink* sink, pb_extruded_category category, pb_shape3D const* shape);
+    int (*end_part)(extrusion_sink* sink);
+};
+
+/**
+ * The parameters shared by a whole building's extrusion, along with the sink receiving the shapes and some scratch
+ * space that is reused for every room.
+ */
+typedef struct {
+    pb_point2D bottom_floor_centre;
+    float floor_height;
+    float door_height;
+    float window_height;
+    pb_wall_structure_extruder const* door_extruder;
+    pb_wall_structure_extruder const* window_extruder;
+    void* door_extruder_param;
+    void* window_extruder_param;
+
+    /* See pb_extrusion_flags. cur_floor and cur_room are the part being walked or counted. */
+    int shared_walls_once;
+    int instance_structures;
+    pb_floor const* cur_floor;
+    size_t cur_room;
+
+    pb_vector scratch_verts;  /* pb_vert3D */
+    pb_vector scratch_shapes; /* pb_shape3D */
+    pb_vector scratch_spans;  /* pb_point2D, see get_wall_spans */
+    extrusion_sink* sink;
+} extrusion_walker;
+
+static void init_walker(extrusion_walker* w, pb_building const* building,
+                        float floor_height, float door_height, float window_height,
+                        pb_wall_structure_extruder const* door_extruder,
+                        pb_wall_structure_extruder const* window_extruder,
+                        void* door_extruder_param, void* window_extruder_param,
+                        unsigned flags, extrusion_sink* sink) {
+    w->bottom_floor_centre = get_bottom_floor_centre(building);
+    w->floor_height = floor_height;
+    w->door_height = door_height;
+    w->window_height = window_height;
+    w->door_extruder = door_extruder;
+    w->window_extruder = window_extruder;
+    w->door_extruder_param = door_extruder_param;
+    w->window_extruder_param = window_extruder_param;
+    w->shared_walls_once = (flags & PB_EXTRUDE_SHARED_WALLS_ONCE) != 0;
+    w->instance_structures = (flags & PB_EXTRUDE_INSTANCE_STRUCTURES) != 0;
+    w->cur_floor = NULL;
+    w->cur_room = PB_EXTRUDED_EXTERIOR;
+    w->sink = sink;
+
+    /* The scratch space is only allocated once it's needed */
+    w->scratch_verts.items = NULL;
+    w->scratch_verts.item_size = sizeof(pb_vert3D);
+    w->scratch_verts.size = 0;
+    w->scratch_verts.cap = 0;
+
+    w->scratch_shapes.items = NULL;
+    w->scratch_shapes.item_size = sizeof(pb_shape3D);
+    w->scratch_shapes.size = 0;
+    w->scratch_shapes.cap = 0;
+
+    w->scratch_spans.items = NULL;
+    w->scratch_spans.item_size = sizeof(pb_point2D);
+    w->scratch_spans.size = 0;
+    w->scratch_spans.cap = 0;
+}
+
+static void free_walker(extrusion_walker* w) {
+    pb_vector_free(&w->scratch_verts);
+    pb_vector_free(&w->scratch_shapes);
+    pb_vector_free(&w->scratch_spans);
+}
+
+static int reserve_scratch(pb_vector* scratch, size_t cap) {
+    return scratch->cap >= cap ? 0 : pb_vector_resize(scratch, cap);
+}
+
+/**
+ * Gets the line and normal for one side of a room or floor. Rooms have their walls flipped to correctly generate UVs,
+ * and their normals face the other way.
+ */
+static void get_wall_line(pb_shape2D const* shape, size_t side, int is_room, pb_line2D* wall_line, pb_point2D* normal) {
+    pb_point2D const* points = (pb_point2D const*)shape->points.items;
+    pb_point2D const* point0 = points + side;
+    pb_point2D const* point1 = points + ((side + 1) % shape->points.size);
+    pb_line2D wall_normal_line;
+
+    wall_line->start = is_room ? *point1 : *point0;
+    wall_line->end = is_room ? *point0 : *point1;
+    wall_normal_line.start = wall_line->end;
+    wall_normal_line.end = wall_line->start;
+
+    *normal = pb_line2D_get_normal(&wall_normal_line);
+}
+
+/* How close (in world units) two walls need to be to count as the same wall. */
+#define SHARED_WALL_EPSILON 1e-4f
+
+/**
+ * Gets how far a point is along a line, where 0 is the line's start and 1 is its end.
+ */
+static float get_line_t(pb_line2D const* line, pb_point2D const* p, float line_len_sq) {
+    return ((p->x - line->start.x) * (line->end.x - line->start.x) +
+            (p->y - line->start.y) * (line->end.y - line->start.y)) / line_len_sq;
+}
+
+/**
+ * Removes the range [start, end] from a sorted list of spans.
+ */
+static int subtract_span(pb_vector* spans, float start, float end) {
+    size_t i;
+    for (i = 0; i < spans->size; ++i) {
+        pb_point2D* span = (pb_point2D*)spans->items + i;
+
+        if (end <= span->x || start >= span->y) {
+            continue;
+        }
+
+        if (start <= span->x && end >= span->y) {
+            memmove(span, span + 1, (spans->size - i - 1) * sizeof(pb_point2D));
+            spans->size--;
+            --i;
+        } else if (start > span->x && end < span->y) {
+            /* Split in two */
+            if (reserve_scratch(spans, spans->size + 1) == -1) {
+                return -1;
+            }
+
+            span = (pb_point2D*)spans->items + i;
+            memmove(span + 2, span + 1, (spans->size - i - 1) * sizeof(pb_point2D));
+            spans->size++;
+            span[1].x = end;
+            span[1].y = span->y;
+            span->y = start;
+            ++i;
+        } else if (start <= span->x) {
+            span->x = end;
+        } else {
+            span->y = start;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Finds the parts of a wall that the current part should extrude. Normally this is the whole wall, but with
+ * PB_EXTRUDE_SHARED_WALLS_ONCE a room leaves out any stretch that lies along a walled side of an earlier room on the
+ * same floor, since that room has already extruded it.
+ *
+ * The spans are stored in the walker's scratch_spans in order, with x and y holding how far along the wall line each
+ * one starts and ends (see get_line_t).
+ *
+ * @param w         The walker.
+ * @param wall_line The wall.
+ * @param num_spans Holds the number of spans, which may be 0 if the whole wall is shared.
+ *
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+static int get_wall_spans(extrusion_walker* w, pb_line2D const* wall_line, size_t* num_spans) {
+    pb_vector* spans = &w->scratch_spans;
+    pb_point2D full = {0.f, 1.f};
+    size_t i, j;
+
+    if (reserve_scratch(spans, 1) == -1) {
+        return -1;
+    }
+    *(pb_point2D*)spans->items = full;
+    spans->size = 1;
+
+    if (w->shared_walls_once && w->cur_room != PB_EXTRUDED_EXTERIOR) {
+        pb_point2D dir = {wall_line->end.x - wall_line->start.x, wall_line->end.y - wall_line->start.y};
+        float len_sq = dir.x * dir.x + dir.y * dir.y;
+        float len = sqrtf(len_sq);
+
+        for (i = 0; i < w->cur_room && spans->size != 0 && len > 0.f; ++i) {
+            pb_room const* other = w->cur_floor->rooms + i;
+            pb_point2D const* points = (pb_point2D const*)other->shape.points.items;
+            int const* has_wall = (int const*)other->walls.items;
+            size_t num_sides = other->shape.points.size;
+
+            for (j = 0; j < num_sides; ++j) {
+                pb_point2D const* p0 = points + j;
+                pb_point2D const* p1 = points + ((j + 1) % num_sides);
+
+                if (has_wall && !has_wall[j]) {
+                    continue;
+                }
+
+                /* Both ends have to lie on the wall's line */
+                float cross0 = dir.x * (p0->y - wall_line->start.y) - dir.y * (p0->x - wall_line->start.x);
+                float cross1 = dir.x * (p1->y - wall_line->start.y) - dir.y * (p1->x - wall_line->start.x);
+                if (fabsf(cross0) > SHARED_WALL_EPSILON * len || fabsf(cross1) > SHARED_WALL_EPSILON * len) {
+                    continue;
+                }
+
+                float t0 = get_line_t(wall_line, p0, len_sq);
+                float t1 = get_line_t(wall_line, p1, len_sq);
+                float start = t0 < t1 ? t0 : t1;
+                float end = t0 < t1 ? t1 : t0;
+
+                if ((end - start) * len > SHARED_WALL_EPSILON &&
+                    subtract_span(spans, start, end) == -1) {
+                    return -1;
+                }
+            }
+        }
+
+        /* Drop any slivers left over from rounding */
+        j = 0;
+        for (i = 0; i < spans->size; ++i) {
+            pb_point2D span = ((pb_point2D*)spans->items)[i];
+            if ((span.y - span.x) * len > SHARED_WALL_EPSILON) {
+                ((pb_point2D*)spans->items)[j++] = span;
+            }
+        }
+        spans->size = j;
+    }
+
+    *num_spans = spans->size;
+    return 0;
+}
+
+/**
+ * Finds the range of structures whose centres lie within a span. The structures must be sorted along the wall.
+ */
+static void get_span_structures(pb_line2D const* wall_line, pb_point2D const* span,
+                                pb_wall_structure const* structures, size_t num_structures,
+                                size_t* first, size_t* last) {
+    pb_point2D dir = {wall_line->end.x - wall_line->start.x, wall_line->end.y - wall_line->start.y};
+    float len_sq = dir.x * dir.x + dir.y * dir.y;
+    size_t i = 0;
+
+    while (i < num_structures) {
+        pb_point2D centre = {(structures[i].start.x + structures[i].end.x) / 2.f,
+                             (structures[i].start.y + structures[i].end.y) / 2.f};
+        if (get_line_t(wall_line, &centre, len_sq) >= span->x) {
+            break;
+        }
+        ++i;
+    }
+    *first = i;
+
+    while (i < num_structures) {
+        pb_point2D centre = {(structures[i].start.x + structures[i].end.x) / 2.f,
+                             (structures[i].start.y + structures[i].end.y) / 2.f};
+        if (get_line_t(wall_line, &centre, len_sq) > span->y) {
+            break;
+        }
+        ++i;
+    }
+    *last = i;
+}
+
+/**
+ * Gets the part of a wall covered by a span.
+ */
+static void get_span_line(pb_line2D const* wall_line, pb_point2D const* span, pb_line2D* span_line) {
+    /* Keep the wall's own end points where possible so that nothing moves when the whole wall is used */
+    pb_point2D dir = {wall_line->end.x - wall_line->start.x, wall_line->end.y - wall_line->start.y};
+
+    span_line->start = wall_line->start;
+    span_line->end = wall_line->end;
+    if (span->x != 0.f) {
+        span_line->start.x += dir.x * span->x;
+        span_line->start.y += dir.y * span->x;
+    }
+    if (span->y != 1.f) {
+        span_line->end.x = wall_line->start.x + dir.x * span->y;
+        span_line->end.y = wall_line->start.y + dir.y * span->y;
+    }
+}
+
+/**
+ * Whether a wall's spans cover all of it, in which case every one of its doors and windows belongs to it.
+ */
+static int spans_are_whole(pb_point2D const* spans, size_t num_spans) {
+    return num_spans == 1 && spans->x == 0.f && spans->y == 1.f;
+}
+
+/**
+ * Whether the centre of a door or window lies within one of a wall's spans.
+ */
+static int structure_in_spans(pb_line2D const* wall_line, pb_wall_structure const* s,
+                              pb_point2D const* spans, size_t num_spans) {
+    pb_point2D dir = {wall_line->end.x - wall_line->start.x, wall_line->end.y - wall_line->start.y};
+    pb_point2D centre = {(s->start.x + s->end.x) / 2.f, (s->start.y + s->end.y) / 2.f};
+    float t = get_line_t(wall_line, &centre, dir.x * dir.x + dir.y * dir.y);
+    size_t i;
+
+    if (spans_are_whole(spans, num_spans)) {
+        return 1;
+    }
+
+    for (i = 0; i < num_spans; ++i) {
+        if (t >= spans[i].x && t <= spans[i].y) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Adds the shapes and triangles produced by a door or window to the given counts.
+ */
+static int count_structure(extrusion_walker const* w, pb_line2D const* wall, pb_line2D const* structure,
+                           pb_point2D const* normal, float start_height, int is_door, pb_extrusion_counts* counts) {
+    pb_wall_structure_extruder const* extruder = is_door ? w->door_extruder : w->window_extruder;
+    void* param = is_door ? w->door_extruder_param : w->window_extruder_param;
+    float struct_height = is_door ? w->door_height : w->window_height;
+    pb_extruded_category category = is_door ? PB_EXTRUDED_DOOR : PB_EXTRUDED_WINDOW;
+
+    size_t num_walls;
+    size_t num_shapes;
+    size_t num_wall_tris = 0;
+    size_t num_shape_tris = 0;
+
+    extruder->count(wall, structure, normal, &w->bottom_floor_centre,
+                    w->floor_height, struct_height, start_height,
+                    param, &num_walls, &num_shapes);
+
+    if (extruder->tri_count) {
+        extruder->tri_count(wall, structure, normal, &w->bottom_floor_centre,
+                            w->floor_height, struct_height, start_height,
+                            param, &num_wall_tris, &num_shape_tris);
+    } else {
+        /* No way of knowing other than to run it */
+        pb_shape3D* walls;
+        pb_shape3D* shapes;
+        size_t i;
+
+        if (extruder->extrude(wall, structure, normal, &w->bottom_floor_centre,
+                              w->floor_height, struct_height, start_height,
+                              param, &walls, &shapes) == -1) {
+            return -1;
+        }
+
+        for (i = 0; i < num_walls; ++i) {
+            num_wall_tris += walls[i].num_tris;
+            pb_shape3D_free(walls + i);
+        }
+        for (i = 0; i < num_shapes; ++i) {
+            num_shape_tris += shapes[i].num_tris;
+            pb_shape3D_free(shapes + i);
+        }
+        free(walls);
+        free(shapes);
+    }
+
+    counts->num_shapes[PB_EXTRUDED_WALL] += num_walls;
+    counts->num_tris[PB_EXTRUDED_WALL] += num_wall_tris;
+    if (!w->instance_structures) {
+        counts->num_shapes[category] += num_shapes;
+        counts->num_tris[category] += num_shape_tris;
+    }
+    return 0;
+}
+
+/**
+ * Counts the shapes and triangles produced for a room or the exterior of a floor.
+ *
+ * @param w            The walker.
+ * @param shape        The room or floor's shape.
+ * @param has_wall     Which sides have a wall (see pb_room.walls), or NULL if they all do.
+ * @param doors        The room or floor's doors.
+ * @param num_doors    The number of doors.
+ * @param windows      The room or floor's windows.
+ * @param num_windows  The number of windows.
+ * @param room         The room, or NULL for the exterior of a floor.
+ * @param start_height The height at which the walls start.
+ * @param counts       Holds the counts.
+ */
+static int count_part(extrusion_walker* w, pb_shape2D const* shape, int const* has_wall,
+                      pb_wall_structure const* doors, size_t num_doors,
+                      pb_wall_structure const* windows, size_t num_windows,
+                      pb_room const* room, float start_height, pb_extrusion_counts* counts) {
+    size_t num_sides = shape->points.size;
+    size_t i, j;
+
+    memset(counts, 0, sizeof(pb_extrusion_counts));
+    counts->num_wall_lists = num_sides;
+
+    for (i = 0; i < num_sides; ++i) {
+        pb_line2D wall_line;
+        pb_point2D normal;
+        size_t num_spans;
+
+        if (has_wall && !has_wall[i]) {
+            continue;
+        }
+
+        get_wall_line(shape, i, room != NULL, &wall_line, &normal);
+        if (get_wall_spans(w, &wall_line, &num_spans) == -1) {
+            return -1;
+        }
+
+        pb_point2D const* spans = (pb_point2D const*)w->scratch_spans.items;
+
+        counts->num_shapes[PB_EXTRUDED_WALL] += num_spans;
+        counts->num_tris[PB_EXTRUDED_WALL] += num_spans * 2;
+
+        /* Each door and window also splits its wall in two */
+        for (j = 0; j < num_doors + num_windows; ++j) {
+            int is_door = j < num_doors;
+            pb_wall_structure const* s = is_door ? doors + j : windows + (j - num_doors);
+            pb_line2D structure;
+
+            if (s->wall != i || !structure_in_spans(&wall_line, s, spans, num_spans)) {
+                continue;
+            }
+
+            structure.start = s->start;
+            structure.end = s->end;
+
+            counts->num_shapes[PB_EXTRUDED_WALL]++;
+            counts->num_tris[PB_EXTRUDED_WALL] += 2;
+            if (count_structure(w, &wall_line, &structure, &normal, start_height, is_door, counts) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    if (room) {
+        size_t num_tris = pb_shape2D_get_num_tris(&room->shape);
+        if (room->has_floor) {
+            counts->num_shapes[PB_EXTRUDED_FLOOR] = 1;
+            counts->num_tris[PB_EXTRUDED_FLOOR] = num_tris;
+        }
+        if (room->has_ceiling) {
+            counts->num_shapes[PB_EXTRUDED_CEILING] = 1;
+            counts->num_tris[PB_EXTRUDED_CEILING] = num_tris;
+        }
+    }
+
+    return 0;
+}
+
+static int count_floor_exterior(extrusion_walker* w, pb_floor const* f, float start_height,
+                                pb_extrusion_counts* counts) {
+    w->cur_floor = f;
+    w->cur_room = PB_EXTRUDED_EXTERIOR;
+    return count_part(w, &f->shape, NULL, f->doors, f->num_doors, f->windows, f->num_windows,
+                      NULL, start_height, counts);
+}
+
+static int count_room(extrusion_walker* w, pb_floor const* f, size_t room_index, float start_height,
+                      pb_extrusion_counts* counts) {
+    pb_room const* room = f->rooms + room_index;
+
+    w->cur_floor = f;
+    w->cur_room = room_index;
+    return count_part(w, &room->shape, (int const*)room->walls.items,
+                      room->doors, room->num_doors, room->windows, room->num_windows,
+                      room, start_height, counts);
+}
+
+/**
+ * Extrudes a door or window and passes the resulting shapes on to the sink. Extruders with a fill function are
+ * extruded into the walker's scratch space.
+ */
+static int walk_structure(extrusion_walker* w, pb_line2D const* wall, pb_line2D const* structure,
+                          pb_point2D const* normal, float start_height, int is_door) {
+    pb_wall_structure_extruder const* extruder = is_door ? w->door_extruder : w->window_extruder;
+    void* param = is_door ? w->door_extruder_param : w->window_extruder_param;
+    float struct_height = is_door ? w->door_height : w->window_height;
+    pb_extruded_category category = is_door ? PB_EXTRUDED_DOOR : PB_EXTRUDED_WINDOW;
+
+    size_t num_walls;
+    size_t num_shapes;
+    pb_shape3D* walls;
+    pb_shape3D* shapes;
+    size_t i;
+
+    extruder->count(wall, structure, normal, &w->bottom_floor_centre,
+                    w->floor_height, struct_height, start_height,
+                    param, &num_walls, &num_shapes);
+
+    int fill_layout = w->sink->layout && extruder->fill_layout;
+    if (extruder->tri_count && (extruder->fill || fill_layout)) {
+        size_t num_wall_tris;
+        size_t num_shape_tris;
+
+        extruder->tri_count(wall, structure, normal, &w->bottom_floor_centre,
+                            w->floor_height, struct_height, start_height,
+                            param, &num_wall_tris, &num_shape_tris);
+
+        if (reserve_scratch(&w->scratch_shapes, num_walls + num_shapes) == -1) {
+            return -1;
+        }
+
+        walls = (pb_shape3D*)w->scratch_shapes.items;
+        shapes = walls + num_walls;
+
+        /* Cleared so that it shows if the extruder didn't fill them in */
+        for (i = 0; i < num_walls + num_shapes; ++i) {
+            pb_bounds3D_clear(&walls[i].bounds);
+        }
+
+        if (fill_layout) {
+            size_t wall_vert;
+            size_t shape_vert = 0;
+
+            if (w->sink->reserve(w->sink, PB_EXTRUDED_WALL, num_wall_tris * 3, &wall_vert) == -1 ||
+                (!w->instance_structures &&
+                 w->sink->reserve(w->sink, category, num_shape_tris * 3, &shape_vert) == -1)) {
+                return -1;
+            }
+
+            if (extruder->fill_layout(wall, structure, normal, &w->bottom_floor_centre,
+                                      w->floor_height, struct_height, start_height,
+                                      param, w->sink->layout, walls, wall_vert,
+                                      w->instance_structures ? NULL : shapes, shape_vert) == -1) {
+                return -1;
+            }
+        } else {
+            if (reserve_scratch(&w->scratch_verts, (num_wall_tris + num_shape_tris) * 3) == -1) {
+                return -1;
+            }
+
+            pb_vert3D* wall_verts = (pb_vert3D*)w->scratch_verts.items;
+            if (extruder->fill(wall, structure, normal, &w->bottom_floor_centre,
+                               w->floor_height, struct_height, start_height,
+                               param, walls, wall_verts, shapes, wall_verts + num_wall_tris * 3) == -1) {
+                return -1;
+            }
+        }
+
+        for (i = 0; i < num_walls; ++i) {
+            if (w->sink->needs_bounds) {
+                ensure_bounds(walls + i);
+            }
+            if (w->sink->add(w->sink, PB_EXTRUDED_WALL, walls + i) == -1) {
+                return -1;
+            }
+        }
+        for (i = 0; i < num_shapes && !w->instance_structures; ++i) {
+            if (w->sink->needs_bounds) {
+                ensure_bounds(shapes + i);
+            }
+            if (w->sink->add(w->sink, category, shapes + i) == -1) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (extruder->extrude(wall, structure, normal, &w->bottom_floor_centre,
+                          w->floor_height, struct_height, start_height,
+                          param, &walls, &shapes) == -1) {
+        return -1;
+    }
+
+    /* Keep going after a failure so that everything gets freed */
+    int result = 0;
+    for (i = 0; i < num_walls; ++i) {
+        if (w->sink->needs_bounds) {
+            ensure_bounds(walls + i);
+        }
+        if (result == 0 && w->sink->add(w->sink, PB_EXTRUDED_WALL, walls + i) == -1) {
+            result = -1;
+        }
+        pb_shape3D_free(walls + i);
+    }
+
+    for (i = 0; i < num_shapes; ++i) {
+        if (w->sink->needs_bounds && !w->instance_structures) {
+            ensure_bounds(shapes + i);
+        }
+        if (result == 0 && !w->instance_structures && w->sink->add(w->sink, category, shapes + i) == -1) {
+            result = -1;
+        }
+        pb_shape3D_free(shapes + i);
+    }
+
+    free(walls);
+    free(shapes);
+    return result;
+}
+
+/**
+ * Passes a wall quad on to the sink, writing it straight into the sink's layout if it has one.
+ */
+static int walk_wall_quad(extrusion_walker* w, pb_point3D const* pos, pb_quad_verts const* quad) {
+    pb_vert3D tris[6];
+    pb_shape3D shape;
+
+    shape.pos = *pos;
+    shape.num_tris = 2;
+    if (w->sink->needs_bounds) {
+        pb_get_quad_bounds(quad, pos, &shape.bounds);
+    }
+
+    if (w->sink->layout) {
+        size_t first;
+        if (w->sink->reserve(w->sink, PB_EXTRUDED_WALL, 6, &first) == -1) {
+            return -1;
+        }
+        pb_write_quad_verts(quad, w->sink->layout, first);
+        shape.tris = NULL;
+    } else {
+        pb_fill_quad_verts(quad, tris);
+        shape.tris = tris;
+    }
+
+    return w->sink->add(w->sink, PB_EXTRUDED_WALL, &shape);
+}
+
+/**
+ * Extrudes part of a wall along with its doors and windows, producing the same shapes in the same order as
+ * pb_extrude_wall when the part is the whole wall. The door and window lists will be sorted, and must lie within the
+ * part.
+ */
+static int walk_wall(extrusion_walker* w, pb_line2D const* wall, pb_line2D const* span,
+                     pb_wall_structure* doors, size_t num_doors,
+                     pb_wall_structure* windows, size_t num_windows,
+                     pb_point2D const* normal, float start_height) {
+    pb_line2D sub_wall;
+    pb_point3D quad_pos;
+    pb_quad_verts quad;
+
+    sort_structures_along_line(wall, doors, num_doors);
+    sort_structures_along_line(wall, windows, num_windows);
+
+    int end_is_start = 0;
+    if (num_doors || num_windows) {
+        pb_wall_structure const* first = num_doors ? doors : windows;
+        pb_point2D first_start_t = pb_line2D_get_t(wall, &first->start);
+        pb_point2D first_end_t = pb_line2D_get_t(wall, &first->end);
+
+        end_is_start = first_end_t.x != INFINITY ? first_end_t.x < first_start_t.x
+                                                 : first_end_t.y < first_start_t.y;
+    }
+
+    pb_point2D start_to_end = {wall->end.x - wall->start.x, wall->end.y - wall->start.y};
+    int x_is_cmp = start_to_end.x != 0.f;
+    int cmp_is_less = x_is_cmp ? start_to_end.x > 0.f : start_to_end.y > 0.f; /* Are smaller x/y values closer to the start? */
+
+    size_t cur_door = 0;
+    size_t cur_window = 0;
+    sub_wall.start = span->start;
+
+    while (cur_door < num_doors || cur_window < num_windows) {
+        int is_door;
+
+        if (cur_door < num_doors && cur_window < num_windows) {
+            pb_point2D const* door_point = end_is_start ? &doors[cur_door].end : &doors[cur_door].start;
+            pb_point2D const* window_point = end_is_start ? &windows[cur_window].end : &windows[cur_window].start;
+            float door_cmp = x_is_cmp ? door_point->x : door_point->y;
+            float window_cmp = x_is_cmp ? window_point->x : window_point->y;
+
+            is_door = cmp_is_less ? door_cmp < window_cmp : door_cmp > window_cmp;
+        } else {
+            is_door = cur_door < num_doors;
+        }
+
+        pb_wall_structure const* next = is_door ? doors + cur_door++ : windows + cur_window++;
+        pb_line2D structure;
+        structure.start = next->start;
+        structure.end = next->end;
+
+        sub_wall.end = end_is_start ? structure.end : structure.start;
+        get_wall_quad(wall, &sub_wall, &w->bottom_floor_centre, start_height, w->floor_height, normal,
+                      &quad_pos, &quad);
+        if (walk_wall_quad(w, &quad_pos, &quad) == -1) {
+            return -1;
+        }
+
+        if (walk_structure(w, wall, &structure, normal, start_height, is_door) == -1) {
+            return -1;
+        }
+
+        sub_wall.start = end_is_start ? structure.start : structure.end;
+    }
+
+    sub_wall.end = span->end;
+    get_wall_quad(wall, &sub_wall, &w->bottom_floor_centre, start_height, w->floor_height, normal, &quad_pos, &quad);
+    return walk_wall_quad(w, &quad_pos, &quad);
+}
+
+/**
+ * Extrudes every side of a room or floor, starting a new wall list for each side.
+ *
+ * @param w            The walker.
+ * @param shape        The room or floor's shape.
+ * @param has_wall     Which sides have a wall (see pb_room.walls), or NULL if they all do.
+ * @param doors        The room or floor's doors. Will be sorted.
+ * @param num_doors    The number of doors.
+ * @param windows      The room or floor's windows. Will be sorted.
+ * @param num_windows  The number of windows.
+ * @param is_room      Whether the shape is a room rather than a floor.
+ * @param start_height The height at which the walls start.
+ */
+static int walk_wall_lists(extrusion_walker* w, pb_shape2D const* shape, int const* has_wall,
+                           pb_wall_structure* doors, size_t num_doors,
+                           pb_wall_structure* windows, size_t num_windows,
+                           int is_room, float start_height) {
+    size_t cur_wall;
+    size_t cur_door = 0;
+    size_t cur_window = 0;
+
+    if (num_doors != 0) {
+        qsort(doors, num_doors, sizeof(pb_wall_structure), wall_structure_cmp);
+    }
+
+    if (num_windows != 0) {
+        qsort(windows, num_windows, sizeof(pb_wall_structure), wall_structure_cmp);
+    }
+
+    for (cur_wall = 0; cur_wall < shape->points.size; ++cur_wall) {
+        if (w->sink->begin_wall_list(w->sink) == -1) {
+            return -1;
+        }
+
+        if (has_wall && !has_wall[cur_wall]) {
+            continue;
+        }
+
+        /* Find the list of doors and windows for this wall, if any */
+        while (cur_door < num_doors && doors[cur_door].wall < cur_wall) ++cur_door;
+        while (cur_window < num_windows && windows[cur_window].wall < cur_wall) ++cur_window;
+
+        size_t door_list_end = cur_door;
+        size_t window_list_end = cur_window;
+        while (door_list_end < num_doors && doors[door_list_end].wall == cur_wall) ++door_list_end;
+        while (window_list_end < num_windows && windows[window_list_end].wall == cur_wall) ++window_list_end;
+
+        pb_line2D wall_line;
+        pb_point2D normal;
+        size_t num_spans;
+        size_t i;
+        get_wall_line(shape, cur_wall, is_room, &wall_line, &normal);
+
+        if (get_wall_spans(w, &wall_line, &num_spans) == -1) {
+            return -1;
+        }
+
+        pb_point2D const* spans = (pb_point2D const*)w->scratch_spans.items;
+        if (spans_are_whole(spans, num_spans)) {
+            if (walk_wall(w, &wall_line, &wall_line,
+                          doors + cur_door, door_list_end - cur_door,
+                          windows + cur_window, window_list_end - cur_window,
+                          &normal, start_height) == -1) {
+                return -1;
+            }
+            continue;
+        }
+
+        /* Only part of the wall belongs to this room, so hand each span the doors and windows that lie in it */
+        sort_structures_along_line(&wall_line, doors + cur_door, door_list_end - cur_door);
+        sort_structures_along_line(&wall_line, windows + cur_window, window_list_end - cur_window);
+
+        for (i = 0; i < num_spans; ++i) {
+            pb_line2D span_line;
+            size_t first_door, last_door, first_window, last_window;
+
+            get_span_line(&wall_line, spans + i, &span_line);
+            get_span_structures(&wall_line, spans + i, doors + cur_door, door_list_end - cur_door,
+                                &first_door, &last_door);
+            get_span_structures(&wall_line, spans + i, windows + cur_window, window_list_end - cur_window,
+                                &first_window, &last_window);
+
+            if (walk_wall(w, &wall_line, &span_line,
+                          doors + cur_door + first_door, last_door - first_door,
+                          windows + cur_window + first_window, last_window - first_window,
+                          &normal, start_height) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Writes a room's floor and ceiling straight into the sink's layout and passes them on to the sink.
+ */
+static int walk_floor_ceiling_layout(extrusion_walker* w, pb_room const* room, size_t const* floor_indices,
+                                     size_t num_tris, float start_height) {
+    pb_point2D const* room_points = (pb_point2D const*)room->shape.points.items;
+    size_t num_verts = num_tris * 3;
+    room_surfaces surfaces;
+    pb_shape3D shape;
+    size_t first;
+    int i;
+
+    get_room_surfaces(room, &w->bottom_floor_centre, start_height, w->floor_height, &surfaces);
+    shape.tris = NULL;
+    shape.num_tris = num_tris;
+
+    /* The floor, then the ceiling (reversed to face downwards) */
+    for (i = 0; i < 2; ++i) {
+        pb_extruded_category category = i == 0 ? PB_EXTRUDED_FLOOR : PB_EXTRUDED_CEILING;
+
+        if (!(i == 0 ? room->has_floor : room->has_ceiling)) {
+            continue;
+        }
+        if (w->sink->reserve(w->sink, category, num_verts, &first) == -1) {
+            return -1;
+        }
+
+        pb_write_surface_verts(room_points, floor_indices, num_verts, i, &surfaces.centre,
+                               surfaces.uv_start + i, surfaces.uv_size + i, i == 0 ? 1.f : -1.f,
+                               w->sink->layout, first);
+        shape.pos = surfaces.pos[i];
+        if (w->sink->needs_bounds) {
+            pb_get_surface_bounds(room_points, num_verts ? room->shape.points.size : 0, &surfaces.centre,
+                                  &shape.pos, &shape.bounds);
+        }
+        if (w->sink->add(w->sink, category, &shape) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Extrudes a room's floor and ceiling into the walker's scratch space (or the sink's layout) and passes them on to
+ * the sink.
+ */
+static int walk_floor_ceiling(extrusion_walker* w, pb_room const* room, float start_height) {
+    if (!room->has_floor && !room->has_ceiling) {
+        return 0;
+    }
+
+    size_t* floor_indices = pb_triangulate(&room->shape);
+    if (!floor_indices) {
+        return -1;
+    }
+
+    size_t num_tris = pb_shape2D_get_num_tris(&room->shape);
+    size_t num_verts = num_tris * 3;
+
+    if (w->sink->layout) {
+        int result = walk_floor_ceiling_layout(w, room, floor_indices, num_tris, start_height);
+        free(floor_indices);
+        return result;
+    }
+
+    if (reserve_scratch(&w->scratch_verts, num_verts * 2) == -1) {
+        free(floor_indices);
+        return -1;
+    }
+
+    pb_shape3D floor_shape;
+    pb_shape3D ceiling_shape;
+    floor_shape.tris = (pb_vert3D*)w->scratch_verts.items;
+    floor_shape.num_tris = num_tris;
+    ceiling_shape.tris = floor_shape.tris + num_verts;
+    ceiling_shape.num_tris = num_tris;
+
+    fill_floor_ceiling(room, floor_indices, num_verts, &w->bottom_floor_centre, start_height, w->floor_height,
+                       room->has_floor ? &floor_shape : NULL, room->has_ceiling ? &ceiling_shape : NULL);
+    free(floor_indices);
+
+    if (room->has_floor && w->sink->add(w->sink, PB_EXTRUDED_FLOOR, &floor_shape) == -1) {
+        return -1;
+    }
+    if (room->has_ceiling && w->sink->add(w->sink, PB_EXTRUDED_CEILING, &ceiling_shape) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Extrudes a floor's exterior followed by each of its rooms.
+ */
+static int walk_floor(extrusion_walker* w, pb_floor const* f, size_t floor_index, float start_height) {
+    pb_extrusion_counts counts;
+    pb_extrusion_counts* part_counts = w->sink->needs_counts ? &counts : NULL;
+
+    w->cur_floor = f;
+    w->cur_room = PB_EXTRUDED_EXTERIOR;
+
+    if ((part_counts && count_floor_exterior(w, f, start_height, part_counts) == -1) ||
+        w->sink->begin_part(w->sink, floor_index, PB_EXTRUDED_EXTERIOR, part_counts) == -1 ||
+        walk_wall_lists(w, &f->shape, NULL, f->doors, f->num_doors, f->windows, f->num_windows,
+                        0, start_height) == -1 ||
+        w->sink->end_part(w->sink) == -1) {
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < f->num_rooms; ++i) {
+        pb_room const* room = f->rooms + i;
+
+        w->cur_room = i;
+        if ((part_counts && count_room(w, f, i, start_height, part_counts) == -1) ||
+            w->sink->begin_part(w->sink, floor_index, i, part_counts) == -1 ||
+            walk_wall_lists(w, &room->shape, (int const*)room->walls.items,
+                            room->doors, room->num_doors, room->windows, room->num_windows,
+                            1, start_height) == -1 ||
+            walk_floor_ceiling(w, room, start_height) == -1 ||
+            w->sink->end_part(w->sink) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Extrudes an entire building into the given sink.
+ */
+static int walk_building(pb_building* building,
+                         float floor_height, float door_height, float window_height,
+                         pb_wall_structure_extruder const* door_extruder,
+                         pb_wall_structure_extruder const* window_extruder,
+                         void* door_extruder_param, void* window_extruder_param,
+                         unsigned flags, extrusion_sink* sink) {
+    extrusion_walker w;
+    init_walker(&w, building, floor_height, door_height, window_height,
+                door_extruder, window_extruder, door_extruder_param, window_extruder_param, flags, sink);
+
+    int result = 0;
+    size_t i;
+    for (i = 0; i < building->num_floors && result == 0; ++i) {
+        result = walk_floor(&w, building->floors + i, i, i * floor_height);
+    }
+
+    free_walker(&w);
+    return result;
+}
+
+/**
+ * Writes a building's shapes into the buffers of a pb_contiguous_building. The counts given to begin_part are used to
+ * lay out each part's categories one after the other, so every shape is written straight to its final position.
+ */
+typedef struct {
+    extrusion_sink base;
+    pb_contiguous_building* out;
+
+    /* Buffer capacities */
+    size_t max_verts;
+    size_t max_shapes;
+    size_t max_wall_lists;
+    size_t max_rooms;
+    size_t max_floors;
+
+    /* Where the next shape of each category goes in the current part, and where the category ends */
+    size_t next_shape[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t shapes_end[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t next_vert[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t verts_end[PB_EXTRUDED_NUM_CATEGORIES];
+    size_t next_wall_list;
+    size_t wall_lists_end;
+
+    pb_contiguous_floor* cur_floor;
+} into_sink;
+
+static int into_sink_begin_part(extrusion_sink* sink, size_t floor, size_t room, pb_extrusion_counts const* counts) {
+    into_sink* s = (into_sink*)sink;
+    pb_contiguous_building* out = s->out;
+    pb_range* shape_ranges;
+    size_t num_shapes = 0;
+    size_t num_verts = 0;
+    size_t i;
+    (void)floor;
+
+    for (i = 0; i < PB_EXTRUDED_NUM_CATEGORIES; ++i) {
+        num_shapes += counts->num_shapes[i];
+        num_verts += counts->num_tris[i] * 3;
+    }
+
+    if (out->num_shapes + num_shapes > s->max_shapes ||
+        out->num_verts + num_verts > s->max_verts ||
+        out->num_wall_lists + counts->num_wall_lists > s->max_wall_lists) {
+        return -1;
+    }
+
+    if (room == PB_EXTRUDED_EXTERIOR) {
+        if (out->num_floors == s->max_floors) {
+            return -1;
+        }
+
+        pb_contiguous_floor* f = out->floors + out->num_floors++;
+        f->rooms.start = out->num_rooms;
+        f->rooms.count = 0;
+        f->wall_lists.start = out->num_wall_lists;
+        f->wall_lists.count = counts->num_wall_lists;
+        f->verts.start = out->num_verts;
+        pb_bounds3D_clear(&f->bounds);
+
+        shape_ranges = f->shapes;
+        s->cur_floor = f;
+    } else {
+        if (out->num_rooms == s->max_rooms) {
+            return -1;
+        }
+
+        pb_contiguous_room* r = out->rooms + out->num_rooms++;
+        r->wall_lists.start = out->num_wall_lists;
+        r->wall_lists.count = counts->num_wall_lists;
+        r->verts.start = out->num_verts;
+        r->verts.count = num_verts;
+        pb_bounds3D_clear(&r->bounds);
+
+        shape_ranges = r->shapes;
+        s->cur_floor->rooms.count++;
+    }
+
+    size_t next_shape = out->num_shapes;
+    size_t next_vert = out->num_verts;
+    for (i = 0; i < PB_EXTRUDED_NUM_CATEGORIES; ++i) {
+        shape_ranges[i].start = next_shape;
+        shape_ranges[i].count = counts->num_shapes[i];
+
+        s->next_shape[i] = next_shape;
+        next_shape += counts->num_shapes[i];
+        s->shapes_end[i] = next_shape;
+
+        s->next_vert[i] = next_vert;
+        next_vert += counts->num_tris[i] * 3;
+        s->verts_end[i] = next_vert;
+    }
+
+    s->next_wall_list = out->num_wall_lists;
+    s->wall_lists_end = out->num_wall_lists + counts->num_wall_lists;
+
+    out->num_shapes += num_shapes;
+    out->num_verts += num_verts;
+    out->num_wall_lists += counts->num_wall_lists;
+    s->cur_floor->verts.count = out->num_verts - s->cur_floor->verts.start;
+
+    return 0;
+}
+
+static int into_sink_begin_wall_list(extrusion_sink* sink) {
+    into_sink* s = (into_sink*)sink;
+
+    if (s->next_wall_list == s->wall_lists_end) {
+        return -1;
+    }
+
+    pb_range* wall_list = s->out->wall_lists + s->next_wall_list++;
+    wall_list->start = s->next_shape[PB_EXTRUDED_WALL];
+    wall_list->count = 0;
+    return 0;
+}
+
+static int into_sink_reserve(extrusion_sink* sink, pb_extruded_category category, size_t num_verts, size_t* first) {
+    into_sink* s = (into_sink*)sink;
+
+    /* An extruder produced more than it said it would */
+    if (s->next_vert[category] + num_verts > s->verts_end[category]) {
+        return -1;
+    }
+
+    *first = s->next_vert[category];
+    return 0;
+}
+
+static int into_sink_add(extrusion_sink* sink, pb_extruded_category category, pb_shape3D const* shape) {
+    into_sink* s = (into_sink*)sink;
+    size_t num_verts = shape->num_tris * 3;
+
+    /* An extruder produced more than it said it would */
+    if (s->next_shape[category] == s->shapes_end[category] ||
+        s->next_vert[category] + num_verts > s->verts_end[category]) {
+        return -1;
+    }
+
+    pb_contiguous_shape* out_shape = s->out->shapes + s->next_shape[category]++;
+    out_shape->verts.start = s->next_vert[category];
+    out_shape->verts.count = num_verts;
+    out_shape->pos = shape->pos;
+    if (s->base.needs_bounds) {
+        out_shape->bounds = shape->bounds;
+    } else {
+        pb_bounds3D_clear(&out_shape->bounds);
+    }
+
+    /* Shapes without tris have already been written into the layout (see into_sink_reserve) */
+    if (!shape->tris) {
+        if (!s->base.layout) {
+            return -1;
+        }
+    } else if (s->base.layout) {
+        pb_write_verts(shape->tris, num_verts, s->base.layout, s->next_vert[category]);
+    } else {
+        memcpy(s->out->verts + s->next_vert[category], shape->tris, sizeof(pb_vert3D) * num_verts);
+    }
+    s->next_vert[category] += num_verts;
+
+    if (category == PB_EXTRUDED_WALL) {
+        s->out->wall_lists[s->next_wall_list - 1].count++;
+    }
+
+    return 0;
+}
+
+static int into_sink_end_part(extrusion_sink* sink) {
+    into_sink* s = (into_sink*)sink;
+    size_t i;
+
+    /* Make sure that nothing was left out */
+    for (i = 0; i < PB_EXTRUDED_NUM_CATEGORIES; ++i) {
+        if (s->next_shape[i] != s->shapes_end[i] || s->next_vert[i] != s->verts_end[i]) {
+            return -1;
+        }
+    }
+
+    return s->next_wall_list == s->wall_lists_end ? 0 : -1;
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_measure(pb_building const* building,
+                                                    float floor_height,
+                                                    float door_height,
+                                                    float window_height,
+                                                    pb_wall_structure_extruder const* door_extruder,
+                                                    pb_wall_structure_extruder const* window_extruder,
+                                                    void* door_extruder_param,
+                                                    void* window_extruder_param,
+                                                    pb_extrusion_counts* floor_counts,
+                                                    pb_extrusion_counts* room_counts,
+                                                    pb_contiguous_building* sizes) {
+    return pb_extrude_building_measure_ex(building, floor_height, door_height, window_height,
+                                          door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                          0, floor_counts, room_counts, sizes);
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_measure_ex(pb_building const* building,
+                                                       float floor_height,
+                                                       float door_height,
+                                                       float window_height,
+                                                       pb_wall_structure_extruder const* door_extruder,
+                                                       pb_wall_structure_extruder const* window_extruder,
+                                                       void* door_extruder_param,
+                                                       void* window_extruder_param,
+                                                       unsigned flags,
+                                                       pb_extrusion_counts* floor_counts,
+                                                       pb_extrusion_counts* room_counts,
+                                                       pb_contiguous_building* sizes) {
+    extrusion_walker w;
+    int result = 0;
+    size_t i, j, k;
+
+    init_walker(&w, building, floor_height, door_height, window_height,
+                door_extruder, window_extruder, door_extruder_param, window_extruder_param, flags, NULL);
+
+    memset(sizes, 0, sizeof(pb_contiguous_building));
+    sizes->num_floors = building->num_floors;
+
+    for (i = 0; i < building->num_floors && result == 0; ++i) {
+        pb_floor const* f = building->floors + i;
+        float start_height = i * floor_height;
+
+        for (j = 0; j <= f->num_rooms; ++j) {
+            /* j == 0 is the floor's exterior */
+            pb_extrusion_counts counts;
+
+            if (j == 0) {
+                if (count_floor_exterior(&w, f, start_height, &counts) == -1) {
+                    result = -1;
+                    break;
+                }
+                if (floor_counts) {
+                    floor_counts[i] = counts;
+                }
+            } else {
+                if (count_room(&w, f, j - 1, start_height, &counts) == -1) {
+                    result = -1;
+                    break;
+                }
+                if (room_counts) {
+                    room_counts[sizes->num_rooms] = counts;
+                }
+                sizes->num_rooms++;
+            }
+
+            for (k = 0; k < PB_EXTRUDED_NUM_CATEGORIES; ++k) {
+                sizes->num_shapes += counts.num_shapes[k];
+                sizes->num_verts += counts.num_tris[k] * 3;
+            }
+            sizes->num_wall_lists += counts.num_wall_lists;
+        }
+    }
+
+    free_walker(&w);
+    return result;
+}
+
+/**
+ * Grows the box of bounds to fit the shapes in a range of a contiguous building, or grows its sphere to contain
+ * theirs.
+ */
+static void bound_contiguous_shapes(pb_contiguous_building const* b, size_t start, size_t end, int enclose,
+                                    pb_bounds3D* bounds) {
+    size_t i;
+    for (i = start; i < end; ++i) {
+        if (enclose) {
+            enclose_bounds(bounds, &b->shapes[i].bounds);
+        } else {
+            grow_box(bounds, &b->shapes[i].bounds);
+        }
+    }
+}
+
+/**
+ * Fills in the bounds of the rooms and floors of a contiguous building from the bounds of their shapes, like
+ * compute_room_bounds and compute_floor_bounds.
+ */
+static void bound_contiguous_building(pb_contiguous_building* b) {
+    pb_range const* last;
+    size_t start, end;
+    size_t i, j;
+
+    /* Each part's shapes are laid out one category after the other, so they are a single range */
+    for (i = 0; i < b->num_rooms; ++i) {
+        pb_contiguous_room* r = b->rooms + i;
+        last = r->shapes + PB_EXTRUDED_NUM_CATEGORIES - 1;
+        start = r->shapes[0].start;
+        end = last->start + last->count;
+
+        bound_contiguous_shapes(b, start, end, 0, &r->bounds);
+        centre_bounds(&r->bounds);
+        bound_contiguous_shapes(b, start, end, 1, &r->bounds);
+    }
+
+    for (i = 0; i < b->num_floors; ++i) {
+        pb_contiguous_floor* f = b->floors + i;
+        last = f->shapes + PB_EXTRUDED_NUM_CATEGORIES - 1;
+        start = f->shapes[0].start;
+        end = last->start + last->count;
+
+        bound_contiguous_shapes(b, start, end, 0, &f->bounds);
+        for (j = f->rooms.start; j < f->rooms.start + f->rooms.count; ++j) {
+            grow_box(&f->bounds, &b->rooms[j].bounds);
+        }
+
+        centre_bounds(&f->bounds);
+        bound_contiguous_shapes(b, start, end, 1, &f->bounds);
+        for (j = f->rooms.start; j < f->rooms.start + f->rooms.count; ++j) {
+            enclose_bounds(&f->bounds, &b->rooms[j].bounds);
+        }
+    }
+}
+
+static int extrude_into(pb_building* building, float floor_height, float door_height, float window_height,
+                        pb_wall_structure_extruder const* door_extruder,
+                        pb_wall_structure_extruder const* window_extruder,
+                        void* door_extruder_param, void* window_extruder_param,
+                        unsigned flags, pb_vertex_layout const* layout, pb_contiguous_building* out) {
+    into_sink s;
+
+    s.base.needs_counts = 1;
+    s.base.needs_bounds = (flags & PB_EXTRUDE_BOUNDS) != 0;
+    s.base.layout = layout;
+    s.base.begin_part = into_sink_begin_part;
+    s.base.begin_wall_list = into_sink_begin_wall_list;
+    s.base.reserve = into_sink_reserve;
+    s.base.add = into_sink_add;
+    s.base.end_part = into_sink_end_part;
+    s.out = out;
+    s.cur_floor = NULL;
+
+    s.max_verts = out->num_verts;
+    s.max_shapes = out->num_shapes;
+    s.max_wall_lists = out->num_wall_lists;
+    s.max_rooms = out->num_rooms;
+    s.max_floors = out->num_floors;
+
+    out->num_verts = 0;
+    out->num_shapes = 0;
+    out->num_wall_lists = 0;
+    out->num_rooms = 0;
+    out->num_floors = 0;
+
+    if (walk_building(building, floor_height, door_height, window_height,
+                      door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                      flags, &s.base) == -1) {
+        return -1;
+    }
+
+    /* Only the shapes' bounds are needed for this, so the vertices don't have to be gone through again */
+    if (s.base.needs_bounds) {
+        bound_contiguous_building(out);
+    }
+    return 0;
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_into(pb_building* building,
+                                                 float floor_height,
+                                                 float door_height,
+                                                 float window_height,
+                                                 pb_wall_structure_extruder const* door_extruder,
+                                                 pb_wall_structure_extruder const* window_extruder,
+                                                 void* door_extruder_param,
+                                                 void* window_extruder_param,
+                                                 pb_contiguous_building* out) {
+    return extrude_into(building, floor_height, door_height, window_height, door_extruder, window_extruder,
+                        door_extruder_param, window_extruder_param, 0, NULL, out);
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_ex(pb_building* building,
+                                                    float floor_height,
+                                                    float door_height,
+                                                    float window_height,
+                                                    pb_wall_structure_extruder const* door_extruder,
+                                                    pb_wall_structure_extruder const* window_extruder,
+                                                    void* door_extruder_param,
+                                                    void* window_extruder_param,
+                                                    unsigned flags,
+                                                    pb_contiguous_building* out) {
+    return extrude_into(building, floor_height, door_height, window_height, door_extruder, window_extruder,
+                        door_extruder_param, window_extruder_param, flags, NULL, out);
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_layout(pb_building* building,
+                                                        float floor_height,
+                                                        float door_height,
+                                                        float window_height,
+                                                        pb_wall_structure_extruder const* door_extruder,
+                                                        pb_wall_structure_extruder const* window_extruder,
+                                                        void* door_extruder_param,
+                                                        void* window_extruder_param,
+                                                        pb_vertex_layout const* layout,
+                                                        pb_contiguous_building* out) {
+    return extrude_into(building, floor_height, door_height, window_height, door_extruder, window_extruder,
+                        door_extruder_param, window_extruder_param, 0, layout, out);
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_into_layout_ex(pb_building* building,
+                                                           float floor_height,
+                                                           float door_height,
+                                                           float window_height,
+                                                           pb_wall_structure_extruder const* door_extruder,
+                                                           pb_wall_structure_extruder const* window_extruder,
+                                                           void* door_extruder_param,
+                                                           void* window_extruder_param,
+                                                           unsigned flags,
+                                                           pb_vertex_layout const* layout,
+                                                           pb_contiguous_building* out) {
+    return extrude_into(building, floor_height, door_height, window_height, door_extruder, window_extruder,
+                        door_extruder_param, window_extruder_param, flags, layout, out);
+}
+
+/* Rounds size up so that whatever follows it in an allocation is suitably aligned. */
+static size_t align_size(size_t size) {
+    size_t const alignment = 16;
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+PB_DECLSPEC pb_contiguous_building* PB_CALL pb_extrude_building_contiguous(pb_building* building,
+                                                                         float floor_height,
+                                                                         float door_height,
+                                                                         float window_height,
+                                                                         pb_wall_structure_extruder const* door_extruder,
+                                                                         pb_wall_structure_extruder const* window_extruder,
+                                                                         void* door_extruder_param,
+                                                                         void* window_extruder_param) {
+    return pb_extrude_building_contiguous_ex(building, floor_height, door_height, window_height,
+                                             door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                             0);
+}
+
+PB_DECLSPEC pb_contiguous_building* PB_CALL pb_extrude_building_contiguous_ex(pb_building* building,
+                                                                            float floor_height,
+                                                                            float door_height,
+                                                                            float window_height,
+                                                                            pb_wall_structure_extruder const* door_extruder,
+                                                                            pb_wall_structure_extruder const* window_extruder,
+                                                                            void* door_extruder_param,
+                                                                            void* window_extruder_param,
+                                                                            unsigned flags) {
+    pb_contiguous_building sizes;
+    size_t shapes_offset, wall_lists_offset, rooms_offset, floors_offset, verts_offset, total_size;
+
+    if (pb_extrude_building_measure_ex(building, floor_height, door_height, window_height,
+                                       door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                       flags, NULL, NULL, &sizes) == -1) {
+        return NULL;
+    }
+
+    shapes_offset = align_size(sizeof(pb_contiguous_building));
+    wall_lists_offset = shapes_offset + align_size(sizeof(pb_contiguous_shape) * sizes.num_shapes);
+    rooms_offset = wall_lists_offset + align_size(sizeof(pb_range) * sizes.num_wall_lists);
+    floors_offset = rooms_offset + align_size(sizeof(pb_contiguous_room) * sizes.num_rooms);
+    verts_offset = floors_offset + align_size(sizeof(pb_contiguous_floor) * sizes.num_floors);
+    total_size = verts_offset + sizeof(pb_vert3D) * sizes.num_verts;
+
+    unsigned char* block = malloc(total_size);
+    if (!block) {
+        return NULL;
+    }
+
+    pb_contiguous_building* out = (pb_contiguous_building*)block;
+    *out = sizes;
+    out->shapes = (pb_contiguous_shape*)(block + shapes_offset);
+    out->wall_lists = (pb_range*)(block + wall_lists_offset);
+    out->rooms = (pb_contiguous_room*)(block + rooms_offset);
+    out->floors = (pb_contiguous_floor*)(block + floors_offset);
+    out->verts = (pb_vert3D*)(block + verts_offset);
+
+    if (pb_extrude_building_into_ex(building, floor_height, door_height, window_height,
+                                    door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                    flags, out) == -1) {
+        free(block);
+        return NULL;
+    }
+
+    return out;
+}
+
+/* The number of triangles buffered per category before they are sent to a stream's sink. */
+#define STREAM_BATCH_TRIS 64
+
+/**
+ * Moves each shape's vertices into place and collects them into one batch per category, which is sent to the user's
+ * sink whenever it fills up and at the end of each part. With PB_EXTRUDE_BOUNDS, each batch's box is grown as its
+ * vertices are moved into place; the shapes' own bounds aren't used, since a shape can be split between batches.
+ */
+typedef struct {
+    extrusion_sink base;
+    pb_extrusion_sink_func func;
+    void* user;
+    int bounds;
+
+    size_t floor;
+    size_t room;
+    pb_vert3D verts[PB_EXTRUDED_NUM_CATEGORIES][STREAM_BATCH_TRIS * 3];
+    size_t num_verts[PB_EXTRUDED_NUM_CATEGORIES];
+    pb_bounds3D batch_bounds[PB_EXTRUDED_NUM_CATEGORIES];
+} stream_sink;
+
+static int stream_sink_flush(stream_sink* s, pb_extruded_category category) {
+    pb_extrusion_batch batch;
+
+    if (s->num_verts[category] == 0) {
+        return 0;
+    }
+
+    batch.floor = s->floor;
+    batch.room = s->room;
+    batch.category = category;
+    batch.verts = s->verts[category];
+    batch.num_verts = s->num_verts[category];
+    batch.bounds = s->batch_bounds[category];
+
+    /* The sphere just encloses the box, so that the vertices don't have to be gone through again */
+    if (s->bounds) {
+        pb_bounds3D* b = &batch.bounds;
+        float dx = (b->max.x - b->min.x) / 2.f;
+        float dy = (b->max.y - b->min.y) / 2.f;
+        float dz = (b->max.z - b->min.z) / 2.f;
+
+        b->centre.x = b->min.x + dx;
+        b->centre.y = b->min.y + dy;
+        b->centre.z = b->min.z + dz;
+        b->radius = sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+
+    s->num_verts[category] = 0;
+    pb_bounds3D_clear(s->batch_bounds + category);
+    return s->func(&batch, s->user) == 0 ? 0 : -1;
+}
+
+static int stream_sink_begin_part(extrusion_sink* sink, size_t floor, size_t room, pb_extrusion_counts const* counts) {
+    stream_sink* s = (stream_sink*)sink;
+    (void)counts;
+
+    s->floor = floor;
+    s->room = room;
+    return 0;
+}
+
+static int stream_sink_begin_wall_list(extrusion_sink* sink) {
+    (void)sink;
+    return 0;
+}
+
+static int stream_sink_add(extrusion_sink* sink, pb_extruded_category category, pb_shape3D const* shape) {
+    stream_sink* s = (stream_sink*)sink;
+    size_t num_verts = shape->num_tris * 3;
+    size_t i;
+
+    /* The batch size is a multiple of three, so triangles never get split between batches */
+    for (i = 0; i < num_verts; ++i) {
+        if (s->num_verts[category] == STREAM_BATCH_TRIS * 3 && stream_sink_flush(s, category) == -1) {
+            return -1;
+        }
+
+        pb_vert3D* v = s->verts[category] + s->num_verts[category]++;
+        *v = shape->tris[i];
+        v->x += shape->pos.x;
+        v->y += shape->pos.y;
+        v->z += shape->pos.z;
+        if (s->bounds) {
+            pb_point3D p = {v->x, v->y, v->z};
+            pb_bounds3D_add_point(s->batch_bounds + category, &p);
+        }
+    }
+
+    return 0;
+}
+
+static int stream_sink_end_part(extrusion_sink* sink) {
+    stream_sink* s = (stream_sink*)sink;
+    int category;
+
+    for (category = 0; category < PB_EXTRUDED_NUM_CATEGORIES; ++category) {
+        if (stream_sink_flush(s, (pb_extruded_category)category) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_stream(pb_building* building,
+                                                   float floor_height,
+                                                   float door_height,
+                                                   float window_height,
+                                                   pb_wall_structure_extruder const* door_extruder,
+                                                   pb_wall_structure_extruder const* window_extruder,
+                                                   void* door_extruder_param,
+                                                   void* window_extruder_param,
+                                                   pb_extrusion_sink_func sink,
+                                                   void* user) {
+    return pb_extrude_building_stream_ex(building, floor_height, door_height, window_height,
+                                         door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                                         0, sink, user);
+}
+
+PB_DECLSPEC int PB_CALL pb_extrude_building_stream_ex(pb_building* building,
+                                                      float floor_height,
+                                                      float door_height,
+                                                      float window_height,
+                                                      pb_wall_structure_extruder const* door_extruder,
+                                                      pb_wall_structure_extruder const* window_extruder,
+                                                      void* door_extruder_param,
+                                                      void* window_extruder_param,
+                                                      unsigned flags,
+                                                      pb_extrusion_sink_func sink,
+                                                      void* user) {
+    /* Too big to comfortably go on the stack */
+    stream_sink* s = malloc(sizeof(stream_sink));
+    int i;
+    if (!s) {
+        return -1;
+    }
+
+    s->base.needs_counts = 0;
+    s->base.needs_bounds = 0;
+    s->base.layout = NULL;
+    s->base.begin_part = stream_sink_begin_part;
+    s->base.begin_wall_list = stream_sink_begin_wall_list;
+    s->base.reserve = NULL;
+    s->base.add = stream_sink_add;
+    s->base.end_part = stream_sink_end_part;
+    s->func = sink;
+    s->user = user;
+    s->bounds = (flags & PB_EXTRUDE_BOUNDS) != 0;
+    memset(s->num_verts, 0, sizeof(s->num_verts));
+    for (i = 0; i < PB_EXTRUDED_NUM_CATEGORIES; ++i) {
+        pb_bounds3D_clear(s->batch_bounds + i);
+    }
+
+    int result = walk_building(building, floor_height, door_height, window_height,
+                               door_extruder, window_extruder, door_extruder_param, window_extruder_param,
+                               flags, &s->base);
+    free(s);
+    return result;
+}
+
+PB_DECLSPEC void PB_CALL pb_contiguous_building_free(pb_contiguous_building* b) {
+    free(b);
+}
+
+PB_DECLSPEC pb_indexed_building* PB_CALL pb_contiguous_building_index(pb_contiguous_building const* b,
+                                                                      size_t fuzz_bits) {
+    pb_vert3D* welded = NULL;
+    unsigned char* indices = NULL;
+    pb_indexed_shape* shapes = NULL;
+    pb_indexed_building* out = NULL;
+    size_t index_size = 2;
+    size_t num_welded = 0;
+    size_t shapes_offset, verts_offset, indices_offset, total_size;
+    size_t i;
+
+    for (i = 0; i < b->num_shapes; ++i) {
+        if (b->shapes[i].verts.count > 65536) {
+            index_size = 4;
+        }
+    }
+
+    /* Weld into scratch buffers first so that the result can be allocated at its final size */
+    welded = malloc(sizeof(pb_vert3D) * b->num_verts);
+    indices = malloc(index_size * b->num_verts);
+    shapes = malloc(sizeof(pb_indexed_shape) * b->num_shapes);
+    if ((b->num_verts && (!welded || !indices)) || (b->num_shapes && !shapes)) {
+        goto err_return;
+    }
+
+    for (i = 0; i < b->num_shapes; ++i) {
+        pb_contiguous_shape const* shape = b->shapes + i;
+        size_t num_shape_verts;
+
+        if (pb_weld_verts(b->verts + shape->verts.start, shape->verts.count, fuzz_bits, welded + num_welded,
+                          indices + index_size * shape->verts.start, index_size, &num_shape_verts) == -1) {
+            goto err_return;
+        }
+
+        shapes[i].verts.start = num_welded;
+        shapes[i].verts.count = num_shape_verts;
+        shapes[i].indices = shape->verts;
+        shapes[i].pos = shape->pos;
+        num_welded += num_shape_verts;
+    }
+
+    shapes_offset = align_size(sizeof(pb_indexed_building));
+    verts_offset = shapes_offset + align_size(sizeof(pb_indexed_shape) * b->num_shapes);
+    indices_offset = verts_offset + align_size(sizeof(pb_vert3D) * num_welded);
+    total_size = indices_offset + index_size * b->num_verts;
+
+    unsigned char* block = malloc(total_size);
+    if (!block) {
+        goto err_return;
+    }
+
+    out = (pb_indexed_building*)block;
+    out->shapes = (pb_indexed_shape*)(block + shapes_offset);
+    out->num_shapes = b->num_shapes;
+    out->verts = (pb_vert3D*)(block + verts_offset);
+    out->num_verts = num_welded;
+    out->indices = block + indices_offset;
+    out->num_indices = b->num_verts;
+    out->index_size = index_size;
+
+    memcpy(out->shapes, shapes, sizeof(pb_indexed_shape) * b->num_shapes);
+    memcpy(out->verts, welded, sizeof(pb_vert3D) * num_welded);
+    memcpy(out->indices, indices, index_size * b->num_verts);
+
+    /* The scratch buffers are freed on success too */
+err_return:
+    free(welded);
+    free(indices);
+    free(shapes);
+    return out;
+}
+
+PB_DECLSPEC int PB_CALL pb_indexed_building_optimize(pb_indexed_building* b, size_t cache_size,
+                                                     float* acmr_before, float* acmr_after) {
+    size_t misses_before = 0;
+    size_t misses_after = 0;
+    size_t i;
+
+    for (i = 0; i < b->num_shapes; ++i) {
+        pb_indexed_shape const* shape = b->shapes + i;
+        pb_vert3D* verts = b->verts + shape->verts.start;
+        unsigned char* indices = (unsigned char*)b->indices + b->index_size * shape->indices.start;
+        size_t misses;
+
+        if (pb_vertex_cache_misses(indices, shape->indices.count, b->index_size, shape->verts.count, cache_size,
+                                   &misses) == -1) {
+            return -1;
+        }
+        misses_before += misses;
+
+        if (pb_optimize_vertex_cache(indices, shape->indices.count, b->index_size, shape->verts.count,
+                                     cache_size) == -1 ||
+            pb_optimize_vertex_fetch(verts, shape->verts.count, indices, shape->indices.count, b->index_size) == -1 ||
+            pb_vertex_cache_misses(indices, shape->indices.count, b->index_size, shape->verts.count, cache_size,
+                                   &misses) == -1) {
+            return -1;
+        }
+        misses_after += misses;
+    }
+
+    if (acmr_before) {
+        *acmr_before = b->num_indices ? (float)misses_before / (b->num_indices / 3) : 0.f;
+    }
+    if (acmr_after) {
+        *acmr_after = b->num_indices ? (float)misses_after / (b->num_indices / 3) : 0.f;
+    }
+    return 0;
+}
+
+PB_DECLSPEC void PB_CALL pb_indexed_building_free(pb_indexed_building* b) {
+    free(b);
+}
+
+#define QUANTIZED_MAX 65535.f
+#define OCTAHEDRAL_MAX 127.f
+
+/* Grows the bounds [min, max] to contain value. */
+static void extend_bounds(float value, float* min, float* max) {
+    if (value < *min) {
+        *min = value;
+    }
+    if (value > *max) {
+        *max = value;
+    }
+}
+
+/* Computes the step between quantised values for the bounds [min, max]. */
+static float quantization_scale(float min, float max) {
+    return max > min ? (max - min) / QUANTIZED_MAX : 0.f;
+}
+
+static uint16_t quantize_float(float value, float min, float scale) {
+    float q = scale > 0.f ? (value - min) / scale + 0.5f : 0.f;
+    return (uint16_t)(q > QUANTIZED_MAX ? QUANTIZED_MAX : q);
+}
+
+static int8_t quantize_snorm(float value) {
+    float q = value * OCTAHEDRAL_MAX;
+    q = q > OCTAHEDRAL_MAX ? OCTAHEDRAL_MAX : (q < -OCTAHEDRAL_MAX ? -OCTAHEDRAL_MAX : q);
+    return (int8_t)(q < 0.f ? q - 0.5f : q + 0.5f);
+}
+
+static float sign_not_zero(float f) {
+    return f < 0.f ? -1.f : 1.f;
+}
+
+/* Projects a normal onto the octahedron |x| + |y| + |z| = 1, then folds the lower half over the upper one. */
+static void encode_octahedral(float nx, float ny, float nz, int8_t* out_x, int8_t* out_y) {
+    float l1 = fabsf(nx) + fabsf(ny) + fabsf(nz);
+    float px = l1 > 0.f ? nx / l1 : 0.f;
+    float py = l1 > 0.f ? ny / l1 : 0.f;
+
+    if (nz < 0.f) {
+        float folded_x = (1.f - fabsf(py)) * sign_not_zero(px);
+        float folded_y = (1.f - fabsf(px)) * sign_not_zero(py);
+        px = folded_x;
+        py = folded_y;
+    }
+
+    *out_x = quantize_snorm(px);
+    *out_y = quantize_snorm(py);
+}
+
+PB_DECLSPEC pb_quantized_building* PB_CALL pb_contiguous_building_quantize(pb_contiguous_building const* b) {
+    size_t floors_offset = align_size(sizeof(pb_quantized_building));
+    size_t verts_offset = floors_offset + align_size(sizeof(pb_dequantization) * b->num_floors);
+    size_t floor_idx;
+    size_t i;
+
+    unsigned char* block = malloc(verts_offset + sizeof(pb_quantized_vert3D) * b->num_verts);
+    if (!block) {
+        return NULL;
+    }
+
+    pb_quantized_building* out = (pb_quantized_building*)block;
+    out->floors = (pb_dequantization*)(block + floors_offset);
+    out->num_floors = b->num_floors;
+    out->verts = (pb_quantized_vert3D*)(block + verts_offset);
+    out->num_verts = b->num_verts;
+
+    /* Shapes are stored in vertex order, and each floor's vertices are contiguous, so the shapes of each floor can be
+     * found by walking through them alongside the floors. */
+    for (floor_idx = 0, i = 0; floor_idx < b->num_floors; ++floor_idx) {
+        pb_range floor_verts = b->floors[floor_idx].verts;
+        pb_dequantization* d = out->floors + floor_idx;
+        pb_point3D pos_max;
+        pb_point2D uv_max;
+        size_t first_shape = i;
+        size_t j;
+
+        d->pos_min.x = d->pos_min.y = d->pos_min.z = HUGE_VALF;
+        pos_max.x = pos_max.y = pos_max.z = -HUGE_VALF;
+        d->uv_min.x = d->uv_min.y = HUGE_VALF;
+        uv_max.x = uv_max.y = -HUGE_VALF;
+
+        for (; i < b->num_shapes && b->shapes[i].verts.start < floor_verts.start + floor_verts.count; ++i) {
+            pb_contiguous_shape const* shape = b->shapes + i;
+            for (j = shape->verts.start; j < shape->verts.start + shape->verts.count; ++j) {
+                pb_vert3D const* v = b->verts + j;
+                extend_bounds(v->x + shape->pos.x, &d->pos_min.x, &pos_max.x);
+                extend_bounds(v->y + shape->pos.y, &d->pos_min.y, &pos_max.y);
+                extend_bounds(v->z + shape->pos.z, &d->pos_min.z, &pos_max.z);
+                extend_bounds(v->u, &d->uv_min.x, &uv_max.x);
+                extend_bounds(v->v, &d->uv_min.y, &uv_max.y);
+            }
+        }
+
+        if (floor_verts.count == 0) {
+            memset(d, 0, sizeof(pb_dequantization));
+            continue;
+        }
+
+        d->pos_scale.x = quantization_scale(d->pos_min.x, pos_max.x);
+        d->pos_scale.y = quantization_scale(d->pos_min.y, pos_max.y);
+        d->pos_scale.z = quantization_scale(d->pos_min.z, pos_max.z);
+        d->uv_scale.x = quantization_scale(d->uv_min.x, uv_max.x);
+        d->uv_scale.y = quantization_scale(d->uv_min.y, uv_max.y);
+
+        for (; first_shape < i; ++first_shape) {
+            pb_contiguous_shape const* shape = b->shapes + first_shape;
+            for (j = shape->verts.start; j < shape->verts.start + shape->verts.count; ++j) {
+                pb_vert3D const* v = b->verts + j;
+                pb_quantized_vert3D* q = out->verts + j;
+
+                q->x = quantize_float(v->x + shape->pos.x, d->pos_min.x, d->pos_scale.x);
+                q->y = quantize_float(v->y + shape->pos.y, d->pos_min.y, d->pos_scale.y);
+                q->z = quantize_float(v->z + shape->pos.z, d->pos_min.z, d->pos_scale.z);
+                encode_octahedral(v->nx, v->ny, v->nz, &q->nx, &q->ny);
+                q->u = quantize_float(v->u, d->uv_min.x, d->uv_scale.x);
+                q->v = quantize_float(v->v, d->uv_min.y, d->uv_scale.y);
+            }
+        }
+    }
+
+    return out;
+}
+
+PB_DECLSPEC void PB_CALL pb_dequantize_vert3D(pb_quantized_vert3D const* v, pb_dequantization const* d,
+                                             pb_vert3D* out) {
+    float px = v->nx / OCTAHEDRAL_MAX;
+    float py = v->ny / OCTAHEDRAL_MAX;
+    float pz = 1.f - fabsf(px) - fabsf(py);
+    float len;
+
+    /* Unfold the lower half of the octahedron */
+    if (pz < 0.f) {
+        float unfolded_x = (1.f - fabsf(py)) * sign_not_zero(px);
+        float unfolded_y = (1.f - fabsf(px)) * sign_not_zero(py);
+        px = unfolded_x;
+        py = unfolded_y;
+    }
+
+    len = sqrtf(px * px + py * py + pz * pz);
+    out->nx = px / len;
+    out->ny = py / len;
+    out->nz = pz / len;
+
+    out->x = d->pos_min.x + v->x * d->pos_scale.x;
+    out->y = d->pos_min.y + v->y * d->pos_scale.y;
+    out->z = d->pos_min.z + v->z * d->pos_scale.z;
+    out->u = d->uv_min.x + v->u * d->uv_scale.x;
+    out->v = d->uv_min.y + v->v * d->uv_scale.y;
+}
+
+PB_DECLSPEC void PB_CALL pb_quantized_building_free(pb_quantized_building* b) {
+    free(b);
+}
+
+/* How close two coordinates must be to be treated as the same when merging walls */
+#define MERGE_EPSILON 1e-4f
+
+/**
+ * A wall quad in the coordinate system of its plane: s runs along the wall (to the left when facing the wall from the
+ * front), y runs up, and d is the plane's distance from the origin along the normal. The uvs are given at the edges.
+ */
+typedef struct {
+    size_t shape;
+    long plane_key[3];
+    float nx, nz, d;
+    float s0, s1, y0, y1;
+    float u0, u1, v0, v1;
+} wall_rect;
+
+static long merge_key(float f) {
+    return (long)floorf(f * 1000.f + 0.5f);
+}
+
+static int merge_eq(float f1, float f2) {
+    return fabsf(f1 - f2) <= MERGE_EPSILON;
+}
+
+/**
+ * Checks whether the uvs of a quad can be carried on across the quad after it along one axis: both must cover the
+ * same range of uvs per unit of length, and the second quad's uvs must start where the first's end, give or take a
+ * whole number of repeats of the texture. Otherwise the merged quad would stretch or shift the texture.
+ *
+ * @param len1 The length of the first quad along the axis.
+ * @param uv1_0 The first quad's uv at its start.
+ * @param uv1_1 The first quad's uv at its end.
+ * @param len2 The length of the second quad along the axis.
+ * @param uv2_0 The second quad's uv at its start.
+ * @param uv2_1 The second quad's uv at its end.
+ * @return 1 if merging the quads keeps their uvs, 0 otherwise.
+ */
+static int merge_uvs_continue(float len1, float uv1_0, float uv1_1, float len2, float uv2_0, float uv2_1) {
+    float offset = uv1_1 - uv2_0;
+    return merge_eq((uv1_1 - uv1_0) / len1, (uv2_1 - uv2_0) / len2) && merge_eq(offset, floorf(offset + 0.5f));
+}
+
+/**
+ * Describes a wall shape as a wall_rect if it's a quad in a vertical plane with uvs that are linear along each edge.
+ *
+ * @return 1 if the shape is such a quad, 0 otherwise.
+ */
+static int get_wall_rect(pb_contiguous_building const* b, size_t shape_index, wall_rect* out) {
+    pb_contiguous_shape const* shape = b->shapes + shape_index;
+    pb_vert3D const* verts = b->verts + shape->verts.start;
+    float len;
+    size_t i;
+
+    if (shape->verts.count != 6 || verts[0].ny != 0.f) {
+        return 0;
+    }
+
+    len = sqrtf(verts[0].nx * verts[0].nx + verts[0].nz * verts[0].nz);
+    if (len == 0.f) {
+        return 0;
+    }
+
+    out->shape = shape_index;
+    out->nx = verts[0].nx / len;
+    out->nz = verts[0].nz / len;
+    out->s0 = out->y0 = HUGE_VALF;
+    out->s1 = out->y1 = -HUGE_VALF;
+
+    for (i = 0; i < 6; ++i) {
+        float x = verts[i].x + shape->pos.x;
+        float z = verts[i].z + shape->pos.z;
+        float s = -out->nz * x + out->nx * z;
+
+        if (verts[i].nx != verts[0].nx || verts[i].ny != 0.f || verts[i].nz != verts[0].nz) {
+            return 0;
+        }
+        if (i == 0) {
+            out->d = out->nx * x + out->nz * z;
+        } else if (!merge_eq(out->d, out->nx * x + out->nz * z)) {
+            return 0;
+        }
+
+        extend_bounds(s, &out->s0, &out->s1);
+        extend_bounds(verts[i].y + shape->pos.y, &out->y0, &out->y1);
+    }
+
+    /* Every vertex must be a corner, and each edge must have a single u or v */
+    int seen_u0 = 0, seen_u1 = 0, seen_v0 = 0, seen_v1 = 0;
+    for (i = 0; i < 6; ++i) {
+        float s = -out->nz * (verts[i].x + shape->pos.x) + out->nx * (verts[i].z + shape->pos.z);
+        float y = verts[i].y + shape->pos.y;
+        int at_s0 = merge_eq(s, out->s0);
+        int at_y0 = merge_eq(y, out->y0);
+
+        if ((!at_s0 && !merge_eq(s, out->s1)) || (!at_y0 && !merge_eq(y, out->y1))) {
+            return 0;
+        }
+
+        float* u = at_s0 ? &out->u0 : &out->u1;
+        int* seen_u = at_s0 ? &seen_u0 : &seen_u1;
+        float* v = at_y0 ? &out->v0 : &out->v1;
+        int* seen_v = at_y0 ? &seen_v0 : &seen_v1;
+
+        if ((*seen_u && *u != verts[i].u) || (*seen_v && *v != verts[i].v)) {
+            return 0;
+        }
+        *u = verts[i].u;
+        *v = verts[i].v;
+        *seen_u = *seen_v = 1;
+    }
+
+    if (!(seen_u0 && seen_u1 && seen_v0 && seen_v1) || merge_eq(out->s0, out->s1) || merge_eq(out->y0, out->y1)) {
+        return 0;
+    }
+
+    out->plane_key[0] = merge_key(out->nx);
+    out->plane_key[1] = merge_key(out->nz);
+    out->plane_key[2] = merge_key(out->d);
+    return 1;
+}
+
+static int compare_long(long l1, long l2) {
+    return l1 < l2 ? -1 : (l1 > l2 ? 1 : 0);
+}
+
+static int compare_plane(wall_rect const* r1, wall_rect const* r2) {
+    int result = compare_long(r1->plane_key[0], r2->plane_key[0]);
+    if (!result) {
+        result = compare_long(r1->plane_key[1], r2->plane_key[1]);
+    }
+    if (!result) {
+        result = compare_long(r1->plane_key[2], r2->plane_key[2]);
+    }
+    return result;
+}
+
+/* Orders quads by plane, then row, then position along the row. */
+static int compare_rows(void const* a, void const* b) {
+    wall_rect const* r1 = (wall_rect const*)a;
+    wall_rect const* r2 = (wall_rect const*)b;
+    int result = compare_plane(r1, r2);
+    if (!result) {
+        result = compare_long(merge_key(r1->y0), merge_key(r2->y0));
+    }
+    if (!result) {
+        result = compare_long(merge_key(r1->y1), merge_key(r2->y1));
+    }
+    if (!result) {
+        result = r1->s0 < r2->s0 ? -1 : (r1->s0 > r2->s0 ? 1 : 0);
+    }
+    return result;
+}
+
+/* Orders quads by plane, then column, then height. */
+static int compare_columns(void const* a, void const* b) {
+    wall_rect const* r1 = (wall_rect const*)a;
+    wall_rect const* r2 = (wall_rect const*)b;
+    int result = compare_plane(r1, r2);
+    if (!result) {
+        result = compare_long(merge_key(r1->s0), merge_key(r2->s0));
+    }
+    if (!result) {
+        result = compare_long(merge_key(r1->s1), merge_key(r2->s1));
+    }
+    if (!result) {
+        result = r1->y0 < r2->y0 ? -1 : (r1->y0 > r2->y0 ? 1 : 0);
+    }
+    return result;
+}
+
+/**
+ * Greedily merges consecutive quads that share an edge, after sorting them into rows (along each wall) or columns
+ * (across floors).
+ *
+ * @return The number of quads left in rects.
+ */
+static size_t merge_wall_rects(wall_rect* rects, size_t num_rects, int along_rows) {
+    size_t num_merged = 0;
+    size_t i;
+
+    if (num_rects == 0) {
+        return 0;
+    }
+
+    qsort(rects, num_rects, sizeof(wall_rect), along_rows ? compare_rows : compare_columns);
+
+    for (i = 1; i < num_rects; ++i) {
+        wall_rect* cur = rects + num_merged;
+        wall_rect const* next = rects + i;
+        int can_merge = compare_plane(cur, next) == 0;
+
+        if (along_rows) {
+            can_merge = can_merge && merge_eq(cur->y0, next->y0) && merge_eq(cur->y1, next->y1) &&
+                        merge_eq(cur->s1, next->s0) && cur->v0 == next->v0 && cur->v1 == next->v1 &&
+                        merge_uvs_continue(cur->s1 - cur->s0, cur->u0, cur->u1,
+                                           next->s1 - next->s0, next->u0, next->u1);
+        } else {
+            can_merge = can_merge && merge_eq(cur->s0, next->s0) && merge_eq(cur->s1, next->s1) &&
+                        merge_eq(cur->y1, next->y0) && cur->u0 == next->u0 && cur->u1 == next->u1 &&
+                        merge_uvs_continue(cur->y1 - cur->y0, cur->v0, cur->v1,
+                                           next->y1 - next->y0, next->v0, next->v1);
+        }
+
+        if (can_merge) {
+            /* Continue the uvs of the current quad across the next one, which covers them at the same density */
+            if (along_rows) {
+                cur->s1 = next->s1;
+                cur->u1 += next->u1 - next->u0;
+            } else {
+                cur->y1 = next->y1;
+                cur->v1 += next->v1 - next->v0;
+            }
+        } else {
+            rects[++num_merged] = *next;
+        }
+    }
+
+    return num_merged + 1;
+}
+
+/* Writes a merged quad as two triangles, positioned at its centre and wound to face along its normal. */
+static void fill_wall_rect(wall_rect const* r, pb_contiguous_shape* shape, pb_vert3D* verts) {
+    float s_mid = (r->s0 + r->s1) / 2.f;
+    float y_mid = (r->y0 + r->y1) / 2.f;
+    pb_vert3D corners[4];
+    size_t i;
+
+    shape->pos.x = -r->nz * s_mid + r->nx * r->d;
+    shape->pos.y = y_mid;
+    shape->pos.z = r->nx * s_mid + r->nz * r->d;
+
+    /* Bottom-s0, bottom-s1, top-s1, top-s0 */
+    for (i = 0; i < 4; ++i) {
+        int at_s1 = i == 1 || i == 2;
+        int at_y1 = i >= 2;
+        float s = (at_s1 ? r->s1 : r->s0) - s_mid;
+
+        corners[i].x = -r->nz * s;
+        corners[i].y = (at_y1 ? r->y1 : r->y0) - y_mid;
+        corners[i].z = r->nx * s;
+        corners[i].nx = r->nx;
+        corners[i].ny = 0.f;
+        corners[i].nz = r->nz;
+        corners[i].u = at_s1 ? r->u1 : r->u0;
+        corners[i].v = at_y1 ? r->v1 : r->v0;
+    }
+
+    /* Wind the triangles counter-clockwise when viewed from the front, like every other shape */
+    pb_point3D e1 = {corners[1].x - corners[0].x, corners[1].y - corners[0].y, corners[1].z - corners[0].z};
+    pb_point3D e2 = {corners[2].x - corners[0].x, corners[2].y - corners[0].y, corners[2].z - corners[0].z};
+    float facing = (e1.y * e2.z - e1.z * e2.y) * r->nx + (e1.x * e2.y - e1.y * e2.x) * r->nz;
+    size_t second = facing > 0.f ? 1 : 3;
+    size_t fourth = facing > 0.f ? 3 : 1;
+
+    verts[0] = corners[0];
+    verts[1] = corners[second];
+    verts[2] = corners[2];
+    verts[3] = corners[0];
+    verts[4] = corners[2];
+    verts[5] = corners[fourth];
+
+    /* The quad's corners are opposite corners of its box, so the sphere through them is as tight as it gets */
+    pb_bounds3D_clear(&shape->bounds);
+    for (i = 0; i < 4; ++i) {
+        pb_point3D p = {corners[i].x + shape->pos.x, corners[i].y + shape->pos.y, corners[i].z + shape->pos.z};
+        pb_bounds3D_add_point(&shape->bounds, &p);
+    }
+    centre_bounds(&shape->bounds);
+
+    pb_point3D half = {shape->bounds.max.x - shape->bounds.centre.x,
+                       shape->bounds.max.y - shape->bounds.centre.y,
+                       shape->bounds.max.z - shape->bounds.centre.z};
+    shape->bounds.radius = sqrtf(half.x * half.x + half.y * half.y + half.z * half.z);
+}
+
+PB_DECLSPEC pb_merged_walls* PB_CALL pb_contiguous_building_merge_walls(pb_contiguous_building const* b) {
+    wall_rect* rects = NULL;
+    size_t* others = NULL;
+    size_t num_rects = 0;
+    size_t num_others = 0;
+    size_t num_other_verts = 0;
+    size_t num_walls = 0;
+    size_t i, j;
+
+    for (i = 0; i < b->num_floors; ++i) {
+        num_walls += b->floors[i].shapes[PB_EXTRUDED_WALL].count;
+    }
+    for (i = 0; i < b->num_rooms; ++i) {
+        num_walls += b->rooms[i].shapes[PB_EXTRUDED_WALL].count;
+    }
+
+    rects = malloc(sizeof(wall_rect) * (num_walls ? num_walls : 1));
+    others = malloc(sizeof(size_t) * (num_walls ? num_walls : 1));
+    if (!rects || !others) {
+        free(rects);
+        free(others);
+        return NULL;
+    }
+
+    for (i = 0; i < b->num_floors + b->num_rooms; ++i) {
+        pb_range walls = i < b->num_floors ? b->floors[i].shapes[PB_EXTRUDED_WALL]
+                                           : b->rooms[i - b->num_floors].shapes[PB_EXTRUDED_WALL];
+        for (j = walls.start; j < walls.start + walls.count; ++j) {
+            if (get_wall_rect(b, j, rects + num_rects)) {
+                ++num_rects;
+            } else {
+                others[num_others++] = j;
+                num_other_verts += b->shapes[j].verts.count;
+            }
+        }
+    }
+
+    num_rects = merge_wall_rects(rects, num_rects, 1);
+    num_rects = merge_wall_rects(rects, num_rects, 0);
+
+    size_t num_shapes = num_rects + num_others;
+    size_t num_verts = num_rects * 6 + num_other_verts;
+    size_t shapes_offset = align_size(sizeof(pb_merged_walls));
+    size_t verts_offset = shapes_offset + align_size(sizeof(pb_contiguous_shape) * num_shapes);
+
+    unsigned char* block = malloc(verts_offset + sizeof(pb_vert3D) * num_verts);
+    if (!block) {
+        free(rects);
+        free(others);
+        return NULL;
+    }
+
+    pb_merged_walls* out = (pb_merged_walls*)block;
+    out->shapes = (pb_contiguous_shape*)(block + shapes_offset);
+    out->num_shapes = num_shapes;
+    out->verts = (pb_vert3D*)(block + verts_offset);
+    out->num_verts = num_verts;
+
+    size_t next_vert = 0;
+    for (i = 0; i < num_rects; ++i) {
+        pb_contiguous_shape* shape = out->shapes + i;
+        shape->verts.start = next_vert;
+        shape->verts.count = 6;
+        fill_wall_rect(rects + i, shape, out->verts + next_vert);
+        next_vert += 6;
+    }
+
+    for (i = 0; i < num_others; ++i) {
+        pb_contiguous_shape const* original = b->shapes + others[i];
+        pb_contiguous_shape* shape = out->shapes + num_rects + i;
+
+        shape->verts.start = next_vert;
+        shape->verts.count = original->verts.count;
+        shape->pos = original->pos;
+        shape->bounds = original->bounds;
+        memcpy(out->verts + next_vert, b->verts + original->verts.start, sizeof(pb_vert3D) * original->verts.count);
+        next_vert += original->verts.count;
+    }
+
+    free(rects);
+    free(others);
+    return out;
+}
+
+PB_DECLSPEC void PB_CALL pb_merged_walls_free(pb_merged_walls* w) {
+    free(w);
+}
+
+/**
+ * Adds the instances for a part's doors or windows, or just counts them if out is NULL. The walker's current floor
+ * and room must be set.
+ */
+static int collect_part_instances(extrusion_walker* w, pb_shape2D const* shape, int const* has_wall,
+                                  pb_wall_structure const* structures, size_t num_structures,
+                                  size_t floor, float start_height, int is_door,
+                                  pb_wall_structure_instance* out, size_t* num_out) {
+    float height = is_door ? w->door_height : w->window_height;
+    size_t i;
+
+    for (i = 0; i < num_structures; ++i) {
+        pb_wall_structure const* s = structures + i;
+        pb_line2D wall_line;
+        pb_point2D normal;
+        size_t num_spans;
+
+        if (s->wall >= shape->points.size || (has_wall && !has_wall[s->wall])) {
+            continue;
+        }
+
+        get_wall_line(shape, s->wall, w->cur_room != PB_EXTRUDED_EXTERIOR, &wall_line, &normal);
+        if (get_wall_spans(w, &wall_line, &num_spans) == -1) {
+            return -1;
+        }
+
+        if (!structure_in_spans(&wall_line, s, (pb_point2D const*)w->scratch_spans.items, num_spans)) {
+            continue;
+        }
+
+        if (out) {
+            pb_wall_structure_instance* instance = out + *num_out;
+            pb_line2D structure_line = {s->start, s->end};
+            pb_point2D vec = {s->end.x - s->start.x, s->end.y - s->start.y};
+            pb_quad_verts quad, wall_quads[2];
+            pb_point3D wall_pos[2];
+
+            /* Place the opening exactly where the simple extruders put their quads, heights capped and all */
+            if (is_door) {
+                pb_simple_door_quads(&wall_line, &structure_line, &normal, &w->bottom_floor_centre, w->floor_height,
+                                     height, start_height, &quad, &instance->pos, wall_quads, wall_pos);
+            } else {
+                pb_simple_window_quads(&wall_line, &structure_line, &normal, &w->bottom_floor_centre, w->floor_height,
+                                       height, start_height, &quad, &instance->pos, wall_quads, wall_pos);
+            }
+
+            instance->normal.x = normal.x;
+            instance->normal.y = 0.f;
+            instance->normal.z = -normal.y;
+            instance->width = sqrtf(vec.x * vec.x + vec.y * vec.y);
+            instance->height = quad.top - quad.bottom;
+            instance->floor = floor;
+            instance->room = w->cur_room;
+        }
+        ++*num_out;
+    }
+
+    return 0;
+}
+
+/**
+ * Walks a building's doors and windows in extrusion order, filling in the instances (if given) and counting them.
+ */
+static int collect_instances(extrusion_walker* w, pb_building const* building, pb_wall_structure_instances* out,
+                             size_t* num_doors, size_t* num_windows) {
+    size_t i, j;
+
+    *num_doors = 0;
+    *num_windows = 0;
+
+    for (i = 0; i < building->num_floors; ++i) {
+        pb_floor const* f = building->floors + i;
+        float start_height = i * w->floor_height;
+
+        w->cur_floor = f;
+        w->cur_room = PB_EXTRUDED_EXTERIOR;
+        if (collect_part_instances(w, &f->shape, NULL, f->doors, f->num_doors, i, start_height, 1,
+                                   out ? out->doors : NULL, num_doors) == -1 ||
+            collect_part_instances(w, &f->shape, NULL, f->windows, f->num_windows, i, start_height, 0,
+                                   out ? out->windows : NULL, num_windows) == -1) {
+            return -1;
+        }
+
+        for (j = 0; j < f->num_rooms; ++j) {
+            pb_room const* room = f->rooms + j;
+            int const* has_wall = (int const*)room->walls.items;
+
+            w->cur_room = j;
+            if (collect_part_instances(w, &room->shape, has_wall, room->doors, room->num_doors, i, start_height, 1,
+                                       out ? out->doors : NULL, num_doors) == -1 ||
+                collect_part_instances(w, &room->shape, has_wall, room->windows, room->num_windows, i, start_height, 0,
+                                       out ? out->windows : NULL, num_windows) == -1) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+PB_DECLSPEC pb_wall_structure_instances* PB_CALL pb_extrude_building_instances(pb_building const* building,
+                                                                             float floor_height,
+                                                                             float door_height,
+                                                                             float window_height,
+                                                                             unsigned flags) {
+    extrusion_walker w;
+    pb_wall_structure_instances* out = NULL;
+    size_t num_doors, num_windows;
+
+    init_walker(&w, building, floor_height, door_height, window_height, NULL, NULL, NULL, NULL, flags, NULL);
+
+    /* Count everything first so that the instances fit in one allocation */
+    if (collect_instances(&w, building, NULL, &num_doors, &num_windows) == -1) {
+        goto err_return;
+    }
+
+    size_t doors_offset = align_size(sizeof(pb_wall_structure_instances));
+    size_t windows_offset = doors_offset + align_size(sizeof(pb_wall_structure_instance) * num_doors);
+    unsigned char* block = malloc(windows_offset + sizeof(pb_wall_structure_instance) * num_windows);
+    if (!block) {
+        goto err_return;
+    }
+
+    out = (pb_wall_structure_instances*)block;
+    out->doors = (pb_wall_structure_instance*)(block + doors_offset);
+    out->windows = (pb_wall_structure_instance*)(block + windows_offset);
+
+    if (collect_instances(&w, building, out, &out->num_doors, &out->num_windows) == -1) {
+        goto err_return;
+    }
+
+    free_walker(&w);
+    return out;
+
+err_return:
+    free(out);
+    free_walker(&w);
+    return NULL;
+}
+
+PB_DECLSPEC void PB_CALL pb_wall_structure_instances_free(pb_wall_structure_instances* instances) {
+    free(instances);
+}
+
 PB_DECLSPEC void PB_CALL pb_extruded_room_free(pb_extruded_room* r) {
     size_t i, j;
     for (i = 0; i < r->num_wall_lists; ++i) {
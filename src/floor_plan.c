@@ -1,8 +1,12 @@
 #include <pb/floor_plan.h>
+#include <pb/util/arena/arena.h>
 #include <stdlib.h>
+#include <string.h>
 
 PB_DECLSPEC void PB_CALL pb_room_free(pb_room* room, pb_room_free_func r_free) {
-    r_free(room);
+    if (r_free) {
+        r_free(room);
+    }
     pb_shape2D_free(&room->shape);
     pb_vector_free(&room->walls);
     free(room->doors);
@@ -15,19 +19,160 @@ PB_DECLSPEC void PB_CALL pb_floor_free(pb_floor* f, pb_floor_free_func f_free, p
         pb_room_free(f->rooms + cur_room, r_free);
     }
 
+    if (f_free) {
+        f_free(f);
+    }
     free(f->rooms);
     pb_shape2D_free(&f->shape);
     free(f->doors);
     free(f->windows);
 }
 
+/**
+ * Frees a packed building. The hooks still see every room and floor (in the same order as for an unpacked building),
+ * but the building's arrays are all released with a single call. If no hooks are given, nothing needs to be walked.
+ */
+static void free_packed_building(pb_building* building, pb_building_free_func b_free, pb_floor_free_func f_free,
+                                 pb_room_free_func r_free) {
+    size_t cur_floor;
+    size_t cur_room;
+
+    if (r_free || f_free) {
+        for (cur_floor = 0; cur_floor < building->num_floors; ++cur_floor) {
+            pb_floor* f = building->floors + cur_floor;
+
+            if (r_free) {
+                for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+                    r_free(f->rooms + cur_room);
+                }
+            }
+            if (f_free) {
+                f_free(f);
+            }
+        }
+    }
+
+    if (b_free) {
+        b_free(building);
+    }
+    pb_arena_free(building->arena);
+    building->arena = NULL;
+}
+
 PB_DECLSPEC void PB_CALL pb_building_free(pb_building* building, pb_building_free_func b_free, pb_floor_free_func f_free,
                                           pb_room_free_func r_free) {
     size_t cur_floor;
+
+    if (building->arena) {
+        free_packed_building(building, b_free, f_free, r_free);
+        return;
+    }
+
     for(cur_floor = 0; cur_floor < building->num_floors; ++cur_floor) {
         pb_floor_free(building->floors + cur_floor, f_free, r_free);
     }
 
-    b_free(building);
+    if (b_free) {
+        b_free(building);
+    }
     free(building->floors);
 }
+
+/* Rounds a size up the same way pb_arena_alloc does so that the arena can be sized exactly */
+static size_t arena_size(size_t size) {
+    return (size + PB_ARENA_ALIGNMENT - 1) & ~(size_t)(PB_ARENA_ALIGNMENT - 1);
+}
+
+static size_t vector_arena_size(pb_vector const* vec) {
+    return arena_size(vec->item_size * vec->size);
+}
+
+static size_t packed_size(pb_building const* building) {
+    size_t total = arena_size(sizeof(pb_floor) * building->num_floors);
+    size_t cur_floor;
+    size_t cur_room;
+
+    for (cur_floor = 0; cur_floor < building->num_floors; ++cur_floor) {
+        pb_floor const* f = building->floors + cur_floor;
+
+        total += arena_size(sizeof(pb_room) * f->num_rooms);
+        total += vector_arena_size(&f->shape.points);
+        total += arena_size(sizeof(pb_wall_structure) * f->num_doors);
+        total += arena_size(sizeof(pb_wall_structure) * f->num_windows);
+
+        for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+            pb_room const* r = f->rooms + cur_room;
+
+            total += vector_arena_size(&r->shape.points);
+            total += vector_arena_size(&r->walls);
+            total += arena_size(sizeof(pb_wall_structure) * r->num_doors);
+            total += arena_size(sizeof(pb_wall_structure) * r->num_windows);
+        }
+    }
+
+    return total;
+}
+
+/* Copies an array into the arena, which must have been sized to hold it. Empty arrays become NULL. */
+static void* pack_array(pb_arena* arena, void const* src, size_t size) {
+    void* dst;
+    if (size == 0) {
+        return NULL;
+    }
+
+    dst = pb_arena_alloc(arena, size);
+    memcpy(dst, src, size);
+    return dst;
+}
+
+static void pack_vector(pb_arena* arena, pb_vector* vec) {
+    vec->items = pack_array(arena, vec->items, vec->item_size * vec->size);
+    vec->cap = vec->size;
+}
+
+PB_DECLSPEC int PB_CALL pb_building_pack(pb_building* building) {
+    pb_arena* arena;
+    pb_floor* floors;
+    size_t cur_floor;
+    size_t cur_room;
+
+    if (building->arena) {
+        return 0;
+    }
+
+    arena = pb_arena_create(packed_size(building));
+    if (!arena) {
+        return -1;
+    }
+
+    /* Copy everything into the arena first; since the arena was sized up front, none of these allocations can fail */
+    floors = pack_array(arena, building->floors, sizeof(pb_floor) * building->num_floors);
+    for (cur_floor = 0; cur_floor < building->num_floors; ++cur_floor) {
+        pb_floor* f = floors + cur_floor;
+
+        f->rooms = pack_array(arena, f->rooms, sizeof(pb_room) * f->num_rooms);
+        pack_vector(arena, &f->shape.points);
+        f->doors = pack_array(arena, f->doors, sizeof(pb_wall_structure) * f->num_doors);
+        f->windows = pack_array(arena, f->windows, sizeof(pb_wall_structure) * f->num_windows);
+
+        for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+            pb_room* r = f->rooms + cur_room;
+
+            pack_vector(arena, &r->shape.points);
+            pack_vector(arena, &r->walls);
+            r->doors = pack_array(arena, r->doors, sizeof(pb_wall_structure) * r->num_doors);
+            r->windows = pack_array(arena, r->windows, sizeof(pb_wall_structure) * r->num_windows);
+        }
+    }
+
+    /* Now release the original arrays without calling any of the generator's hooks, since its data was carried over */
+    for (cur_floor = 0; cur_floor < building->num_floors; ++cur_floor) {
+        pb_floor_free(building->floors + cur_floor, NULL, NULL);
+    }
+    free(building->floors);
+
+    building->floors = floors;
+    building->arena = arena;
+
+    return 0;
+}
@@ -1,6 +1,4 @@
 #include <pb/internal/astar.h>
-#include <pb/util/heap/heap.h>
-#include <pb/util/hashmap/hash_utils.h>
 #include <stdlib.h>
 
 typedef struct pb_astar_node pb_astar_node;
@@ -10,65 +8,128 @@ struct pb_astar_node {
     pb_astar_node* parent; /* Previous node in least-cost path to this node */
     float g_cost; /* Actual cost to reach this vertex */
     float h_cost; /* Estimated cost from this vertex to the goal */
+    pb_heap_handle handle; /* The node's handle in the frontier */
 };
 
-/* TODO: Fix memory leak (node's aren't freed) */
-int pb_astar(pb_vertex const* start, pb_vertex const* goal, pb_astar_heuristic heuristic, pb_vector** path) {
-    pb_vector* result;
-    pb_heap* frontier;
-    pb_hashmap* visited;
+struct pb_astar_csr_node {
+    size_t parent;         /* Previous vertex in least-cost path to this vertex */
+    float g_cost;          /* Actual cost to reach this vertex */
+    float h_cost;          /* Estimated cost from this vertex to the goal */
+    pb_heap_handle handle; /* The node's handle in the frontier */
+    unsigned search_id;    /* The search that the node was last reached by */
+};
 
-    pb_astar_node* start_node;
-    int found_path = 0;
+/* The space that each node takes up in the arena */
+#define PB_ASTAR_NODE_SIZE \
+    ((sizeof(pb_astar_node) + PB_ARENA_ALIGNMENT - 1) / PB_ARENA_ALIGNMENT * PB_ARENA_ALIGNMENT)
 
-    result = pb_vector_create(sizeof(pb_vertex*), 0);
-    if (!result) {
+#define PB_ASTAR_DEFAULT_NODES 64
+
+int pb_astar_ctx_init(pb_astar_ctx* ctx) {
+    ctx->nodes = pb_arena_create(PB_ASTAR_NODE_SIZE * PB_ASTAR_DEFAULT_NODES);
+    if (!ctx->nodes) {
         return -1;
     }
+    ctx->num_nodes = 0;
+    ctx->nodes_cap = PB_ASTAR_DEFAULT_NODES;
+    ctx->csr_nodes = NULL;
+    ctx->csr_nodes_cap = 0;
+    ctx->search_id = 0;
 
-    frontier = pb_heap_create(0);
-    if (!frontier) {
-        pb_vector_free(result);
+    if (pb_handle_heap_init(&ctx->frontier, 0) == -1) {
+        pb_arena_free(ctx->nodes);
         return -1;
     }
 
-    visited = pb_hashmap_create(pb_pointer_hash, pb_pointer_eq);
-    if (!visited) {
-        pb_vector_free(result);
-        pb_heap_free(frontier);
+    if (pb_ptr_map_init(&ctx->visited) == -1) {
+        pb_handle_heap_free(&ctx->frontier);
+        pb_arena_free(ctx->nodes);
         return -1;
     }
 
-    /* The easy case */
-    if (start == goal)  {
-        if (pb_vector_push_back(result, start) == -1) {
-            goto err_return;
-        } else {
-            *path = result;
-            return 0;
-        }
+    return 0;
+}
+
+void pb_astar_ctx_free(pb_astar_ctx* ctx) {
+    free(ctx->csr_nodes);
+    pb_ptr_map_destroy(&ctx->visited);
+    pb_handle_heap_free(&ctx->frontier);
+    pb_arena_free(ctx->nodes);
+}
+
+/**
+ * Releases the last search's nodes. Resetting an arena frees every block but the first, so if the last search
+ * outgrew the first block, the arena is replaced with one whose first block holds all of its nodes.
+ *
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+static int reset_nodes(pb_astar_ctx* ctx) {
+    pb_arena* nodes;
+    if (ctx->num_nodes <= ctx->nodes_cap) {
+        pb_arena_reset(ctx->nodes);
+        ctx->num_nodes = 0;
+        return 0;
     }
 
-    /* Every other case lol */
-    start_node = malloc(sizeof(pb_astar_node));
-    if (!start_node) {
-        goto err_return;
+    nodes = pb_arena_create(PB_ASTAR_NODE_SIZE * ctx->num_nodes);
+    if (!nodes) {
+        return -1;
     }
 
-    start_node->vert = start;
-    start_node->g_cost = 0.f;
-    start_node->h_cost = heuristic(start, goal);
-    start_node->parent = NULL;
-    if (pb_heap_insert(frontier, start_node, start_node->g_cost + start_node->h_cost) == -1 || pb_hashmap_put(visited, start, start_node) == -1) {
-        goto err_return;
+    pb_arena_free(ctx->nodes);
+    ctx->nodes = nodes;
+    ctx->nodes_cap = ctx->num_nodes;
+    ctx->num_nodes = 0;
+    return 0;
+}
+
+/**
+ * Makes a node for a newly reached vertex, adds it to the visited map and puts it in the frontier.
+ *
+ * @return The new node, or NULL if out of memory.
+ */
+static pb_astar_node* add_node(pb_astar_ctx* ctx, pb_vertex const* vert, pb_astar_node* parent, float g_cost,
+                               float h_cost) {
+    pb_astar_node* node = pb_arena_alloc(ctx->nodes, sizeof(pb_astar_node));
+    if (!node) {
+        return NULL;
+    }
+    ctx->num_nodes++;
+
+    node->vert = vert;
+    node->parent = parent;
+    node->g_cost = g_cost;
+    node->h_cost = h_cost;
+    node->handle = pb_handle_heap_insert(&ctx->frontier, node, g_cost + h_cost);
+    if (node->handle == PB_HEAP_NO_HANDLE || pb_ptr_map_put(&ctx->visited, vert, node) == -1) {
+        return NULL;
+    }
+
+    return node;
+}
+
+int pb_astar_search(pb_astar_ctx* ctx, pb_vertex const* start, pb_vertex const* goal, pb_astar_heuristic heuristic,
+                    pb_vector* path) {
+    pb_astar_node* node;
+    size_t num_path_verts = 0;
+    int found_path = 0;
+
+    if (reset_nodes(ctx) == -1) {
+        return -1;
     }
+    pb_handle_heap_clear(&ctx->frontier);
+    pb_ptr_map_clear(&ctx->visited);
+    path->size = 0;
 
-    pb_astar_node* node = start_node;
-    while (frontier->items.size) {
+    node = add_node(ctx, start, NULL, 0.f, heuristic(start, goal));
+    if (!node) {
+        return -1;
+    }
+
+    while (ctx->frontier.size) {
         unsigned i;
-        
-        node = (pb_astar_node*)pb_heap_get_min(frontier);
 
+        node = (pb_astar_node*)pb_handle_heap_get_min(&ctx->frontier);
         if (node->vert == goal) {
             found_path = 1;
             break;
@@ -78,75 +139,186 @@ int pb_astar(pb_vertex const* start, pb_vertex const* goal, pb_astar_heuristic h
         for (i = 0; i < node->vert->edges_size; ++i) {
             pb_edge* edge = node->vert->edges[i];
             float g_cost_neighbour = node->g_cost + edge->weight;
-            
-            /* Add the node to the visited map if it hasn't been visited already; otherwise, update its cost if appropriate */
-            pb_astar_node* neighbour_node;
-            if (pb_hashmap_get(visited, edge->to, (void**)&neighbour_node) == -1) {
-                neighbour_node = malloc(sizeof(pb_astar_node));
-                if (!neighbour_node) {
-                    goto err_return;
-                }
+            void** visited_node = pb_ptr_map_get(&ctx->visited, edge->to);
 
-                /* Add the neighbour to the visited list */
-                if (pb_hashmap_put(visited, edge->to, neighbour_node) == -1) {
-                    free(neighbour_node);
-                    goto err_return;
-                }
-
-                neighbour_node->parent = node;
-                neighbour_node->vert = edge->to;
-                neighbour_node->g_cost = g_cost_neighbour;
-                neighbour_node->h_cost = heuristic(edge->to, goal);
-
-                /* Add the neighbour to the frontier and keep searching */
-                if (pb_heap_insert(frontier, neighbour_node, neighbour_node->g_cost + neighbour_node->h_cost) == -1) {
-                    goto err_return;
+            if (!visited_node) {
+                /* Add the neighbour to the visited map and the frontier and keep searching */
+                if (!add_node(ctx, edge->to, node, g_cost_neighbour, heuristic(edge->to, goal))) {
+                    return -1;
                 }
             } else {
                 /* Decrease the neighbour's cost if we found a better path */
+                pb_astar_node* neighbour_node = (pb_astar_node*)*visited_node;
                 if (g_cost_neighbour < neighbour_node->g_cost) {
                     neighbour_node->g_cost = g_cost_neighbour;
                     neighbour_node->parent = node;
-                    pb_heap_decrease_key(frontier, neighbour_node, neighbour_node->g_cost + neighbour_node->h_cost);
+                    pb_handle_heap_decrease_key(&ctx->frontier, neighbour_node->handle,
+                                                neighbour_node->g_cost + neighbour_node->h_cost);
                 }
             }
         }
     }
 
-    if (found_path) {
-        /* Push all the elements onto the list */
-        int err = 0;
-        while (node) {
-            if (!err) {
-                err = pb_vector_push_back(result, &node->vert) == -1;
-            }
-            node = node->parent;
+    if (!found_path) {
+        return -1;
+    }
+
+    /* Fill in the path back to front, so that it doesn't need to be reversed */
+    {
+        pb_astar_node* cur;
+        pb_vertex const** verts;
+
+        for (cur = node; cur; cur = cur->parent) {
+            ++num_path_verts;
         }
-        if (err) {
-            goto err_return;
+        if (path->cap < num_path_verts && pb_vector_resize(path, num_path_verts) == -1) {
+            return -1;
         }
 
-        /* Reverse the list to give the correct path from start to goal */
-        {
-            pb_vertex* temp;
-            pb_vector_reverse_no_alloc(result, &temp);
+        verts = (pb_vertex const**)path->items;
+        path->size = num_path_verts;
+        for (cur = node; cur; cur = cur->parent) {
+            verts[--num_path_verts] = cur->vert;
         }
-        *path = result;
-    } else {
-        pb_vector_free(result);
-        free(result);
     }
 
-    pb_hashmap_for_each(visited, pb_hashmap_free_entry_data, 0);
-    pb_hashmap_free(visited);
-    pb_heap_free(frontier);
+    return 0;
+}
+
+/**
+ * Makes sure that there's a node for every vertex in the graph and starts a new search ID.
+ *
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+static int reset_csr_nodes(pb_astar_ctx* ctx, size_t num_vertices) {
+    size_t i;
+
+    if (num_vertices > ctx->csr_nodes_cap) {
+        pb_astar_csr_node* nodes = realloc(ctx->csr_nodes, sizeof(pb_astar_csr_node) * num_vertices);
+        if (!nodes) {
+            return -1;
+        }
+
+        for (i = ctx->csr_nodes_cap; i < num_vertices; ++i) {
+            nodes[i].search_id = 0;
+        }
+        ctx->csr_nodes = nodes;
+        ctx->csr_nodes_cap = num_vertices;
+    }
+
+    /* Search IDs start from 1, so if they wrap around then every node has to be marked as unreached again */
+    if (++ctx->search_id == 0) {
+        for (i = 0; i < ctx->csr_nodes_cap; ++i) {
+            ctx->csr_nodes[i].search_id = 0;
+        }
+        ctx->search_id = 1;
+    }
+
+    return 0;
+}
 
-    return found_path ? 0 : -1;
+/**
+ * Sets up the node for a newly reached vertex and puts it in the frontier.
+ *
+ * @return 0 on success, -1 on failure (out of memory).
+ */
+static int add_csr_node(pb_astar_ctx* ctx, size_t vert, size_t parent, float g_cost, float h_cost) {
+    pb_astar_csr_node* node = ctx->csr_nodes + vert;
 
-err_return:
-    pb_hashmap_for_each(visited, pb_hashmap_free_entry_data, 0);
-    pb_hashmap_free(visited);
-    pb_vector_free(result);
-    pb_heap_free(frontier);
-    return -1;
+    node->parent = parent;
+    node->g_cost = g_cost;
+    node->h_cost = h_cost;
+    node->search_id = ctx->search_id;
+    node->handle = pb_handle_heap_insert(&ctx->frontier, node, g_cost + h_cost);
+    return node->handle == PB_HEAP_NO_HANDLE ? -1 : 0;
 }
+
+int pb_astar_csr_search(pb_astar_ctx* ctx, pb_graph_csr const* graph, size_t start, size_t goal,
+                        pb_astar_csr_heuristic heuristic, pb_vector* path) {
+    size_t num_path_verts = 0;
+    size_t cur;
+    int found_path = 0;
+
+    pb_handle_heap_clear(&ctx->frontier);
+    path->size = 0;
+    if (reset_csr_nodes(ctx, graph->num_vertices) == -1 ||
+        add_csr_node(ctx, start, PB_GRAPH_CSR_NONE, 0.f, heuristic(graph, start, goal)) == -1) {
+        return -1;
+    }
+
+    while (ctx->frontier.size) {
+        pb_astar_csr_node* node = (pb_astar_csr_node*)pb_handle_heap_get_min(&ctx->frontier);
+        size_t i;
+
+        cur = (size_t)(node - ctx->csr_nodes);
+        if (cur == goal) {
+            found_path = 1;
+            break;
+        }
+
+        /* Check out all neighbouring nodes */
+        for (i = graph->edge_offsets[cur]; i < graph->edge_offsets[cur + 1]; ++i) {
+            size_t to = graph->edge_targets[i];
+            pb_astar_csr_node* neighbour_node = ctx->csr_nodes + to;
+            float g_cost_neighbour = node->g_cost + graph->edge_weights[i];
+
+            if (neighbour_node->search_id != ctx->search_id) {
+                if (add_csr_node(ctx, to, cur, g_cost_neighbour, heuristic(graph, to, goal)) == -1) {
+                    return -1;
+                }
+            } else if (g_cost_neighbour < neighbour_node->g_cost) {
+                /* Decrease the neighbour's cost if we found a better path */
+                neighbour_node->g_cost = g_cost_neighbour;
+                neighbour_node->parent = cur;
+                pb_handle_heap_decrease_key(&ctx->frontier, neighbour_node->handle,
+                                            neighbour_node->g_cost + neighbour_node->h_cost);
+            }
+        }
+    }
+
+    if (!found_path) {
+        return -1;
+    }
+
+    /* Fill in the path back to front, so that it doesn't need to be reversed */
+    for (cur = goal; cur != PB_GRAPH_CSR_NONE; cur = ctx->csr_nodes[cur].parent) {
+        ++num_path_verts;
+    }
+    if (path->cap < num_path_verts && pb_vector_resize(path, num_path_verts) == -1) {
+        return -1;
+    }
+
+    path->size = num_path_verts;
+    for (cur = goal; cur != PB_GRAPH_CSR_NONE; cur = ctx->csr_nodes[cur].parent) {
+        ((size_t*)path->items)[--num_path_verts] = cur;
+    }
+
+    return 0;
+}
+
+int pb_astar(pb_vertex const* start, pb_vertex const* goal, pb_astar_heuristic heuristic, pb_vector** path) {
+    pb_astar_ctx ctx;
+    pb_vector* result;
+
+    result = pb_vector_create(sizeof(pb_vertex*), 0);
+    if (!result) {
+        return -1;
+    }
+
+    if (pb_astar_ctx_init(&ctx) == -1) {
+        pb_vector_free(result);
+        free(result);
+        return -1;
+    }
+
+    if (pb_astar_search(&ctx, start, goal, heuristic, result) == -1) {
+        pb_astar_ctx_free(&ctx);
+        pb_vector_free(result);
+        free(result);
+        return -1;
+    }
+
+    pb_astar_ctx_free(&ctx);
+    *path = result;
+    return 0;
+}
\ No newline at end of file
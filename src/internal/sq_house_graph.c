@@ -5,6 +5,7 @@
 #include <pb/extrusion.h>
 #include <pb/internal/astar.h>
 #include <pb/internal/sq_house_graph.h>
+#include <pb/internal/sq_house_layout.h>
 #include <pb/util/vector/vector.h>
 #include <pb/util/pair/pair.h>
 #include <pb/util/hashmap/hash_utils.h>
@@ -105,6 +106,231 @@ void pb_sq_house_get_wall_overlap(pb_room const* room1, pb_room const* room2, in
     }
 }
 
+/**
+ * One side of a room's rectangle, used to find shared walls.
+ *
+ * line:   The fuzzed coordinate of the line that the side lies on (y for the top and bottom, x for the left and right).
+ *         Two sides on the same line have the same value, as per pb_float_approx_eq.
+ * start:  Where the side starts along the line.
+ * end:    Where the side ends along the line.
+ * is_low: 1 for a bottom or left side, 0 for a top or right side. A wall can only be shared by a low side and a high
+ *         side.
+ * room:   The index of the room in its floor.
+ */
+typedef struct {
+    uint32_t line;
+    float start;
+    float end;
+    int is_low;
+    size_t room;
+} room_side;
+
+/* An ordered pair of room indices whose rooms might share a wall. */
+typedef struct {
+    size_t room;
+    size_t neighbour;
+} room_pair;
+
+static void set_room_side(room_side* side, float line, float start, float end, int is_low, size_t room) {
+    side->line = pb_fuzz_float(line, 5);
+    side->start = start;
+    side->end = end;
+    side->is_low = is_low;
+    side->room = room;
+}
+
+static int room_side_cmp(void const* s1, void const* s2) {
+    room_side const* side1 = (room_side const*)s1;
+    room_side const* side2 = (room_side const*)s2;
+
+    if (side1->line != side2->line) {
+        return side1->line < side2->line ? -1 : 1;
+    } else if (side1->start != side2->start) {
+        return side1->start < side2->start ? -1 : 1;
+    }
+    return 0;
+}
+
+static int room_pair_cmp(void const* p1, void const* p2) {
+    room_pair const* pair1 = (room_pair const*)p1;
+    room_pair const* pair2 = (room_pair const*)p2;
+
+    if (pair1->room != pair2->room) {
+        return pair1->room < pair2->room ? -1 : 1;
+    } else if (pair1->neighbour != pair2->neighbour) {
+        return pair1->neighbour < pair2->neighbour ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Sweeps along each line that the given sides lie on, adding both orderings of every pair of rooms that have a low
+ * and a high side overlapping on that line to pairs. Since rooms don't overlap, only a couple of sides are ever active
+ * at once, so this takes O(n log n + k) for n sides and k pairs.
+ *
+ * @param sides     The sides to sweep. They get sorted by line and start.
+ * @param num_sides The number of sides.
+ * @param active    Scratch space for num_sides indices.
+ * @param pairs     The vector of room_pair to add to.
+ * @return 0 on success, -1 on failure.
+ */
+static int sweep_room_sides(room_side* sides, size_t num_sides, size_t* active, pb_vector* pairs) {
+    size_t num_active = 0;
+    size_t i;
+
+    qsort(sides, num_sides, sizeof(room_side), room_side_cmp);
+
+    for (i = 0; i < num_sides; ++i) {
+        room_side const* side = sides + i;
+        size_t kept = 0;
+        size_t j;
+
+        if (i > 0 && sides[i - 1].line != side->line) {
+            num_active = 0;
+        }
+
+        for (j = 0; j < num_active; ++j) {
+            room_side const* other = sides + active[j];
+
+            /* The sides are sorted by start, so anything that ends here can't overlap anything that comes after */
+            if (other->end <= side->start) {
+                continue;
+            }
+            active[kept++] = active[j];
+
+            if (other->is_low != side->is_low && other->room != side->room && other->start < side->end) {
+                room_pair pair = {other->room, side->room};
+                room_pair reversed = {side->room, other->room};
+                if (pb_vector_push_back(pairs, &pair) == -1 || pb_vector_push_back(pairs, &reversed) == -1) {
+                    return -1;
+                }
+            }
+        }
+
+        num_active = kept;
+        active[num_active++] = i;
+    }
+
+    return 0;
+}
+
+/**
+ * Finds every ordered pair of rooms on a floor that might share a wall (i.e. every pair for which
+ * pb_sq_house_get_shared_wall could return something other than -1). The pairs are sorted and have no duplicates,
+ * so they come out in the same order as a brute force check of every pair would find them.
+ *
+ * @param floor The floor.
+ * @param pairs An initialised vector of room_pair, which holds the pairs.
+ * @return 0 on success, -1 on failure.
+ */
+static int find_adjacent_rooms(pb_floor const* floor, pb_vector* pairs) {
+    size_t num_sides = floor->num_rooms * 2;
+    room_side* horizontal = malloc(sizeof(room_side) * num_sides);
+    room_side* vertical = malloc(sizeof(room_side) * num_sides);
+    size_t* active = malloc(sizeof(size_t) * num_sides);
+    room_pair* items;
+    size_t num_unique = 0;
+    size_t i;
+
+    if (num_sides == 0) {
+        goto success;
+    }
+    if (!horizontal || !vertical || !active) {
+        goto err_return;
+    }
+
+    for (i = 0; i < floor->num_rooms; ++i) {
+        pb_rect r;
+        float left, bottom, right, top;
+
+        /* Same corners as pb_sq_house_get_shared_wall, so that the comparisons come out the same */
+        pb_shape2D_to_pb_rect(&floor->rooms[i].shape, &r);
+        left = r.bottom_left.x;
+        bottom = r.bottom_left.y;
+        right = r.bottom_left.x + r.w;
+        top = r.bottom_left.y + r.h;
+
+        set_room_side(horizontal + i * 2, bottom, left, right, 1, i);
+        set_room_side(horizontal + i * 2 + 1, top, left, right, 0, i);
+        set_room_side(vertical + i * 2, left, bottom, top, 1, i);
+        set_room_side(vertical + i * 2 + 1, right, bottom, top, 0, i);
+    }
+
+    if (sweep_room_sides(horizontal, num_sides, active, pairs) == -1 ||
+        sweep_room_sides(vertical, num_sides, active, pairs) == -1) {
+        goto err_return;
+    }
+
+    /* Rooms can only be found twice if they're degenerate, but keep the pairs unique anyway */
+    items = (room_pair*)pairs->items;
+    qsort(items, pairs->size, sizeof(room_pair), room_pair_cmp);
+    for (i = 0; i < pairs->size; ++i) {
+        if (num_unique == 0 || room_pair_cmp(items + num_unique - 1, items + i) != 0) {
+            items[num_unique++] = items[i];
+        }
+    }
+    pairs->size = num_unique;
+
+success:
+    free(horizontal);
+    free(vertical);
+    free(active);
+    return 0;
+
+err_return:
+    free(horizontal);
+    free(vertical);
+    free(active);
+    return -1;
+}
+
+/**
+ * Adds an edge from room to neighbour to the floor graph if they share a wall.
+ *
+ * @return 0 on success (whether or not the rooms shared a wall), -1 on failure.
+ */
+static int add_room_conn(pb_graph* g, pb_sq_house_house_spec const* house_spec, pb_floor* floor,
+                         size_t room, size_t neighbour) {
+    pb_sq_house_room_conn* conn;
+    pb_rect room_rect;
+    pb_rect neighbour_rect;
+    int shared_wall;
+    float delta;
+
+    pb_shape2D_to_pb_rect(&floor->rooms[room].shape, &room_rect);
+    pb_shape2D_to_pb_rect(&floor->rooms[neighbour].shape, &neighbour_rect);
+    shared_wall = pb_sq_house_get_shared_wall(&room_rect, &neighbour_rect);
+    if (shared_wall == -1) {
+        return 0;
+    }
+
+    conn = malloc(sizeof(pb_sq_house_room_conn));
+    if (!conn) {
+        return -1;
+    }
+
+    pb_sq_house_get_wall_overlap(floor->rooms + room, floor->rooms + neighbour, shared_wall,
+                                 &conn->overlap_start, &conn->overlap_end);
+    conn->room = floor->rooms + room;
+    conn->neighbour = floor->rooms + neighbour;
+    conn->wall = shared_wall;
+    conn->can_connect = 1;
+
+    /* Check whether there's enough wall surface area to actually fit a door here */
+    if (pb_float_approx_eq(conn->overlap_start.x, conn->overlap_end.x, 5)) {
+        delta = conn->overlap_end.y - conn->overlap_start.y;
+    } else {
+        delta = conn->overlap_end.x - conn->overlap_start.x;
+    }
+    conn->has_door = delta > house_spec->door_size;
+
+    if (pb_graph_add_edge(g, floor->rooms + room, floor->rooms + neighbour, 0.f, conn) == -1) {
+        free(conn);
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Generates a connectivity graph between the rooms of a given floor.
  * The edges in the graph are of type pb_sq_house_room_edge and indicate whether these rooms
@@ -116,9 +342,15 @@ void pb_sq_house_get_wall_overlap(pb_room const* room1, pb_room const* room2, in
  * @return A graph containing the rooms' connections or NULL on failure.
  */
 pb_graph* pb_sq_house_generate_floor_graph(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs, pb_floor* floor) {
-    pb_graph* g = pb_graph_create(pb_pointer_hash, pb_pointer_eq); /* Hash based on each room's pointer */
+    pb_graph* g = pb_graph_create_pooled(pb_pointer_hash, pb_pointer_eq); /* Hash based on each room's pointer */
+    pb_vector pairs;
+    (void)room_specs; /* Room specs don't restrict connections yet; any adjacent rooms can be connected */
 
     if (!g) return NULL;
+    if (pb_vector_init(&pairs, sizeof(room_pair), 0) == -1) {
+        pb_graph_free(g);
+        return NULL;
+    }
 
     /* Add all the rooms to the graph */
     unsigned i;
@@ -128,95 +360,26 @@ pb_graph* pb_sq_house_generate_floor_graph(pb_sq_house_house_spec* house_spec, p
         }
     }
 
-    /* Do a brute force check of all rooms to determine their shared edges */
+    /* Sweep along the rooms' edges to find the pairs of rooms that might share a wall, then check each of them */
     /* Note that this doesn't account for connections to outside; that's done during window placement */
-    for (i = 0; i < floor->num_rooms; ++i) {
-        unsigned j;
-        pb_sq_house_room_spec* spec;
-        pb_rect roomi_rect;
-        pb_shape2D_to_pb_rect(&floor->rooms[i].shape, &roomi_rect);
-
-        /* Stairs and hallways have no associated room spec; they can connect to any adjacent rooms */
-        int roomi_has_spec = pb_hashmap_get(room_specs, floor->rooms[i].name, (void**)&spec) != -1;
-
-
-        for (j = 0; j < floor->num_rooms; ++j) {
-            if (i == j) continue;
-
-            pb_point2D start;
-            pb_point2D end;
-
-            pb_rect roomj_rect;
-            pb_shape2D_to_pb_rect(&floor->rooms[j].shape, &roomj_rect);
-            
-            int shared_wall = pb_sq_house_get_shared_wall(&roomi_rect, &roomj_rect);
-
-            if (shared_wall != -1) {
-                pb_sq_house_room_conn* conn = malloc(sizeof(pb_sq_house_room_conn));
-                unsigned adj;
-                if (!conn) goto err_return;
-
-                pb_sq_house_get_wall_overlap(floor->rooms + i, floor->rooms + j, shared_wall, &start, &end);
-
-                conn->room = floor->rooms + i;
-                conn->neighbour = floor->rooms + j;
-                conn->overlap_start = start;
-                conn->overlap_end = end;
-                conn->can_connect = 0;
-                conn->has_door = 0;
-                conn->wall = shared_wall;
-                conn->can_connect = 1;
-
-                float delta;
-                if (pb_float_approx_eq(conn->overlap_start.x, conn->overlap_end.x, 5)) {
-                    delta = conn->overlap_end.y - conn->overlap_start.y;
-                } else {
-                    delta = conn->overlap_end.x - conn->overlap_start.x;
-                }
-                conn->has_door = delta > house_spec->door_size;
+    if (find_adjacent_rooms(floor, &pairs) == -1) {
+        goto err_return;
+    }
 
-//                if (!roomi_has_spec) {
-//                    conn->can_connect = 1;
-//
-//                    /* Check whether there's enough wall surface area to actually fit a door here */
-//                    float delta;
-//                    if (pb_float_approx_eq(conn->overlap_start.x, conn->overlap_end.x, 5)) {
-//                        delta = conn->overlap_end.y - conn->overlap_start.y;
-//                    } else {
-//                        delta = conn->overlap_end.x - conn->overlap_start.x;
-//                    }
-//                    conn->has_door = delta >= house_spec->door_size;
-//                } else {
-//                    /* Check whether the room spec for room i allows a connection to room j */
-//                    for (adj = 0; adj < spec->num_adjacent; ++adj) {
-//                        if (strcmp(floor->rooms[j].name, spec->adjacent[adj]) == 0) {
-//                            conn->can_connect = 1;
-//
-//                            /* Check whether there's enough wall surface area to actually fit a door here */
-//                            float delta;
-//                            if (pb_float_approx_eq(conn->overlap_start.x, conn->overlap_end.x, 5)) {
-//                                delta = conn->overlap_end.y - conn->overlap_start.y;
-//                            } else {
-//                                delta = conn->overlap_end.x - conn->overlap_start.x;
-//                            }
-//                            conn->has_door = delta >= house_spec->door_size;
-//                            break;
-//                        }
-//                    }
-//                }
-
-                if (pb_graph_add_edge(g, floor->rooms + i, floor->rooms + j, 0.f, conn) == -1) {
-                    free(conn);
-                    goto err_return;
-                }
-            }
+    room_pair const* pair_items = (room_pair const*)pairs.items;
+    size_t p;
+    for (p = 0; p < pairs.size; ++p) {
+        if (add_room_conn(g, house_spec, floor, pair_items[p].room, pair_items[p].neighbour) == -1) {
+            goto err_return;
         }
     }
 
+    pb_vector_free(&pairs);
     return g;
 
 err_return:
     /* Free the graph and all the edge info we just created */
+    pb_vector_free(&pairs);
     pb_graph_for_each_edge(g, pb_graph_free_edge_data, NULL);
     pb_graph_free(g);
     return NULL;
@@ -379,7 +542,7 @@ static void add_internal_points(void const* vert_id, pb_vertex* vert, void* para
 }
 
 pb_graph* pb_sq_house_generate_internal_graph(pb_graph* floor_graph) {
-    pb_graph* internal = pb_graph_create(pb_point_hash, pb_point_eq);
+    pb_graph* internal = pb_graph_create_pooled(pb_point_hash, pb_point_eq);
     int error = 0;
     pb_pair params = {internal, &error};
 
@@ -444,9 +607,9 @@ static void get_next_pair(pb_hashmap_entry* entry, void* param) {
     }
 }
 
-static float euclid_squared(pb_vertex const* vert, pb_vertex const* goal) {
-    pb_point2D const* v_point = (pb_point2D*)vert->data;
-    pb_point2D const* g_point = (pb_point2D*)goal->data;
+static float euclid_squared(pb_graph_csr const* graph, size_t vert, size_t goal) {
+    pb_point2D const* v_point = (pb_point2D*)graph->vert_data[vert];
+    pb_point2D const* g_point = (pb_point2D*)graph->vert_data[goal];
 
     float x_diff = v_point->x - g_point->x;
     float y_diff = v_point->y - g_point->y;
@@ -462,9 +625,11 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
     pb_room* room;
     pb_hallway_room_selection_params params;
 
-    pb_vector* astar_points;
-    pb_vertex const* start;
-    pb_vertex const* goal;
+    pb_graph_csr* internal_csr;
+    pb_astar_ctx astar;
+    pb_vector astar_points;
+    size_t start;
+    size_t goal;
 
     unsigned i;
 
@@ -553,6 +718,28 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
         return NULL;
     }
 
+    /* Every hallway search shares one A* context and path so that they only allocate while they're still growing.
+     * The internal graph doesn't change while the hallways are found, so they search a frozen copy of it. */
+    internal_csr = pb_graph_freeze(internal_graph);
+    if (!internal_csr) {
+        pb_vector_free(&hallway_points);
+        pb_vector_free(hallways);
+        return NULL;
+    }
+    if (pb_astar_ctx_init(&astar) == -1) {
+        pb_graph_csr_free(internal_csr);
+        pb_vector_free(&hallway_points);
+        pb_vector_free(hallways);
+        return NULL;
+    }
+    if (pb_vector_init(&astar_points, sizeof(size_t), 0) == -1) {
+        pb_astar_ctx_free(&astar);
+        pb_graph_csr_free(internal_csr);
+        pb_vector_free(&hallway_points);
+        pb_vector_free(hallways);
+        return NULL;
+    }
+
     /* Get list of internal goal points, which in this case means points that aren't on a corner of the floor */
     for(i = 0; i < f->rooms->shape.points.size; ++i) {
         pb_point2D const* p = ((pb_point2D*)f->rooms->shape.points.items) + i;
@@ -604,9 +791,10 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
         /* Remove disconnected room from the list */
         pb_hashmap_remove(disconnected, params.start_room);
 
-        start = pb_graph_get_vertex(internal_graph, params.start);
-        goal = pb_graph_get_vertex(internal_graph, params.goal);
-        if (pb_astar(start, goal, euclid_squared, &astar_points) == -1) {
+        start = pb_graph_csr_get_index(internal_csr, params.start);
+        goal = pb_graph_csr_get_index(internal_csr, params.goal);
+        if (start == PB_GRAPH_CSR_NONE || goal == PB_GRAPH_CSR_NONE ||
+            pb_astar_csr_search(&astar, internal_csr, start, goal, euclid_squared, &astar_points) == -1) {
             /* Couldn't find a path - set min and max so that the next one has a chance at beating it */
             pb_vector_free(&hallway);
             params.dist = params.closest ? INFINITY : -INFINITY;
@@ -616,10 +804,10 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
         {
             /* TODO: Refactor this garbage to use mixed declarations and code */
             /* Remove any disconnected rooms that this hallway touches */
-            pb_vertex** verts = (pb_vertex**)astar_points->items;
-            for (i = 0; i < astar_points->size - 1; ++i) {
-                pb_point2D* p0 = (pb_point2D*)verts[i]->data;
-                pb_point2D* p1 = (pb_point2D*)verts[i + 1]->data;
+            size_t const* verts = (size_t const*)astar_points.items;
+            for (i = 0; i < astar_points.size - 1; ++i) {
+                pb_point2D* p0 = (pb_point2D*)internal_csr->vert_data[verts[i]];
+                pb_point2D* p1 = (pb_point2D*)internal_csr->vert_data[verts[i + 1]];
 
                 pb_edge const* edge = pb_graph_get_edge(internal_graph, p0, p1);
                 pb_hashmap_remove(disconnected, ((pb_sq_house_room_conn*)edge->data)->room);
@@ -638,20 +826,18 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
 
             /* Add the last point to the list of points and add the constructed hallway to the hallway list */
             if (pb_vector_push_back(hallways, &hallway) == -1 ||
-                pb_vector_push_back(&hallway_points, verts[astar_points->size - 1]->data) == -1) {
-                pb_vector_free(astar_points);
-                free(astar_points);
+                pb_vector_push_back(&hallway_points, internal_csr->vert_data[verts[astar_points.size - 1]]) == -1) {
                 pb_vector_free(&hallway);
                 goto err_return;
             }
-
-            pb_vector_free(astar_points);
-            free(astar_points);
         }
         params.closest = 1;
         params.dist = INFINITY;
     }
 
+    pb_astar_ctx_free(&astar);
+    pb_graph_csr_free(internal_csr);
+    pb_vector_free(&astar_points);
     pb_vector_free(&hallway_points);
     return hallways;
 
@@ -661,6 +847,9 @@ pb_vector* pb_sq_house_get_hallways(pb_floor* f, pb_graph* floor_graph, pb_graph
         for(i = 0; i < hallways->size; ++i) {
             pb_vector_free(hallway_items + i);
         }
+        pb_astar_ctx_free(&astar);
+        pb_graph_csr_free(internal_csr);
+        pb_vector_free(&astar_points);
         pb_vector_free(&hallway_points);
         pb_vector_free(hallways);
         free(hallways);
@@ -1349,40 +1538,24 @@ static int intrude_hallway(pb_rect const* room_rect, pb_rect const* hallway_rect
     }
 }
 
-static void vert_remove_edges(void const* key, pb_vertex* vert, void* param) {
-    pb_graph* g = (pb_graph*)param;
-    size_t i;
-    while(vert->edges_size) {
-        void* other_key = vert->edges[0]->to->data;
-        pb_graph_remove_edge(g, key, other_key);
-    }
-}
-
 /**
  * Reconstructs the floor graph after adding hallways.
  *
  * @param floor_graph The floor graph to reconstruct.
  * @param floor       The floor for which to construct a new graph.
+ * @param arena       The arena from which the floor's walls were allocated, or NULL if they came from malloc.
  *
  * @return 0 on success, -1 on failure.
  */
 static int reconstruct_floor_graph(pb_graph* floor_graph, pb_floor const* f, size_t num_hallways,
-                                   pb_sq_house_house_spec const* h, pb_hashmap* room_specs) {
+                                   pb_sq_house_house_spec const* h, pb_hashmap* room_specs, pb_arena* arena) {
     size_t i, j;
 
     /* Won't be needing this anymore */
     pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-    pb_graph_for_each_vertex(floor_graph, vert_remove_edges, floor_graph);
-    
-    /* Remove and re-add all vertices since the floor's rooms array may have been assigned a new pointer */
-    for (i = 0; i < floor_graph->vertices->cap; ++i) {
-        if (floor_graph->vertices->states[i] == FULL) {
-            pb_vertex_free(floor_graph->vertices->entries[i].val);
-        }
 
-        floor_graph->vertices->states[i] = EMPTY;
-    }
-    floor_graph->vertices->size = 0;
+    /* Remove and re-add all vertices since the floor's rooms array may have been assigned a new pointer */
+    pb_graph_clear(floor_graph);
     for (i = 0; i < f->num_rooms; ++i) {
         if (pb_graph_add_vertex(floor_graph, f->rooms + i, f->rooms + i) == -1) {
             return -1;
@@ -1778,7 +1951,7 @@ static int reconstruct_floor_graph(pb_graph* floor_graph, pb_floor const* f, siz
 
         /* Finally, realloc the walls array to the new size and set all walls to 1 */
         if (f->rooms[i].walls.cap < f->rooms[i].shape.points.size) {
-            if (pb_vector_resize(&f->rooms[i].walls, f->rooms[i].shape.points.size) == -1) {
+            if (pb_sq_house_resize_walls(arena, &f->rooms[i].walls, f->rooms[i].shape.points.size) == -1) {
                 return -1;
             }
 
@@ -2026,7 +2199,7 @@ typedef struct {
  * []   "Cleverness" in parts basically just made it an unreadable mess
  * []   There are magic numbers everywhere */
 int pb_sq_house_place_hallways(pb_floor* f, pb_sq_house_house_spec* hspec, pb_hashmap* room_specs,
-                               pb_graph* floor_graph, pb_graph* internal_graph, pb_vector* hallways) {
+                               pb_graph* floor_graph, pb_graph* internal_graph, pb_vector* hallways, pb_arena* arena) {
     pb_vector* hallway_list = (pb_vector*)hallways->items;
     
     /* Find smallest dimension so that we can set the hallway dimensions */
@@ -2057,7 +2230,7 @@ int pb_sq_house_place_hallways(pb_floor* f, pb_sq_house_house_spec* hspec, pb_ha
     }
     hallway_size = fminf(hallway_size * 0.25f, hspec->hallway_width);
 
-    pb_graph* pruned = pb_graph_create(internal_graph->vertices->hash, internal_graph->vertices->key_eq);
+    pb_graph* pruned = pb_graph_create_pooled(internal_graph->vertices->hash, internal_graph->vertices->key_eq);
     if (pruned == NULL) {
         return -1;
     }
@@ -2247,7 +2420,8 @@ int pb_sq_house_place_hallways(pb_floor* f, pb_sq_house_house_spec* hspec, pb_ha
     size_t old_num_rooms = f->num_rooms;
     size_t new_num_rooms = f->num_rooms + num_4way + hallway_segments.size;
 
-    pb_room* new_rooms_list = realloc(f->rooms, sizeof(pb_room) * new_num_rooms);
+    pb_room* new_rooms_list = pb_sq_house_plan_realloc(arena, f->rooms, sizeof(pb_room) * old_num_rooms,
+                                                       sizeof(pb_room) * new_num_rooms);
     if (!new_rooms_list) {
         goto err_return;
     }
@@ -2467,7 +2641,7 @@ int pb_sq_house_place_hallways(pb_floor* f, pb_sq_house_house_spec* hspec, pb_ha
                 if (pb_rect_to_pb_shape2D(&room_rect, &next->shape) == -1) {
                     err = 1;
                     break;
-                } else if (pb_vector_init(&next->walls, sizeof(int), num_walls) == -1) {
+                } else if (pb_sq_house_init_walls(arena, &next->walls, num_walls) == -1) {
                     pb_shape2D_free(&next->shape);
                     err = 1;
                     break;
@@ -2582,7 +2756,7 @@ int pb_sq_house_place_hallways(pb_floor* f, pb_sq_house_house_spec* hspec, pb_ha
         }
     }
 
-    if (reconstruct_floor_graph(floor_graph, f, new_num_rooms - old_num_rooms, hspec, room_specs) == -1) {
+    if (reconstruct_floor_graph(floor_graph, f, new_num_rooms - old_num_rooms, hspec, room_specs, arena) == -1) {
         /* :( */
         goto err_return;
     }
@@ -2620,13 +2794,19 @@ err_return:
     return -1;
 }
 
+typedef struct {
+    pb_sq_house_house_spec* hspec;
+    pb_arena* arena; /* The arena from which to allocate doors, or NULL to use malloc */
+    int err;
+} pb_door_placement_params;
+
 static void add_vertex_doors(void const* vert_id, pb_vertex* vert, void* params) {
     pb_room* room = (pb_room*)vert->data;
     size_t i;
     size_t num_doors = 0;
-    pb_pair* params_pair = (pb_pair*)params;
-    int* err = (int*)params_pair->first;
-    pb_sq_house_house_spec* hspec = (pb_sq_house_house_spec*)params_pair->second;
+    pb_door_placement_params* door_params = (pb_door_placement_params*)params;
+    int* err = &door_params->err;
+    pb_sq_house_house_spec* hspec = door_params->hspec;
 
 
     for (i = 0; i < vert->edges_size; ++i) {
@@ -2637,7 +2817,7 @@ static void add_vertex_doors(void const* vert_id, pb_vertex* vert, void* params)
     /* Technically this should always be true, but it sometimes won't be in the current implementation.
      * If it's not, just mark the room as having no doors and don't bother setting its pointer. */
     if (num_doors) {
-        pb_wall_structure* doors = malloc(sizeof(pb_wall_structure) * num_doors);
+        pb_wall_structure* doors = pb_sq_house_plan_alloc(door_params->arena, sizeof(pb_wall_structure) * num_doors);
         if (!doors) {
             *err = 1;
             return;
@@ -2679,9 +2859,9 @@ static void add_vertex_doors(void const* vert_id, pb_vertex* vert, void* params)
     }
 }
 
-int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph* floor_graph, int is_first_floor) {
-    int err = 0;
-    pb_pair params = {&err, hspec};
+int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph* floor_graph, int is_first_floor,
+                            pb_arena* arena) {
+    pb_door_placement_params params = {hspec, arena, 0};
 
     /* Just in case we have to clean them up later */
     /* TODO: Initialise everything in one place so that cleanup becomes easier */
@@ -2698,14 +2878,16 @@ int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph
 
     /* Add a door to the bottom wall in the first room on the first floor so that we can get outside */
     if (is_first_floor) {
-        pb_wall_structure* floor_doors = malloc(sizeof(pb_wall_structure));
+        pb_wall_structure* floor_doors = pb_sq_house_plan_alloc(arena, sizeof(pb_wall_structure));
         if (!floor_doors) {
             f->doors = NULL;
             f->num_doors = 0;
             return -1;
         }
 
-        pb_wall_structure* room0_doors = realloc(f->rooms[0].doors, sizeof(pb_wall_structure) * (f->rooms[0].num_doors + 1));
+        pb_wall_structure* room0_doors = pb_sq_house_plan_realloc(arena, f->rooms[0].doors,
+                                                                  sizeof(pb_wall_structure) * f->rooms[0].num_doors,
+                                                                  sizeof(pb_wall_structure) * (f->rooms[0].num_doors + 1));
         if (!room0_doors) {
             return -1;
         }
@@ -2742,10 +2924,10 @@ int pb_sq_house_place_doors(pb_floor* f, pb_sq_house_house_spec* hspec, pb_graph
         f->doors = NULL;
     }
 
-    return err ? -1 : 0;
+    return params.err ? -1 : 0;
 }
 
-int pb_sq_house_place_windows(pb_floor* f, pb_sq_house_house_spec* hspec, int is_first_floor) {
+int pb_sq_house_place_windows(pb_floor* f, pb_sq_house_house_spec* hspec, int is_first_floor, pb_arena* arena) {
     pb_rect floor_rect;
     pb_point2D top_right;
     pb_point2D bottom_left;
@@ -2797,15 +2979,17 @@ int pb_sq_house_place_windows(pb_floor* f, pb_sq_house_house_spec* hspec, int is
         }
 
         if (num_windows) {
-            pb_wall_structure *windows = malloc(sizeof(pb_wall_structure) * num_windows);
+            pb_wall_structure *windows = pb_sq_house_plan_alloc(arena, sizeof(pb_wall_structure) * num_windows);
             if (!windows) {
                 return -1;
             }
 
-            pb_wall_structure *floor_windows = realloc(f->windows,
-                                                       sizeof(pb_wall_structure) * (f->num_windows + num_windows));
+            pb_wall_structure *floor_windows = pb_sq_house_plan_realloc(arena, f->windows,
+                                                                        sizeof(pb_wall_structure) * f->num_windows,
+                                                                        sizeof(pb_wall_structure) *
+                                                                        (f->num_windows + num_windows));
             if (!floor_windows) {
-                free(windows);
+                pb_sq_house_plan_free(arena, windows);
                 return -1;
             }
             f->windows = floor_windows;
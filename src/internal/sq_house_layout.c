@@ -8,10 +8,51 @@
 #include <pb/internal/sq_house_layout.h>
 #include <pb/util/geom/rect_utils.h>
 
-static void shuffle_arr(char const** arr, size_t size) {
+void* pb_sq_house_plan_alloc(pb_arena* arena, size_t size) {
+    return arena ? pb_arena_alloc(arena, size) : malloc(size);
+}
+
+void* pb_sq_house_plan_realloc(pb_arena* arena, void* ptr, size_t old_size, size_t size) {
+    return arena ? pb_arena_realloc(arena, ptr, old_size, size) : realloc(ptr, size);
+}
+
+void pb_sq_house_plan_free(pb_arena* arena, void* ptr) {
+    if (!arena) {
+        free(ptr);
+    }
+}
+
+int pb_sq_house_init_walls(pb_arena* arena, pb_vector* walls, size_t cap) {
+    walls->items = pb_sq_house_plan_alloc(arena, sizeof(int) * cap);
+    if (!walls->items) {
+        return -1;
+    }
+
+    walls->item_size = sizeof(int);
+    walls->size = 0;
+    walls->cap = cap;
+    return 0;
+}
+
+int pb_sq_house_resize_walls(pb_arena* arena, pb_vector* walls, size_t cap) {
+    void* items = pb_sq_house_plan_realloc(arena, walls->items, walls->item_size * walls->cap, walls->item_size * cap);
+    if (!items) {
+        return -1;
+    }
+
+    walls->items = items;
+    walls->cap = cap;
+    return 0;
+}
+
+void pb_sq_house_free_walls(pb_arena* arena, pb_vector* walls) {
+    pb_sq_house_plan_free(arena, walls->items);
+}
+
+static void shuffle_arr(char const** arr, size_t size, pb_rng* rng) {
     size_t i;
     for (i = size - 1; i > 0; --i) {
-        int num = rand() % (i + 1);
+        size_t num = pb_rng_range(rng, (uint32_t)(i + 1));
         char* tmp = arr[i];
         arr[i] = arr[num];
         arr[num] = tmp;
@@ -25,10 +66,21 @@ int pb_sq_house_room_spec_cmp(void const* room_spec1, void const* room_spec2) {
     return spec1->priority - spec2->priority;
 }
 
-char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec* house_spec) {
+typedef struct {
+    pb_sq_house_room_spec* specs;
+    size_t num_specs;
+} room_spec_copy_params;
+
+static void copy_room_spec(pb_hashmap_entry* entry, void* param) {
+    room_spec_copy_params* params = (room_spec_copy_params*)param;
+    memcpy(params->specs + params->num_specs, entry->val, sizeof(pb_sq_house_room_spec));
+    ++params->num_specs;
+}
+
+char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec* house_spec, pb_rng* rng) {
     pb_sq_house_room_spec* sorted = malloc(room_specs->size * sizeof(pb_sq_house_room_spec));
     size_t i;
-    size_t sorted_pos = 0;
+    room_spec_copy_params copy_params;
 
     pb_hashmap* instances = pb_hashmap_create(pb_str_hash, pb_str_eq);
     size_t num_added = 0;
@@ -38,12 +90,9 @@ char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec*
     char** result = malloc(sizeof(char*) * house_spec->num_rooms);
 
     /* Create a sorted copy of the hash map to select by priority */
-    for (i = 0; i < room_specs->cap; ++i) {
-        if (room_specs->states[i] == FULL) {
-            memcpy(sorted + sorted_pos, room_specs->entries[i].val, sizeof(pb_sq_house_room_spec));
-            ++sorted_pos;
-        }
-    }
+    copy_params.specs = sorted;
+    copy_params.num_specs = 0;
+    pb_hashmap_for_each(room_specs, copy_room_spec, &copy_params);
     qsort(sorted, room_specs->size, sizeof(pb_sq_house_room_spec), pb_sq_house_room_spec_cmp);
 
     /* Initialise the room names -> number of instances map */
@@ -69,7 +118,7 @@ char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec*
 
                 /* Choose a number between 1 and (max instances - already placed) to add to the house */
                 size_t remaining = spec->max_instances - (size_t)num_placed;
-                size_t added = rand() % remaining + 1;
+                size_t added = pb_rng_range(rng, (uint32_t)remaining) + 1;
                 if (added + num_added > house_spec->num_rooms) {
                     added = house_spec->num_rooms - num_added;
                 }
@@ -97,7 +146,7 @@ char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec*
         return NULL;
     } else {
         unsigned int outside_idx;
-        shuffle_arr(result, house_spec->num_rooms);
+        shuffle_arr(result, house_spec->num_rooms, rng);
         has_outside = 0;
 
         for (i = 0; i < house_spec->num_rooms && !has_outside; ++i) {
@@ -117,7 +166,7 @@ char** pb_sq_house_choose_rooms(pb_hashmap* room_specs, pb_sq_house_house_spec*
         /* No rooms that connect to outside were selected; we need to randomly replace one with a room that CAN connect to outside */
         if (!has_outside) {
             int outside_room = -1;
-            outside_idx = rand() % (house_spec->num_rooms + 1);
+            outside_idx = pb_rng_range(rng, house_spec->num_rooms);
 
             for (i = 0; i < room_specs->size && outside_room == -1; ++i) {
                 unsigned int j;
@@ -157,14 +206,15 @@ static void adjust_rect(pb_rect* rect, pb_point2D* bleft_adjust, float w_adjust,
 }
 
 static int add_stairs(pb_floor* f, unsigned int num_added, pb_shape2D* stair_shape, unsigned int stair_index,
-                      int has_ceiling, int has_floor) {
+                      int has_ceiling, int has_floor, pb_arena* arena) {
     pb_room* new_rooms = NULL;
     
-    new_rooms = realloc(f->rooms, sizeof(pb_room) * (f->num_rooms + num_added));
+    new_rooms = pb_sq_house_plan_realloc(arena, f->rooms, sizeof(pb_room) * f->num_rooms,
+                                         sizeof(pb_room) * (f->num_rooms + num_added));
     if (!new_rooms) {
         return -1;
-    } else if (pb_vector_init(&new_rooms[stair_index].walls, sizeof(int), 4) == -1) {
-        free(new_rooms);
+    } else if (pb_sq_house_init_walls(arena, &new_rooms[stair_index].walls, 4) == -1) {
+        pb_sq_house_plan_free(arena, new_rooms);
         return -1;
     }
 
@@ -188,7 +238,8 @@ static int add_stairs(pb_floor* f, unsigned int num_added, pb_shape2D* stair_sha
     return 0;
 }
 
-pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, pb_sq_house_house_spec* h_spec, pb_building* house) {
+pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, pb_sq_house_house_spec* h_spec, pb_building* house,
+                                  pb_rng* rng, pb_arena* arena) {
     /* Stores sums of room areas added to the current floor */
     float* areas = NULL;
     
@@ -210,7 +261,7 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
         return NULL;
     }
 
-    house->floors = malloc(sizeof(pb_floor));
+    house->floors = pb_sq_house_plan_alloc(arena, sizeof(pb_floor));
     if (!house->floors) {
         free(areas);
         return NULL;
@@ -258,7 +309,9 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
         if (current_room + num_rooms_added == h_spec->num_rooms) {
             /* house->floors[current_floor].num_rooms is the number of stairs */
             size_t total_rooms_on_floor = house->floors[current_floor].num_rooms + current_room;
-            pb_room* new_rooms = realloc(house->floors[current_floor].rooms, sizeof(pb_room) * total_rooms_on_floor);
+            pb_room* new_rooms = pb_sq_house_plan_realloc(arena, house->floors[current_floor].rooms,
+                                                          sizeof(pb_room) * house->floors[current_floor].num_rooms,
+                                                          sizeof(pb_room) * total_rooms_on_floor);
             
             if (!new_rooms)
                 goto err_return;
@@ -294,7 +347,8 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
             next_stair_rect.bottom_left = next_floor_rect.bottom_left;
 
             /* Reallocate the floors array to hold another floor*/
-            new_floors = realloc(house->floors, sizeof(pb_floor) * (house->num_floors + 1));
+            new_floors = pb_sq_house_plan_realloc(arena, house->floors, sizeof(pb_floor) * house->num_floors,
+                                                  sizeof(pb_floor) * (house->num_floors + 1));
             if (!new_floors) {
                 goto err_return;
             }
@@ -304,7 +358,7 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
             /* Don't have two stairs right beside each other */
             side new_stair_loc;
             do {
-                new_stair_loc = (side)(rand() % 4);
+                new_stair_loc = (side)pb_rng_range(rng, 4);
             } while (new_stair_loc == last_stair_loc ||
                     (current_floor == 0 && (new_stair_loc == SQ_HOUSE_LEFT || new_stair_loc == SQ_HOUSE_BOTTOM)));
 
@@ -391,8 +445,9 @@ pb_rect* pb_sq_house_layout_stairs(char const** rooms, pb_hashmap* room_specs, p
 
             house->floors[current_floor + 1].num_rooms = 0;
 
-            if (add_stairs(house->floors + current_floor, current_room + 1, &current_stair_shape, stair_index, 0, 1) == -1 ||
-                add_stairs(house->floors + current_floor + 1, 1, &next_stair_shape, 0, 1, 0) == -1) {
+            if (add_stairs(house->floors + current_floor, current_room + 1, &current_stair_shape, stair_index, 0, 1,
+                           arena) == -1 ||
+                add_stairs(house->floors + current_floor + 1, 1, &next_stair_shape, 0, 1, 0, arena) == -1) {
                 goto err_return;
             }
 
@@ -417,9 +472,9 @@ err_return:
         unsigned int i;
         for (i = 0; house->floors[house->num_floors - 1].rooms && house->floors[house->num_floors - 1].rooms[i].shape.points.items; ++i) {
             pb_shape2D_free(&house->floors[house->num_floors - 1].rooms[i].shape);
-            pb_vector_free(&house->floors[house->num_floors - 1].rooms[i].walls);
+            pb_sq_house_free_walls(arena, &house->floors[house->num_floors - 1].rooms[i].walls);
         }
-        free(house->floors[house->num_floors - 1].rooms);
+        pb_sq_house_plan_free(arena, house->floors[house->num_floors - 1].rooms);
         pb_shape2D_free(&house->floors[house->num_floors - 1].shape);
         house->num_floors--;
     }
@@ -427,7 +482,7 @@ err_return:
 }
 
 int pb_sq_house_layout_floor(char const** rooms, pb_hashmap* room_specs, pb_floor* floor, size_t num_rooms,
-                             pb_rect* floor_rect, int should_swap_room0) {
+                             pb_rect* floor_rect, int should_swap_room0, pb_arena* arena) {
     float* areas = NULL;
     float total_area = 0.f;
 
@@ -488,7 +543,7 @@ int pb_sq_house_layout_floor(char const** rooms, pb_hashmap* room_specs, pb_floo
         floor->rooms[i].walls.items = NULL;
 
         if (pb_rect_to_pb_shape2D(&(rects[i - num_stairs]), &(floor->rooms[i].shape)) == -1 ||
-            pb_vector_init(&floor->rooms[i].walls, sizeof(int), 4) == -1) {
+            pb_sq_house_init_walls(arena, &floor->rooms[i].walls, 4) == -1) {
             goto err_return;
         }
 
@@ -525,7 +580,7 @@ err_return:
             break;
         } else {
             pb_shape2D_free(&floor->rooms[i].shape);
-            pb_vector_free(&floor->rooms[i].walls);
+            pb_sq_house_free_walls(arena, &floor->rooms[i].walls);
         }
     }
 
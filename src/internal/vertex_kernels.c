@@ -0,0 +1,429 @@
+#include <pb/internal/vertex_kernels.h>
+#include <pb/util/geom/shape_utils.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PB_VERTEX_KERNELS_AVX
+#define PB_VERTEX_KERNELS_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PB_VERTEX_KERNELS_SSE2
+#endif
+
+static void set_vert(pb_vert3D* v, float x, float y, float z, float nx, float ny, float nz, float u, float tex_v) {
+    v->x = x;
+    v->y = y;
+    v->z = z;
+    v->nx = nx;
+    v->ny = ny;
+    v->nz = nz;
+    v->u = u;
+    v->v = tex_v;
+}
+
+void pb_fill_quad_verts_scalar(pb_quad_verts const* q, pb_vert3D* out) {
+    set_vert(out + 0, q->start_x, q->bottom, q->start_z, q->nx, 0.f, q->nz, q->start_u, q->bottom_v);
+    set_vert(out + 1, q->end_x, q->top, q->end_z, q->nx, 0.f, q->nz, q->end_u, q->top_v);
+    set_vert(out + 2, q->start_x, q->top, q->start_z, q->nx, 0.f, q->nz, q->start_u, q->top_v);
+    out[3] = out[0];
+    set_vert(out + 4, q->end_x, q->bottom, q->end_z, q->nx, 0.f, q->nz, q->end_u, q->bottom_v);
+    out[5] = out[1];
+}
+
+void pb_fill_quad_verts(pb_quad_verts const* q, pb_vert3D* out) {
+#if defined(PB_VERTEX_KERNELS_AVX)
+    /* A pb_vert3D is exactly eight floats, so each corner is one register */
+    __m256 start_bottom = _mm256_setr_ps(q->start_x, q->bottom, q->start_z, q->nx, 0.f, q->nz, q->start_u, q->bottom_v);
+    __m256 end_top = _mm256_setr_ps(q->end_x, q->top, q->end_z, q->nx, 0.f, q->nz, q->end_u, q->top_v);
+    __m256 start_top = _mm256_setr_ps(q->start_x, q->top, q->start_z, q->nx, 0.f, q->nz, q->start_u, q->top_v);
+    __m256 end_bottom = _mm256_setr_ps(q->end_x, q->bottom, q->end_z, q->nx, 0.f, q->nz, q->end_u, q->bottom_v);
+    float* dest = &out->x;
+
+    _mm256_storeu_ps(dest + 0, start_bottom);
+    _mm256_storeu_ps(dest + 8, end_top);
+    _mm256_storeu_ps(dest + 16, start_top);
+    _mm256_storeu_ps(dest + 24, start_bottom);
+    _mm256_storeu_ps(dest + 32, end_bottom);
+    _mm256_storeu_ps(dest + 40, end_top);
+#elif defined(PB_VERTEX_KERNELS_SSE2)
+    /* Each corner is two registers: (x, y, z, nx) and (ny, nz, u, v) */
+    __m128 start_bottom = _mm_setr_ps(q->start_x, q->bottom, q->start_z, q->nx);
+    __m128 start_top = _mm_setr_ps(q->start_x, q->top, q->start_z, q->nx);
+    __m128 end_bottom = _mm_setr_ps(q->end_x, q->bottom, q->end_z, q->nx);
+    __m128 end_top = _mm_setr_ps(q->end_x, q->top, q->end_z, q->nx);
+    __m128 start_bottom_uv = _mm_setr_ps(0.f, q->nz, q->start_u, q->bottom_v);
+    __m128 start_top_uv = _mm_setr_ps(0.f, q->nz, q->start_u, q->top_v);
+    __m128 end_bottom_uv = _mm_setr_ps(0.f, q->nz, q->end_u, q->bottom_v);
+    __m128 end_top_uv = _mm_setr_ps(0.f, q->nz, q->end_u, q->top_v);
+    float* dest = &out->x;
+
+    _mm_storeu_ps(dest + 0, start_bottom);
+    _mm_storeu_ps(dest + 4, start_bottom_uv);
+    _mm_storeu_ps(dest + 8, end_top);
+    _mm_storeu_ps(dest + 12, end_top_uv);
+    _mm_storeu_ps(dest + 16, start_top);
+    _mm_storeu_ps(dest + 20, start_top_uv);
+    _mm_storeu_ps(dest + 24, start_bottom);
+    _mm_storeu_ps(dest + 28, start_bottom_uv);
+    _mm_storeu_ps(dest + 32, end_bottom);
+    _mm_storeu_ps(dest + 36, end_bottom_uv);
+    _mm_storeu_ps(dest + 40, end_top);
+    _mm_storeu_ps(dest + 44, end_top_uv);
+#else
+    pb_fill_quad_verts_scalar(q, out);
+#endif
+}
+
+static pb_point2D const* get_surface_point(pb_point2D const* points, size_t const* indices, size_t num_verts,
+                                           int reverse, size_t i) {
+    return points + (reverse ? indices[num_verts - 1 - i] : indices[i]);
+}
+
+/**
+ * Fills in vertices [first, num_verts) one at a time. This is the whole of the scalar kernel, and finishes off
+ * whatever the vectorised loops leave over.
+ */
+static void fill_surface_verts_from(pb_point2D const* points, size_t const* indices, size_t first, size_t num_verts,
+                                    int reverse, pb_point2D const* centre, pb_point2D const* uv_start,
+                                    pb_point2D const* uv_size, float ny, pb_vert3D* out) {
+    size_t i;
+    for (i = first; i < num_verts; ++i) {
+        pb_point2D const* p = get_surface_point(points, indices, num_verts, reverse, i);
+        set_vert(out + i, p->x - centre->x, 0.f, centre->y - p->y, 0.f, ny, 0.f,
+                 (p->x - uv_start->x) / uv_size->x, (p->y - uv_start->y) / uv_size->y);
+    }
+}
+
+void pb_fill_surface_verts_scalar(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                                  pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                                  float ny, pb_vert3D* out) {
+    fill_surface_verts_from(points, indices, 0, num_verts, reverse, centre, uv_start, uv_size, ny, out);
+}
+
+#if defined(PB_VERTEX_KERNELS_SSE2)
+/* Loads two points into one register as (x0, y0, x1, y1). */
+static __m128 load_point_pair(pb_point2D const* p0, pb_point2D const* p1) {
+    return _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (__m64 const*)p0), (__m64 const*)p1);
+}
+#endif
+
+void pb_fill_surface_verts(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                           pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                           float ny, pb_vert3D* out) {
+    size_t i = 0;
+
+#if defined(PB_VERTEX_KERNELS_SSE2)
+    /*
+     * Two points at a time, (x0, y0, x1, y1). The differences from the centre give x and z, which are computed exactly
+     * as the scalar kernel does (rather than negating one of them) so that the signs of zeroes match too. y and nx are
+     * masked to +0.
+     */
+    __m128 centre4 = _mm_setr_ps(centre->x, centre->y, centre->x, centre->y);
+    __m128 start4 = _mm_setr_ps(uv_start->x, uv_start->y, uv_start->x, uv_start->y);
+    __m128 size4 = _mm_setr_ps(uv_size->x, uv_size->y, uv_size->x, uv_size->y);
+    __m128 normal4 = _mm_setr_ps(ny, 0.f, 0.f, 0.f);
+    __m128 pos_mask4 = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, 0));
+    float* dest = &out->x;
+
+#if defined(PB_VERTEX_KERNELS_AVX)
+    /* Four points at a time, two per lane. Each lane produces the halves of two vertices, which are then paired up. */
+    __m256 centre8 = _mm256_insertf128_ps(_mm256_castps128_ps256(centre4), centre4, 1);
+    __m256 start8 = _mm256_insertf128_ps(_mm256_castps128_ps256(start4), start4, 1);
+    __m256 size8 = _mm256_insertf128_ps(_mm256_castps128_ps256(size4), size4, 1);
+    __m256 normal8 = _mm256_insertf128_ps(_mm256_castps128_ps256(normal4), normal4, 1);
+    __m256 pos_mask8 = _mm256_insertf128_ps(_mm256_castps128_ps256(pos_mask4), pos_mask4, 1);
+
+    for (; i + 4 <= num_verts; i += 4) {
+        __m128 p01 = load_point_pair(get_surface_point(points, indices, num_verts, reverse, i),
+                                     get_surface_point(points, indices, num_verts, reverse, i + 1));
+        __m128 p23 = load_point_pair(get_surface_point(points, indices, num_verts, reverse, i + 2),
+                                     get_surface_point(points, indices, num_verts, reverse, i + 3));
+        __m256 p = _mm256_insertf128_ps(_mm256_castps128_ps256(p01), p23, 1);
+
+        __m256 from_centre = _mm256_sub_ps(p, centre8);
+        __m256 to_centre = _mm256_sub_ps(centre8, p);
+        __m256 uv = _mm256_div_ps(_mm256_sub_ps(p, start8), size8);
+
+        /* (x, y, z, nx) and (ny, nz, u, v) for vertices 0 and 2, then 1 and 3 */
+        __m256 pos02 = _mm256_and_ps(_mm256_shuffle_ps(from_centre, to_centre, _MM_SHUFFLE(1, 1, 0, 0)), pos_mask8);
+        __m256 pos13 = _mm256_and_ps(_mm256_shuffle_ps(from_centre, to_centre, _MM_SHUFFLE(3, 3, 2, 2)), pos_mask8);
+        __m256 rest02 = _mm256_shuffle_ps(normal8, uv, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 rest13 = _mm256_shuffle_ps(normal8, uv, _MM_SHUFFLE(3, 2, 1, 0));
+
+        _mm256_storeu_ps(dest + i * 8, _mm256_permute2f128_ps(pos02, rest02, 0x20));
+        _mm256_storeu_ps(dest + i * 8 + 8, _mm256_permute2f128_ps(pos13, rest13, 0x20));
+        _mm256_storeu_ps(dest + i * 8 + 16, _mm256_permute2f128_ps(pos02, rest02, 0x31));
+        _mm256_storeu_ps(dest + i * 8 + 24, _mm256_permute2f128_ps(pos13, rest13, 0x31));
+    }
+#endif
+
+    for (; i + 2 <= num_verts; i += 2) {
+        __m128 p = load_point_pair(get_surface_point(points, indices, num_verts, reverse, i),
+                                   get_surface_point(points, indices, num_verts, reverse, i + 1));
+
+        __m128 from_centre = _mm_sub_ps(p, centre4);
+        __m128 to_centre = _mm_sub_ps(centre4, p);
+        __m128 uv = _mm_div_ps(_mm_sub_ps(p, start4), size4);
+
+        _mm_storeu_ps(dest + i * 8, _mm_and_ps(_mm_shuffle_ps(from_centre, to_centre, _MM_SHUFFLE(1, 1, 0, 0)),
+                                               pos_mask4));
+        _mm_storeu_ps(dest + i * 8 + 4, _mm_movelh_ps(normal4, uv));
+        _mm_storeu_ps(dest + i * 8 + 8, _mm_and_ps(_mm_shuffle_ps(from_centre, to_centre, _MM_SHUFFLE(3, 3, 2, 2)),
+                                                   pos_mask4));
+        _mm_storeu_ps(dest + i * 8 + 12, _mm_shuffle_ps(normal4, uv, _MM_SHUFFLE(3, 2, 1, 0)));
+    }
+#endif
+
+    fill_surface_verts_from(points, indices, i, num_verts, reverse, centre, uv_start, uv_size, ny, out);
+}
+
+/* Converts a float to half precision, rounding to nearest. */
+static uint16_t float_to_half(float f) {
+    uint32_t bits;
+    uint32_t sign;
+    uint32_t mantissa;
+    int exponent;
+
+    memcpy(&bits, &f, sizeof(float));
+    sign = (bits >> 16) & 0x8000;
+    exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        /* Infinity or NaN */
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    } else if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    } else if (exponent <= 0) {
+        /* Subnormal in half precision */
+        uint32_t shift;
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        shift = (uint32_t)(14 - exponent);
+        return (uint16_t)(sign | ((mantissa + (1u << (shift - 1))) >> shift));
+    }
+
+    /* A carry out of the mantissa correctly bumps the exponent */
+    return (uint16_t)((sign | ((uint32_t)exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+static float clamp_snorm(float f) {
+    return f > 1.f ? 1.f : (f < -1.f ? -1.f : f);
+}
+
+static void store_float32(unsigned char* dst, float const* components, size_t num_components) {
+    memcpy(dst, components, sizeof(float) * num_components);
+}
+
+static void store_float16(unsigned char* dst, float const* components, size_t num_components) {
+    size_t i;
+    for (i = 0; i < num_components; ++i) {
+        uint16_t h = float_to_half(components[i]);
+        memcpy(dst + i * sizeof(uint16_t), &h, sizeof(uint16_t));
+    }
+}
+
+static void store_snorm16(unsigned char* dst, float const* components, size_t num_components) {
+    size_t i;
+    for (i = 0; i < num_components; ++i) {
+        int16_t s = (int16_t)floorf(clamp_snorm(components[i]) * 32767.f + 0.5f);
+        memcpy(dst + i * sizeof(int16_t), &s, sizeof(int16_t));
+    }
+}
+
+static void store_snorm8(unsigned char* dst, float const* components, size_t num_components) {
+    size_t i;
+    for (i = 0; i < num_components; ++i) {
+        int8_t s = (int8_t)floorf(clamp_snorm(components[i]) * 127.f + 0.5f);
+        memcpy(dst + i, &s, sizeof(int8_t));
+    }
+}
+
+/**
+ * One attribute of the vertices being written. The format is picked once per call rather than once per component.
+ */
+typedef struct {
+    unsigned char* dst; /* Where the first vertex's attribute goes */
+    size_t stride;
+    void (*store)(unsigned char* dst, float const* components, size_t num_components);
+} attribute_writer;
+
+/**
+ * Gets ready to write an attribute from the given vertex onwards.
+ *
+ * @return 1 if the attribute is to be written, 0 if the layout skips it.
+ */
+static int init_attribute_writer(attribute_writer* w, pb_vertex_attribute const* attrib, size_t first) {
+    if (!attrib->data) {
+        return 0;
+    }
+
+    w->dst = (unsigned char*)attrib->data + attrib->offset + first * attrib->stride;
+    w->stride = attrib->stride;
+    switch (attrib->type) {
+        case PB_VERTEX_FLOAT16:
+            w->store = store_float16;
+            break;
+        case PB_VERTEX_SNORM16:
+            w->store = store_snorm16;
+            break;
+        case PB_VERTEX_SNORM8:
+            w->store = store_snorm8;
+            break;
+        default:
+            w->store = store_float32;
+            break;
+    }
+    return 1;
+}
+
+/* The corner of the quad that each of its vertices comes from: start bottom, end top, start top and end bottom. */
+static int const quad_corners[6] = {0, 1, 2, 0, 3, 1};
+
+void pb_write_quad_verts(pb_quad_verts const* q, pb_vertex_layout const* layout, size_t first) {
+    attribute_writer w;
+    size_t i;
+
+    if (init_attribute_writer(&w, &layout->position, first)) {
+        float const corners[4][3] = {{q->start_x, q->bottom, q->start_z}, {q->end_x, q->top, q->end_z},
+                                     {q->start_x, q->top, q->start_z}, {q->end_x, q->bottom, q->end_z}};
+        for (i = 0; i < 6; ++i) {
+            w.store(w.dst + i * w.stride, corners[quad_corners[i]], 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->normal, first)) {
+        float const normal[3] = {q->nx, 0.f, q->nz};
+        for (i = 0; i < 6; ++i) {
+            w.store(w.dst + i * w.stride, normal, 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->uv, first)) {
+        float const corners[4][2] = {{q->start_u, q->bottom_v}, {q->end_u, q->top_v},
+                                     {q->start_u, q->top_v}, {q->end_u, q->bottom_v}};
+        for (i = 0; i < 6; ++i) {
+            w.store(w.dst + i * w.stride, corners[quad_corners[i]], 2);
+        }
+    }
+}
+
+void pb_write_surface_verts(pb_point2D const* points, size_t const* indices, size_t num_verts, int reverse,
+                            pb_point2D const* centre, pb_point2D const* uv_start, pb_point2D const* uv_size,
+                            float ny, pb_vertex_layout const* layout, size_t first) {
+    attribute_writer w;
+    size_t i;
+
+    if (init_attribute_writer(&w, &layout->position, first)) {
+        for (i = 0; i < num_verts; ++i) {
+            pb_point2D const* p = get_surface_point(points, indices, num_verts, reverse, i);
+            float const pos[3] = {p->x - centre->x, 0.f, centre->y - p->y};
+            w.store(w.dst + i * w.stride, pos, 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->normal, first)) {
+        float const normal[3] = {0.f, ny, 0.f};
+        for (i = 0; i < num_verts; ++i) {
+            w.store(w.dst + i * w.stride, normal, 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->uv, first)) {
+        for (i = 0; i < num_verts; ++i) {
+            pb_point2D const* p = get_surface_point(points, indices, num_verts, reverse, i);
+            float const uv[2] = {(p->x - uv_start->x) / uv_size->x, (p->y - uv_start->y) / uv_size->y};
+            w.store(w.dst + i * w.stride, uv, 2);
+        }
+    }
+}
+
+void pb_write_verts(pb_vert3D const* verts, size_t num_verts, pb_vertex_layout const* layout, size_t first) {
+    attribute_writer w;
+    size_t i;
+
+    if (init_attribute_writer(&w, &layout->position, first)) {
+        for (i = 0; i < num_verts; ++i) {
+            w.store(w.dst + i * w.stride, &verts[i].x, 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->normal, first)) {
+        for (i = 0; i < num_verts; ++i) {
+            w.store(w.dst + i * w.stride, &verts[i].nx, 3);
+        }
+    }
+
+    if (init_attribute_writer(&w, &layout->uv, first)) {
+        for (i = 0; i < num_verts; ++i) {
+            w.store(w.dst + i * w.stride, &verts[i].u, 2);
+        }
+    }
+}
+
+/* Centres the sphere of bounds on its box, ready for grow_sphere. */
+static void centre_sphere(pb_bounds3D* bounds) {
+    bounds->centre.x = (bounds->min.x + bounds->max.x) / 2.f;
+    bounds->centre.y = (bounds->min.y + bounds->max.y) / 2.f;
+    bounds->centre.z = (bounds->min.z + bounds->max.z) / 2.f;
+    bounds->radius = 0.f;
+}
+
+/* Grows the sphere of bounds to contain a point. */
+static void grow_sphere(pb_bounds3D* bounds, pb_point3D const* p) {
+    float dx = p->x - bounds->centre.x;
+    float dy = p->y - bounds->centre.y;
+    float dz = p->z - bounds->centre.z;
+    float dist = sqrtf(dx * dx + dy * dy + dz * dz);
+    bounds->radius = dist > bounds->radius ? dist : bounds->radius;
+}
+
+void pb_get_quad_bounds(pb_quad_verts const* q, pb_point3D const* pos, pb_bounds3D* bounds) {
+    pb_point3D corners[4];
+    size_t i;
+
+    pb_bounds3D_clear(bounds);
+    for (i = 0; i < 4; ++i) {
+        corners[i].x = (i & 1 ? q->end_x : q->start_x) + pos->x;
+        corners[i].y = (i & 2 ? q->top : q->bottom) + pos->y;
+        corners[i].z = (i & 1 ? q->end_z : q->start_z) + pos->z;
+        pb_bounds3D_add_point(bounds, corners + i);
+    }
+
+    centre_sphere(bounds);
+    for (i = 0; i < 4; ++i) {
+        grow_sphere(bounds, corners + i);
+    }
+}
+
+/* Gets where a point of a surface's outline ends up, offset by the surface's position. */
+static pb_point3D get_surface_corner(pb_point2D const* p, pb_point2D const* centre, pb_point3D const* pos) {
+    pb_point3D result = {p->x - centre->x + pos->x, 0.f + pos->y, centre->y - p->y + pos->z};
+    return result;
+}
+
+void pb_get_surface_bounds(pb_point2D const* points, size_t num_points, pb_point2D const* centre,
+                           pb_point3D const* pos, pb_bounds3D* bounds) {
+    size_t i;
+
+    pb_bounds3D_clear(bounds);
+    if (num_points == 0) {
+        return;
+    }
+
+    for (i = 0; i < num_points; ++i) {
+        pb_point3D p = get_surface_corner(points + i, centre, pos);
+        pb_bounds3D_add_point(bounds, &p);
+    }
+
+    centre_sphere(bounds);
+    for (i = 0; i < num_points; ++i) {
+        pb_point3D p = get_surface_corner(points + i, centre, pos);
+        grow_sphere(bounds, &p);
+    }
+}
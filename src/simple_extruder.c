@@ -1,9 +1,12 @@
 #include <pb/simple_extruder.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pb/util/geom/types.h>
 #include <pb/util/geom/shape_utils.h>
 #include <math.h>
 #include <pb/util/geom/line_utils.h>
+#include <pb/internal/vertex_kernels.h>
+#include <pb/internal/simple_extruder_quads.h>
 
 void pb_simple_door_extruder_count(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
                                    pb_point2D const* bottom_floor_centre, float floor_height,
@@ -13,33 +16,20 @@ void pb_simple_door_extruder_count(pb_line2D const* wall, pb_line2D const* wall_
     *num_structures = 1;
 }
 
-int pb_simple_door_extruder_func(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
-                                 pb_point2D const* bottom_floor_centre, float floor_height,
-                                 float struct_height, float start_height,
-                                 void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
-    pb_shape3D* door = NULL;
-    pb_shape3D* door_wall = NULL;
-
-    /* The door will take up the entire width, with some space at the top */
-    door = malloc(sizeof(pb_shape3D));
-    door_wall = malloc(sizeof(pb_shape3D));
-
-    if (!door || !door_wall) {
-        free(door);
-        free(door_wall);
-        return -1;
-    }
-
-    /* Make sure we can safely free if necessary */
-    size_t i;
-    door->tris = NULL;
-    door_wall->tris = NULL;
-
-    if (pb_shape3D_init(door, 2) == -1 ||
-        pb_shape3D_init(door_wall, 2) == -1) {
-        goto err_return;
-    }
+void pb_simple_door_extruder_tri_count(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                       pb_point2D const* bottom_floor_centre, float floor_height,
+                                       float struct_height, float start_height,
+                                       void* param, size_t* num_wall_tris, size_t* num_structure_tris) {
+    *num_wall_tris = 2;
+    *num_structure_tris = 2;
+}
 
+/* Both of the door's fill functions write out these quads */
+void pb_simple_door_quads(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                          pb_point2D const* bottom_floor_centre, float floor_height,
+                          float struct_height, float start_height,
+                          pb_quad_verts* door_quad, pb_point3D* door_pos,
+                          pb_quad_verts* wall_quad, pb_point3D* wall_pos) {
     pb_point2D wall_structure_vec  = {wall_structure->end.x - wall_structure->start.x,
                                       wall_structure->end.y - wall_structure->start.y};
     pb_point2D wall_structure_centre = {wall_structure->start.x + wall_structure_vec.x / 2.f,
@@ -59,89 +49,130 @@ int pb_simple_door_extruder_func(pb_line2D const* wall, pb_line2D const* wall_st
 
     float actual_door_height = fminf(floor_height * 0.95f, struct_height); /* Leave some space at the top */
     float door_top_v = 1.f - (actual_door_height / floor_height);
-    door->pos.x = wall_structure_centre.x - bottom_floor_centre->x;
-    door->pos.y = start_height + (actual_door_height / 2.f);
-    door->pos.z = -(wall_structure_centre.y - bottom_floor_centre->y);
-
-    /* Bottom left corner */
-    door->tris[0].nx = normal->x;
-    door->tris[0].ny = 0.f;
-    door->tris[0].nz = -normal->y;
-    door->tris[0].x = wall_structure_len.x / 2.f * wall_end_to_start.x;
-    door->tris[0].y = -actual_door_height / 2.f;
-    door->tris[0].z = wall_structure_len.y / 2.f * wall_end_to_start.y;
-    door->tris[0].v = 1.f;
-
-    /* Now that we've figured out where the *actual* start of the wall is, calculate its u coordinate */
-    pb_point2D s = {wall_structure_centre.x + door->tris[0].x, wall_structure_centre.y - door->tris[0].z};
+    door_pos->x = wall_structure_centre.x - bottom_floor_centre->x;
+    door_pos->y = start_height + (actual_door_height / 2.f);
+    door_pos->z = -(wall_structure_centre.y - bottom_floor_centre->y);
+
+    pb_quad_verts quad;
+    quad.start_x = wall_structure_len.x / 2.f * wall_end_to_start.x;
+    quad.start_z = wall_structure_len.y / 2.f * wall_end_to_start.y;
+    quad.end_x = wall_structure_len.x / 2.f * wall_start_to_end.x;
+    quad.end_z = wall_structure_len.y / 2.f * wall_start_to_end.y;
+    quad.nx = normal->x;
+    quad.nz = -normal->y;
+
+    /* Now that we've figured out where the *actual* start and end of the door are, calculate their u coordinates */
+    pb_point2D s = {wall_structure_centre.x + quad.start_x, wall_structure_centre.y - quad.start_z};
     pb_point2D start_t = pb_line2D_get_t(wall, &s);
-    float start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
-    door->tris[0].u = start_u;
-
-    /* Top right corner */
-    door->tris[1].nx = normal->x;
-    door->tris[1].ny = 0.f;
-    door->tris[1].nz = -normal->y;
-    door->tris[1].x = wall_structure_len.x / 2.f * wall_start_to_end.x;
-    door->tris[1].y = actual_door_height / 2.f;
-    door->tris[1].z = wall_structure_len.y / 2.f * wall_start_to_end.y;
-    door->tris[1].v = door_top_v;
-
-    /* Same for the end */
-    pb_point2D e = {wall_structure_centre.x + door->tris[1].x, wall_structure_centre.y - door->tris[1].z};
+    quad.start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
+
+    pb_point2D e = {wall_structure_centre.x + quad.end_x, wall_structure_centre.y - quad.end_z};
     pb_point2D end_t = pb_line2D_get_t(wall, &e);
-    float end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
-    door->tris[1].u = end_u;
-
-    /* Top left corner */
-    door->tris[2].nx = normal->x;
-    door->tris[2].ny = 0.f;
-    door->tris[2].nz = -normal->y;
-    door->tris[2].x = wall_structure_len.x / 2.f * wall_end_to_start.x;
-    door->tris[2].y = actual_door_height / 2.f;
-    door->tris[2].z = wall_structure_len.y / 2.f * wall_end_to_start.y;
-    door->tris[2].u = start_u;
-    door->tris[2].v = door_top_v;
-
-    /* Bottom left corner again */
-    door->tris[3] = door->tris[0];
-
-    /* Bottom right corner */
-    door->tris[4].nx = normal->x;
-    door->tris[4].ny = 0.f;
-    door->tris[4].nz = -normal->y;
-    door->tris[4].x = wall_structure_len.x / 2.f * wall_start_to_end.x;
-    door->tris[4].y = -actual_door_height / 2.f;
-    door->tris[4].z = wall_structure_len.y / 2.f * wall_start_to_end.y;
-    door->tris[4].u = end_u;
-    door->tris[4].v = 1.f;
-
-    /* Top right corner again */
-    door->tris[5] = door->tris[1];
+    quad.end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
+
+    quad.bottom = -actual_door_height / 2.f;
+    quad.top = actual_door_height / 2.f;
+    quad.bottom_v = 1.f;
+    quad.top_v = door_top_v;
+    *door_quad = quad;
 
     float door_wall_height = floor_height - actual_door_height;
-    door_wall->pos = door->pos;
-    door_wall->pos.y = start_height + floor_height - (door_wall_height / 2.f);
+    *wall_pos = *door_pos;
+    wall_pos->y = start_height + floor_height - (door_wall_height / 2.f);
+
+    quad.bottom = -door_wall_height / 2.f;
+    quad.top = door_wall_height / 2.f;
+    quad.bottom_v = door_top_v;
+    quad.top_v = 0.f;
+    *wall_quad = quad;
+}
+
+int pb_simple_door_extruder_fill(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                 pb_point2D const* bottom_floor_centre, float floor_height,
+                                 float struct_height, float start_height,
+                                 void* param,
+                                 pb_shape3D* walls_out, pb_vert3D* wall_verts,
+                                 pb_shape3D* structures_out, pb_vert3D* structure_verts) {
+    pb_shape3D* door = structures_out;
+    pb_shape3D* door_wall = walls_out;
+    pb_quad_verts door_quad;
+    pb_quad_verts wall_quad;
+
+    door->tris = structure_verts;
+    door->num_tris = 2;
+    door_wall->tris = wall_verts;
+    door_wall->num_tris = 2;
+
+    pb_simple_door_quads(wall, wall_structure, normal, bottom_floor_centre, floor_height,
+                         struct_height, start_height, &door_quad, &door->pos, &wall_quad, &door_wall->pos);
+    pb_fill_quad_verts(&door_quad, door->tris);
+    pb_fill_quad_verts(&wall_quad, door_wall->tris);
+    pb_get_quad_bounds(&door_quad, &door->pos, &door->bounds);
+    pb_get_quad_bounds(&wall_quad, &door_wall->pos, &door_wall->bounds);
 
-    door_wall->tris[0] = door->tris[0];
-    door_wall->tris[0].y = -door_wall_height / 2.f;
-    door_wall->tris[0].v = door_top_v;
+    return 0;
+}
 
-    door_wall->tris[1] = door->tris[1];
-    door_wall->tris[1].y = door_wall_height / 2.f;
-    door_wall->tris[1].v = 0.f;
+int pb_simple_door_extruder_fill_layout(pb_line2D const* wall, pb_line2D const* wall_structure,
+                                        pb_point2D const* normal,
+                                        pb_point2D const* bottom_floor_centre, float floor_height,
+                                        float struct_height, float start_height,
+                                        void* param, pb_vertex_layout const* layout,
+                                        pb_shape3D* walls_out, size_t wall_vert,
+                                        pb_shape3D* structures_out, size_t structure_vert) {
+    pb_shape3D* door_wall = walls_out;
+    pb_quad_verts door_quad;
+    pb_quad_verts wall_quad;
+    pb_point3D door_pos;
 
-    door_wall->tris[2] = door->tris[2];
-    door_wall->tris[2].y = door_wall_height / 2.f;
-    door_wall->tris[2].v = 0.f;
+    door_wall->tris = NULL;
+    door_wall->num_tris = 2;
+
+    pb_simple_door_quads(wall, wall_structure, normal, bottom_floor_centre, floor_height,
+                         struct_height, start_height, &door_quad, &door_pos, &wall_quad, &door_wall->pos);
+    pb_write_quad_verts(&wall_quad, layout, wall_vert);
+    pb_get_quad_bounds(&wall_quad, &door_wall->pos, &door_wall->bounds);
+
+    if (structures_out) {
+        structures_out->tris = NULL;
+        structures_out->num_tris = 2;
+        structures_out->pos = door_pos;
+        pb_write_quad_verts(&door_quad, layout, structure_vert);
+        pb_get_quad_bounds(&door_quad, &door_pos, &structures_out->bounds);
+    }
 
-    door_wall->tris[3] = door_wall->tris[0];
+    return 0;
+}
 
-    door_wall->tris[4] = door->tris[4];
-    door_wall->tris[4].y = -door_wall_height / 2.f;
-    door_wall->tris[4].v = door_top_v;
+int pb_simple_door_extruder_func(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                 pb_point2D const* bottom_floor_centre, float floor_height,
+                                 float struct_height, float start_height,
+                                 void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
+    pb_shape3D* door = NULL;
+    pb_shape3D* door_wall = NULL;
 
-    door_wall->tris[5] = door_wall->tris[1];
+    /* The door will take up the entire width, with some space at the top */
+    door = malloc(sizeof(pb_shape3D));
+    door_wall = malloc(sizeof(pb_shape3D));
+
+    if (!door || !door_wall) {
+        free(door);
+        free(door_wall);
+        return -1;
+    }
+
+    /* Make sure we can safely free if necessary */
+    door->tris = NULL;
+    door_wall->tris = NULL;
+
+    if (pb_shape3D_init(door, 2) == -1 ||
+        pb_shape3D_init(door_wall, 2) == -1) {
+        goto err_return;
+    }
+
+    pb_simple_door_extruder_fill(wall, wall_structure, normal, bottom_floor_centre,
+                                 floor_height, struct_height, start_height,
+                                 param, door_wall, door_wall->tris, door, door->tris);
 
     *walls_out = door_wall;
     *structures_out = door;
@@ -165,35 +196,20 @@ void pb_simple_window_extruder_count(pb_line2D const* wall, pb_line2D const* wal
     *num_structures = 1;
 }
 
-int pb_simple_window_extruder_func(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
-                                   pb_point2D const* bottom_floor_centre, float floor_height,
-                                   float struct_height, float start_height,
-                                   void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
-    pb_shape3D* window = NULL;
-    pb_shape3D* window_walls = NULL;
-
-    /* The door will take up the entire width, with some space at the top */
-    window = malloc(sizeof(pb_shape3D));
-    window_walls = malloc(sizeof(pb_shape3D) * 2);
-
-    if (!window || !window_walls) {
-        free(window);
-        free(window_walls);
-        return -1;
-    }
-
-    /* Make sure we can safely free if necessary */
-    size_t i;
-    window->tris = NULL;
-    window_walls[0].tris = NULL;
-    window_walls[1].tris = NULL;
-
-    if (pb_shape3D_init(window, 2) == -1 ||
-        pb_shape3D_init(window_walls + 0, 2) == -1 ||
-        pb_shape3D_init(window_walls + 1, 2) == -1) {
-        goto err_return;
-    }
+void pb_simple_window_extruder_tri_count(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                         pb_point2D const* bottom_floor_centre, float floor_height,
+                                         float struct_height, float start_height,
+                                         void* param, size_t* num_wall_tris, size_t* num_structure_tris) {
+    *num_wall_tris = 4;
+    *num_structure_tris = 2;
+}
 
+/* Both of the window's fill functions write out these quads */
+void pb_simple_window_quads(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                            pb_point2D const* bottom_floor_centre, float floor_height,
+                            float struct_height, float start_height,
+                            pb_quad_verts* window_quad, pb_point3D* window_pos,
+                            pb_quad_verts* wall_quads, pb_point3D* wall_pos) {
     pb_point2D wall_structure_vec  = {wall_structure->end.x - wall_structure->start.x,
                                       wall_structure->end.y - wall_structure->start.y};
     pb_point2D wall_structure_centre = {wall_structure->start.x + wall_structure_vec.x / 2.f,
@@ -216,112 +232,161 @@ int pb_simple_window_extruder_func(pb_line2D const* wall, pb_line2D const* wall_
     float window_top_v = window_wall_height / floor_height;
     float window_bottom_v = 1 - window_top_v;
 
-    window->pos.x = wall_structure_centre.x - bottom_floor_centre->x;
-    window->pos.y = start_height + (floor_height / 2.f);
-    window->pos.z = bottom_floor_centre->y - wall_structure_centre.y;
-
-    /* Bottom left corner */
-    window->tris[0].nx = normal->x;
-    window->tris[0].ny = 0.f;
-    window->tris[0].nz = -normal->y;
-    window->tris[0].x = wall_structure_len.x / 2.f * wall_end_to_start.x;
-    window->tris[0].y = -actual_window_height / 2.f;
-    window->tris[0].z = wall_structure_len.y / 2.f * wall_end_to_start.y;
-    window->tris[0].v = window_bottom_v;
-
-    /* Now that we've figured out where the *actual* start of the wall is, calculate its u coordinate */
-    pb_point2D s = {wall_structure_centre.x + window->tris[0].x, wall_structure_centre.y - window->tris[0].z};
-    pb_point2D start_t = pb_line2D_get_t(wall, &s);
-    float start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
-    window->tris[0].u = start_u;
-
-    /* Top right corner */
-    window->tris[1].nx = normal->x;
-    window->tris[1].ny = 0.f;
-    window->tris[1].nz = -normal->y;
-    window->tris[1].x = wall_structure_len.x / 2.f * wall_start_to_end.x;
-    window->tris[1].y = actual_window_height / 2.f;
-    window->tris[1].z = wall_structure_len.y / 2.f * wall_start_to_end.y;
-    window->tris[1].v = window_top_v;
-
-    /* Same for the end */
-    pb_point2D e = {wall_structure_centre.x + window->tris[1].x, wall_structure_centre.y - window->tris[1].z};
-    pb_point2D end_t = pb_line2D_get_t(wall, &e);
-    float end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
-    window->tris[1].u = end_u;
+    window_pos->x = wall_structure_centre.x - bottom_floor_centre->x;
+    window_pos->y = start_height + (floor_height / 2.f);
+    window_pos->z = bottom_floor_centre->y - wall_structure_centre.y;
 
-    /* Top left corner */
-    window->tris[2].nx = normal->x;
-    window->tris[2].ny = 0.f;
-    window->tris[2].nz = -normal->y;
-    window->tris[2].x = wall_structure_len.x / 2.f * wall_end_to_start.x;
-    window->tris[2].y = actual_window_height / 2.f;
-    window->tris[2].z = wall_structure_len.y / 2.f * wall_end_to_start.y;
-    window->tris[2].u = start_u;
-    window->tris[2].v = window_top_v;
+    pb_quad_verts quad;
+    quad.start_x = wall_structure_len.x / 2.f * wall_end_to_start.x;
+    quad.start_z = wall_structure_len.y / 2.f * wall_end_to_start.y;
+    quad.end_x = wall_structure_len.x / 2.f * wall_start_to_end.x;
+    quad.end_z = wall_structure_len.y / 2.f * wall_start_to_end.y;
+    quad.nx = normal->x;
+    quad.nz = -normal->y;
 
-    /* Bottom left corner again */
-    window->tris[3] = window->tris[0];
+    /* Now that we've figured out where the *actual* start and end of the window are, calculate their u coordinates */
+    pb_point2D s = {wall_structure_centre.x + quad.start_x, wall_structure_centre.y - quad.start_z};
+    pb_point2D start_t = pb_line2D_get_t(wall, &s);
+    quad.start_u = start_t.x == INFINITY ? start_t.y : start_t.x;
 
-    /* Bottom right corner */
-    window->tris[4].nx = normal->x;
-    window->tris[4].ny = 0.f;
-    window->tris[4].nz = -normal->y;
-    window->tris[4].x = wall_structure_len.x / 2.f * wall_start_to_end.x;
-    window->tris[4].y = -actual_window_height / 2.f;
-    window->tris[4].z = wall_structure_len.y / 2.f * wall_start_to_end.y;
-    window->tris[4].u = end_u;
-    window->tris[4].v = window_bottom_v;
+    pb_point2D e = {wall_structure_centre.x + quad.end_x, wall_structure_centre.y - quad.end_z};
+    pb_point2D end_t = pb_line2D_get_t(wall, &e);
+    quad.end_u = end_t.x == INFINITY ? end_t.y : end_t.x;
+
+    quad.bottom = -actual_window_height / 2.f;
+    quad.top = actual_window_height / 2.f;
+    quad.bottom_v = window_bottom_v;
+    quad.top_v = window_top_v;
+    *window_quad = quad;
+
+    /* The walls below and above the window */
+    quad.bottom = -window_wall_height / 2.f;
+    quad.top = window_wall_height / 2.f;
+
+    wall_pos[0] = *window_pos;
+    wall_pos[0].y = start_height + (window_wall_height / 2.f);
+    quad.bottom_v = 1.f;
+    quad.top_v = window_bottom_v;
+    wall_quads[0] = quad;
+
+    wall_pos[1] = *window_pos;
+    wall_pos[1].y = start_height + floor_height - (window_wall_height / 2.f);
+    quad.bottom_v = window_top_v;
+    quad.top_v = 0.f;
+    wall_quads[1] = quad;
+}
 
-    /* Top right corner again */
-    window->tris[5] = window->tris[1];
+int pb_simple_window_extruder_fill(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                   pb_point2D const* bottom_floor_centre, float floor_height,
+                                   float struct_height, float start_height,
+                                   void* param,
+                                   pb_shape3D* walls_out, pb_vert3D* wall_verts,
+                                   pb_shape3D* structures_out, pb_vert3D* structure_verts) {
+    pb_shape3D* window = structures_out;
+    pb_shape3D* window_walls = walls_out;
+    pb_quad_verts window_quad;
+    pb_quad_verts wall_quads[2];
+    pb_point3D wall_pos[2];
+    size_t i;
 
-    window_walls[0].pos = window->pos;
-    window_walls[0].pos.y = start_height + (window_wall_height / 2.f);
+    window->tris = structure_verts;
+    window->num_tris = 2;
+    window_walls[0].tris = wall_verts;
+    window_walls[0].num_tris = 2;
+    window_walls[1].tris = wall_verts + 6;
+    window_walls[1].num_tris = 2;
+
+    pb_simple_window_quads(wall, wall_structure, normal, bottom_floor_centre, floor_height,
+                           struct_height, start_height, &window_quad, &window->pos, wall_quads, wall_pos);
+    pb_fill_quad_verts(&window_quad, window->tris);
+    pb_get_quad_bounds(&window_quad, &window->pos, &window->bounds);
+
+    for (i = 0; i < 2; ++i) {
+        window_walls[i].pos = wall_pos[i];
+        pb_fill_quad_verts(wall_quads + i, window_walls[i].tris);
+        pb_get_quad_bounds(wall_quads + i, wall_pos + i, &window_walls[i].bounds);
+    }
 
-    window_walls[0].tris[0] = window->tris[0];
-    window_walls[0].tris[0].y = -window_wall_height / 2.f;
-    window_walls[0].tris[0].v = 1.f;
+    return 0;
+}
 
-    window_walls[0].tris[1] = window->tris[1];
-    window_walls[0].tris[1].y = window_wall_height / 2.f;
-    window_walls[0].tris[1].v = window_bottom_v;
+int pb_simple_window_extruder_fill_layout(pb_line2D const* wall, pb_line2D const* wall_structure,
+                                          pb_point2D const* normal,
+                                          pb_point2D const* bottom_floor_centre, float floor_height,
+                                          float struct_height, float start_height,
+                                          void* param, pb_vertex_layout const* layout,
+                                          pb_shape3D* walls_out, size_t wall_vert,
+                                          pb_shape3D* structures_out, size_t structure_vert) {
+    pb_shape3D* window_walls = walls_out;
+    pb_quad_verts window_quad;
+    pb_quad_verts wall_quads[2];
+    pb_point3D wall_pos[2];
+    pb_point3D window_pos;
+    size_t i;
 
-    window_walls[0].tris[2] = window->tris[2];
-    window_walls[0].tris[2].y = window_wall_height / 2.f;
-    window_walls[0].tris[2].v = window_bottom_v;
+    pb_simple_window_quads(wall, wall_structure, normal, bottom_floor_centre, floor_height,
+                           struct_height, start_height, &window_quad, &window_pos, wall_quads, wall_pos);
 
-    window_walls[0].tris[3] = window_walls[0].tris[0];
+    for (i = 0; i < 2; ++i) {
+        window_walls[i].tris = NULL;
+        window_walls[i].num_tris = 2;
+        window_walls[i].pos = wall_pos[i];
+        pb_write_quad_verts(wall_quads + i, layout, wall_vert + i * 6);
+        pb_get_quad_bounds(wall_quads + i, wall_pos + i, &window_walls[i].bounds);
+    }
 
-    window_walls[0].tris[4] = window->tris[4];
-    window_walls[0].tris[4].y = -window_wall_height / 2.f;
-    window_walls[0].tris[4].v = 1.f;
+    if (structures_out) {
+        structures_out->tris = NULL;
+        structures_out->num_tris = 2;
+        structures_out->pos = window_pos;
+        pb_write_quad_verts(&window_quad, layout, structure_vert);
+        pb_get_quad_bounds(&window_quad, &window_pos, &structures_out->bounds);
+    }
 
-    window_walls[0].tris[5] = window_walls[0].tris[1];
+    return 0;
+}
 
+int pb_simple_window_extruder_func(pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                   pb_point2D const* bottom_floor_centre, float floor_height,
+                                   float struct_height, float start_height,
+                                   void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
+    pb_shape3D* window = NULL;
+    pb_shape3D* window_walls = NULL;
 
-    window_walls[1].pos = window->pos;
-    window_walls[1].pos.y = start_height + floor_height - (window_wall_height / 2.f);
+    /* The fill function puts both walls in one vertex array, but each wall needs its own allocation here */
+    pb_shape3D filled_walls[2];
+    pb_vert3D filled_wall_verts[12];
 
-    window_walls[1].tris[0] = window->tris[0];
-    window_walls[1].tris[0].y = -window_wall_height / 2.f;
-    window_walls[1].tris[0].v = window_top_v;
+    window = malloc(sizeof(pb_shape3D));
+    window_walls = malloc(sizeof(pb_shape3D) * 2);
 
-    window_walls[1].tris[1] = window->tris[1];
-    window_walls[1].tris[1].y = window_wall_height / 2.f;
-    window_walls[1].tris[1].v = 0.f;
+    if (!window || !window_walls) {
+        free(window);
+        free(window_walls);
+        return -1;
+    }
 
-    window_walls[1].tris[2] = window->tris[2];
-    window_walls[1].tris[2].y = window_wall_height / 2.f;
-    window_walls[1].tris[2].v = 0.f;
+    /* Make sure we can safely free if necessary */
+    window->tris = NULL;
+    window_walls[0].tris = NULL;
+    window_walls[1].tris = NULL;
 
-    window_walls[1].tris[3] = window_walls[1].tris[0];
+    if (pb_shape3D_init(window, 2) == -1 ||
+        pb_shape3D_init(window_walls + 0, 2) == -1 ||
+        pb_shape3D_init(window_walls + 1, 2) == -1) {
+        goto err_return;
+    }
 
-    window_walls[1].tris[4] = window->tris[4];
-    window_walls[1].tris[4].y = -window_wall_height / 2.f;
-    window_walls[1].tris[4].v = window_top_v;
+    pb_simple_window_extruder_fill(wall, wall_structure, normal, bottom_floor_centre,
+                                   floor_height, struct_height, start_height,
+                                   param, filled_walls, filled_wall_verts, window, window->tris);
 
-    window_walls[1].tris[5] = window_walls[1].tris[1];
+    window_walls[0].pos = filled_walls[0].pos;
+    window_walls[0].bounds = filled_walls[0].bounds;
+    memcpy(window_walls[0].tris, filled_walls[0].tris, sizeof(pb_vert3D) * 6);
+    window_walls[1].pos = filled_walls[1].pos;
+    window_walls[1].bounds = filled_walls[1].bounds;
+    memcpy(window_walls[1].tris, filled_walls[1].tris, sizeof(pb_vert3D) * 6);
 
     *walls_out = window_walls;
     *structures_out = window;
@@ -342,12 +407,18 @@ err_return:
 static pb_wall_structure_extruder simple_door_extruder = {
     pb_simple_door_extruder_count,
     pb_simple_door_extruder_func,
+    pb_simple_door_extruder_tri_count,
+    pb_simple_door_extruder_fill,
+    pb_simple_door_extruder_fill_layout,
 };
 pb_wall_structure_extruder const* pb_simple_door_extruder = &simple_door_extruder;
 
 static pb_wall_structure_extruder simple_window_extruder = {
         pb_simple_window_extruder_count,
         pb_simple_window_extruder_func,
+        pb_simple_window_extruder_tri_count,
+        pb_simple_window_extruder_fill,
+        pb_simple_window_extruder_fill_layout,
 };
 
 pb_wall_structure_extruder const* pb_simple_window_extruder = &simple_window_extruder;
@@ -2,23 +2,260 @@
 #include <pb/internal/sq_house_layout.h>
 #include <pb/internal/sq_house_graph.h>
 #include <pb/floor_plan.h>
+#include <pb/util/arena/arena.h>
+#include <pb/util/geom/shape_utils.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Identifiers for the random streams used by each stage of the algorithm */
+enum {
+    PB_SQ_HOUSE_STREAM_ROOMS = 1,
+    PB_SQ_HOUSE_STREAM_STAIRS = 2
+};
 
 PB_DECLSPEC pb_building* PB_CALL pb_sq_house(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs) {
+    pb_rng rng;
+    uint64_t seed = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+
+    pb_rng_seed(&rng, seed);
+    return pb_sq_house_ex(house_spec, room_specs, &rng);
+}
+
+/* Everything needed to lay out each floor once the stairs have been placed. Every floor reads the shared state and
+ * writes only to its own pb_floor, so floors can be laid out in any order (or at the same time). */
+typedef struct {
+    pb_sq_house_house_spec* house_spec;
+    pb_hashmap* room_specs;
+    pb_building* b;
+    char const** room_list;
+    pb_rect* floor_rects;
+    int* results;
+    pb_arena** arenas; /* Each floor's arena when floors are laid out concurrently, or NULL to use the building's */
+} floor_layout_job;
+
+static size_t floor_num_stairs(pb_building const* b, size_t floor) {
+    if (b->num_floors == 1) {
+        return 0;
+    }
+    return floor > 0 && floor < b->num_floors - 1 ? 2 : 1;
+}
+
+/**
+ * Frees the room shapes added to a floor by layout_floor_pipeline. Everything else on the floor lives in an arena.
+ *
+ * @param f The floor to free.
+ */
+static void free_floor_layout(pb_floor* f) {
+    size_t cur_room;
+    for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+        pb_shape2D_free(&f->rooms[cur_room].shape);
+    }
+}
+
+/**
+ * Frees a building whose generation failed after its stairs were placed, along with its arena.
+ *
+ * @param b The building to free.
+ */
+static void free_failed_building(pb_building* b) {
+    size_t cur_floor;
+    for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+        pb_shape2D_free(&b->floors[cur_floor].shape);
+    }
+    pb_arena_free(b->arena);
+    free(b);
+}
+
+/* Moves a shape's points to dst, which must have room for them, and returns the end of the moved points */
+static pb_point2D* move_shape(pb_shape2D* shape, pb_point2D* dst) {
+    memcpy(dst, shape->points.items, sizeof(pb_point2D) * shape->points.size);
+    pb_shape2D_free(shape);
+    shape->points.items = dst;
+    shape->points.cap = shape->points.size;
+    return dst + shape->points.size;
+}
+
+/**
+ * Moves the points of every shape in the building into its arena, so that the whole building is released along with
+ * the arena. The shapes are the only part of the plan built with malloc, since hallway placement grows them with
+ * pb_vector. They're copied into a single allocation in the order in which a plan is normally traversed.
+ *
+ * @param b The building whose shapes to move.
+ * @return 0 on success, -1 on failure (out of memory), in which case the building is unchanged.
+ */
+static int move_shapes_to_arena(pb_building* b) {
+    size_t num_points = 0;
+    pb_point2D* points;
+    size_t cur_floor;
+    size_t cur_room;
+
+    for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+        pb_floor const* f = b->floors + cur_floor;
+
+        num_points += f->shape.points.size;
+        for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+            num_points += f->rooms[cur_room].shape.points.size;
+        }
+    }
+
+    points = pb_arena_alloc(b->arena, sizeof(pb_point2D) * num_points);
+    if (!points) {
+        return -1;
+    }
+
+    for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+        pb_floor* f = b->floors + cur_floor;
+
+        points = move_shape(&f->shape, points);
+        for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
+            points = move_shape(&f->rooms[cur_room].shape, points);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Lays out the rooms on a floor, then connects them with hallways and places their doors and windows. None of these
+ * stages draw random numbers, so the result depends only on the floor's rooms and rectangle.
+ *
+ * @param job       The house being generated.
+ * @param cur_floor The index of the floor to lay out.
+ * @return 0 on success, -1 on failure, in which case the shapes added to the floor have been freed.
+ */
+static int layout_floor_pipeline(floor_layout_job const* job, size_t cur_floor) {
+    pb_building* b = job->b;
+    pb_floor* f = b->floors + cur_floor;
+    pb_arena* arena = job->arenas ? job->arenas[cur_floor] : b->arena;
+    size_t room_sum = 0;
+    size_t i;
+
+    for (i = 0; i < cur_floor; ++i) {
+        room_sum += b->floors[i].num_rooms - floor_num_stairs(b, i);
+    }
+
+    size_t actual_num_rooms = f->num_rooms - floor_num_stairs(b, cur_floor);
+    if (pb_sq_house_layout_floor(job->room_list + room_sum, job->room_specs, f, actual_num_rooms,
+                                 job->floor_rects + cur_floor, b->num_floors > 1 && cur_floor == 0, arena) == -1) {
+        return -1;
+    }
+
+    pb_graph* floor_graph = pb_sq_house_generate_floor_graph(job->house_spec, job->room_specs, f);
+    if (!floor_graph) {
+        goto err_return;
+    }
+
+    pb_hashmap* disconnected = pb_sq_house_find_disconnected_rooms(floor_graph, f);
+    if (!disconnected) {
+        pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
+        pb_graph_free(floor_graph);
+        goto err_return;
+    }
+
+    if (disconnected->size > 0) {
+        pb_graph* internal_graph = pb_sq_house_generate_internal_graph(floor_graph);
+        if (!internal_graph) {
+            pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
+            pb_graph_free(floor_graph);
+            pb_hashmap_free(disconnected);
+            goto err_return;
+        }
+
+        pb_vector* hallways = pb_sq_house_get_hallways(f, floor_graph, internal_graph, disconnected);
+
+        if (!hallways) {
+            pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
+            pb_graph_free(floor_graph);
+            pb_hashmap_free(disconnected);
+            pb_graph_free(internal_graph);
+            goto err_return;
+        }
+
+        /* TODO: Re-write hallway algorithm so that hallways are always found in this case */
+        if (hallways->size) {
+            if (pb_sq_house_place_hallways(f, job->house_spec, job->room_specs, floor_graph,
+                                           internal_graph, hallways, arena) == -1) {
+                pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
+                pb_graph_free(floor_graph);
+                pb_hashmap_free(disconnected);
+                pb_graph_free(internal_graph);
+                pb_vector_free(hallways);
+                free(hallways);
+                goto err_return;
+            }
+        }
+
+        pb_graph_free(internal_graph);
+        pb_vector_free(hallways);
+        free(hallways);
+    }
+    pb_hashmap_free(disconnected);
+
+    int door_place_result = pb_sq_house_place_doors(f, job->house_spec, floor_graph, cur_floor == 0, arena);
+
+    pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
+    pb_graph_free(floor_graph);
+
+    if (door_place_result == -1) {
+        goto err_return;
+    }
+
+    int window_place_result = pb_sq_house_place_windows(f, job->house_spec, cur_floor == 0, arena);
+    if (window_place_result == -1) {
+        goto err_return;
+    }
+
+    return 0;
+
+err_return:
+    free_floor_layout(f);
+    return -1;
+}
+
+static void PB_UTIL_CALL layout_floor_task(size_t index, size_t worker, void* param) {
+    floor_layout_job* job = (floor_layout_job*)param;
+    (void)worker;
+    job->results[index] = layout_floor_pipeline(job, index);
+}
+
+PB_DECLSPEC pb_building* PB_CALL pb_sq_house_ex(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs, pb_rng* rng) {
+    return pb_sq_house_parallel(house_spec, room_specs, rng, NULL);
+}
+
+PB_DECLSPEC pb_building* PB_CALL pb_sq_house_parallel(pb_sq_house_house_spec* house_spec, pb_hashmap* room_specs,
+                                                      pb_rng* rng, pb_thread_pool* pool) {
+    pb_rng house_rng;
+    pb_rng stage_rng;
+
+    pb_rng_seed(&house_rng, pb_rng_next64(rng));
+
     pb_building* b = malloc(sizeof(pb_building));
     if (!b) {
         return NULL;
     }
     b->has_names = 1;
+    b->data = NULL;
+    b->arena = pb_arena_create(0);
+    if (!b->arena) {
+        free(b);
+        return NULL;
+    }
 
-    char const** room_list = (char const**)pb_sq_house_choose_rooms(room_specs, house_spec);
+    pb_rng_split(&house_rng, PB_SQ_HOUSE_STREAM_ROOMS, &stage_rng);
+    char const** room_list = (char const**)pb_sq_house_choose_rooms(room_specs, house_spec, &stage_rng);
     if (!room_list) {
+        pb_arena_free(b->arena);
+        free(b);
         return NULL;
     }
 
-    pb_rect* floor_rects = pb_sq_house_layout_stairs(room_list, room_specs, house_spec, b);
+    pb_rng_split(&house_rng, PB_SQ_HOUSE_STREAM_STAIRS, &stage_rng);
+    pb_rect* floor_rects = pb_sq_house_layout_stairs(room_list, room_specs, house_spec, b, &stage_rng, b->arena);
     if (!floor_rects) {
         free(room_list);
+        pb_arena_free(b->arena);
+        free(b);
         return NULL;
     }
 
@@ -27,18 +264,12 @@ PB_DECLSPEC pb_building* PB_CALL pb_sq_house(pb_sq_house_house_spec* house_spec,
         pb_room* first_room = b->floors[0].rooms;
 
         first_room->shape.points.items = NULL;
-        first_room->walls.items = NULL;
 
         if (pb_rect_to_pb_shape2D(floor_rects, &b->floors[0].rooms[0].shape) == -1 ||
-                pb_vector_init(&b->floors[0].rooms[0].walls, sizeof(int), 4) == -1) {
+                pb_sq_house_init_walls(b->arena, &b->floors[0].rooms[0].walls, 4) == -1) {
             
             pb_shape2D_free(&b->floors[0].rooms[0].shape);
-            pb_vector_free(&b->floors[0].rooms[0].walls);
-            free(b->floors[0].rooms[0].doors);
-
-            pb_shape2D_free(&b->floors[0].shape);
-            
-            free(b);
+            free_failed_building(b);
             free(floor_rects);
             return NULL;
         }
@@ -54,28 +285,11 @@ PB_DECLSPEC pb_building* PB_CALL pb_sq_house(pb_sq_house_house_spec* house_spec,
         first_room->name = room_list[0];
         first_room->data = NULL;
 
-        if (pb_sq_house_place_doors(b->floors, house_spec, NULL, 1) == -1) {
-            pb_shape2D_free(&b->floors[0].rooms[0].shape);
-            pb_vector_free(&b->floors[0].rooms[0].walls);
-            free(b->floors[0].rooms[0].doors);
-
-            pb_shape2D_free(&b->floors[0].shape);
-            free(b->floors[0].doors);
-
-            free(b);
-            free(floor_rects);
-            return NULL;
-        } else if (pb_sq_house_place_windows(b->floors, house_spec, 1) == -1) {
-            pb_shape2D_free(&b->floors[0].rooms[0].shape);
-            pb_vector_free(&b->floors[0].rooms[0].walls);
-            free(b->floors[0].rooms[0].doors);
-            free(b->floors[0].rooms[0].windows);
-
-            pb_shape2D_free(&b->floors[0].shape);
-            free(b->floors[0].doors);
-            free(b->floors[0].windows);
-
-            free(b);
+        if (pb_sq_house_place_doors(b->floors, house_spec, NULL, 1, b->arena) == -1 ||
+            pb_sq_house_place_windows(b->floors, house_spec, 1, b->arena) == -1 ||
+            move_shapes_to_arena(b) == -1) {
+            free_floor_layout(b->floors);
+            free_failed_building(b);
             free(floor_rects);
             return NULL;
         }
@@ -84,136 +298,87 @@ PB_DECLSPEC pb_building* PB_CALL pb_sq_house(pb_sq_house_house_spec* house_spec,
         return b;
     }
 
-    /* TODO: Create a function to initialise rooms/floor, because the variables tracking whether they've been added
-     * are pretty hacky. */
+    floor_layout_job job;
     size_t cur_floor;
-    size_t room_sum = 0;
-    int added_doors;/* Whether we've added doors to the current floor */
-    int added_windows; /* Whether we've added windows to the current floor. */
-    for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
-        added_doors = 0;
-        added_windows = 0;
-
-        size_t num_stairs = b->num_floors > 1 ? (cur_floor > 0 && cur_floor < b->num_floors - 1 ? 2 : 1): 0;
-        size_t actual_num_rooms = b->floors[cur_floor].num_rooms - num_stairs;
-
-        const char** start_room = room_list + room_sum;
-        room_sum += actual_num_rooms;
-        if (pb_sq_house_layout_floor(start_room, room_specs, b->floors + cur_floor,
-                                     actual_num_rooms, floor_rects + cur_floor, b->num_floors > 1 && cur_floor == 0) == -1) {
-            cur_floor--;
-            goto err_return;
-        }
+    int failed = 0;
+
+    job.house_spec = house_spec;
+    job.room_specs = room_specs;
+    job.b = b;
+    job.room_list = room_list;
+    job.floor_rects = floor_rects;
+    job.arenas = NULL;
+    job.results = malloc(sizeof(int) * b->num_floors);
+    if (!job.results) {
+        goto err_return;
+    }
 
-        pb_graph* floor_graph = pb_sq_house_generate_floor_graph(house_spec, room_specs, b->floors + cur_floor);
-        if (!floor_graph) {
+    if (pool) {
+        /* Floors laid out at the same time can't share an arena, so each gets its own until they're all done */
+        job.arenas = calloc(b->num_floors, sizeof(pb_arena*));
+        if (!job.arenas) {
+            free(job.results);
             goto err_return;
         }
-
-        pb_hashmap* disconnected = pb_sq_house_find_disconnected_rooms(floor_graph, b->floors + cur_floor);
-        if (!disconnected) {
-            pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-            pb_graph_free(floor_graph);
-            goto err_return;
+        for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+            job.arenas[cur_floor] = pb_arena_create(0);
+            failed |= job.arenas[cur_floor] == NULL;
         }
 
-        if (disconnected->size > 0) {
-            pb_graph* internal_graph = pb_sq_house_generate_internal_graph(floor_graph);
-            if (!internal_graph) {
-                pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-                pb_graph_free(floor_graph);
-                pb_hashmap_free(disconnected);
-                goto err_return;
+        if (!failed) {
+            pb_thread_pool_run(pool, b->num_floors, layout_floor_task, &job);
+        } else {
+            for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+                job.results[cur_floor] = -1;
             }
+        }
 
-            pb_vector* hallways = pb_sq_house_get_hallways(b->floors + cur_floor, floor_graph, internal_graph, disconnected);
-
-            if (!hallways) {
-                pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-                pb_graph_free(floor_graph);
-                pb_hashmap_free(disconnected);
-                pb_graph_free(internal_graph);
-                goto err_return;
+        for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+            if (job.arenas[cur_floor]) {
+                pb_arena_merge(b->arena, job.arenas[cur_floor]);
             }
-
-            /* TODO: Re-write hallway algorithm so that hallways are always found in this case */
-            if (hallways->size) {
-                if (pb_sq_house_place_hallways(b->floors + cur_floor, house_spec, room_specs, floor_graph,
-                                               internal_graph, hallways) == -1) {
-                    pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-                    pb_graph_free(floor_graph);
-                    pb_hashmap_free(disconnected);
-                    pb_graph_free(internal_graph);
-                    pb_vector_free(hallways);
-                    free(hallways);
-                    goto err_return;
-                }
+        }
+        free(job.arenas);
+    } else {
+        /* Floors that are never laid out are marked as failed so that they aren't freed below */
+        for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+            job.results[cur_floor] = -1;
+        }
+        for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+            if ((job.results[cur_floor] = layout_floor_pipeline(&job, cur_floor)) == -1) {
+                break;
             }
-
-            pb_graph_free(internal_graph);
-            pb_vector_free(hallways);
-            free(hallways);
         }
-        pb_hashmap_free(disconnected);
-
-        int door_place_result = pb_sq_house_place_doors(b->floors + cur_floor, house_spec, floor_graph, cur_floor == 0);
-        added_doors = 1;
-
-        pb_graph_for_each_edge(floor_graph, pb_graph_free_edge_data, NULL);
-        pb_graph_free(floor_graph);
+    }
 
-        if (door_place_result == -1) {
-            goto err_return;
-        }
+    for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+        failed |= job.results[cur_floor] == -1;
+    }
 
-        int window_place_result = pb_sq_house_place_windows(b->floors + cur_floor, house_spec, cur_floor == 0);
-        added_windows = 1;
-        if (window_place_result == -1) {
-            goto err_return;
+    if (failed || move_shapes_to_arena(b) == -1) {
+        /* Failed floors have already cleaned up after themselves */
+        for (cur_floor = 0; cur_floor < b->num_floors; ++cur_floor) {
+            if (job.results[cur_floor] == 0) {
+                free_floor_layout(b->floors + cur_floor);
+            }
         }
+        free(job.results);
+        goto err_return;
     }
 
+    free(job.results);
     free(floor_rects);
     free(room_list);
 
     return b;
 
 err_return:
-    if (cur_floor != -1) {
-        do {
-            pb_floor* f = b->floors + cur_floor;
-            size_t cur_room;
-            for (cur_room = 0; cur_room < f->num_rooms; ++cur_room) {
-                pb_shape2D_free(&f->rooms[cur_room].shape);
-                pb_vector_free(&f->rooms[cur_room].walls);
-                if (added_doors) {
-                    free(f->rooms[cur_room].doors);
-                }
-                if (added_windows) {
-                    free(f->rooms[cur_room].windows);
-                }
-            }
-
-            if (added_doors) {
-                free(f->doors);
-            }
-            if (added_windows) {
-                free(f->windows);
-            }
-
-            /* All floors before this one finished successfully */
-            added_windows = 1;
-            added_doors = 1;
-        } while(cur_floor--);
-    }
-    free(b->floors);
-    free(b);
+    free_failed_building(b);
     free(floor_rects);
     free(room_list);
     return NULL;
 }
 
-
 PB_DECLSPEC void PB_CALL pb_sq_house_free_room(pb_room const* room) {
     return;
 }
@@ -0,0 +1,110 @@
+#include <pb/sq_house.h>
+#include <pb/extrusion.h>
+#include <pb/util/rng/rng.h>
+#include <pb/util/thread_pool/thread_pool.h>
+#include <stdlib.h>
+
+/* Per-worker scratch state. Workers only ever touch their own entry, which is padded to a cache line so that
+ * updating it doesn't contend with neighbouring workers. */
+typedef struct {
+    pb_rng rng;
+    size_t num_failed;
+    char pad[64];
+} pb_sq_house_batch_worker;
+
+typedef struct {
+    pb_sq_house_house_spec* specs;
+    pb_hashmap* room_specs;
+    uint64_t const* seeds;
+    pb_sq_house_batch_extrusion const* extrusion;
+    pb_building** out_buildings;
+    pb_extruded_floor*** out_meshes;
+    pb_sq_house_batch_worker* workers;
+} pb_sq_house_batch_job;
+
+static void PB_UTIL_CALL generate_house(size_t index, size_t worker, void* param) {
+    pb_sq_house_batch_job* job = (pb_sq_house_batch_job*)param;
+    pb_sq_house_batch_worker* w = job->workers + worker;
+    pb_building* b;
+
+    pb_rng_seed(&w->rng, job->seeds[index]);
+    b = pb_sq_house_ex(job->specs + index, job->room_specs, &w->rng);
+    job->out_buildings[index] = b;
+
+    if (!b) {
+        if (job->out_meshes) {
+            job->out_meshes[index] = NULL;
+        }
+        ++w->num_failed;
+        return;
+    }
+
+    if (job->out_meshes) {
+        pb_sq_house_batch_extrusion const* e = job->extrusion;
+        pb_extruded_floor** floors = pb_extrude_building(b, e->floor_height, e->door_height, e->window_height,
+                                                         e->door_extruder, e->window_extruder,
+                                                         e->door_extruder_param, e->window_extruder_param);
+        job->out_meshes[index] = floors;
+
+        if (!floors) {
+            pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+            free(b);
+            job->out_buildings[index] = NULL;
+            ++w->num_failed;
+        }
+    }
+}
+
+PB_DECLSPEC int PB_CALL pb_sq_house_batch(pb_sq_house_house_spec* specs, pb_hashmap* room_specs, uint64_t const* seeds,
+                                          size_t n, pb_sq_house_batch_extrusion const* extrusion,
+                                          pb_building** out_buildings, pb_extruded_floor*** out_meshes) {
+    pb_sq_house_batch_job job;
+    pb_thread_pool* pool;
+    size_t num_workers;
+    size_t num_failed = 0;
+    size_t i;
+
+    /* There's nothing to extrude with */
+    if (out_meshes && !extrusion) {
+        return -1;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+    /* No point in starting more threads than there are houses */
+    num_workers = pb_thread_pool_hardware_threads();
+    if (num_workers > n) {
+        num_workers = n;
+    }
+
+    pool = pb_thread_pool_create(num_workers);
+    if (!pool) {
+        return -1;
+    }
+
+    job.workers = calloc(num_workers, sizeof(pb_sq_house_batch_worker));
+    if (!job.workers) {
+        pb_thread_pool_free(pool);
+        return -1;
+    }
+
+    job.specs = specs;
+    job.room_specs = room_specs;
+    job.seeds = seeds;
+    job.extrusion = extrusion;
+    job.out_buildings = out_buildings;
+    job.out_meshes = out_meshes;
+
+    pb_thread_pool_run(pool, n, generate_house, &job);
+
+    for (i = 0; i < num_workers; ++i) {
+        num_failed += job.workers[i].num_failed;
+    }
+
+    free(job.workers);
+    pb_thread_pool_free(pool);
+
+    return num_failed == 0 ? 0 : -1;
+}
@@ -0,0 +1,146 @@
+#include <pb/util/arena/arena.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t const PB_ARENA_DEFAULT_SIZE = 4096;
+
+struct pb_arena_block {
+    pb_arena_block* next; /* The previously allocated block */
+    size_t size;          /* The size of the block's data */
+    size_t used;          /* The number of chars of the block's data in use */
+    int is_embedded;      /* Whether the block was allocated along with the arena itself */
+    void* base;           /* The pointer to pass to free to release the block */
+};
+
+#define PB_ARENA_ROUND_UP(size) (((size) + PB_ARENA_ALIGNMENT - 1) & ~(size_t)(PB_ARENA_ALIGNMENT - 1))
+
+/* Headers are padded so that each block's data starts on an aligned address */
+#define PB_ARENA_HEADER_SIZE PB_ARENA_ROUND_UP(sizeof(pb_arena))
+#define PB_ARENA_BLOCK_HEADER_SIZE PB_ARENA_ROUND_UP(sizeof(pb_arena_block))
+
+static char* block_data(pb_arena_block* block) {
+    return (char*)block + PB_ARENA_BLOCK_HEADER_SIZE;
+}
+
+PB_UTIL_DECLSPEC pb_arena* PB_UTIL_CALL pb_arena_create(size_t init_size) {
+    pb_arena* arena;
+    pb_arena_block* block;
+
+    init_size = PB_ARENA_ROUND_UP(init_size == 0 ? PB_ARENA_DEFAULT_SIZE : init_size);
+
+    arena = malloc(PB_ARENA_HEADER_SIZE + PB_ARENA_BLOCK_HEADER_SIZE + init_size);
+    if (!arena) {
+        return NULL;
+    }
+
+    block = (pb_arena_block*)((char*)arena + PB_ARENA_HEADER_SIZE);
+    block->next = NULL;
+    block->size = init_size;
+    block->used = 0;
+    block->is_embedded = 1;
+    block->base = arena;
+
+    arena->head = block;
+    arena->next_block_size = init_size * 2;
+
+    return arena;
+}
+
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_arena_alloc(pb_arena* arena, size_t size) {
+    pb_arena_block* block = arena->head;
+    void* result;
+
+    size = PB_ARENA_ROUND_UP(size);
+
+    if (block->size - block->used < size) {
+        size_t new_size = arena->next_block_size;
+        while (new_size < size) {
+            new_size *= 2;
+        }
+
+        block = malloc(PB_ARENA_BLOCK_HEADER_SIZE + new_size);
+        if (!block) {
+            return NULL;
+        }
+        block->next = arena->head;
+        block->size = new_size;
+        block->used = 0;
+        block->is_embedded = 0;
+        block->base = block;
+
+        arena->head = block;
+        arena->next_block_size = new_size * 2;
+    }
+
+    result = block_data(block) + block->used;
+    block->used += size;
+    return result;
+}
+
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_arena_realloc(pb_arena* arena, void* ptr, size_t old_size, size_t size) {
+    pb_arena_block* block = arena->head;
+    size_t old_rounded = PB_ARENA_ROUND_UP(old_size);
+    size_t rounded = PB_ARENA_ROUND_UP(size);
+    void* result;
+
+    if (!ptr) {
+        return pb_arena_alloc(arena, size);
+    } else if (rounded <= old_rounded) {
+        return ptr;
+    }
+
+    /* The most recent allocation can be grown in place if its block has room */
+    if ((char*)ptr + old_rounded == block_data(block) + block->used &&
+        block->size - block->used >= rounded - old_rounded) {
+        block->used += rounded - old_rounded;
+        return ptr;
+    }
+
+    result = pb_arena_alloc(arena, size);
+    if (!result) {
+        return NULL;
+    }
+    memcpy(result, ptr, old_size);
+    return result;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_merge(pb_arena* dst, pb_arena* src) {
+    pb_arena_block* last = src->head;
+
+    while (!last->is_embedded) {
+        last = last->next;
+    }
+
+    /* src's embedded block becomes an ordinary block of dst, freed through src's own allocation. Chaining src's blocks
+     * in front of dst's keeps dst's embedded block last. */
+    last->is_embedded = 0;
+    last->next = dst->head;
+    dst->head = src->head;
+    if (dst->next_block_size < src->next_block_size) {
+        dst->next_block_size = src->next_block_size;
+    }
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_reset(pb_arena* arena) {
+    pb_arena_block* block = arena->head;
+
+    /* The embedded block is always the last in the chain */
+    while (!block->is_embedded) {
+        pb_arena_block* next = block->next;
+        free(block->base);
+        block = next;
+    }
+
+    block->used = 0;
+    arena->head = block;
+    arena->next_block_size = block->size * 2;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_arena_free(pb_arena* arena) {
+    if (!arena) {
+        return;
+    }
+
+    pb_arena_reset(arena);
+    free(arena);
+}
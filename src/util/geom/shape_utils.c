@@ -1,6 +1,10 @@
 #include <pb/util/geom/shape_utils.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pb/util/geom/types.h>
+#include <pb/util/float_utils.h>
 
 PB_UTIL_DECLSPEC int pb_shape2D_init(pb_shape2D* shape, unsigned int num_points) {
 
@@ -39,6 +43,7 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_shape3D_init(pb_shape3D* shape, unsigned in
         return NULL;
     }
     shape->num_tris = num_tris;
+    pb_bounds3D_clear(&shape->bounds);
 
     return 0;
 }
@@ -60,3 +65,361 @@ PB_UTIL_DECLSPEC pb_shape3D* pb_shape3D_create(unsigned int num_tris) {
 PB_UTIL_DECLSPEC void pb_shape3D_free(pb_shape3D* shape) {
     free(shape->tris);
 }
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_bounds3D_clear(pb_bounds3D* bounds) {
+    bounds->min.x = bounds->min.y = bounds->min.z = INFINITY;
+    bounds->max.x = bounds->max.y = bounds->max.z = -INFINITY;
+    bounds->centre.x = bounds->centre.y = bounds->centre.z = 0.f;
+    bounds->radius = 0.f;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_bounds3D_add_point(pb_bounds3D* bounds, pb_point3D const* p) {
+    bounds->min.x = p->x < bounds->min.x ? p->x : bounds->min.x;
+    bounds->min.y = p->y < bounds->min.y ? p->y : bounds->min.y;
+    bounds->min.z = p->z < bounds->min.z ? p->z : bounds->min.z;
+    bounds->max.x = p->x > bounds->max.x ? p->x : bounds->max.x;
+    bounds->max.y = p->y > bounds->max.y ? p->y : bounds->max.y;
+    bounds->max.z = p->z > bounds->max.z ? p->z : bounds->max.z;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_shape3D_get_bounds(pb_shape3D const* shape, pb_bounds3D* bounds) {
+    size_t num_verts = shape->num_tris * 3;
+    float max_dist_sq = 0.f;
+    size_t i;
+
+    pb_bounds3D_clear(bounds);
+    if (num_verts == 0) {
+        return;
+    }
+
+    for (i = 0; i < num_verts; ++i) {
+        pb_point3D p = {shape->tris[i].x + shape->pos.x,
+                        shape->tris[i].y + shape->pos.y,
+                        shape->tris[i].z + shape->pos.z};
+        pb_bounds3D_add_point(bounds, &p);
+    }
+
+    bounds->centre.x = (bounds->min.x + bounds->max.x) / 2.f;
+    bounds->centre.y = (bounds->min.y + bounds->max.y) / 2.f;
+    bounds->centre.z = (bounds->min.z + bounds->max.z) / 2.f;
+
+    /* The vertices are still in the cache, so the sphere can be tight rather than just enclosing the box */
+    for (i = 0; i < num_verts; ++i) {
+        float dx = shape->tris[i].x + shape->pos.x - bounds->centre.x;
+        float dy = shape->tris[i].y + shape->pos.y - bounds->centre.y;
+        float dz = shape->tris[i].z + shape->pos.z - bounds->centre.z;
+        float dist_sq = dx * dx + dy * dy + dz * dz;
+        max_dist_sq = dist_sq > max_dist_sq ? dist_sq : max_dist_sq;
+    }
+    bounds->radius = sqrtf(max_dist_sq);
+}
+
+/* The number of floats in a pb_vert3D */
+#define WELD_COMPONENTS (sizeof(pb_vert3D) / sizeof(float))
+#define WELD_EMPTY UINT32_MAX
+
+/**
+ * Computes the fuzzed bits of each of a vertex's components, which are equal for two vertices exactly when
+ * pb_float_approx_eq holds for every component.
+ */
+static void weld_keys(pb_vert3D const* v, size_t fuzz_bits, uint32_t* keys) {
+    float const* components = (float const*)v;
+    size_t i;
+
+    for (i = 0; i < WELD_COMPONENTS; ++i) {
+        /* Adding 0 turns -0 into +0 so that normals like {-0, 1, 0} weld with {0, 1, 0} */
+        keys[i] = pb_fuzz_float(components[i] + 0.f, fuzz_bits);
+    }
+}
+
+static uint32_t weld_hash(uint32_t const* keys) {
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < WELD_COMPONENTS; ++i) {
+        hash = (hash ^ keys[i]) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_weld_verts(pb_vert3D const* verts, size_t num_verts, size_t fuzz_bits,
+                                                pb_vert3D* out_verts, void* out_indices, size_t index_size,
+                                                size_t* out_num_verts) {
+    uint32_t keys[WELD_COMPONENTS];
+    uint32_t other_keys[WELD_COMPONENTS];
+    uint32_t* table;
+    size_t cap = 16;
+    size_t num_unique = 0;
+    size_t i;
+
+    if ((index_size != 2 && index_size != 4) || (index_size == 2 && num_verts > 65536)) {
+        return -1;
+    }
+
+    /* Keep the table at most half full so that probe sequences stay short */
+    while (cap < num_verts * 2) {
+        cap *= 2;
+    }
+
+    table = malloc(sizeof(uint32_t) * cap);
+    if (!table) {
+        return -1;
+    }
+    for (i = 0; i < cap; ++i) {
+        table[i] = WELD_EMPTY;
+    }
+
+    for (i = 0; i < num_verts; ++i) {
+        size_t pos;
+        uint32_t index;
+
+        weld_keys(verts + i, fuzz_bits, keys);
+        pos = weld_hash(keys) & (cap - 1);
+
+        while ((index = table[pos]) != WELD_EMPTY) {
+            weld_keys(out_verts + index, fuzz_bits, other_keys);
+            if (memcmp(keys, other_keys, sizeof(keys)) == 0) {
+                break;
+            }
+            pos = (pos + 1) & (cap - 1);
+        }
+
+        if (index == WELD_EMPTY) {
+            index = (uint32_t)num_unique++;
+            out_verts[index] = verts[i];
+            table[pos] = index;
+        }
+
+        if (index_size == 2) {
+            ((uint16_t*)out_indices)[i] = (uint16_t)index;
+        } else {
+            ((uint32_t*)out_indices)[i] = index;
+        }
+    }
+
+    free(table);
+    *out_num_verts = num_unique;
+    return 0;
+}
+
+static size_t get_index(void const* indices, size_t index_size, size_t i) {
+    return index_size == 2 ? ((uint16_t const*)indices)[i] : ((uint32_t const*)indices)[i];
+}
+
+static void set_index(void* indices, size_t index_size, size_t i, size_t index) {
+    if (index_size == 2) {
+        ((uint16_t*)indices)[i] = (uint16_t)index;
+    } else {
+        ((uint32_t*)indices)[i] = (uint32_t)index;
+    }
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_vertex_cache_misses(void const* indices, size_t num_indices, size_t index_size,
+                                                         size_t num_verts, size_t cache_size, size_t* out_misses) {
+    /* A vertex is in the cache if fewer than cache_size misses have happened since it was loaded. Stamps start at 0,
+     * so time starts after cache_size to make every vertex a miss the first time it's used. */
+    size_t* stamps = calloc(num_verts ? num_verts : 1, sizeof(size_t));
+    size_t time = cache_size + 1;
+    size_t misses = 0;
+    size_t i;
+
+    if (!stamps) {
+        return -1;
+    }
+
+    for (i = 0; i < num_indices; ++i) {
+        size_t v = get_index(indices, index_size, i);
+        if (time - stamps[v] > cache_size) {
+            stamps[v] = time++;
+            ++misses;
+        }
+    }
+
+    free(stamps);
+    *out_misses = misses;
+    return 0;
+}
+
+/* Scratch state for pb_optimize_vertex_cache */
+typedef struct {
+    size_t* adjacency_offsets; /* Where each vertex's triangles start in adjacency (num_verts + 1 elements) */
+    size_t* adjacency;         /* The triangles using each vertex */
+    size_t* live;              /* The number of unemitted triangles using each vertex */
+    size_t* cache_time;        /* When each vertex was last loaded into the cache */
+    size_t* dead_end;          /* A stack of recently used vertices, to restart from when fanning gets stuck */
+    size_t* candidates;        /* The vertices of the triangles emitted around the current fanning vertex */
+    unsigned char* emitted;    /* Whether each triangle has been emitted */
+} tipsify_scratch;
+
+static void tipsify_scratch_free(tipsify_scratch* s) {
+    free(s->adjacency_offsets);
+    free(s->adjacency);
+    free(s->live);
+    free(s->cache_time);
+    free(s->dead_end);
+    free(s->candidates);
+    free(s->emitted);
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_optimize_vertex_cache(void* indices, size_t num_indices, size_t index_size,
+                                                           size_t num_verts, size_t cache_size) {
+    tipsify_scratch s;
+    size_t* out_tris = NULL;
+    size_t num_tris = num_indices / 3;
+    size_t num_out = 0;
+    size_t dead_end_size = 0;
+    size_t time = cache_size + 1;
+    size_t cursor = 0;
+    size_t i, j;
+    size_t fanning;
+
+    if (num_tris == 0 || num_verts == 0) {
+        return 0;
+    }
+
+    s.adjacency_offsets = calloc(num_verts + 1, sizeof(size_t));
+    s.adjacency = malloc(sizeof(size_t) * num_tris * 3);
+    s.live = calloc(num_verts, sizeof(size_t));
+    s.cache_time = calloc(num_verts, sizeof(size_t));
+    s.dead_end = malloc(sizeof(size_t) * num_tris * 3);
+    s.candidates = malloc(sizeof(size_t) * num_tris * 3);
+    s.emitted = calloc(num_tris, 1);
+    out_tris = malloc(sizeof(size_t) * num_tris);
+    if (!s.adjacency_offsets || !s.adjacency || !s.live || !s.cache_time || !s.dead_end || !s.candidates ||
+        !s.emitted || !out_tris) {
+        tipsify_scratch_free(&s);
+        free(out_tris);
+        return -1;
+    }
+
+    /* Build the vertex => triangle adjacency with a counting sort */
+    for (i = 0; i < num_tris * 3; ++i) {
+        ++s.live[get_index(indices, index_size, i)];
+    }
+    for (i = 0; i < num_verts; ++i) {
+        s.adjacency_offsets[i + 1] = s.adjacency_offsets[i] + s.live[i];
+    }
+    memcpy(s.cache_time, s.adjacency_offsets, sizeof(size_t) * num_verts);
+    for (i = 0; i < num_tris * 3; ++i) {
+        size_t v = get_index(indices, index_size, i);
+        s.adjacency[s.cache_time[v]++] = i / 3;
+    }
+    memset(s.cache_time, 0, sizeof(size_t) * num_verts);
+
+    fanning = get_index(indices, index_size, 0);
+    while (fanning != (size_t)-1) {
+        size_t num_candidates = 0;
+        size_t best = (size_t)-1;
+        size_t best_priority = 0;
+
+        /* Emit every remaining triangle around the fanning vertex */
+        for (i = s.adjacency_offsets[fanning]; i < s.adjacency_offsets[fanning + 1]; ++i) {
+            size_t tri = s.adjacency[i];
+            if (s.emitted[tri]) {
+                continue;
+            }
+
+            for (j = 0; j < 3; ++j) {
+                size_t v = get_index(indices, index_size, tri * 3 + j);
+                s.dead_end[dead_end_size++] = v;
+                s.candidates[num_candidates++] = v;
+                --s.live[v];
+                if (time - s.cache_time[v] > cache_size) {
+                    s.cache_time[v] = time++;
+                }
+            }
+            s.emitted[tri] = 1;
+            out_tris[num_out++] = tri;
+        }
+
+        /* Prefer the candidate that will still be in the cache after its remaining triangles are emitted, and that
+         * has been in the cache the longest */
+        for (i = 0; i < num_candidates; ++i) {
+            size_t v = s.candidates[i];
+            if (s.live[v] > 0 && time - s.cache_time[v] + 2 * s.live[v] <= cache_size) {
+                size_t priority = time - s.cache_time[v];
+                if (priority > best_priority) {
+                    best = v;
+                    best_priority = priority;
+                }
+            }
+        }
+
+        /* Otherwise, restart from a recently used vertex, or failing that, the next vertex in input order */
+        if (best == (size_t)-1) {
+            while (dead_end_size > 0) {
+                size_t v = s.dead_end[--dead_end_size];
+                if (s.live[v] > 0) {
+                    best = v;
+                    break;
+                }
+            }
+        }
+        while (best == (size_t)-1 && cursor < num_verts) {
+            if (s.live[cursor] > 0) {
+                best = cursor;
+            }
+            ++cursor;
+        }
+
+        fanning = best;
+    }
+
+    /* Write the triangles back in their new order, reusing the adjacency array as the old indices */
+    for (i = 0; i < num_tris * 3; ++i) {
+        s.adjacency[i] = get_index(indices, index_size, i);
+    }
+    for (i = 0; i < num_out; ++i) {
+        for (j = 0; j < 3; ++j) {
+            set_index(indices, index_size, i * 3 + j, s.adjacency[out_tris[i] * 3 + j]);
+        }
+    }
+
+    tipsify_scratch_free(&s);
+    free(out_tris);
+    return 0;
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_optimize_vertex_fetch(pb_vert3D* verts, size_t num_verts, void* indices,
+                                                           size_t num_indices, size_t index_size) {
+    size_t* remap;
+    pb_vert3D* old_verts;
+    size_t next = 0;
+    size_t i;
+
+    if (num_verts == 0) {
+        return 0;
+    }
+
+    remap = malloc(sizeof(size_t) * num_verts);
+    old_verts = malloc(sizeof(pb_vert3D) * num_verts);
+    if (!remap || !old_verts) {
+        free(remap);
+        free(old_verts);
+        return -1;
+    }
+
+    memcpy(old_verts, verts, sizeof(pb_vert3D) * num_verts);
+    for (i = 0; i < num_verts; ++i) {
+        remap[i] = (size_t)-1;
+    }
+
+    for (i = 0; i < num_indices; ++i) {
+        size_t v = get_index(indices, index_size, i);
+        if (remap[v] == (size_t)-1) {
+            remap[v] = next++;
+        }
+        set_index(indices, index_size, i, remap[v]);
+    }
+
+    for (i = 0; i < num_verts; ++i) {
+        if (remap[i] == (size_t)-1) {
+            remap[i] = next++;
+        }
+        verts[remap[i]] = old_verts[i];
+    }
+
+    free(remap);
+    free(old_verts);
+    return 0;
+}
@@ -1,9 +1,28 @@
 #include <stdlib.h>
 #include <string.h>
+#include <pb/util/arena/arena.h>
 #include <pb/util/graph/graph.h>
 #include <pb/util/hashmap/hash_utils.h>
 #include <pb/util/pair/pair.h>
 
+/* Edge lists start with room for 2 edges and double from there, so size class i holds lists of 2 << i edges */
+#define PB_GRAPH_POOL_INIT_EDGES 2
+#define PB_GRAPH_POOL_NUM_CLASSES 32
+
+typedef struct pb_graph_free_item pb_graph_free_item;
+
+/* A vertex, edge or edge list that has been released back to a pool, and is linked into one of its free lists */
+struct pb_graph_free_item {
+    pb_graph_free_item* next;
+};
+
+struct pb_graph_pool {
+    pb_arena* arena;
+    pb_graph_free_item* free_vertices;
+    pb_graph_free_item* free_edges;
+    pb_graph_free_item* free_edge_lists[PB_GRAPH_POOL_NUM_CLASSES];
+};
+
 static void pb_graph_remove_edge_internal(pb_graph* graph, pb_edge* edge);
 
 PB_UTIL_DECLSPEC pb_vertex* PB_UTIL_CALL pb_vertex_create(void* data) {
@@ -80,99 +99,260 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_vertex_remove_edge(pb_vertex *start, pb_edg
     return 0;
 }
 
-static uint32_t edge_hash(void const* edge) {
-    pb_edge* actual = (pb_edge*)edge;
-    uint32_t hash = 23;
+/**
+ * Takes an item from a pool's free list, or allocates a new one from its arena if the list is empty.
+ *
+ * @param pool      The pool from which to allocate.
+ * @param free_list The free list holding items of the given size.
+ * @param size      The item's size.
+ * @return The item on success, NULL on failure (out of memory).
+ */
+static void* pool_alloc(pb_graph_pool* pool, pb_graph_free_item** free_list, size_t size) {
+    pb_graph_free_item* item = *free_list;
+    if (item) {
+        *free_list = item->next;
+        return item;
+    }
 
-    /* Hash the addresses; every edge will have a different pair of vertices, so the combination of
-     * addresses will identify the edge */
-    hash += 31 * pb_murmurhash3((void*)&actual->from, (int)sizeof(pb_vertex*));
-    hash += 31 * pb_murmurhash3((void*)&actual->to, (int)sizeof(pb_vertex*));
+    return pb_arena_alloc(pool->arena, size);
+}
 
-    return hash;
+static void pool_release(pb_graph_free_item** free_list, void* mem) {
+    pb_graph_free_item* item = (pb_graph_free_item*)mem;
+    item->next = *free_list;
+    *free_list = item;
 }
 
-static int edge_eq(void const* edge1, void const* edge2) {
-    pb_edge* actual1 = (pb_edge*)edge1;
-    pb_edge* actual2 = (pb_edge*)edge2;
+static size_t edge_list_class(size_t capacity) {
+    size_t size_class = 0;
+    while (((size_t)PB_GRAPH_POOL_INIT_EDGES << size_class) < capacity) {
+        ++size_class;
+    }
+
+    return size_class;
+}
+
+static pb_vertex* graph_vertex_create(pb_graph* graph, void* data) {
+    pb_graph_pool* pool = graph->pool;
+    pb_vertex* vert;
+
+    if (!pool) {
+        return pb_vertex_create(data);
+    }
+
+    vert = pool_alloc(pool, &pool->free_vertices, sizeof(pb_vertex));
+    if (!vert) {
+        return NULL;
+    }
+
+    vert->edges = pool_alloc(pool, pool->free_edge_lists, sizeof(pb_edge*) * PB_GRAPH_POOL_INIT_EDGES);
+    if (!vert->edges) {
+        pool_release(&pool->free_vertices, vert);
+        return NULL;
+    }
+
+    vert->edges_capacity = PB_GRAPH_POOL_INIT_EDGES;
+    vert->edges_size = 0;
+    vert->in_degree = 0;
+    vert->data = data;
+    return vert;
+}
+
+static void graph_vertex_free(pb_graph* graph, pb_vertex* vert) {
+    pb_graph_pool* pool = graph->pool;
+
+    if (!pool) {
+        pb_vertex_free(vert);
+        return;
+    }
 
-    return actual1->from == actual2->from && actual1->to == actual2->to;
+    pool_release(pool->free_edge_lists + edge_list_class(vert->edges_capacity), vert->edges);
+    pool_release(&pool->free_vertices, vert);
+}
+
+static int graph_vertex_add_edge(pb_graph* graph, pb_vertex* vert, pb_edge* edge) {
+    pb_graph_pool* pool = graph->pool;
+
+    if (!pool) {
+        return pb_vertex_add_edge(vert, edge);
+    }
+
+    if (vert->edges_size == vert->edges_capacity) {
+        size_t size_class = edge_list_class(vert->edges_capacity) + 1;
+        pb_edge** new_edges;
+
+        if (size_class == PB_GRAPH_POOL_NUM_CLASSES) {
+            return -1;
+        }
+
+        new_edges = pool_alloc(pool, pool->free_edge_lists + size_class, sizeof(pb_edge*) * vert->edges_capacity * 2);
+        if (!new_edges) {
+            return -1;
+        }
+
+        memcpy(new_edges, vert->edges, sizeof(pb_edge*) * vert->edges_size);
+        pool_release(pool->free_edge_lists + size_class - 1, vert->edges);
+        vert->edges = new_edges;
+        vert->edges_capacity = vert->edges_capacity * 2;
+    }
+
+    vert->edges[vert->edges_size] = edge;
+    vert->edges_size++;
+    return 0;
+}
+
+static pb_edge* graph_edge_alloc(pb_graph* graph) {
+    pb_graph_pool* pool = graph->pool;
+    return pool ? pool_alloc(pool, &pool->free_edges, sizeof(pb_edge)) : malloc(sizeof(pb_edge));
+}
+
+static void graph_edge_free(pb_graph* graph, pb_edge* edge) {
+    if (graph->pool) {
+        pool_release(&graph->pool->free_edges, edge);
+    } else {
+        free(edge);
+    }
+}
+
+static pb_edge_key get_edge_key(pb_edge const* edge) {
+    pb_edge_key key;
+    key.from = edge->from;
+    key.to = edge->to;
+    return key;
 }
 
 PB_UTIL_DECLSPEC pb_graph* PB_UTIL_CALL pb_graph_create(pb_hash_func id_hash, pb_hash_eq_func id_eq) {
     pb_graph* graph = malloc(sizeof(pb_graph));
-    pb_hashmap* vertices;
-    pb_hashmap* edges;
-    
+    pb_ordered_map* vertices;
+
     if (!graph) {
         return NULL;
     }
+    graph->pool = NULL;
 
-    vertices = pb_hashmap_create(id_hash, id_eq);
+    vertices = pb_ordered_map_create(id_hash, id_eq);
     if (vertices == NULL) {
         free(graph);
         return NULL;
     }
 
-    edges = pb_hashmap_create(edge_hash, edge_eq);
-    if (!edges) {
-        pb_hashmap_free(vertices);
+    if (pb_edge_map_init(&graph->edges) == -1) {
+        pb_ordered_map_free(vertices);
         free(graph);
         return NULL;
     }
 
     graph->vertices = vertices;
-    graph->edges = edges;
 
     return graph;
 }
 
+PB_UTIL_DECLSPEC pb_graph* PB_UTIL_CALL pb_graph_create_pooled(pb_hash_func id_hash, pb_hash_eq_func id_eq) {
+    pb_graph* graph;
+    pb_graph_pool* pool = calloc(1, sizeof(pb_graph_pool));
+
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->arena = pb_arena_create(0);
+    if (!pool->arena) {
+        free(pool);
+        return NULL;
+    }
+
+    graph = pb_graph_create(id_hash, id_eq);
+    if (!graph) {
+        pb_arena_free(pool->arena);
+        free(pool);
+        return NULL;
+    }
+
+    graph->pool = pool;
+    return graph;
+}
+
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_add_vertex(pb_graph* graph, void const* vert_id, void* data) {
-    pb_vertex* vert = pb_vertex_create(data);
+    pb_vertex* vert = graph_vertex_create(graph, data);
     if (!vert) {
         return -1;
     }
 
-    if (pb_hashmap_put(graph->vertices, vert_id, (void*)vert) == -1) {
-        pb_vertex_free(vert);
+    if (pb_ordered_map_put(graph->vertices, vert_id, (void*)vert) == -1) {
+        graph_vertex_free(graph, vert);
         return -1;
     } else {
         return 0;
     }
 }
 
+/**
+ * Collects the edges into a vertex from other vertices.
+ *
+ * @param graph     The graph containing the vertex.
+ * @param vert      The vertex whose in-edges should be found.
+ * @param in_edges  Holds at least vert->in_degree edges.
+ * @return The number of edges that were found.
+ */
+static size_t get_in_edges(pb_graph const* graph, pb_vertex const* vert, pb_edge** in_edges) {
+    pb_ordered_map const* vertices = graph->vertices;
+    size_t num_edges = 0;
+    size_t i, j;
+
+    for (i = 0; i < vertices->num_items && num_edges < vert->in_degree; ++i) {
+        pb_vertex const* from = (pb_vertex const*)vertices->items[i].entry.val;
+        if (vertices->items[i].removed || from == vert) {
+            continue;
+        }
+
+        for (j = 0; j < from->edges_size; ++j) {
+            if (from->edges[j]->to == vert) {
+                in_edges[num_edges++] = from->edges[j];
+            }
+        }
+    }
+
+    return num_edges;
+}
+
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_remove_vertex(pb_graph* graph, void const* vert_id) {
     pb_vertex* vert;
+    pb_edge** in_edges;
+    size_t num_in_edges;
     size_t i;
-    if (pb_hashmap_get(graph->vertices, vert_id, (void**)&vert) == -1) {
+    if (pb_ordered_map_get(graph->vertices, vert_id, (void**)&vert) == -1) {
         return -1; /* There was no vertex with the given ID in this graph */
     }
 
-    /* Decrease destination vertices' in-degree */
+    /* Find the edges to the given vertex first, since the other vertices' edge lists change as they're removed */
+    in_edges = malloc(sizeof(pb_edge*) * (vert->in_degree ? vert->in_degree : 1));
+    if (!in_edges) {
+        return -1;
+    }
+    num_in_edges = get_in_edges(graph, vert, in_edges);
+
+    /* Decrease destination vertices' in-degree and free the edges from the given vertex */
     for (i = 0; i < vert->edges_size; ++i) {
         vert->edges[i]->to->in_degree--;
-        pb_hashmap_remove(graph->edges, vert->edges[i]);
+        pb_edge_map_remove(&graph->edges, get_edge_key(vert->edges[i]));
+        graph_edge_free(graph, vert->edges[i]);
     }
 
-    /* Iterate over the edges list to remove all edges to the given vertex */
-    for (i = 0; i < graph->edges->cap; ++i) {
-        if (graph->edges->states[i] == FULL) {
-            pb_edge* edge = (pb_edge*)graph->edges->entries[i].val;
-            if (edge->to == vert) {
-                pb_graph_remove_edge_internal(graph, edge);
-            }
-        }
+    /* Remove all edges to the given vertex */
+    for (i = 0; i < num_in_edges; ++i) {
+        pb_graph_remove_edge_internal(graph, in_edges[i]);
     }
+    free(in_edges);
 
-    pb_hashmap_remove(graph->vertices, vert_id);
-    pb_vertex_free(vert);
+    pb_ordered_map_remove(graph->vertices, vert_id);
+    graph_vertex_free(graph, vert);
 
     return 0;
 }
 
 PB_UTIL_DECLSPEC pb_vertex const* PB_UTIL_CALL pb_graph_get_vertex(pb_graph const* graph, void const* vert_id) {
     pb_vertex* out;
-    if (pb_hashmap_get(graph->vertices, vert_id, (void**)&out) == -1) {
+    if (pb_ordered_map_get(graph->vertices, vert_id, (void**)&out) == -1) {
         return NULL;
     }
 
@@ -188,7 +368,7 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_add_edge(pb_graph *graph, void const*
         return -1;
     }
 
-    edge = malloc(sizeof(pb_edge));
+    edge = graph_edge_alloc(graph);
     if (!edge) {
         return -1;
     }
@@ -198,14 +378,14 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_add_edge(pb_graph *graph, void const*
     edge->to = to;
     edge->data = data;
 
-    if (pb_vertex_add_edge(from, edge) == -1) {
-        free(edge);
+    if (graph_vertex_add_edge(graph, from, edge) == -1) {
+        graph_edge_free(graph, edge);
         return -1;
     }
 
-    if (pb_hashmap_put(graph->edges, edge, edge) == -1) {
+    if (pb_edge_map_put(&graph->edges, get_edge_key(edge), edge) == -1) {
         pb_vertex_remove_edge(from, edge);
-        free(edge);
+        graph_edge_free(graph, edge);
         return -1;
     }
 
@@ -216,8 +396,8 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_add_edge(pb_graph *graph, void const*
 static void pb_graph_remove_edge_internal(pb_graph* graph, pb_edge* edge) {
     edge->to->in_degree--;
     pb_vertex_remove_edge(edge->from, edge);
-    pb_hashmap_remove(graph->edges, (void*)edge);
-    free(edge);
+    pb_edge_map_remove(&graph->edges, get_edge_key(edge));
+    graph_edge_free(graph, edge);
 }
 
 PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_remove_edge(pb_graph *graph, void const* from_id, void const* to_id) {
@@ -231,55 +411,75 @@ PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_graph_remove_edge(pb_graph *graph, void con
 PB_UTIL_DECLSPEC pb_edge const* PB_UTIL_CALL pb_graph_get_edge(pb_graph const* graph, void const* from_id, void const* to_id) {
     pb_vertex* from;
     pb_vertex* to;
-    pb_edge* out;
-    pb_edge temp;
+    pb_edge** out;
+    pb_edge_key key;
 
-    if (pb_hashmap_get(graph->vertices, from_id, (void**)&from) == -1 ||
-        pb_hashmap_get(graph->vertices, to_id, (void**)&to) == -1) {
+    if (pb_ordered_map_get(graph->vertices, from_id, (void**)&from) == -1 ||
+        pb_ordered_map_get(graph->vertices, to_id, (void**)&to) == -1) {
         return NULL;
     }
 
-    temp.from = from;
-    temp.to = to;
-
-    if (pb_hashmap_get(graph->edges, (void*)&temp, (void**)&out) == -1) {
-        return NULL;
-    }
+    key.from = from;
+    key.to = to;
 
-    return out;
+    out = pb_edge_map_get(&graph->edges, key);
+    return out ? *out : NULL;
 }
 
 static void free_hashed_vertex(pb_hashmap_entry* entry, void* unused) {
     pb_vertex_free((pb_vertex*)entry->val);
 }
 
-PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_free(pb_graph *graph) {
-    pb_hashmap_for_each(graph->vertices, free_hashed_vertex, NULL);
-    pb_hashmap_free(graph->vertices);
+/**
+ * Frees every vertex and edge in the graph without removing them from its maps. A pooled graph's vertices and edges
+ * are released along with its arena instead.
+ *
+ * @param graph The graph whose vertices and edges should be freed.
+ */
+static void free_vertices_and_edges(pb_graph* graph) {
+    size_t i;
 
-    pb_hashmap_for_each(graph->edges, pb_hashmap_free_entry_data, NULL);
-    pb_hashmap_free(graph->edges);
+    if (graph->pool) {
+        return;
+    }
 
-    free(graph);
+    pb_ordered_map_for_each(graph->vertices, free_hashed_vertex, NULL);
+    for (i = 0; i < graph->edges.cap; ++i) {
+        if (pb_map_ctrl_is_full(graph->edges.ctrl[i])) {
+            free(graph->edges.entries[i].val);
+        }
+    }
 }
 
-/**
- * Iterates over the edge hash map, calling a given pb_graph_edge_iterator_func on each edge.
- *
- * @param entry An entry from graph->edges.
- * @param param A pair containing the edge iterator function and the parameter supplied to it.
- */
-static void edge_hash_iterator(pb_hashmap_entry* entry, void* param) {
-    pb_pair* p = (pb_pair*)param;
-    pb_graph_edge_iterator_func f = (pb_graph_edge_iterator_func)p->first;
-    void* edge_param = p->second;
-    pb_edge* edge = entry->val;
-    
-    f(edge, edge_param);
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_clear(pb_graph* graph) {
+    pb_graph_pool* pool = graph->pool;
+
+    free_vertices_and_edges(graph);
+    if (pool) {
+        pb_arena_reset(pool->arena);
+        pool->free_vertices = NULL;
+        pool->free_edges = NULL;
+        memset(pool->free_edge_lists, 0, sizeof(pool->free_edge_lists));
+    }
+
+    pb_ordered_map_clear(graph->vertices);
+    pb_edge_map_clear(&graph->edges);
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_free(pb_graph *graph) {
+    free_vertices_and_edges(graph);
+    if (graph->pool) {
+        pb_arena_free(graph->pool->arena);
+        free(graph->pool);
+    }
+
+    pb_ordered_map_free(graph->vertices);
+    pb_edge_map_destroy(&graph->edges);
+    free(graph);
 }
 
 /**
- * Iterates over the vertex hash map, calling a given pb_graph_vertex_iterator_func on each entry.
+ * Iterates over the vertex map, calling a given pb_graph_vertex_iterator_func on each entry.
  *
  * @param entry An entry from graph->vertices.
  * @param param A pair containing the vertex iterator function and the parameter supplied to it.
@@ -296,13 +496,23 @@ static void vertex_hash_iterator(pb_hashmap_entry* entry, void* param) {
 }
 
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_for_each_edge(pb_graph* graph, pb_graph_edge_iterator_func func, void* param) {
-    pb_pair params = { func, param };
-    pb_hashmap_for_each(graph->edges, edge_hash_iterator, &params);
+    pb_ordered_map const* vertices = graph->vertices;
+    size_t i, j;
+
+    /* Go through each vertex's edges in order rather than the edge map, so that the order is the same every time */
+    for (i = 0; i < vertices->num_items; ++i) {
+        pb_vertex const* vert = (pb_vertex const*)vertices->items[i].entry.val;
+        if (!vertices->items[i].removed) {
+            for (j = 0; j < vert->edges_size; ++j) {
+                func(vert->edges[j], param);
+            }
+        }
+    }
 }
 
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_for_each_vertex(pb_graph* graph, pb_graph_vertex_iterator_func func, void* param) {
     pb_pair params = { func, param };
-    pb_hashmap_for_each(graph->vertices, vertex_hash_iterator, &params);
+    pb_ordered_map_for_each(graph->vertices, vertex_hash_iterator, &params);
 }
 
 PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_free_vertex_data(void const* vert_id, pb_vertex* vert, void* unused) {
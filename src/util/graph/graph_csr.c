@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <pb/util/graph/graph_csr.h>
+#include <pb/util/hashmap/typed_map.h>
+
+/**
+ * Allocates the frozen graph's lists for its num_vertices and num_edges.
+ *
+ * @return 0 on success, -1 on OOM (in which case whatever was allocated is left for pb_graph_csr_free).
+ */
+static int alloc_lists(pb_graph_csr* csr, pb_graph const* graph) {
+    /* Always allocate at least one of each so that a NULL list means that allocation failed */
+    size_t num_vertices = csr->num_vertices ? csr->num_vertices : 1;
+    size_t num_edges = csr->num_edges ? csr->num_edges : 1;
+
+    csr->vert_ids = malloc(sizeof(void const*) * num_vertices);
+    csr->vert_data = malloc(sizeof(void*) * num_vertices);
+    csr->edge_offsets = malloc(sizeof(size_t) * (num_vertices + 1));
+    csr->edge_targets = malloc(sizeof(size_t) * num_edges);
+    csr->edge_weights = malloc(sizeof(float) * num_edges);
+    csr->edge_data = malloc(sizeof(void*) * num_edges);
+    csr->id_index = pb_hashmap_create(graph->vertices->hash, graph->vertices->key_eq);
+
+    if (!csr->vert_ids || !csr->vert_data || !csr->edge_offsets || !csr->edge_targets || !csr->edge_weights ||
+        !csr->edge_data || !csr->id_index) {
+        return -1;
+    }
+
+    return pb_hashmap_reserve(csr->id_index, csr->num_vertices);
+}
+
+PB_UTIL_DECLSPEC pb_graph_csr* PB_UTIL_CALL pb_graph_freeze(pb_graph const* graph) {
+    pb_ordered_map const* vertices = graph->vertices;
+    pb_graph_csr* csr = calloc(1, sizeof(pb_graph_csr));
+    pb_ptr_index_map vert_index;
+    size_t num_vertices = 0;
+    size_t num_edges = 0;
+    size_t i, j;
+
+    if (!csr) {
+        return NULL;
+    }
+
+    if (pb_ptr_index_map_init(&vert_index) == -1) {
+        free(csr);
+        return NULL;
+    }
+
+    csr->num_vertices = vertices->size;
+    csr->num_edges = graph->edges.size;
+    if (alloc_lists(csr, graph) == -1 || pb_ptr_index_map_reserve(&vert_index, vertices->size) == -1) {
+        goto err_return;
+    }
+
+    /* Number the vertices first so that the edges' targets can be looked up */
+    for (i = 0; i < vertices->num_items; ++i) {
+        pb_ordered_map_item const* item = vertices->items + i;
+        if (!item->removed) {
+            csr->vert_ids[num_vertices] = item->entry.key;
+            csr->vert_data[num_vertices] = ((pb_vertex const*)item->entry.val)->data;
+            if (pb_ptr_index_map_put(&vert_index, item->entry.val, num_vertices) == -1 ||
+                pb_hashmap_put(csr->id_index, item->entry.key, csr->vert_ids + num_vertices) == -1) {
+                goto err_return;
+            }
+            ++num_vertices;
+        }
+    }
+
+    num_vertices = 0;
+    for (i = 0; i < vertices->num_items; ++i) {
+        pb_vertex const* vert = (pb_vertex const*)vertices->items[i].entry.val;
+        if (vertices->items[i].removed) {
+            continue;
+        }
+
+        csr->edge_offsets[num_vertices++] = num_edges;
+        for (j = 0; j < vert->edges_size; ++j) {
+            pb_edge const* edge = vert->edges[j];
+            csr->edge_targets[num_edges] = *pb_ptr_index_map_get(&vert_index, edge->to);
+            csr->edge_weights[num_edges] = edge->weight;
+            csr->edge_data[num_edges] = edge->data;
+            ++num_edges;
+        }
+    }
+    csr->edge_offsets[num_vertices] = num_edges;
+
+    pb_ptr_index_map_destroy(&vert_index);
+    return csr;
+
+err_return:
+    pb_ptr_index_map_destroy(&vert_index);
+    pb_graph_csr_free(csr);
+    return NULL;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_free(pb_graph_csr* graph) {
+    free(graph->vert_ids);
+    free(graph->vert_data);
+    free(graph->edge_offsets);
+    free(graph->edge_targets);
+    free(graph->edge_weights);
+    free(graph->edge_data);
+    if (graph->id_index) {
+        pb_hashmap_free(graph->id_index);
+    }
+    free(graph);
+}
+
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_graph_csr_get_index(pb_graph_csr const* graph, void const* vert_id) {
+    void* id;
+    if (pb_hashmap_get(graph->id_index, vert_id, &id) == -1) {
+        return PB_GRAPH_CSR_NONE;
+    }
+
+    return (size_t)((void const**)id - graph->vert_ids);
+}
+
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_graph_csr_get_edge(pb_graph_csr const* graph, size_t from, size_t to) {
+    size_t i;
+    for (i = graph->edge_offsets[from]; i < graph->edge_offsets[from + 1]; ++i) {
+        if (graph->edge_targets[i] == to) {
+            return i;
+        }
+    }
+
+    return PB_GRAPH_CSR_NONE;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_for_each_vertex(pb_graph_csr const* graph,
+                                                               pb_graph_csr_vertex_func func, void* param) {
+    size_t i;
+    for (i = 0; i < graph->num_vertices; ++i) {
+        func(graph, i, param);
+    }
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_graph_csr_for_each_edge(pb_graph_csr const* graph, pb_graph_csr_edge_func func,
+                                                             void* param) {
+    size_t i, j;
+    for (i = 0; i < graph->num_vertices; ++i) {
+        for (j = graph->edge_offsets[i]; j < graph->edge_offsets[i + 1]; ++j) {
+            func(graph, i, j, param);
+        }
+    }
+}
\ No newline at end of file
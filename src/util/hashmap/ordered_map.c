@@ -0,0 +1,180 @@
+#include <pb/util/hashmap/ordered_map.h>
+#include <pb/util/hashmap/map_ctrl.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t get_hash(pb_ordered_map const* map, void const* key) {
+    return pb_mix32(map->hash(key));
+}
+
+/* Compares the key of the item that an index slot points to with the given key. */
+static int slot_eq(void const* map, void const* slot, void const* key) {
+    pb_ordered_map const* m = (pb_ordered_map const*)map;
+    return m->key_eq(m->items[*(uint32_t const*)slot].entry.key, key);
+}
+
+/**
+ * Probes the index for the given key and returns its slot if found.
+ *
+ * @param map  The map to search.
+ * @param key  The key for which to search.
+ * @param hash The key's mixed hash.
+ * @return The key's slot, or PB_MAP_NO_SLOT if the key wasn't found.
+ */
+static size_t get_slot(pb_ordered_map const* map, void const* key, uint32_t hash) {
+    return pb_map_find(map->ctrl, map->cap, hash, map->index, sizeof(uint32_t), slot_eq, map, key);
+}
+
+/**
+ * Moves the items that haven't been removed into a new list and indexes them with the given number of slots.
+ *
+ * @param map     The map to rebuild.
+ * @param new_cap The new number of slots. Must be a power of two whose expand_num can hold all of the map's items.
+ * @return 0 on success, -1 on OOM (in which case the map is left alone).
+ */
+static int rebuild_index(pb_ordered_map* map, size_t new_cap) {
+    size_t expand_num = pb_map_expand_num(new_cap);
+    pb_ordered_map_item* items = malloc(sizeof(pb_ordered_map_item) * expand_num);
+    uint32_t* index = malloc(sizeof(uint32_t) * new_cap);
+    uint8_t* ctrl = malloc(new_cap + PB_MAP_GROUP_WIDTH);
+    size_t num_items = 0;
+    size_t i;
+
+    if (!items || !index || !ctrl) {
+        free(items);
+        free(index);
+        free(ctrl);
+        return -1;
+    }
+
+    pb_map_clear_ctrl(ctrl, new_cap);
+    for (i = 0; i < map->num_items; ++i) {
+        if (!map->items[i].removed) {
+            size_t slot = pb_map_insert_new(ctrl, new_cap, map->items[i].hash);
+            items[num_items] = map->items[i];
+            index[slot] = (uint32_t)num_items++;
+        }
+    }
+
+    free(map->items);
+    free(map->index);
+    free(map->ctrl);
+    map->items = items;
+    map->num_items = num_items;
+    map->index = index;
+    map->ctrl = ctrl;
+    map->cap = new_cap;
+    map->expand_num = expand_num;
+    map->num_deleted = 0;
+    return 0;
+}
+
+PB_UTIL_DECLSPEC pb_ordered_map* PB_UTIL_CALL pb_ordered_map_create(pb_hash_func hash, pb_hash_eq_func key_eq) {
+    pb_ordered_map* map = malloc(sizeof(pb_ordered_map));
+    if (!map) {
+        return NULL;
+    }
+
+    map->items = NULL;
+    map->num_items = 0;
+    map->index = NULL;
+    map->ctrl = NULL;
+    map->size = 0;
+    map->hash = hash;
+    map->key_eq = key_eq;
+
+    if (rebuild_index(map, PB_MAP_MIN_CAP) == -1) {
+        free(map);
+        return NULL;
+    }
+
+    return map;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_free(pb_ordered_map* map) {
+    free(map->items);
+    free(map->index);
+    free(map->ctrl);
+    free(map);
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_put(pb_ordered_map* map, void const* key, void const* val) {
+    uint32_t hash = get_hash(map, key);
+    pb_ordered_map_item* item;
+    size_t slot;
+
+    /* If the map already contains the key, update its associated value */
+    if ((slot = get_slot(map, key, hash)) != PB_MAP_NO_SLOT) {
+        map->items[map->index[slot]].entry.val = (void*)val;
+        return 0;
+    }
+
+    /* The list holds as many items as the index can, so once it's full the index needs more slots (or just to have
+     * the removed items cleared out) */
+    if (map->num_items == map->expand_num &&
+        rebuild_index(map, pb_map_grow_cap(map->cap, map->size, map->expand_num)) == -1) {
+        return -1;
+    }
+
+    slot = pb_map_find_free(map->ctrl, map->cap, hash);
+    map->num_deleted -= pb_map_fill_ctrl(map->ctrl, map->cap, slot, hash);
+
+    item = map->items + map->num_items;
+    item->entry.key = (void*)key;
+    item->entry.val = (void*)val;
+    item->hash = hash;
+    item->removed = 0;
+    map->index[slot] = (uint32_t)map->num_items++;
+    map->size++;
+    return 0;
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_get(pb_ordered_map const* map, void const* key, void** out) {
+    size_t slot;
+    if ((slot = get_slot(map, key, get_hash(map, key))) == PB_MAP_NO_SLOT) {
+        return -1;
+    }
+
+    *out = map->items[map->index[slot]].entry.val;
+    return 0;
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_remove(pb_ordered_map* map, void const* key) {
+    size_t slot;
+    size_t new_cap;
+    if ((slot = get_slot(map, key, get_hash(map, key))) == PB_MAP_NO_SLOT) {
+        return -1;
+    }
+
+    map->items[map->index[slot]].removed = 1;
+    map->num_deleted += pb_map_erase_ctrl(map->ctrl, map->cap, slot);
+    map->size--;
+
+    /* If shrinking fails, the map is still fine as it is */
+    new_cap = pb_map_shrink_cap(map->cap, map->size);
+    if (new_cap != map->cap) {
+        rebuild_index(map, new_cap);
+    }
+    return 0;
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_ordered_map_reserve(pb_ordered_map* map, size_t num_items) {
+    size_t new_cap = pb_map_reserve_cap(map->cap, num_items);
+    return new_cap == map->cap ? 0 : rebuild_index(map, new_cap);
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_clear(pb_ordered_map* map) {
+    pb_map_clear_ctrl(map->ctrl, map->cap);
+    map->num_items = 0;
+    map->size = 0;
+    map->num_deleted = 0;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_ordered_map_for_each(pb_ordered_map* map, pb_hash_iterator_func func, void* param) {
+    size_t i;
+    for (i = 0; i < map->num_items; ++i) {
+        if (!map->items[i].removed) {
+            func(&map->items[i].entry, param);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include <pb/util/heap/handle_heap.h>
+#include <pb/util/heap/heap.h>
+#include <stdlib.h>
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_handle_heap_init(pb_handle_heap* heap, size_t init_cap) {
+    size_t cap = init_cap ? init_cap : PB_HEAP_DEFAULT_CAP;
+
+    heap->heap = malloc(sizeof(pb_heap_handle) * cap);
+    heap->priority = malloc(sizeof(float) * cap);
+    heap->pos = malloc(sizeof(size_t) * cap);
+    heap->data = malloc(sizeof(void*) * cap);
+    if (!heap->heap || !heap->priority || !heap->pos || !heap->data) {
+        pb_handle_heap_free(heap);
+        return -1;
+    }
+
+    heap->size = 0;
+    heap->cap = cap;
+    heap->num_handles = 0;
+    heap->handles_cap = cap;
+    return 0;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_free(pb_handle_heap* heap) {
+    free(heap->heap);
+    free(heap->priority);
+    free(heap->pos);
+    free(heap->data);
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_clear(pb_handle_heap* heap) {
+    heap->size = 0;
+    heap->num_handles = 0;
+}
+
+/**
+ * Moves the item at the given position up until its parent's priority is no greater than its own.
+ *
+ * @param heap The heap in which to move the item.
+ * @param hole The item's position.
+ */
+static void percolate_up(pb_handle_heap* heap, size_t hole) {
+    pb_heap_handle handle = heap->heap[hole];
+    float priority = heap->priority[hole];
+
+    while (hole > 0) {
+        size_t parent = (hole - 1) / PB_HANDLE_HEAP_ARITY;
+        if (heap->priority[parent] <= priority) {
+            break;
+        }
+
+        heap->heap[hole] = heap->heap[parent];
+        heap->priority[hole] = heap->priority[parent];
+        heap->pos[heap->heap[hole]] = hole;
+        hole = parent;
+    }
+
+    heap->heap[hole] = handle;
+    heap->priority[hole] = priority;
+    heap->pos[handle] = hole;
+}
+
+/**
+ * Moves the item at the given position down until none of its children have a lower priority.
+ *
+ * @param heap The heap in which to move the item.
+ * @param hole The item's position.
+ */
+static void percolate_down(pb_handle_heap* heap, size_t hole) {
+    pb_heap_handle handle = heap->heap[hole];
+    float priority = heap->priority[hole];
+
+    for (;;) {
+        size_t first = hole * PB_HANDLE_HEAP_ARITY + 1;
+        size_t last = first + PB_HANDLE_HEAP_ARITY < heap->size ? first + PB_HANDLE_HEAP_ARITY : heap->size;
+        size_t child, min_child;
+
+        if (first >= heap->size) {
+            break;
+        }
+
+        min_child = first;
+        for (child = first + 1; child < last; ++child) {
+            if (heap->priority[child] < heap->priority[min_child]) {
+                min_child = child;
+            }
+        }
+
+        if (heap->priority[min_child] >= priority) {
+            break;
+        }
+
+        heap->heap[hole] = heap->heap[min_child];
+        heap->priority[hole] = heap->priority[min_child];
+        heap->pos[heap->heap[hole]] = hole;
+        hole = min_child;
+    }
+
+    heap->heap[hole] = handle;
+    heap->priority[hole] = priority;
+    heap->pos[handle] = hole;
+}
+
+/**
+ * Doubles the size of a list if it's full.
+ *
+ * @return 0 on success, -1 on OOM (in which case the list is left alone).
+ */
+static int grow_list(void** list, size_t item_size, size_t size, size_t cap) {
+    void* new_list;
+    if (size < cap) {
+        return 0;
+    }
+
+    new_list = realloc(*list, item_size * cap * 2);
+    if (!new_list) {
+        return -1;
+    }
+
+    *list = new_list;
+    return 0;
+}
+
+PB_UTIL_DECLSPEC pb_heap_handle PB_UTIL_CALL pb_handle_heap_insert(pb_handle_heap* heap, void* item, float priority) {
+    pb_heap_handle handle = heap->num_handles;
+
+    if (grow_list((void**)&heap->heap, sizeof(pb_heap_handle), heap->size, heap->cap) == -1 ||
+        grow_list((void**)&heap->priority, sizeof(float), heap->size, heap->cap) == -1 ||
+        grow_list((void**)&heap->pos, sizeof(size_t), heap->num_handles, heap->handles_cap) == -1 ||
+        grow_list((void**)&heap->data, sizeof(void*), heap->num_handles, heap->handles_cap) == -1) {
+        return PB_HEAP_NO_HANDLE;
+    }
+
+    /* Only update the capacities once every list has grown, so that a failure part way through is harmless */
+    if (heap->size == heap->cap) {
+        heap->cap *= 2;
+    }
+    if (heap->num_handles == heap->handles_cap) {
+        heap->handles_cap *= 2;
+    }
+
+    heap->data[handle] = item;
+    heap->num_handles++;
+    heap->heap[heap->size] = handle;
+    heap->priority[heap->size] = priority;
+    percolate_up(heap, heap->size++);
+
+    return handle;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_handle_heap_decrease_key(pb_handle_heap* heap, pb_heap_handle handle,
+                                                              float new_priority) {
+    size_t hole;
+    if (!pb_handle_heap_contains(heap, handle)) {
+        return;
+    }
+
+    hole = heap->pos[handle];
+    heap->priority[hole] = new_priority;
+    percolate_up(heap, hole);
+}
+
+PB_UTIL_DECLSPEC int PB_UTIL_CALL pb_handle_heap_contains(pb_handle_heap const* heap, pb_heap_handle handle) {
+    return handle < heap->num_handles && heap->pos[handle] != PB_HEAP_NO_HANDLE;
+}
+
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_handle_heap_peek_min(pb_handle_heap const* heap) {
+    return heap->size != 0 ? heap->data[heap->heap[0]] : NULL;
+}
+
+PB_UTIL_DECLSPEC void* PB_UTIL_CALL pb_handle_heap_get_min(pb_handle_heap* heap) {
+    pb_heap_handle min_handle;
+    if (heap->size == 0) {
+        return NULL;
+    }
+
+    min_handle = heap->heap[0];
+    heap->pos[min_handle] = PB_HEAP_NO_HANDLE;
+
+    if (--heap->size != 0) {
+        heap->heap[0] = heap->heap[heap->size];
+        heap->priority[0] = heap->priority[heap->size];
+        percolate_down(heap, 0);
+    }
+
+    return heap->data[min_handle];
+}
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include <pb/util/heap/heap.h>
-#include <pb/util/hashmap/hash_utils.h>
 #include <stdlib.h>
 
 pb_heap* pb_heap_create(size_t init_cap) {
@@ -15,8 +14,7 @@ pb_heap* pb_heap_create(size_t init_cap) {
     }
 
     /* Allocate the map to hold indices to each entry */
-    heap->index_map = pb_hashmap_create(pb_pointer_hash, pb_pointer_eq);
-    if (!heap->index_map) {
+    if (pb_ptr_index_map_init(&heap->index_map) == -1) {
         pb_vector_free(&heap->items);
         free(heap);
         return NULL;
@@ -27,7 +25,7 @@ pb_heap* pb_heap_create(size_t init_cap) {
 
 void pb_heap_free(pb_heap* heap) {
     pb_vector_free(&heap->items);
-    pb_hashmap_free(heap->index_map);
+    pb_ptr_index_map_destroy(&heap->index_map);
     free(heap);
 }
 
@@ -51,13 +49,13 @@ static void percolate_down(pb_heap* heap, int hole) {
         
         if(entries[child].priority < tmp.priority) {
             entries[hole] = entries[child];
-            pb_hashmap_put(heap->index_map, entries[hole].data, (void*)hole);
+            *pb_ptr_index_map_get(&heap->index_map, entries[hole].data) = hole;
         } else {
             break;
         }
     }
     entries[hole] = tmp;
-    pb_hashmap_put(heap->index_map, tmp.data, (void*)hole);
+    *pb_ptr_index_map_get(&heap->index_map, tmp.data) = hole;
 }
 
 void percolate_up(pb_heap* heap, int hole) {
@@ -66,11 +64,11 @@ void percolate_up(pb_heap* heap, int hole) {
 
     for (; hole > 0 && entries[(hole - 1) / 2].priority > tmp.priority; hole = (hole - 1) / 2) {
         entries[hole] = entries[(hole - 1) / 2];
-        pb_hashmap_put(heap->index_map, entries[hole].data, (void*)hole);
+        *pb_ptr_index_map_get(&heap->index_map, entries[hole].data) = hole;
     }
 
     entries[hole] = tmp;
-    pb_hashmap_put(heap->index_map, tmp.data, hole);
+    *pb_ptr_index_map_get(&heap->index_map, tmp.data) = hole;
 }
 
 int pb_heap_insert(pb_heap* heap, void* item, float priority) {
@@ -83,7 +81,8 @@ int pb_heap_insert(pb_heap* heap, void* item, float priority) {
         return -1;
     }
 
-    if (pb_hashmap_put(heap->index_map, e.data, NULL) == -1) {
+    if (pb_ptr_index_map_put(&heap->index_map, e.data, hole) == -1) {
+        heap->items.size--;
         return -1;
     }
 
@@ -92,13 +91,13 @@ int pb_heap_insert(pb_heap* heap, void* item, float priority) {
 }
 
 void pb_heap_decrease_key(pb_heap* heap, void* item, float new_priority) {
-    void* hole_v;
-    int hole;
-    pb_hashmap_get(heap->index_map, item, &hole_v);
+    size_t* hole = pb_ptr_index_map_get(&heap->index_map, item);
+    if (!hole) {
+        return;
+    }
 
-    hole = (int)hole_v; /* void* may be bigger than int, so we need to store it in hole_v first */
-    ((pb_heap_entry*)heap->items.items)[hole].priority = new_priority;
-    percolate_up(heap, hole);
+    ((pb_heap_entry*)heap->items.items)[*hole].priority = new_priority;
+    percolate_up(heap, (int)*hole);
 }
 
 /**
@@ -126,9 +125,12 @@ void* pb_heap_get_min(pb_heap* heap) {
     }
     
     min_item = entries[0].data;
-    
+    pb_ptr_index_map_remove(&heap->index_map, min_item);
+
     entries[0] = entries[--heap->items.size];
-    percolate_down(heap, 0);
+    if (heap->items.size != 0) {
+        percolate_down(heap, 0);
+    }
     
     return min_item;
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <pb/util/rng/rng.h>
+
+/* The golden ratio increment and finaliser from SplitMix64. Since the state after n draws is just key + n * GAMMA,
+ * the generator is counter-based: any value in the stream can be computed directly from (key, counter). */
+static const uint64_t PB_RNG_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_rng_seed(pb_rng* rng, uint64_t seed) {
+    rng->key = mix64(seed + PB_RNG_GAMMA);
+    rng->counter = 0;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_rng_split(pb_rng const* parent, uint64_t stream_id, pb_rng* child) {
+    /* Mix the stream id separately so that nearby (key, stream_id) pairs don't produce nearby keys */
+    uint64_t key = mix64(parent->key ^ mix64(stream_id * PB_RNG_GAMMA + 1));
+    child->key = key;
+    child->counter = 0;
+}
+
+PB_UTIL_DECLSPEC uint64_t PB_UTIL_CALL pb_rng_next64(pb_rng* rng) {
+    ++rng->counter;
+    return mix64(rng->key + rng->counter * PB_RNG_GAMMA);
+}
+
+PB_UTIL_DECLSPEC uint32_t PB_UTIL_CALL pb_rng_next(pb_rng* rng) {
+    return (uint32_t)(pb_rng_next64(rng) >> 32);
+}
+
+PB_UTIL_DECLSPEC uint32_t PB_UTIL_CALL pb_rng_range(pb_rng* rng, uint32_t bound) {
+    /* Lemire's multiply-shift reduction with rejection of the biased low region */
+    uint64_t m = (uint64_t)pb_rng_next(rng) * bound;
+    uint32_t low = (uint32_t)m;
+
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)pb_rng_next(rng) * bound;
+            low = (uint32_t)m;
+        }
+    }
+
+    return (uint32_t)(m >> 32);
+}
@@ -0,0 +1,338 @@
+#include <pb/util/thread_pool/thread_pool.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE pb_thread;
+typedef CRITICAL_SECTION pb_mutex;
+typedef CONDITION_VARIABLE pb_cond;
+
+static int pb_mutex_init(pb_mutex* m) { InitializeCriticalSection(m); return 0; }
+static void pb_mutex_destroy(pb_mutex* m) { DeleteCriticalSection(m); }
+static void pb_mutex_lock(pb_mutex* m) { EnterCriticalSection(m); }
+static void pb_mutex_unlock(pb_mutex* m) { LeaveCriticalSection(m); }
+
+static int pb_cond_init(pb_cond* c) { InitializeConditionVariable(c); return 0; }
+static void pb_cond_destroy(pb_cond* c) { (void)c; }
+static void pb_cond_wait(pb_cond* c, pb_mutex* m) { SleepConditionVariableCS(c, m, INFINITE); }
+static void pb_cond_signal(pb_cond* c) { WakeConditionVariable(c); }
+static void pb_cond_broadcast(pb_cond* c) { WakeAllConditionVariable(c); }
+
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t pb_thread;
+typedef pthread_mutex_t pb_mutex;
+typedef pthread_cond_t pb_cond;
+
+static int pb_mutex_init(pb_mutex* m) { return pthread_mutex_init(m, NULL) == 0 ? 0 : -1; }
+static void pb_mutex_destroy(pb_mutex* m) { pthread_mutex_destroy(m); }
+static void pb_mutex_lock(pb_mutex* m) { pthread_mutex_lock(m); }
+static void pb_mutex_unlock(pb_mutex* m) { pthread_mutex_unlock(m); }
+
+static int pb_cond_init(pb_cond* c) { return pthread_cond_init(c, NULL) == 0 ? 0 : -1; }
+static void pb_cond_destroy(pb_cond* c) { pthread_cond_destroy(c); }
+static void pb_cond_wait(pb_cond* c, pb_mutex* m) { pthread_cond_wait(c, m); }
+static void pb_cond_signal(pb_cond* c) { pthread_cond_signal(c); }
+static void pb_cond_broadcast(pb_cond* c) { pthread_cond_broadcast(c); }
+#endif
+
+/* Keep each worker's range on its own cache line so that workers taking tasks don't contend with each other */
+#define PB_THREAD_POOL_CACHE_LINE 64
+
+typedef struct {
+    pb_mutex lock;
+    size_t begin; /* The next task this worker will run */
+    size_t end;   /* One past the last task this worker owns */
+    char pad[PB_THREAD_POOL_CACHE_LINE];
+} pb_worker_range;
+
+typedef struct {
+    pb_thread_pool* pool;
+    size_t index;
+} pb_worker_arg;
+
+struct pb_thread_pool {
+    size_t num_workers;
+    pb_thread* threads;      /* num_workers - 1 threads; worker 0 is the thread calling pb_thread_pool_run */
+    pb_worker_arg* args;
+    pb_worker_range* ranges;
+
+    pb_mutex lock;
+    pb_cond start_cond;      /* Signalled when a new batch starts or the pool is shutting down */
+    pb_cond done_cond;       /* Signalled when the last thread finishes its part of a batch */
+    size_t generation;       /* Incremented for each batch */
+    size_t active;           /* The number of threads still working on the current batch */
+    int shutdown;
+
+    pb_thread_pool_task task;
+    void* param;
+};
+
+/**
+ * Takes the next task for the given worker, stealing half of another worker's remaining tasks if necessary.
+ *
+ * @param pool   The pool.
+ * @param worker The worker looking for a task.
+ * @param index  Out: the index of the task to run.
+ * @return 1 if a task was found, 0 if there are no tasks left to take.
+ */
+static int take_task(pb_thread_pool* pool, size_t worker, size_t* index) {
+    pb_worker_range* own = pool->ranges + worker;
+    size_t i;
+
+    pb_mutex_lock(&own->lock);
+    if (own->begin < own->end) {
+        *index = own->begin++;
+        pb_mutex_unlock(&own->lock);
+        return 1;
+    }
+    pb_mutex_unlock(&own->lock);
+
+    for (i = 1; i < pool->num_workers; ++i) {
+        pb_worker_range* victim = pool->ranges + (worker + i) % pool->num_workers;
+        size_t remaining;
+
+        pb_mutex_lock(&victim->lock);
+        remaining = victim->end - victim->begin;
+        if (remaining > 0) {
+            /* Steal the back half, leaving the front (which the victim is working through) alone */
+            size_t num_stolen = (remaining + 1) / 2;
+            size_t stolen_begin = victim->end - num_stolen;
+
+            victim->end = stolen_begin;
+            pb_mutex_unlock(&victim->lock);
+
+            pb_mutex_lock(&own->lock);
+            own->begin = stolen_begin + 1;
+            own->end = stolen_begin + num_stolen;
+            pb_mutex_unlock(&own->lock);
+
+            *index = stolen_begin;
+            return 1;
+        }
+        pb_mutex_unlock(&victim->lock);
+    }
+
+    return 0;
+}
+
+static void run_worker(pb_thread_pool* pool, size_t worker) {
+    pb_thread_pool_task task = pool->task;
+    void* param = pool->param;
+    size_t index;
+
+    while (take_task(pool, worker, &index)) {
+        task(index, worker, param);
+    }
+}
+
+static void worker_loop(pb_worker_arg* arg) {
+    pb_thread_pool* pool = arg->pool;
+    size_t seen_generation = 0;
+
+    pb_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pb_cond_wait(&pool->start_cond, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen_generation = pool->generation;
+        pb_mutex_unlock(&pool->lock);
+
+        run_worker(pool, arg->index);
+
+        pb_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pb_cond_signal(&pool->done_cond);
+        }
+    }
+    pb_mutex_unlock(&pool->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_main(LPVOID arg) {
+    worker_loop((pb_worker_arg*)arg);
+    return 0;
+}
+
+static int pb_thread_start(pb_thread* thread, pb_worker_arg* arg) {
+    *thread = CreateThread(NULL, 0, thread_main, arg, 0, NULL);
+    return *thread ? 0 : -1;
+}
+
+static void pb_thread_join(pb_thread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+#else
+static void* thread_main(void* arg) {
+    worker_loop((pb_worker_arg*)arg);
+    return NULL;
+}
+
+static int pb_thread_start(pb_thread* thread, pb_worker_arg* arg) {
+    return pthread_create(thread, NULL, thread_main, arg) == 0 ? 0 : -1;
+}
+
+static void pb_thread_join(pb_thread thread) {
+    pthread_join(thread, NULL);
+}
+#endif
+
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_thread_pool_hardware_threads(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? (size_t)num : 1;
+#endif
+}
+
+/* Stops and joins the first num_threads threads. */
+static void stop_threads(pb_thread_pool* pool, size_t num_threads) {
+    size_t i;
+
+    pb_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pb_cond_broadcast(&pool->start_cond);
+    pb_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < num_threads; ++i) {
+        pb_thread_join(pool->threads[i]);
+    }
+}
+
+PB_UTIL_DECLSPEC pb_thread_pool* PB_UTIL_CALL pb_thread_pool_create(size_t num_workers) {
+    pb_thread_pool* pool;
+    size_t num_ranges_init = 0;
+    size_t num_threads_started = 0;
+
+    if (num_workers == 0) {
+        num_workers = pb_thread_pool_hardware_threads();
+    }
+
+    pool = calloc(1, sizeof(pb_thread_pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->num_workers = num_workers;
+
+    pool->ranges = calloc(num_workers, sizeof(pb_worker_range));
+    pool->args = malloc(sizeof(pb_worker_arg) * num_workers);
+    pool->threads = num_workers > 1 ? malloc(sizeof(pb_thread) * (num_workers - 1)) : NULL;
+    if (!pool->ranges || !pool->args || (num_workers > 1 && !pool->threads)) {
+        goto err_return;
+    }
+
+    for (num_ranges_init = 0; num_ranges_init < num_workers; ++num_ranges_init) {
+        if (pb_mutex_init(&pool->ranges[num_ranges_init].lock) == -1) {
+            goto err_return;
+        }
+    }
+
+    if (pb_mutex_init(&pool->lock) == -1) {
+        goto err_return;
+    } else if (pb_cond_init(&pool->start_cond) == -1) {
+        pb_mutex_destroy(&pool->lock);
+        goto err_return;
+    } else if (pb_cond_init(&pool->done_cond) == -1) {
+        pb_cond_destroy(&pool->start_cond);
+        pb_mutex_destroy(&pool->lock);
+        goto err_return;
+    }
+
+    for (num_threads_started = 0; num_threads_started < num_workers - 1; ++num_threads_started) {
+        pb_worker_arg* arg = pool->args + num_threads_started + 1;
+        arg->pool = pool;
+        arg->index = num_threads_started + 1;
+
+        if (pb_thread_start(pool->threads + num_threads_started, arg) == -1) {
+            stop_threads(pool, num_threads_started);
+            pb_cond_destroy(&pool->done_cond);
+            pb_cond_destroy(&pool->start_cond);
+            pb_mutex_destroy(&pool->lock);
+            goto err_return;
+        }
+    }
+
+    return pool;
+
+err_return:
+    while (num_ranges_init--) {
+        pb_mutex_destroy(&pool->ranges[num_ranges_init].lock);
+    }
+    free(pool->ranges);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+    return NULL;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_thread_pool_free(pb_thread_pool* pool) {
+    size_t i;
+
+    if (!pool) {
+        return;
+    }
+
+    stop_threads(pool, pool->num_workers - 1);
+    pb_cond_destroy(&pool->done_cond);
+    pb_cond_destroy(&pool->start_cond);
+    pb_mutex_destroy(&pool->lock);
+
+    for (i = 0; i < pool->num_workers; ++i) {
+        pb_mutex_destroy(&pool->ranges[i].lock);
+    }
+    free(pool->ranges);
+    free(pool->args);
+    free(pool->threads);
+    free(pool);
+}
+
+PB_UTIL_DECLSPEC size_t PB_UTIL_CALL pb_thread_pool_num_workers(pb_thread_pool const* pool) {
+    return pool->num_workers;
+}
+
+PB_UTIL_DECLSPEC void PB_UTIL_CALL pb_thread_pool_run(pb_thread_pool* pool, size_t num_tasks, pb_thread_pool_task task,
+                                                      void* param) {
+    size_t i;
+
+    if (num_tasks == 0) {
+        return;
+    }
+
+    /* The other threads are idle, so the ranges can be set up without locking them; taking the pool lock below
+     * publishes them to the workers */
+    for (i = 0; i < pool->num_workers; ++i) {
+        pool->ranges[i].begin = num_tasks * i / pool->num_workers;
+        pool->ranges[i].end = num_tasks * (i + 1) / pool->num_workers;
+    }
+    pool->task = task;
+    pool->param = param;
+
+    if (pool->num_workers == 1) {
+        run_worker(pool, 0);
+        return;
+    }
+
+    pb_mutex_lock(&pool->lock);
+    pool->active = pool->num_workers - 1;
+    ++pool->generation;
+    pb_cond_broadcast(&pool->start_cond);
+    pb_mutex_unlock(&pool->lock);
+
+    run_worker(pool, 0);
+
+    pb_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pb_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pb_mutex_unlock(&pool->lock);
+}
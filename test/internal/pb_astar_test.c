@@ -4,6 +4,7 @@
 #include <pb/internal/astar.h>
 #include <pb/util/hashmap/hash_utils.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 uint32_t int_hash(void* num) {
     int num_i = *((int*)num);
@@ -114,6 +115,136 @@ START_TEST(astar_no_path)
 }
 END_TEST
 
+#define ASTAR_GRID_SIZE 10
+
+/* Builds a grid of ASTAR_GRID_SIZE x ASTAR_GRID_SIZE vertices, numbered row by row, with unit edges between neighbours */
+static pb_graph* make_grid_graph(int* ids) {
+    pb_graph* graph = pb_graph_create(int_hash, int_eq);
+    int x, y;
+
+    for (x = 0; x < ASTAR_GRID_SIZE * ASTAR_GRID_SIZE; ++x) {
+        ids[x] = x;
+        pb_graph_add_vertex(graph, ids + x, ids + x);
+    }
+    for (y = 0; y < ASTAR_GRID_SIZE; ++y) {
+        for (x = 0; x < ASTAR_GRID_SIZE; ++x) {
+            int cur = y * ASTAR_GRID_SIZE + x;
+            if (x + 1 < ASTAR_GRID_SIZE) {
+                pb_graph_add_edge(graph, ids + cur, ids + cur + 1, 1.f, NULL);
+                pb_graph_add_edge(graph, ids + cur + 1, ids + cur, 1.f, NULL);
+            }
+            if (y + 1 < ASTAR_GRID_SIZE) {
+                pb_graph_add_edge(graph, ids + cur, ids + cur + ASTAR_GRID_SIZE, 1.f, NULL);
+                pb_graph_add_edge(graph, ids + cur + ASTAR_GRID_SIZE, ids + cur, 1.f, NULL);
+            }
+        }
+    }
+
+    return graph;
+}
+
+static float csr_manhattan(pb_graph_csr const* graph, size_t vert, size_t goal) {
+    int from = *(int*)graph->vert_data[vert];
+    int to = *(int*)graph->vert_data[goal];
+    return (float)(abs(from % ASTAR_GRID_SIZE - to % ASTAR_GRID_SIZE) +
+                   abs(from / ASTAR_GRID_SIZE - to / ASTAR_GRID_SIZE));
+}
+
+START_TEST(astar_ctx_reuse)
+{
+    /*
+     * Given a 10x10 grid graph with unit edge weights
+     * When I run several searches with one A* context and path vector
+     * Then each path should be as long as the Manhattan distance, and repeating a search shouldn't allocate
+     */
+    static int ids[ASTAR_GRID_SIZE * ASTAR_GRID_SIZE];
+    pb_graph* graph = make_grid_graph(ids);
+    pb_astar_ctx ctx;
+    pb_vector path;
+    void* path_items;
+    void* arena_head;
+    int goal;
+
+    ck_assert_msg(pb_astar_ctx_init(&ctx) == 0 && pb_vector_init(&path, sizeof(pb_vertex*), 0) == 0, "Out of memory");
+
+    for (goal = 0; goal < ASTAR_GRID_SIZE * ASTAR_GRID_SIZE; goal += 7) {
+        size_t expected = (size_t)(goal % ASTAR_GRID_SIZE + goal / ASTAR_GRID_SIZE + 1);
+        pb_vertex** verts;
+
+        ck_assert_msg(pb_astar_search(&ctx, pb_graph_get_vertex(graph, ids), pb_graph_get_vertex(graph, ids + goal),
+                                      bad_heuristic, &path) == 0, "No path found to %d", goal);
+        verts = (pb_vertex**)path.items;
+        ck_assert_msg(path.size == expected, "The path to %d should have had %u vertices, had %u", goal,
+                      (unsigned)expected, (unsigned)path.size);
+        ck_assert_msg(verts[0]->data == ids && verts[path.size - 1]->data == ids + goal,
+                      "The path to %d should have gone from the start to the goal", goal);
+    }
+
+    /* The last search was the longest, so once the context has been resized to fit it, repeating it shouldn't need
+     * any more memory */
+    ck_assert_msg(pb_astar_search(&ctx, pb_graph_get_vertex(graph, ids), pb_graph_get_vertex(graph, ids + goal - 7),
+                                  bad_heuristic, &path) == 0, "No path found");
+    path_items = path.items;
+    arena_head = ctx.nodes->head;
+    ck_assert_msg(pb_astar_search(&ctx, pb_graph_get_vertex(graph, ids), pb_graph_get_vertex(graph, ids + goal - 7),
+                                  bad_heuristic, &path) == 0, "No path found");
+    ck_assert_msg(path.items == path_items && ctx.nodes->head == arena_head,
+                  "Repeating a search shouldn't have allocated");
+
+    pb_astar_ctx_free(&ctx);
+    pb_vector_free(&path);
+    pb_graph_free(graph);
+}
+END_TEST
+
+START_TEST(astar_csr)
+{
+    /*
+     * Given a frozen 10x10 grid graph with unit edge weights, and an extra vertex with no edges
+     * When I search it with pb_astar_csr_search
+     * Then each path should be as long as the Manhattan distance and go from the start to the goal, and there should
+     * be no path to the extra vertex
+     */
+    static int ids[ASTAR_GRID_SIZE * ASTAR_GRID_SIZE + 1];
+    pb_graph* graph = make_grid_graph(ids);
+    pb_graph_csr* csr;
+    pb_astar_ctx ctx;
+    pb_vector path;
+    size_t start;
+    int goal;
+
+    ids[ASTAR_GRID_SIZE * ASTAR_GRID_SIZE] = ASTAR_GRID_SIZE * ASTAR_GRID_SIZE;
+    pb_graph_add_vertex(graph, ids + ASTAR_GRID_SIZE * ASTAR_GRID_SIZE, ids + ASTAR_GRID_SIZE * ASTAR_GRID_SIZE);
+    csr = pb_graph_freeze(graph);
+    ck_assert_msg(csr != NULL, "Out of memory");
+    ck_assert_msg(pb_astar_ctx_init(&ctx) == 0 && pb_vector_init(&path, sizeof(size_t), 0) == 0, "Out of memory");
+
+    start = pb_graph_csr_get_index(csr, ids + 12);
+    for (goal = 0; goal < ASTAR_GRID_SIZE * ASTAR_GRID_SIZE; goal += 3) {
+        size_t goal_idx = pb_graph_csr_get_index(csr, ids + goal);
+        size_t expected = (size_t)(csr_manhattan(csr, start, goal_idx) + 1.5f);
+        size_t* verts;
+
+        ck_assert_msg(pb_astar_csr_search(&ctx, csr, start, goal_idx, csr_manhattan, &path) == 0,
+                      "No path found to %d", goal);
+        verts = (size_t*)path.items;
+        ck_assert_msg(path.size == expected, "The path to %d should have had %u vertices, had %u", goal,
+                      (unsigned)expected, (unsigned)path.size);
+        ck_assert_msg(verts[0] == start && verts[path.size - 1] == goal_idx,
+                      "The path to %d should have gone from the start to the goal", goal);
+    }
+
+    ck_assert_msg(pb_astar_csr_search(&ctx, csr, start,
+                                      pb_graph_csr_get_index(csr, ids + ASTAR_GRID_SIZE * ASTAR_GRID_SIZE),
+                                      csr_manhattan, &path) == -1, "There shouldn't have been a path");
+
+    pb_astar_ctx_free(&ctx);
+    pb_vector_free(&path);
+    pb_graph_csr_free(csr);
+    pb_graph_free(graph);
+}
+END_TEST
+
 Suite *make_pb_astar_suite(void)
 {
     Suite *s;
@@ -125,6 +256,8 @@ Suite *make_pb_astar_suite(void)
     suite_add_tcase(s, tc_astar);
     tcase_add_test(tc_astar, astar_simple);
     tcase_add_test(tc_astar, astar_no_path);
+    tcase_add_test(tc_astar, astar_ctx_reuse);
+    tcase_add_test(tc_astar, astar_csr);
 
     return s;
 }
\ No newline at end of file
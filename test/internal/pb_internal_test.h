@@ -8,5 +8,6 @@ Suite* make_pb_squarify_suite(void);
 Suite* make_pb_sq_house_layout_suite(void);
 Suite* make_pb_sq_house_graph_suite(void);
 Suite* make_pb_astar_suite(void);
+Suite* make_pb_vertex_kernels_suite(void);
 
 #endif /* PB_INTERNAL_TEST_H */
\ No newline at end of file
@@ -17,6 +17,7 @@ int main(void)
     sr = srunner_create(make_pb_sq_house_layout_suite());
     srunner_add_suite(sr, make_pb_sq_house_graph_suite());
     srunner_add_suite(sr, make_pb_astar_suite());
+    srunner_add_suite(sr, make_pb_vertex_kernels_suite());
 	srunner_set_tap(sr, "internal_test_results.tap");
 
     srunner_set_fork_status(sr, CK_NOFORK);
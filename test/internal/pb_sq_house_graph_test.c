@@ -411,6 +411,82 @@ START_TEST(generate_floor_graph_no_door_space)
 }
 END_TEST
 
+#define MANY_ROOMS_ROWS 8
+#define MANY_ROOMS_PER_ROW 12
+#define MANY_ROOMS_NUM_ROOMS (MANY_ROOMS_ROWS * MANY_ROOMS_PER_ROW)
+
+START_TEST(generate_floor_graph_many_rooms)
+{
+    /*
+     * Given a floor with rows of rooms of uneven widths, so that the rooms in neighbouring rows only partly overlap
+     * When I invoke pb_sq_house_generate_floor_graph
+     * Then there should be an edge between every pair of rooms that pb_sq_house_get_shared_wall says share a wall,
+     *      and no others
+     */
+    pb_room rooms[MANY_ROOMS_NUM_ROOMS];
+    pb_rect rects[MANY_ROOMS_NUM_ROOMS];
+    pb_hashmap* room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
+    pb_sq_house_house_spec h_spec;
+    pb_graph* result;
+    pb_floor f;
+    size_t num_edges = 0;
+    unsigned i, j;
+
+    for (i = 0; i < MANY_ROOMS_ROWS; ++i) {
+        float x = 0.f;
+        for (j = 0; j < MANY_ROOMS_PER_ROW; ++j) {
+            pb_rect* r = rects + i * MANY_ROOMS_PER_ROW + j;
+
+            /* Thirds make sure the shared walls are only approximately equal */
+            r->bottom_left.x = x;
+            r->bottom_left.y = i * (10.f / 3.f);
+            r->w = 1.f + (float)((i * 7 + j * 3) % 5) / 3.f;
+            r->h = 10.f / 3.f;
+            x += r->w;
+
+            pb_rect_to_pb_shape2D(r, &rooms[i * MANY_ROOMS_PER_ROW + j].shape);
+            rooms[i * MANY_ROOMS_PER_ROW + j].name = "Room";
+        }
+    }
+
+    f.num_rooms = MANY_ROOMS_NUM_ROOMS;
+    f.rooms = rooms;
+    h_spec.door_size = 0.5f;
+
+    result = pb_sq_house_generate_floor_graph(&h_spec, room_specs, &f);
+    ck_assert_msg(result != NULL, "Generating the floor graph should have succeeded");
+
+    for (i = 0; i < MANY_ROOMS_NUM_ROOMS; ++i) {
+        for (j = 0; j < MANY_ROOMS_NUM_ROOMS; ++j) {
+            int wall = i == j ? -1 : pb_sq_house_get_shared_wall(rects + i, rects + j);
+            pb_edge const* edge = pb_graph_get_edge(result, rooms + i, rooms + j);
+
+            if (wall == -1) {
+                ck_assert_msg(edge == NULL, "There should not have been an edge from room %u to room %u", i, j);
+            } else {
+                pb_sq_house_room_conn const* conn;
+                ck_assert_msg(edge != NULL, "There should have been an edge from room %u to room %u", i, j);
+
+                conn = (pb_sq_house_room_conn const*)edge->data;
+                ck_assert_msg(conn->room == rooms + i && conn->neighbour == rooms + j && conn->wall == wall,
+                              "The edge from room %u to room %u should have been on wall %d", i, j, wall);
+                ++num_edges;
+            }
+        }
+    }
+
+    /* Every room has a neighbour on each side, apart from the edges of the floor */
+    ck_assert_msg(num_edges > MANY_ROOMS_NUM_ROOMS * 2, "Only found %u edges", (unsigned)num_edges);
+
+    for (i = 0; i < MANY_ROOMS_NUM_ROOMS; ++i) {
+        pb_shape2D_free(&rooms[i].shape);
+    }
+    pb_graph_for_each_edge(result, pb_graph_free_edge_data, NULL);
+    pb_graph_free(result);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
 START_TEST(find_disconnected_rooms_basic)
 {
     /* Given a pb_floor with three rooms and a pb_graph holding the floor connectivity graph with a connection between rooms 0 and 1
@@ -605,7 +681,7 @@ START_TEST(internal_graph_simple)
 
     result = pb_sq_house_generate_internal_graph(floor_graph);
     ck_assert_msg(result->vertices->size == 5, "result graph should have had 5 vertices, had %lu", result->vertices->size);
-    ck_assert_msg(result->edges->size == 8, "result graph should have had 8 edges, had %lu", result->edges->size);
+    ck_assert_msg(result->edges.size == 8, "result graph should have had 8 edges, had %lu", result->edges.size);
 
     for(i = 0; i < 5; ++i) {
         pb_vertex const* vert = pb_graph_get_vertex(result, &expected_points[i]);
@@ -714,7 +790,7 @@ START_TEST(internal_graph_multiple_overlap)
 
     result = pb_sq_house_generate_internal_graph(floor_graph);
     ck_assert_msg(result->vertices->size == 8, "result graph should have had 8 vertices, had %lu", result->vertices->size);
-    ck_assert_msg(result->edges->size == 14, "result graph should have had 14 edges, had %lu", result->edges->size);
+    ck_assert_msg(result->edges.size == 14, "result graph should have had 14 edges, had %lu", result->edges.size);
 
     for(i = 0; i < 8; ++i) {
         pb_vertex const* vert = pb_graph_get_vertex(result, &expected_points[i]);
@@ -1143,7 +1219,7 @@ START_TEST(place_hallways_simple)
 
     pb_vector_push_back(&hallways, &hallway);
     
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
 
     pb_point2D hallway0_expected_points[] = { {4.75f, 5.f}, {4.75f, 0.f}, {5.25f, 0.f}, {5.25f, 5.f} };
     int hallway0_expected_walls[] = { 1, 1, 1, 1 };
@@ -1223,8 +1299,8 @@ START_TEST(place_hallways_simple)
     for (i = 0; i < f.num_rooms; ++i) {
         total_edges += expected_room_conn_counts[i];
     }
-    ck_assert_msg(floor_graph->edges->size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
-                  floor_graph->edges->size);
+    ck_assert_msg(floor_graph->edges.size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
+                  floor_graph->edges.size);
 
     for (i = 0; i < f.num_rooms; ++i) {
         pb_vertex const* vert = pb_graph_get_vertex(floor_graph, f.rooms + i);
@@ -1363,7 +1439,7 @@ START_TEST(place_hallways_corner)
 
     pb_vector_push_back(&hallways, &hallway);
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
 
     pb_point2D hallway0_expected_points[] = { { 5.25f, 5.25f },
                                               { 5.25f, 4.75f },
@@ -1493,8 +1569,8 @@ START_TEST(place_hallways_corner)
     for (i = 0; i < f.num_rooms; ++i) {
         total_edges += expected_room_conn_counts[i];
     }
-    ck_assert_msg(floor_graph->edges->size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
-                  floor_graph->edges->size);
+    ck_assert_msg(floor_graph->edges.size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
+                  floor_graph->edges.size);
 
     for (i = 0; i < f.num_rooms; ++i) {
         pb_vertex const* vert = pb_graph_get_vertex(floor_graph, f.rooms + i);
@@ -1644,7 +1720,7 @@ START_TEST(place_hallways_2_corners_opposite_sides)
     pb_vector_push_back(&hallways, &hallway);
 
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
     pb_point2D hallway0_expected_points[] = { { 0.f, 2.75f },
                                               { 0.f, 2.25f },
                                               { 4.75f, 2.25f },
@@ -1810,8 +1886,8 @@ START_TEST(place_hallways_2_corners_opposite_sides)
     for (i = 0; i < f.num_rooms; ++i) {
         total_edges += expected_room_conn_counts[i];
     }
-    ck_assert_msg(floor_graph->edges->size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
-                  floor_graph->edges->size);
+    ck_assert_msg(floor_graph->edges.size == total_edges, "floor graph should have had %lu edges, had %lu", total_edges,
+                  floor_graph->edges.size);
 
     for (i = 0; i < f.num_rooms; ++i) {
         pb_vertex const* vert = pb_graph_get_vertex(floor_graph, f.rooms + i);
@@ -1964,7 +2040,7 @@ START_TEST(place_hallways_2_corners_same_side)
     pb_vector_push_back(&hallways, &hallway);
 
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
     pb_point2D hallway0_expected_points[] = { { 5.25f, 10.f / 3.f + 0.25f },
                                               { 5.25f, 10.f / 3.f - 0.25f },
                                               { 10.f, 10.f / 3.f - 0.25f },
@@ -2271,7 +2347,7 @@ START_TEST(place_hallways_t_intersection_y_axis)
         pb_vector_push_back(&hallways, &input_hallways[i]);
     }
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
     pb_point2D hallway0_expected_points[] = { { 5.25f, 5.25f },
                                               { 5.25f, 4.75f },
                                               { 10.f, 4.75f },
@@ -2530,7 +2606,7 @@ START_TEST(place_hallways_t_intersection_x_axis)
         pb_vector_push_back(&hallways, &input_hallways[i]);
     }
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
     pb_point2D hallway0_expected_points[] = { { 0.f, 5.25f },
                                               { 0.f, 4.75f },
                                               { 10.f, 4.75f },
@@ -2804,7 +2880,7 @@ START_TEST(place_hallways_4_way_intersection)
         pb_vector_push_back(&hallways, &input_hallways[i]);
     }
 
-    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways);
+    pb_sq_house_place_hallways(&f, &h, room_spec_map, floor_graph, internal_graph, &hallways, NULL);
     pb_point2D hallway0_expected_points[] = { { 0.f, 5.25f },
                                               { 0.f, 4.75f },
                                               { 4.75f, 4.75f },
@@ -3055,7 +3131,7 @@ START_TEST(place_doors_have_doors)
     f.num_rooms = 2;
 
     pb_graph* floor_graph = pb_sq_house_generate_floor_graph(&house_spec, room_spec_map, &f);
-    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 0);
+    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 0, NULL);
 
     pb_wall_structure expected_room0_doors[] = {
             { { 5.f, 2.125f }, { 5.f, 2.875f }, 2 },
@@ -3157,7 +3233,7 @@ START_TEST(place_doors_no_doors)
     f.num_rooms = 2;
 
     pb_graph* floor_graph = pb_sq_house_generate_floor_graph(&house_spec, room_spec_map, &f);
-    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 0);
+    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 0, NULL);
 
     size_t num_rooms = sizeof(rooms) / sizeof(pb_room);
 
@@ -3227,7 +3303,7 @@ START_TEST(place_doors_one_room_floor0)
     f.num_rooms = num_rooms;
 
     pb_graph* floor_graph = pb_sq_house_generate_floor_graph(&house_spec, room_spec_map, &f);
-    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 1);
+    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 1, NULL);
 
     pb_wall_structure expected_room0_doors[] = {
             { { 2.125f, 0.f }, { 2.875f, 0.f }, 1 },
@@ -3334,7 +3410,7 @@ START_TEST(place_doors_multi_room_floor0)
     f.num_rooms = num_rooms;
 
     pb_graph* floor_graph = pb_sq_house_generate_floor_graph(&house_spec, room_spec_map, &f);
-    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 1);
+    pb_sq_house_place_doors(&f, &house_spec, floor_graph, 1, NULL);
 
     pb_wall_structure expected_room0_doors[] = {
             {{7.5f, 2.125f}, {7.5f, 2.875f}, 2},
@@ -3452,7 +3528,7 @@ START_TEST(place_windows_simple)
     f.num_rooms = 2;
     pb_rect_to_pb_shape2D(&floor_rect, &f.shape);
 
-    pb_sq_house_place_windows(&f, &house_spec, 0);
+    pb_sq_house_place_windows(&f, &house_spec, 0, NULL);
 
     pb_wall_structure expected_room0_windows[] = {
             {{0.f, 2.25f}, {0.f, 2.75f}, 0},
@@ -3581,7 +3657,7 @@ START_TEST(place_windows_one_room_floor0)
         f.num_rooms = 1;
         pb_rect_to_pb_shape2D(&floor_rect, &f.shape);
 
-        pb_sq_house_place_windows(&f, &house_spec, 1);
+        pb_sq_house_place_windows(&f, &house_spec, 1, NULL);
 
         pb_wall_structure expected_room0_windows[] = {
                 {{0.f, 2.25f}, {0.f, 2.75f}, 0},
@@ -3705,7 +3781,7 @@ START_TEST(place_windows_multi_room_floor0)
     f.num_rooms = 2;
     pb_rect_to_pb_shape2D(&floor_rect, &f.shape);
 
-    pb_sq_house_place_windows(&f, &house_spec, 1);
+    pb_sq_house_place_windows(&f, &house_spec, 1, NULL);
 
     pb_wall_structure expected_room0_windows[] = {
             {{0.f, 2.25f}, {0.f, 2.75f}, 0},
@@ -3851,7 +3927,7 @@ START_TEST(place_windows_centre_room)
     f.num_rooms = num_rooms;
     pb_rect_to_pb_shape2D(&floor_rect, &f.shape);
 
-    pb_sq_house_place_windows(&f, &house_spec, 0);
+    pb_sq_house_place_windows(&f, &house_spec, 0, NULL);
 
     pb_wall_structure expected_room0_windows[] = {
             {{0.f, 4.75f},  {0.f, 5.25f}, 0},
@@ -3972,6 +4048,7 @@ Suite *make_pb_sq_house_graph_suite(void)
     suite_add_tcase(s, tc_sq_house_generate_floor_graph);
     tcase_add_test(tc_sq_house_generate_floor_graph, generate_floor_graph_multi_room);
     tcase_add_test(tc_sq_house_generate_floor_graph, generate_floor_graph_no_door_space);
+    tcase_add_test(tc_sq_house_generate_floor_graph, generate_floor_graph_many_rooms);
 
     tc_sq_house_find_disconnected = tcase_create("Disconnected room finding tests");
     suite_add_tcase(s, tc_sq_house_find_disconnected);
@@ -11,6 +11,7 @@ START_TEST(choose_rooms_single_room)
     pb_sq_house_room_spec specs[1];
     pb_hashmap* rooms = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_sq_house_house_spec spec;
+    pb_rng rng;
     char** result;
 
     char* adjacent[] = { PB_SQ_HOUSE_OUTSIDE, "Closet" };
@@ -24,7 +25,8 @@ START_TEST(choose_rooms_single_room)
     pb_hashmap_put(rooms, (void*)"Closet", (void*)&specs[0]);
     spec.num_rooms = 1;
 
-    result = pb_sq_house_choose_rooms(rooms, &spec);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_choose_rooms(rooms, &spec, &rng);
 
     ck_assert_msg(strcmp(result[0], specs[0].name) == 0, "Result should contain closet, but instead contained %s", result[0]);
 
@@ -38,6 +40,7 @@ START_TEST(choose_rooms_multiple_rooms)
     pb_sq_house_room_spec specs[2] = {0};
     pb_hashmap* rooms = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_sq_house_house_spec spec;
+    pb_rng rng;
 
     pb_hashmap* instances = pb_hashmap_create(pb_str_hash, pb_str_eq); /* Stores the number of each room type from the result array */
     void* spec0_instances;
@@ -64,7 +67,8 @@ START_TEST(choose_rooms_multiple_rooms)
     pb_hashmap_put(rooms, (void*)specs[1].name, (void*)&specs[1]);
     spec.num_rooms = 12;
 
-    result = pb_sq_house_choose_rooms(rooms, &spec);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_choose_rooms(rooms, &spec, &rng);
 
     pb_hashmap_put(instances, (void*)specs[0].name, (void*)0);
     pb_hashmap_put(instances, (void*)specs[1].name, (void*)0);
@@ -101,6 +105,7 @@ START_TEST(choose_rooms_house_too_big)
     pb_sq_house_room_spec specs[2];
     pb_hashmap* rooms = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_sq_house_house_spec spec;
+    pb_rng rng;
     char** result;
     
     specs[0].max_instances = 6;
@@ -119,7 +124,8 @@ START_TEST(choose_rooms_house_too_big)
     pb_hashmap_put(rooms, (void*)specs[1].name, (void*)&specs[1]);
     spec.num_rooms = 24;
 
-    result = pb_sq_house_choose_rooms(rooms, &spec);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_choose_rooms(rooms, &spec, &rng);
     ck_assert_msg(result == NULL, "Result should have been NULL, was %p", result);
 
     pb_hashmap_free(rooms);
@@ -132,6 +138,7 @@ START_TEST(choose_rooms_no_outside)
     pb_sq_house_room_spec specs[1] = {0};
     pb_hashmap* rooms = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_sq_house_house_spec spec;
+    pb_rng rng;
     char** result;
 
     char* adjacent[] = { "Closet", "Bathroom" };
@@ -145,7 +152,8 @@ START_TEST(choose_rooms_no_outside)
     pb_hashmap_put(rooms, (void*)specs[0].name, (void*)&specs[0]);
     spec.num_rooms = 6;
 
-    result = pb_sq_house_choose_rooms(rooms, &spec);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_choose_rooms(rooms, &spec, &rng);
     ck_assert_msg(result == NULL, "Result should have been NULL, was %p", result);
 
     pb_hashmap_free(rooms);
@@ -166,6 +174,7 @@ START_TEST(layout_stairs_single_floor)
     pb_hashmap* room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_rect* result;
     pb_building house;
+    pb_rng rng;
 
     h_spec.width = 10;
     h_spec.height = 25;
@@ -177,7 +186,8 @@ START_TEST(layout_stairs_single_floor)
 
     pb_hashmap_put(room_specs, (void*)living_room.name, (void*)&living_room);
 
-    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house, &rng, NULL);
     ck_assert_msg(house.num_floors == 1, "House should have had one floor, but had %lu", house.num_floors);
     ck_assert_msg(house.floors[0].num_rooms == 1, "House's first floor should have had one room, but had %lu", house.floors[0].num_rooms);
     ck_assert_msg(result[0].bottom_left.x == 0.f && result[0].bottom_left.y == 0.f && result[0].w == 10 && result[0].h == 25,
@@ -207,6 +217,7 @@ START_TEST(layout_stairs_three_floors)
     pb_hashmap* room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_rect* result;
     pb_building house;
+    pb_rng rng;
 
     float expected_areas[3] = { 900.f, 900.f, 900.f };
     pb_rect temp;
@@ -223,7 +234,8 @@ START_TEST(layout_stairs_three_floors)
 
     pb_hashmap_put(room_specs, (void*)living_room.name, (void*)&living_room);
 
-    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house, &rng, NULL);
     ck_assert_msg(house.num_floors == 3, "House should have had 3 floors, but had %lu", house.num_floors);
 
     /* The remaining areas will depend on the stairs which are assigned randomly */
@@ -274,6 +286,7 @@ START_TEST(layout_stairs_big_stairs)
     pb_hashmap* room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
     pb_rect* result;
     pb_building house;
+    pb_rng rng;
 
     float expected_areas[3] = { 675.f, 675.f };
     size_t expected_num_rooms[] = { 2, 2 };
@@ -290,7 +303,8 @@ START_TEST(layout_stairs_big_stairs)
 
     pb_hashmap_put(room_specs, (void*)living_room.name, (void*)&living_room);
 
-    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house);
+    pb_rng_seed(&rng, 0);
+    result = pb_sq_house_layout_stairs(&rooms[0], room_specs, &h_spec, &house, &rng, NULL);
     ck_assert_msg(house.num_floors == 2, "House should have had 2 floors, but had %lu", house.num_floors);
     for (i = 0; i < house.num_floors; ++i) {
         float area = result[i].w * result[i].h;
@@ -417,7 +431,7 @@ START_TEST(layout_floor_single_room)
     
     lr.area = 90.f;
     pb_hashmap_put(map, (void*)&rooms[0], (void*)&lr);
-    pb_sq_house_layout_floor(&rooms[0], map, &f, 1, &floor_rect, 0);
+    pb_sq_house_layout_floor(&rooms[0], map, &f, 1, &floor_rect, 0, NULL);
 
     pb_shape2D_to_pb_rect(&f.rooms[0].shape, &result);
     ck_assert_msg(assert_close_enough(result.w, floor_rect.w, 5), "Result's width should have been about %.3f, was %.3f", floor_rect.w, result.w);
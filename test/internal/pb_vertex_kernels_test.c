@@ -0,0 +1,386 @@
+#include "../test_util.h"
+#include <check.h>
+#include <pb/internal/vertex_kernels.h>
+#include <pb/util/geom/shape_utils.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define KERNEL_TEST_NUM_POINTS 64
+
+static float random_coord(void) {
+    /* Multiples of 1/8 hit exact zeroes (and so signed zeroes) often enough to matter */
+    return (float)(rand() % 161 - 80) / 8.f;
+}
+
+static void fill_random_points(pb_point2D* points, size_t num_points) {
+    size_t i;
+    for (i = 0; i < num_points; ++i) {
+        points[i].x = random_coord();
+        points[i].y = random_coord();
+    }
+}
+
+START_TEST(surface_verts_match_scalar)
+{
+    /*
+     * Given random points and triangulations of every length up to a few vectors' worth
+     * When I invoke pb_fill_surface_verts and pb_fill_surface_verts_scalar, forwards and backwards
+     * Then the vertices should be bit-identical
+     */
+    pb_point2D points[KERNEL_TEST_NUM_POINTS];
+    size_t indices[KERNEL_TEST_NUM_POINTS];
+    pb_vert3D expected[KERNEL_TEST_NUM_POINTS];
+    pb_vert3D actual[KERNEL_TEST_NUM_POINTS];
+    pb_point2D centre = {1.5f, -2.f};
+    pb_point2D uv_start = {-10.f, 10.f};
+    pb_point2D uv_size = {20.f, -20.f};
+    size_t num_verts;
+    int reverse;
+    size_t i;
+
+    srand(17);
+    fill_random_points(points, KERNEL_TEST_NUM_POINTS);
+    for (i = 0; i < KERNEL_TEST_NUM_POINTS; ++i) {
+        indices[i] = (size_t)rand() % KERNEL_TEST_NUM_POINTS;
+    }
+
+    /* Make sure that the vertices lying on the centre are covered */
+    points[indices[3]] = centre;
+
+    for (num_verts = 0; num_verts <= 19; ++num_verts) {
+        for (reverse = 0; reverse <= 1; ++reverse) {
+            memset(expected, 0xcd, sizeof(expected));
+            memset(actual, 0xcd, sizeof(actual));
+
+            pb_fill_surface_verts_scalar(points, indices, num_verts, reverse, &centre, &uv_start, &uv_size,
+                                         reverse ? -1.f : 1.f, expected);
+            pb_fill_surface_verts(points, indices, num_verts, reverse, &centre, &uv_start, &uv_size,
+                                  reverse ? -1.f : 1.f, actual);
+
+            ck_assert_msg(memcmp(expected, actual, sizeof(expected)) == 0,
+                          "Vertices should have matched for %u vertices (reverse = %d)", (unsigned)num_verts, reverse);
+        }
+    }
+
+    /* Spot check the scalar kernel itself */
+    pb_fill_surface_verts_scalar(points, indices, 2, 1, &centre, &uv_start, &uv_size, -1.f, expected);
+    ck_assert_msg(expected[0].x == points[indices[1]].x - centre.x &&
+                  expected[0].z == centre.y - points[indices[1]].y &&
+                  expected[0].u == (points[indices[1]].x - uv_start.x) / uv_size.x &&
+                  expected[0].v == (points[indices[1]].y - uv_start.y) / uv_size.y &&
+                  expected[0].ny == -1.f && expected[1].x == points[indices[0]].x - centre.x,
+                  "The first reversed vertex should have come from the last index");
+}
+END_TEST
+
+START_TEST(quad_verts_match_scalar)
+{
+    /*
+     * Given random quads
+     * When I invoke pb_fill_quad_verts and pb_fill_quad_verts_scalar
+     * Then the vertices should be bit-identical, and laid out as two triangles sharing the quad's diagonal
+     */
+    pb_vert3D expected[6];
+    pb_vert3D actual[6];
+    pb_quad_verts q;
+    int i;
+
+    srand(29);
+    for (i = 0; i < 100; ++i) {
+        q.start_x = random_coord();
+        q.start_z = random_coord();
+        q.end_x = random_coord();
+        q.end_z = random_coord();
+        q.bottom = random_coord();
+        q.top = random_coord();
+        q.nx = random_coord();
+        q.nz = random_coord();
+        q.start_u = random_coord();
+        q.end_u = random_coord();
+        q.bottom_v = random_coord();
+        q.top_v = random_coord();
+
+        pb_fill_quad_verts_scalar(&q, expected);
+        pb_fill_quad_verts(&q, actual);
+        ck_assert_msg(memcmp(expected, actual, sizeof(expected)) == 0, "Quad %d should have matched", i);
+    }
+
+    ck_assert_msg(memcmp(expected + 3, expected + 0, sizeof(pb_vert3D)) == 0 &&
+                  memcmp(expected + 5, expected + 1, sizeof(pb_vert3D)) == 0,
+                  "The triangles should have shared the diagonal");
+    ck_assert_msg(expected[0].x == q.start_x && expected[0].y == q.bottom && expected[0].v == q.bottom_v &&
+                  expected[1].x == q.end_x && expected[1].y == q.top && expected[1].u == q.end_u &&
+                  expected[2].z == q.start_z && expected[2].y == q.top && expected[2].nz == q.nz &&
+                  expected[4].z == q.end_z && expected[4].y == q.bottom && expected[4].ny == 0.f,
+                  "The corners should have been in the right order");
+}
+END_TEST
+
+/* Checks that bounds are the same as the bounds of a shape's vertices, apart from rounding in the radius. */
+static int bounds_match_shape(pb_bounds3D const* bounds, pb_shape3D const* shape) {
+    pb_bounds3D expected;
+    pb_shape3D_get_bounds(shape, &expected);
+
+    return memcmp(&bounds->min, &expected.min, sizeof(pb_point3D)) == 0 &&
+           memcmp(&bounds->max, &expected.max, sizeof(pb_point3D)) == 0 &&
+           memcmp(&bounds->centre, &expected.centre, sizeof(pb_point3D)) == 0 &&
+           fabsf(bounds->radius - expected.radius) <= 1e-4f;
+}
+
+START_TEST(bounds_match_vertices)
+{
+    /*
+     * Given random quads and surfaces
+     * When I invoke pb_get_quad_bounds and pb_get_surface_bounds
+     * Then the bounds should be the same as pb_shape3D_get_bounds gives for the vertices that the kernels fill in
+     */
+    pb_point2D points[KERNEL_TEST_NUM_POINTS];
+    size_t indices[KERNEL_TEST_NUM_POINTS * 3];
+    pb_vert3D verts[KERNEL_TEST_NUM_POINTS * 3];
+    pb_point2D centre = {1.5f, -2.f};
+    pb_point2D uv_start = {-10.f, 10.f};
+    pb_point2D uv_size = {20.f, -20.f};
+    pb_bounds3D bounds;
+    pb_shape3D shape;
+    pb_quad_verts q = {0};
+    size_t num_points;
+    size_t i;
+
+    srand(31);
+    shape.tris = verts;
+    for (i = 0; i < 100; ++i) {
+        q.start_x = random_coord();
+        q.start_z = random_coord();
+        q.end_x = random_coord();
+        q.end_z = random_coord();
+        q.bottom = random_coord();
+        q.top = random_coord();
+        shape.pos.x = random_coord();
+        shape.pos.y = random_coord();
+        shape.pos.z = random_coord();
+        shape.num_tris = 2;
+
+        pb_fill_quad_verts(&q, verts);
+        pb_get_quad_bounds(&q, &shape.pos, &bounds);
+        ck_assert_msg(bounds_match_shape(&bounds, &shape), "The bounds of quad %u should have matched", (unsigned)i);
+    }
+
+    /* Triangulations that use every point of the outline, as the floors' and ceilings' do */
+    fill_random_points(points, KERNEL_TEST_NUM_POINTS);
+    for (num_points = 3; num_points <= KERNEL_TEST_NUM_POINTS; ++num_points) {
+        for (i = 0; i < (num_points - 2) * 3; ++i) {
+            indices[i] = i < num_points ? i : (size_t)rand() % num_points;
+        }
+        shape.pos.x = random_coord();
+        shape.pos.y = random_coord();
+        shape.pos.z = random_coord();
+        shape.num_tris = num_points - 2;
+
+        pb_fill_surface_verts(points, indices, (num_points - 2) * 3, 0, &centre, &uv_start, &uv_size, 1.f, verts);
+        pb_get_surface_bounds(points, num_points, &centre, &shape.pos, &bounds);
+        ck_assert_msg(bounds_match_shape(&bounds, &shape),
+                      "The bounds of a surface with %u points should have matched", (unsigned)num_points);
+    }
+
+    pb_get_surface_bounds(points, 0, &centre, &shape.pos, &bounds);
+    ck_assert_msg(bounds.min.x > bounds.max.x, "A surface without points should have been left empty");
+}
+END_TEST
+
+/* Points every attribute of a layout at its own stream of the given type. */
+static void init_test_layout(pb_vertex_layout* layout, unsigned char* streams, size_t stream_size,
+                             pb_vertex_component_type type) {
+    size_t component_size = type == PB_VERTEX_FLOAT32 ? 4 : (type == PB_VERTEX_SNORM8 ? 1 : 2);
+
+    layout->position.data = streams;
+    layout->position.offset = 0;
+    layout->position.stride = component_size * 3;
+    layout->position.type = type;
+
+    /* Offset into its stream to make sure that offsets are respected */
+    layout->normal.data = streams + stream_size;
+    layout->normal.offset = 1;
+    layout->normal.stride = component_size * 3 + 1;
+    layout->normal.type = type;
+
+    layout->uv.data = streams + stream_size * 2;
+    layout->uv.offset = 0;
+    layout->uv.stride = component_size * 2;
+    layout->uv.type = type;
+}
+
+START_TEST(layout_writes_match_conversion)
+{
+    /*
+     * Given random quads and surfaces, and layouts of every component type
+     * When I write them straight into the layouts with pb_write_quad_verts and pb_write_surface_verts
+     * Then the bytes should be the same as filling in pb_vert3Ds and converting them with pb_write_verts
+     */
+    size_t const stream_size = KERNEL_TEST_NUM_POINTS * 3 * sizeof(float) + KERNEL_TEST_NUM_POINTS;
+    unsigned char expected[(KERNEL_TEST_NUM_POINTS * 3 * sizeof(float) + KERNEL_TEST_NUM_POINTS) * 3];
+    unsigned char actual[(KERNEL_TEST_NUM_POINTS * 3 * sizeof(float) + KERNEL_TEST_NUM_POINTS) * 3];
+    pb_point2D points[KERNEL_TEST_NUM_POINTS];
+    size_t indices[KERNEL_TEST_NUM_POINTS];
+    pb_vert3D verts[KERNEL_TEST_NUM_POINTS];
+    pb_point2D centre = {1.5f, -2.f};
+    pb_point2D uv_start = {-10.f, 10.f};
+    pb_point2D uv_size = {20.f, -20.f};
+    pb_vertex_layout expected_layout;
+    pb_vertex_layout actual_layout;
+    pb_quad_verts q;
+    int type;
+    int reverse;
+    size_t i;
+
+    srand(41);
+    fill_random_points(points, KERNEL_TEST_NUM_POINTS);
+    for (i = 0; i < KERNEL_TEST_NUM_POINTS; ++i) {
+        indices[i] = (size_t)rand() % KERNEL_TEST_NUM_POINTS;
+    }
+
+    for (type = PB_VERTEX_FLOAT32; type <= PB_VERTEX_SNORM8; ++type) {
+        init_test_layout(&expected_layout, expected, stream_size, (pb_vertex_component_type)type);
+        init_test_layout(&actual_layout, actual, stream_size, (pb_vertex_component_type)type);
+
+        for (reverse = 0; reverse <= 1; ++reverse) {
+            memset(expected, 0xcd, sizeof(expected));
+            memset(actual, 0xcd, sizeof(actual));
+
+            /* Start part of the way in to make sure that the first vertex is respected */
+            pb_fill_surface_verts(points, indices, KERNEL_TEST_NUM_POINTS - 5, reverse, &centre, &uv_start,
+                                  &uv_size, reverse ? -1.f : 1.f, verts);
+            pb_write_verts(verts, KERNEL_TEST_NUM_POINTS - 5, &expected_layout, 5);
+            pb_write_surface_verts(points, indices, KERNEL_TEST_NUM_POINTS - 5, reverse, &centre, &uv_start,
+                                   &uv_size, reverse ? -1.f : 1.f, &actual_layout, 5);
+
+            ck_assert_msg(memcmp(expected, actual, sizeof(expected)) == 0,
+                          "The surface should have matched for type %d (reverse = %d)", type, reverse);
+        }
+
+        for (i = 0; i < 20; ++i) {
+            q.start_x = random_coord();
+            q.start_z = random_coord();
+            q.end_x = random_coord();
+            q.end_z = random_coord();
+            q.bottom = random_coord();
+            q.top = random_coord();
+            q.nx = random_coord() / 10.f;
+            q.nz = random_coord() / 10.f;
+            q.start_u = random_coord();
+            q.end_u = random_coord();
+            q.bottom_v = random_coord();
+            q.top_v = random_coord();
+
+            memset(expected, 0xcd, sizeof(expected));
+            memset(actual, 0xcd, sizeof(actual));
+
+            pb_fill_quad_verts(&q, verts);
+            pb_write_verts(verts, 6, &expected_layout, i);
+            pb_write_quad_verts(&q, &actual_layout, i);
+
+            ck_assert_msg(memcmp(expected, actual, sizeof(expected)) == 0,
+                          "Quad %u should have matched for type %d", (unsigned)i, type);
+        }
+    }
+
+    /* Attributes without data are skipped */
+    memset(actual, 0xcd, sizeof(actual));
+    memset(expected, 0xcd, sizeof(expected));
+    init_test_layout(&actual_layout, actual, stream_size, PB_VERTEX_FLOAT32);
+    actual_layout.normal.data = NULL;
+    actual_layout.uv.data = NULL;
+    pb_write_quad_verts(&q, &actual_layout, 0);
+    ck_assert_msg(memcmp(actual + stream_size, expected, stream_size * 2) == 0,
+                  "Attributes without data should have been left alone");
+}
+END_TEST
+
+START_TEST(vertex_kernels_performance)
+{
+    /* Compares the kernels with their scalar versions over many rooms' worth of vertices */
+    size_t const num_verts = 1 << 16;
+    int const iterations = 200;
+    pb_point2D* points = malloc(sizeof(pb_point2D) * KERNEL_TEST_NUM_POINTS);
+    size_t* indices = malloc(sizeof(size_t) * num_verts);
+    pb_vert3D* out = malloc(sizeof(pb_vert3D) * num_verts);
+    pb_point2D centre = {1.5f, -2.f};
+    pb_point2D uv_start = {-10.f, 10.f};
+    pb_point2D uv_size = {20.f, -20.f};
+    pb_quad_verts q = {-1.f, 0.f, 1.f, 0.f, -1.f, 1.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f};
+    double scalar_ms, kernel_ms;
+    clock_t start;
+    size_t i;
+    int it;
+
+    ck_assert_msg(points && indices && out, "Out of memory");
+    srand(3);
+    fill_random_points(points, KERNEL_TEST_NUM_POINTS);
+    for (i = 0; i < num_verts; ++i) {
+        indices[i] = (size_t)rand() % KERNEL_TEST_NUM_POINTS;
+    }
+
+    start = clock();
+    for (it = 0; it < iterations; ++it) {
+        pb_fill_surface_verts_scalar(points, indices, num_verts, it & 1, &centre, &uv_start, &uv_size, 1.f, out);
+    }
+    scalar_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (it = 0; it < iterations; ++it) {
+        pb_fill_surface_verts(points, indices, num_verts, it & 1, &centre, &uv_start, &uv_size, 1.f, out);
+    }
+    kernel_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    printf("Floor/ceiling vertices (%d x %lu): %.2f ms scalar, %.2f ms vectorised\n",
+           iterations, (unsigned long)num_verts, scalar_ms, kernel_ms);
+
+    start = clock();
+    for (it = 0; it < iterations; ++it) {
+        for (i = 0; i + 6 <= num_verts; i += 6) {
+            q.start_u = (float)i;
+            pb_fill_quad_verts_scalar(&q, out + i);
+        }
+    }
+    scalar_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    start = clock();
+    for (it = 0; it < iterations; ++it) {
+        for (i = 0; i + 6 <= num_verts; i += 6) {
+            q.start_u = (float)i;
+            pb_fill_quad_verts(&q, out + i);
+        }
+    }
+    kernel_ms = (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    printf("Wall quads (%d x %lu): %.2f ms scalar, %.2f ms vectorised\n",
+           iterations, (unsigned long)(num_verts / 6), scalar_ms, kernel_ms);
+
+    free(points);
+    free(indices);
+    free(out);
+}
+END_TEST
+
+Suite *make_pb_vertex_kernels_suite(void)
+{
+    Suite *s;
+    TCase *tc_kernels;
+    TCase *tc_performance;
+
+    s = suite_create("Vertex kernels");
+
+    tc_kernels = tcase_create("Kernels match scalar code");
+    suite_add_tcase(s, tc_kernels);
+    tcase_add_test(tc_kernels, surface_verts_match_scalar);
+    tcase_add_test(tc_kernels, quad_verts_match_scalar);
+    tcase_add_test(tc_kernels, layout_writes_match_conversion);
+    tcase_add_test(tc_kernels, bounds_match_vertices);
+
+    tc_performance = tcase_create("Performance test");
+    suite_add_tcase(s, tc_performance);
+    tcase_add_test(tc_performance, vertex_kernels_performance);
+
+    return s;
+}
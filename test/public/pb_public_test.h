@@ -6,5 +6,6 @@
 
 Suite *make_pb_perf_suite(void);
 Suite *make_pb_extrusion_suite(void);
+Suite *make_pb_sq_house_suite(void);
 
 #endif /* PB_PUBLIC_TEST_H */
\ No newline at end of file
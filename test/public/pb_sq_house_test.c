@@ -0,0 +1,2409 @@
+#include "pb_public_test.h"
+#include <pb/sq_house.h>
+#include <pb/floor_plan.h>
+#include <pb/extrusion.h>
+#include <pb/simple_extruder.h>
+#include <pb/util/hashmap/hash_utils.h>
+#include <pb/util/float_utils.h>
+#include <pb/util/geom/shape_utils.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_TEST_ROOM_SPECS 4
+
+static pb_hashmap* create_room_specs(pb_sq_house_room_spec* specs) {
+    static char const* living_adj[] = { PB_SQ_HOUSE_OUTSIDE, PB_SQ_HOUSE_STAIRS, "Kitchen", "Bedroom", "Bathroom" };
+    static char const* kitchen_adj[] = { PB_SQ_HOUSE_OUTSIDE, "Living room" };
+    static char const* bedroom_adj[] = { PB_SQ_HOUSE_STAIRS, "Living room", "Bathroom" };
+    static char const* bathroom_adj[] = { PB_SQ_HOUSE_STAIRS, "Living room", "Bedroom" };
+    size_t i;
+    pb_hashmap* room_specs;
+
+    specs[0].name = "Living room";
+    specs[0].adjacent = &living_adj[0];
+    specs[0].num_adjacent = sizeof(living_adj) / sizeof(char*);
+    specs[0].priority = 0;
+    specs[0].max_instances = 1;
+    specs[0].area = 20.f;
+
+    specs[1].name = "Kitchen";
+    specs[1].adjacent = &kitchen_adj[0];
+    specs[1].num_adjacent = sizeof(kitchen_adj) / sizeof(char*);
+    specs[1].priority = 1;
+    specs[1].max_instances = 1;
+    specs[1].area = 15.f;
+
+    specs[2].name = "Bedroom";
+    specs[2].adjacent = &bedroom_adj[0];
+    specs[2].num_adjacent = sizeof(bedroom_adj) / sizeof(char*);
+    specs[2].priority = 2;
+    specs[2].max_instances = 4;
+    specs[2].area = 10.f;
+
+    specs[3].name = "Bathroom";
+    specs[3].adjacent = &bathroom_adj[0];
+    specs[3].num_adjacent = sizeof(bathroom_adj) / sizeof(char*);
+    specs[3].priority = 3;
+    specs[3].max_instances = 3;
+    specs[3].area = 7.f;
+
+    room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
+    for (i = 0; i < NUM_TEST_ROOM_SPECS; ++i) {
+        pb_hashmap_put(room_specs, specs[i].name, &specs[i]);
+    }
+    return room_specs;
+}
+
+static void init_house_spec(pb_sq_house_house_spec* hspec) {
+    hspec->num_rooms = 8;
+    hspec->door_size = 0.75f;
+    hspec->window_size = 0.5f;
+    hspec->hallway_width = 0.75f;
+    hspec->stair_room_width = 3.f;
+    hspec->width = 12.f;
+    hspec->height = 8.f;
+}
+
+static int shapes_equal(pb_shape2D const* s1, pb_shape2D const* s2) {
+    return s1->points.size == s2->points.size &&
+           memcmp(s1->points.items, s2->points.items, sizeof(pb_point2D) * s1->points.size) == 0;
+}
+
+static int structures_equal(pb_wall_structure const* s1, size_t n1, pb_wall_structure const* s2, size_t n2) {
+    size_t i;
+    if (n1 != n2) {
+        return 0;
+    }
+    for (i = 0; i < n1; ++i) {
+        if (memcmp(&s1[i].start, &s2[i].start, sizeof(pb_point2D)) != 0 ||
+            memcmp(&s1[i].end, &s2[i].end, sizeof(pb_point2D)) != 0 ||
+            s1[i].wall != s2[i].wall) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int walls_equal(pb_vector const* w1, pb_vector const* w2) {
+    return w1->size == w2->size && memcmp(w1->items, w2->items, sizeof(int) * w1->size) == 0;
+}
+
+static int buildings_equal(pb_building const* b1, pb_building const* b2) {
+    size_t i, j;
+
+    if (b1->num_floors != b2->num_floors) {
+        return 0;
+    }
+
+    for (i = 0; i < b1->num_floors; ++i) {
+        pb_floor const* f1 = b1->floors + i;
+        pb_floor const* f2 = b2->floors + i;
+
+        if (f1->num_rooms != f2->num_rooms || !shapes_equal(&f1->shape, &f2->shape) ||
+            !structures_equal(f1->doors, f1->num_doors, f2->doors, f2->num_doors) ||
+            !structures_equal(f1->windows, f1->num_windows, f2->windows, f2->num_windows)) {
+            return 0;
+        }
+
+        for (j = 0; j < f1->num_rooms; ++j) {
+            pb_room const* r1 = f1->rooms + j;
+            pb_room const* r2 = f2->rooms + j;
+
+            if (strcmp(r1->name, r2->name) != 0 || !shapes_equal(&r1->shape, &r2->shape) ||
+                !walls_equal(&r1->walls, &r2->walls) ||
+                !structures_equal(r1->doors, r1->num_doors, r2->doors, r2->num_doors) ||
+                !structures_equal(r1->windows, r1->num_windows, r2->windows, r2->num_windows)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int shape_lists_equal(pb_shape3D const* l1, size_t n1, pb_shape3D const* l2, size_t n2) {
+    size_t i;
+    if (n1 != n2) {
+        return 0;
+    }
+    for (i = 0; i < n1; ++i) {
+        if (l1[i].num_tris != l2[i].num_tris ||
+            memcmp(&l1[i].pos, &l2[i].pos, sizeof(pb_point3D)) != 0 ||
+            memcmp(l1[i].tris, l2[i].tris, sizeof(pb_vert3D) * l1[i].num_tris * 3) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int wall_lists_equal(pb_shape3D* const* w1, size_t const* c1, size_t n1,
+                            pb_shape3D* const* w2, size_t const* c2, size_t n2) {
+    size_t i;
+    if (n1 != n2) {
+        return 0;
+    }
+    for (i = 0; i < n1; ++i) {
+        if (!shape_lists_equal(w1[i], c1[i], w2[i], c2[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int meshes_equal(pb_extruded_floor* const* m1, pb_extruded_floor* const* m2, size_t num_floors) {
+    size_t i, j;
+
+    for (i = 0; i < num_floors; ++i) {
+        pb_extruded_floor const* f1 = m1[i];
+        pb_extruded_floor const* f2 = m2[i];
+
+        if (f1->num_rooms != f2->num_rooms ||
+            !wall_lists_equal(f1->walls, f1->wall_counts, f1->num_wall_lists,
+                              f2->walls, f2->wall_counts, f2->num_wall_lists) ||
+            !shape_lists_equal(f1->doors, f1->num_doors, f2->doors, f2->num_doors) ||
+            !shape_lists_equal(f1->windows, f1->num_windows, f2->windows, f2->num_windows)) {
+            return 0;
+        }
+
+        for (j = 0; j < f1->num_rooms; ++j) {
+            pb_extruded_room const* r1 = f1->rooms[j];
+            pb_extruded_room const* r2 = f2->rooms[j];
+
+            if (!wall_lists_equal(r1->walls, r1->wall_counts, r1->num_wall_lists,
+                                  r2->walls, r2->wall_counts, r2->num_wall_lists) ||
+                !shape_lists_equal(r1->doors, r1->num_doors, r2->doors, r2->num_doors) ||
+                !shape_lists_equal(r1->windows, r1->num_windows, r2->windows, r2->num_windows) ||
+                !shape_lists_equal(r1->floor, r1->num_floor_shapes, r2->floor, r2->num_floor_shapes) ||
+                !shape_lists_equal(r1->ceiling, r1->num_ceiling_shapes, r2->ceiling, r2->num_ceiling_shapes)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static int contiguous_shapes_equal(pb_contiguous_building const* cb, pb_range range,
+                                   pb_shape3D const* l, size_t n) {
+    size_t i;
+    if (range.count != n) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        pb_contiguous_shape const* s = cb->shapes + range.start + i;
+        if (s->verts.count != l[i].num_tris * 3 ||
+            memcmp(&s->pos, &l[i].pos, sizeof(pb_point3D)) != 0 ||
+            memcmp(cb->verts + s->verts.start, l[i].tris, sizeof(pb_vert3D) * s->verts.count) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int contiguous_wall_lists_equal(pb_contiguous_building const* cb, pb_range wall_lists,
+                                       pb_shape3D* const* w, size_t const* c, size_t n) {
+    size_t i;
+    if (wall_lists.count != n) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (!contiguous_shapes_equal(cb, cb->wall_lists[wall_lists.start + i], w[i], c[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int contiguous_mesh_equal(pb_contiguous_building const* cb, pb_extruded_floor* const* m, size_t num_floors) {
+    size_t i, j;
+
+    if (cb->num_floors != num_floors) {
+        return 0;
+    }
+
+    for (i = 0; i < num_floors; ++i) {
+        pb_contiguous_floor const* cf = cb->floors + i;
+        pb_extruded_floor const* f = m[i];
+
+        if (cf->rooms.count != f->num_rooms ||
+            !contiguous_wall_lists_equal(cb, cf->wall_lists, f->walls, f->wall_counts, f->num_wall_lists) ||
+            !contiguous_shapes_equal(cb, cf->shapes[PB_EXTRUDED_DOOR], f->doors, f->num_doors) ||
+            !contiguous_shapes_equal(cb, cf->shapes[PB_EXTRUDED_WINDOW], f->windows, f->num_windows)) {
+            return 0;
+        }
+
+        for (j = 0; j < f->num_rooms; ++j) {
+            pb_contiguous_room const* cr = cb->rooms + cf->rooms.start + j;
+            pb_extruded_room const* r = f->rooms[j];
+
+            if (!contiguous_wall_lists_equal(cb, cr->wall_lists, r->walls, r->wall_counts, r->num_wall_lists) ||
+                !contiguous_shapes_equal(cb, cr->shapes[PB_EXTRUDED_DOOR], r->doors, r->num_doors) ||
+                !contiguous_shapes_equal(cb, cr->shapes[PB_EXTRUDED_WINDOW], r->windows, r->num_windows) ||
+                !contiguous_shapes_equal(cb, cr->shapes[PB_EXTRUDED_FLOOR], r->floor, r->num_floor_shapes) ||
+                !contiguous_shapes_equal(cb, cr->shapes[PB_EXTRUDED_CEILING], r->ceiling, r->num_ceiling_shapes)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Checks that every shape, room and floor covers exactly the vertices that follow the previous one. */
+static int contiguous_ranges_tile(pb_contiguous_building const* cb) {
+    size_t next_vert = 0;
+    size_t next_shape = 0;
+    size_t i, j, k;
+
+    for (i = 0; i < cb->num_floors; ++i) {
+        pb_contiguous_floor const* f = cb->floors + i;
+        if (f->verts.start != next_vert) {
+            return 0;
+        }
+
+        for (j = 0; j <= f->rooms.count; ++j) {
+            /* j == 0 is the floor's exterior */
+            pb_range const* shapes = j == 0 ? f->shapes : cb->rooms[f->rooms.start + j - 1].shapes;
+            size_t part_start = next_vert;
+
+            for (k = 0; k < PB_EXTRUDED_NUM_CATEGORIES; ++k) {
+                size_t s;
+                if (shapes[k].start != next_shape) {
+                    return 0;
+                }
+                for (s = shapes[k].start; s < shapes[k].start + shapes[k].count; ++s) {
+                    if (cb->shapes[s].verts.start != next_vert) {
+                        return 0;
+                    }
+                    next_vert += cb->shapes[s].verts.count;
+                }
+                next_shape += shapes[k].count;
+            }
+
+            if (j > 0) {
+                pb_range verts = cb->rooms[f->rooms.start + j - 1].verts;
+                if (verts.start != part_start || verts.count != next_vert - part_start) {
+                    return 0;
+                }
+            }
+        }
+
+        if (f->verts.count != next_vert - f->verts.start) {
+            return 0;
+        }
+    }
+
+    return next_vert == cb->num_verts && next_shape == cb->num_shapes;
+}
+
+START_TEST(sq_house_ex_same_seed)
+{
+    /*
+     * Given two generators seeded with the same value
+     * When I invoke pb_sq_house_ex with each of them
+     * Then the resulting buildings should be identical
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng1;
+    pb_rng rng2;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng1, 99);
+    pb_rng_seed(&rng2, 99);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b1 = pb_sq_house_ex(&hspec, room_specs, &rng1);
+        pb_building* b2 = pb_sq_house_ex(&hspec, room_specs, &rng2);
+
+        ck_assert_msg(b1 && b2, "Both houses should have been generated");
+        ck_assert_msg(buildings_equal(b1, b2), "House %d differed between generators with the same seed", i);
+
+        pb_building_free(b1, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        pb_building_free(b2, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b1);
+        free(b2);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_parallel_same_seed)
+{
+    /*
+     * Given two generators seeded with the same value
+     * When I invoke pb_sq_house_ex with one and pb_sq_house_parallel with the other
+     * Then the resulting buildings should be identical
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_thread_pool* pool = pb_thread_pool_create(4);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng1;
+    pb_rng rng2;
+    int i;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng1, 71);
+    pb_rng_seed(&rng2, 71);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b1 = pb_sq_house_ex(&hspec, room_specs, &rng1);
+        pb_building* b2 = pb_sq_house_parallel(&hspec, room_specs, &rng2, i % 2 ? pool : NULL);
+
+        ck_assert_msg(b1 && b2, "Both houses should have been generated");
+        ck_assert_msg(b1->num_floors > 1, "House %d should have had more than one floor", i);
+        ck_assert_msg(buildings_equal(b1, b2), "House %d differed between serial and parallel layout", i);
+
+        pb_building_free(b1, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        pb_building_free(b2, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b1);
+        free(b2);
+    }
+
+    pb_thread_pool_free(pool);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+static size_t num_freed_rooms;
+static size_t num_freed_floors;
+
+static void count_freed_room(pb_room const* room) {
+    (void)room;
+    ++num_freed_rooms;
+}
+
+static void count_freed_floor(pb_floor const* f) {
+    (void)f;
+    ++num_freed_floors;
+}
+
+START_TEST(sq_house_arena_building)
+{
+    /*
+     * Given a generated building
+     * Then it should already be backed by an arena, so packing it should do nothing
+     * And pb_building_free should still call the hooks for every room and floor
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 13);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_floor* floors;
+        pb_arena* arena;
+        size_t num_rooms = 0;
+        size_t j;
+
+        ck_assert_msg(b != NULL, "House %d should have been generated", i);
+        ck_assert_msg(b->arena != NULL, "A generated building should be backed by an arena");
+
+        floors = b->floors;
+        arena = b->arena;
+        ck_assert_msg(pb_building_pack(b) == 0, "Packing a generated building should have succeeded");
+        ck_assert_msg(b->arena == arena && b->floors == floors, "Packing a generated building shouldn't copy it");
+
+        for (j = 0; j < b->num_floors; ++j) {
+            num_rooms += b->floors[j].num_rooms;
+        }
+
+        num_freed_rooms = 0;
+        num_freed_floors = 0;
+        pb_building_free(b, pb_sq_house_free_building, count_freed_floor, count_freed_room);
+        ck_assert_msg(num_freed_rooms == num_rooms, "Expected %lu rooms to be freed, got %lu", (unsigned long)num_rooms,
+                      (unsigned long)num_freed_rooms);
+        ck_assert_msg(num_freed_floors == b->num_floors, "Expected %lu floors to be freed, got %lu",
+                      (unsigned long)b->num_floors, (unsigned long)num_freed_floors);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Copies an array with malloc. Empty arrays become NULL. */
+static void* copy_array(void const* src, size_t size) {
+    void* dst;
+    if (size == 0) {
+        return NULL;
+    }
+
+    dst = malloc(size);
+    ck_assert_msg(dst != NULL, "Copying an array failed");
+    memcpy(dst, src, size);
+    return dst;
+}
+
+static void copy_vector(pb_vector* vec) {
+    vec->items = copy_array(vec->items, vec->item_size * vec->size);
+    vec->cap = vec->size;
+}
+
+/* Copies a building into arrays allocated with malloc, as a floor plan generator without an arena would build it */
+static pb_building* copy_building_with_malloc(pb_building const* src) {
+    pb_building* b = malloc(sizeof(pb_building));
+    size_t i, j;
+
+    ck_assert_msg(b != NULL, "Copying a building failed");
+    *b = *src;
+    b->arena = NULL;
+    b->floors = copy_array(src->floors, sizeof(pb_floor) * src->num_floors);
+
+    for (i = 0; i < b->num_floors; ++i) {
+        pb_floor* f = b->floors + i;
+
+        f->rooms = copy_array(f->rooms, sizeof(pb_room) * f->num_rooms);
+        copy_vector(&f->shape.points);
+        f->doors = copy_array(f->doors, sizeof(pb_wall_structure) * f->num_doors);
+        f->windows = copy_array(f->windows, sizeof(pb_wall_structure) * f->num_windows);
+
+        for (j = 0; j < f->num_rooms; ++j) {
+            pb_room* r = f->rooms + j;
+
+            copy_vector(&r->shape.points);
+            copy_vector(&r->walls);
+            r->doors = copy_array(r->doors, sizeof(pb_wall_structure) * r->num_doors);
+            r->windows = copy_array(r->windows, sizeof(pb_wall_structure) * r->num_windows);
+        }
+    }
+
+    return b;
+}
+
+START_TEST(sq_house_pack_building)
+{
+    /*
+     * Given a building whose arrays were allocated with malloc
+     * When I invoke pb_building_pack on it
+     * Then the building should be unchanged apart from being backed by an arena, and should be freed by pb_building_free
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 5);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b1 = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_building* b2 = copy_building_with_malloc(b1);
+
+        ck_assert_msg(pb_building_pack(b2) == 0, "Packing should have succeeded");
+        ck_assert_msg(b2->arena != NULL, "A packed building should have an arena");
+        ck_assert_msg(buildings_equal(b1, b2), "Packed building %d differed from the original", i);
+
+        /* Packing twice does nothing */
+        ck_assert_msg(pb_building_pack(b2) == 0, "Packing a packed building should have succeeded");
+
+        pb_building_free(b1, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        pb_building_free(b2, NULL, NULL, NULL);
+        free(b1);
+        free(b2);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_contiguous)
+{
+    /*
+     * Given a generated building
+     * When I invoke pb_extrude_building_contiguous on it
+     * Then every shape should match the output of pb_extrude_building, and the ranges should tile the vertex buffer
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 17);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** m = pb_extrude_building(b, 2.f, 1.5f, 0.5f,
+                                                    pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+
+        ck_assert_msg(m && cb, "Both extrusions should have succeeded");
+        ck_assert_msg(contiguous_mesh_equal(cb, m, b->num_floors), "Contiguous mesh %d differed from the tree", i);
+        ck_assert_msg(contiguous_ranges_tile(cb), "Contiguous mesh %d had gaps or overlaps", i);
+
+        pb_contiguous_building_free(cb);
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/**
+ * Checks that expanding the indices of an indexed building gives back the vertices of the contiguous building it was
+ * made from (to within the welding tolerance), and that no vertex in a shape was duplicated.
+ */
+static int indexed_mesh_matches(pb_indexed_building const* ib, pb_contiguous_building const* cb, size_t fuzz_bits) {
+    size_t i, j, k;
+
+    if (ib->num_shapes != cb->num_shapes || ib->num_indices != cb->num_verts || ib->num_verts > cb->num_verts) {
+        return 0;
+    }
+
+    for (i = 0; i < ib->num_shapes; ++i) {
+        pb_indexed_shape const* shape = ib->shapes + i;
+        pb_contiguous_shape const* original = cb->shapes + i;
+
+        if (shape->indices.start != original->verts.start || shape->indices.count != original->verts.count ||
+            memcmp(&shape->pos, &original->pos, sizeof(pb_point3D)) != 0) {
+            return 0;
+        }
+
+        for (j = 0; j < shape->indices.count; ++j) {
+            size_t index = ib->index_size == 2 ? ((uint16_t const*)ib->indices)[shape->indices.start + j]
+                                               : ((uint32_t const*)ib->indices)[shape->indices.start + j];
+            float const* welded;
+            float const* expected;
+
+            if (index >= shape->verts.count) {
+                return 0;
+            }
+
+            welded = (float const*)(ib->verts + shape->verts.start + index);
+            expected = (float const*)(cb->verts + original->verts.start + j);
+            for (k = 0; k < sizeof(pb_vert3D) / sizeof(float); ++k) {
+                if (!pb_float_approx_eq(welded[k] + 0.f, expected[k] + 0.f, fuzz_bits)) {
+                    return 0;
+                }
+            }
+        }
+
+        for (j = 1; j < shape->verts.count; ++j) {
+            for (k = 0; k < j; ++k) {
+                if (memcmp(ib->verts + shape->verts.start + j, ib->verts + shape->verts.start + k,
+                           sizeof(pb_vert3D)) == 0) {
+                    return 0;
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+START_TEST(sq_house_extrude_indexed)
+{
+    /*
+     * Given a building extruded with pb_extrude_building_contiguous
+     * When I invoke pb_contiguous_building_index on it
+     * Then the indices should reproduce the original triangles from fewer vertices
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 53);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        pb_indexed_building* ib = pb_contiguous_building_index(cb, 5);
+        ck_assert_msg(ib != NULL, "Indexing should have succeeded");
+        ck_assert_msg(ib->index_size == 2, "Houses this small should have had 16-bit indices");
+        ck_assert_msg(ib->num_verts < cb->num_verts, "Welding should have removed vertices from mesh %d", i);
+        ck_assert_msg(indexed_mesh_matches(ib, cb, 5), "Indexed mesh %d differed from the contiguous mesh", i);
+
+        pb_indexed_building_free(ib);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+static int compare_tris(void const* a, void const* b) {
+    return memcmp(a, b, sizeof(pb_vert3D) * 3);
+}
+
+/**
+ * Expands every shape of an indexed building into triangles, sorting each shape's triangles so that two buildings can
+ * be compared regardless of triangle and vertex order.
+ */
+static pb_vert3D* sorted_indexed_tris(pb_indexed_building const* ib) {
+    pb_vert3D* tris = malloc(sizeof(pb_vert3D) * (ib->num_indices ? ib->num_indices : 1));
+    size_t i, j;
+
+    for (i = 0; i < ib->num_shapes; ++i) {
+        pb_indexed_shape const* shape = ib->shapes + i;
+        for (j = 0; j < shape->indices.count; ++j) {
+            size_t index = ib->index_size == 2 ? ((uint16_t const*)ib->indices)[shape->indices.start + j]
+                                               : ((uint32_t const*)ib->indices)[shape->indices.start + j];
+            tris[shape->indices.start + j] = ib->verts[shape->verts.start + index];
+        }
+        qsort(tris + shape->indices.start, shape->indices.count / 3, sizeof(pb_vert3D) * 3, compare_tris);
+    }
+
+    return tris;
+}
+
+START_TEST(sq_house_extrude_optimized)
+{
+    /*
+     * Given an indexed building
+     * When I invoke pb_indexed_building_optimize on it
+     * Then each shape should have the same triangles, and the average cache miss ratio shouldn't have increased
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 59);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        pb_indexed_building* ib = pb_contiguous_building_index(cb, 5);
+        ck_assert_msg(ib != NULL, "Indexing should have succeeded");
+
+        pb_vert3D* before = sorted_indexed_tris(ib);
+        float acmr_before;
+        float acmr_after;
+        ck_assert_msg(pb_indexed_building_optimize(ib, 16, &acmr_before, &acmr_after) == 0,
+                      "Optimising should have succeeded");
+        pb_vert3D* after = sorted_indexed_tris(ib);
+
+        ck_assert_msg(memcmp(before, after, sizeof(pb_vert3D) * ib->num_indices) == 0,
+                      "Optimising mesh %d should only have reordered triangles and vertices", i);
+        ck_assert_msg(acmr_after <= acmr_before, "Optimising mesh %d increased its ACMR from %f to %f",
+                      i, acmr_before, acmr_after);
+        ck_assert_msg(acmr_after >= 0.5f, "ACMR of mesh %d should have been at least 0.5, was %f", i, acmr_after);
+
+        free(before);
+        free(after);
+        pb_indexed_building_free(ib);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/**
+ * Checks that every vertex of a quantised building dequantises to within half a quantisation step of the vertex it
+ * was made from, and that its normal points in the same direction.
+ */
+static int quantized_mesh_matches(pb_quantized_building const* qb, pb_contiguous_building const* cb) {
+    size_t floor_idx, i, j;
+
+    if (qb->num_verts != cb->num_verts || qb->num_floors != cb->num_floors) {
+        return 0;
+    }
+
+    for (i = 0, floor_idx = 0; i < cb->num_shapes; ++i) {
+        pb_contiguous_shape const* shape = cb->shapes + i;
+
+        while (floor_idx < cb->num_floors &&
+               shape->verts.start >= cb->floors[floor_idx].verts.start + cb->floors[floor_idx].verts.count) {
+            ++floor_idx;
+        }
+
+        for (j = shape->verts.start; j < shape->verts.start + shape->verts.count; ++j) {
+            pb_dequantization const* d = qb->floors + floor_idx;
+            pb_vert3D const* expected = cb->verts + j;
+            pb_vert3D actual;
+
+            pb_dequantize_vert3D(qb->verts + j, d, &actual);
+            if (fabsf(actual.x - (expected->x + shape->pos.x)) > d->pos_scale.x * 0.5f + 1e-4f ||
+                fabsf(actual.y - (expected->y + shape->pos.y)) > d->pos_scale.y * 0.5f + 1e-4f ||
+                fabsf(actual.z - (expected->z + shape->pos.z)) > d->pos_scale.z * 0.5f + 1e-4f ||
+                fabsf(actual.u - expected->u) > d->uv_scale.x * 0.5f + 1e-4f ||
+                fabsf(actual.v - expected->v) > d->uv_scale.y * 0.5f + 1e-4f ||
+                actual.nx * expected->nx + actual.ny * expected->ny + actual.nz * expected->nz < 0.99f) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+START_TEST(sq_house_extrude_quantized)
+{
+    /*
+     * Given a building extruded with pb_extrude_building_contiguous
+     * When I invoke pb_contiguous_building_quantize on it
+     * Then every vertex should take 12 bytes and dequantise to within the precision of its floor's bounds
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    ck_assert_msg(sizeof(pb_quantized_vert3D) == 12, "Quantised vertices should have been 12 bytes, were %lu",
+                  (unsigned long)sizeof(pb_quantized_vert3D));
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 61);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        pb_quantized_building* qb = pb_contiguous_building_quantize(cb);
+        ck_assert_msg(qb != NULL, "Quantising should have succeeded");
+        ck_assert_msg(quantized_mesh_matches(qb, cb), "Quantised mesh %d differed from the contiguous mesh", i);
+
+        pb_quantized_building_free(qb);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Accumulates the total area, uv area and facing of a list of triangles. */
+typedef struct {
+    double area;
+    double uv_area;
+    size_t num_front_facing;
+    size_t num_tris;
+} tri_stats;
+
+static void add_tri_stats(pb_vert3D const* verts, size_t num_verts, tri_stats* stats) {
+    size_t i;
+
+    for (i = 0; i < num_verts; i += 3) {
+        pb_vert3D const* a = verts + i;
+        pb_vert3D const* b = verts + i + 1;
+        pb_vert3D const* c = verts + i + 2;
+        double e1[3] = {b->x - a->x, b->y - a->y, b->z - a->z};
+        double e2[3] = {c->x - a->x, c->y - a->y, c->z - a->z};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+
+        stats->area += sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) / 2.0;
+        stats->uv_area += fabs((b->u - a->u) * (c->v - a->v) - (c->u - a->u) * (b->v - a->v)) / 2.0;
+        stats->num_front_facing += n[0] * a->nx + n[1] * a->ny + n[2] * a->nz > 0.0;
+        stats->num_tris++;
+    }
+}
+
+START_TEST(sq_house_merge_walls)
+{
+    /*
+     * Given multi-storey buildings extruded with pb_extrude_building_contiguous
+     * When I invoke pb_contiguous_building_merge_walls on them
+     * Then the walls should cover the same area (and uv area) with fewer triangles, all facing the same way as before
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng, 73);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        tri_stats before = {0};
+        tri_stats after = {0};
+        size_t j, k;
+
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+        ck_assert_msg(b->num_floors > 1, "House %d should have had more than one floor", i);
+
+        pb_merged_walls* mw = pb_contiguous_building_merge_walls(cb);
+        ck_assert_msg(mw != NULL, "Merging should have succeeded");
+
+        for (j = 0; j < cb->num_floors + cb->num_rooms; ++j) {
+            pb_range walls = j < cb->num_floors ? cb->floors[j].shapes[PB_EXTRUDED_WALL]
+                                                : cb->rooms[j - cb->num_floors].shapes[PB_EXTRUDED_WALL];
+            for (k = walls.start; k < walls.start + walls.count; ++k) {
+                add_tri_stats(cb->verts + cb->shapes[k].verts.start, cb->shapes[k].verts.count, &before);
+            }
+        }
+        for (j = 0; j < mw->num_shapes; ++j) {
+            add_tri_stats(mw->verts + mw->shapes[j].verts.start, mw->shapes[j].verts.count, &after);
+        }
+
+        ck_assert_msg(after.num_tris < before.num_tris, "Merging should have removed triangles from house %d", i);
+        ck_assert_msg(fabs(after.area - before.area) < before.area * 1e-4,
+                      "Walls of house %d covered %f before merging and %f after", i, before.area, after.area);
+        ck_assert_msg(fabs(after.uv_area - before.uv_area) < before.uv_area * 1e-4,
+                      "Walls of house %d had a uv area of %f before merging and %f after",
+                      i, before.uv_area, after.uv_area);
+        ck_assert_msg(before.num_front_facing == before.num_tris || before.num_front_facing == 0,
+                      "Walls of house %d should all have been wound the same way", i);
+        ck_assert_msg((after.num_front_facing == after.num_tris) == (before.num_front_facing == before.num_tris) &&
+                      (after.num_front_facing == 0) == (before.num_front_facing == 0),
+                      "Merged walls of house %d should have been wound like the original ones", i);
+
+        pb_merged_walls_free(mw);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Gets a point and its uvs a fraction of the way from the centre of a triangle to one of its corners, in world space. */
+static void get_inner_point(pb_vert3D const* verts, pb_contiguous_shape const* shape, size_t tri, size_t corner,
+                            double t, double p[3], double uv[2]) {
+    pb_vert3D const* v = verts + shape->verts.start + tri * 3;
+    pb_vert3D const* c = v + corner;
+    double centre[5] = {(v[0].x + v[1].x + v[2].x) / 3.0, (v[0].y + v[1].y + v[2].y) / 3.0,
+                        (v[0].z + v[1].z + v[2].z) / 3.0, (v[0].u + v[1].u + v[2].u) / 3.0,
+                        (v[0].v + v[1].v + v[2].v) / 3.0};
+
+    p[0] = centre[0] + t * (c->x - centre[0]) + shape->pos.x;
+    p[1] = centre[1] + t * (c->y - centre[1]) + shape->pos.y;
+    p[2] = centre[2] + t * (c->z - centre[2]) + shape->pos.z;
+    uv[0] = centre[3] + t * (c->u - centre[3]);
+    uv[1] = centre[4] + t * (c->v - centre[4]);
+}
+
+/**
+ * Finds the uvs that the merged walls give a point on a wall facing along a normal, by interpolating the uvs of the
+ * merged triangle that faces the same way and contains the point.
+ *
+ * @return 1 if such a triangle was found, 0 otherwise.
+ */
+static int get_merged_uv(pb_merged_walls const* mw, double const* p, pb_vert3D const* normal, double uv[2]) {
+    size_t i, j;
+
+    for (i = 0; i < mw->num_shapes; ++i) {
+        pb_contiguous_shape const* shape = mw->shapes + i;
+
+        for (j = 0; j < shape->verts.count; j += 3) {
+            pb_vert3D const* v = mw->verts + shape->verts.start + j;
+            double a[3] = {v[0].x + shape->pos.x, v[0].y + shape->pos.y, v[0].z + shape->pos.z};
+            double e1[3] = {v[1].x - v[0].x, v[1].y - v[0].y, v[1].z - v[0].z};
+            double e2[3] = {v[2].x - v[0].x, v[2].y - v[0].y, v[2].z - v[0].z};
+            double ep[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+            double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            double n_len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            double d11 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+            double d12 = e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2];
+            double d22 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+            double dp1 = ep[0] * e1[0] + ep[1] * e1[1] + ep[2] * e1[2];
+            double dp2 = ep[0] * e2[0] + ep[1] * e2[1] + ep[2] * e2[2];
+            double denom = d11 * d22 - d12 * d12;
+            double b1, b2;
+
+            if (n_len == 0.0 || v[0].nx * normal->nx + v[0].ny * normal->ny + v[0].nz * normal->nz < 0.99 ||
+                fabs((ep[0] * n[0] + ep[1] * n[1] + ep[2] * n[2]) / n_len) > 1e-3) {
+                continue;
+            }
+
+            b1 = (d22 * dp1 - d12 * dp2) / denom;
+            b2 = (d11 * dp2 - d12 * dp1) / denom;
+            if (b1 < -1e-6 || b2 < -1e-6 || b1 + b2 > 1.0 + 1e-6) {
+                continue;
+            }
+
+            uv[0] = v[0].u + b1 * (v[1].u - v[0].u) + b2 * (v[2].u - v[0].u);
+            uv[1] = v[0].v + b1 * (v[1].v - v[0].v) + b2 * (v[2].v - v[0].v);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Checks whether two uvs are the same, give or take whole repeats of the texture. */
+static int uvs_repeat(double const* uv1, double const* uv2) {
+    double du = uv1[0] - uv2[0];
+    double dv = uv1[1] - uv2[1];
+    return fabs(du - floor(du + 0.5)) < 1e-3 && fabs(dv - floor(dv + 0.5)) < 1e-3;
+}
+
+START_TEST(sq_house_merge_walls_uvs)
+{
+    /*
+     * Given multi-storey buildings extruded with pb_extrude_building_contiguous, with rooms of different widths
+     * When I invoke pb_contiguous_building_merge_walls on them
+     * Then every point on the original walls should have the same uvs on the merged walls, give or take whole
+     * repeats of the texture
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng, 73);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        size_t j, k, t, c;
+
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        pb_merged_walls* mw = pb_contiguous_building_merge_walls(cb);
+        ck_assert_msg(mw != NULL, "Merging should have succeeded");
+
+        for (j = 0; j < cb->num_floors + cb->num_rooms; ++j) {
+            pb_range walls = j < cb->num_floors ? cb->floors[j].shapes[PB_EXTRUDED_WALL]
+                                                : cb->rooms[j - cb->num_floors].shapes[PB_EXTRUDED_WALL];
+            for (k = walls.start; k < walls.start + walls.count; ++k) {
+                pb_contiguous_shape const* shape = cb->shapes + k;
+
+                for (t = 0; t < shape->verts.count / 3; ++t) {
+                    for (c = 0; c < 3; ++c) {
+                        double p[3];
+                        double expected[2];
+                        double actual[2];
+
+                        get_inner_point(cb->verts, shape, t, c, 0.9, p, expected);
+                        ck_assert_msg(get_merged_uv(mw, p, cb->verts + shape->verts.start + t * 3, actual),
+                                      "(%f, %f, %f) on house %d should have been covered by a merged wall",
+                                      p[0], p[1], p[2], i);
+                        ck_assert_msg(uvs_repeat(expected, actual),
+                                      "(%f, %f, %f) on house %d had uvs (%f, %f) before merging and (%f, %f) after",
+                                      p[0], p[1], p[2], i, expected[0], expected[1], actual[0], actual[1]);
+                    }
+                }
+            }
+        }
+
+        pb_merged_walls_free(mw);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Gets the corners of a triangle in a pb_contiguous_building in world space. */
+static void get_world_tri(pb_contiguous_building const* cb, pb_contiguous_shape const* shape, size_t tri,
+                          double corners[3][3]) {
+    size_t i;
+    for (i = 0; i < 3; ++i) {
+        pb_vert3D const* v = cb->verts + shape->verts.start + tri * 3 + i;
+        corners[i][0] = v->x + shape->pos.x;
+        corners[i][1] = v->y + shape->pos.y;
+        corners[i][2] = v->z + shape->pos.z;
+    }
+}
+
+static double tri_area(double const* a, double const* b, double const* c) {
+    double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    return sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) / 2.0;
+}
+
+/* Counts the room wall triangles of a floor that contain a point. */
+static size_t count_covering_walls(pb_contiguous_building const* cb, size_t floor, double const* p) {
+    pb_range rooms = cb->floors[floor].rooms;
+    size_t count = 0;
+    size_t i, j, k;
+
+    for (i = rooms.start; i < rooms.start + rooms.count; ++i) {
+        pb_range walls = cb->rooms[i].shapes[PB_EXTRUDED_WALL];
+
+        for (j = walls.start; j < walls.start + walls.count; ++j) {
+            for (k = 0; k < cb->shapes[j].verts.count / 3; ++k) {
+                double c[3][3];
+                get_world_tri(cb, cb->shapes + j, k, c);
+
+                double area = tri_area(c[0], c[1], c[2]);
+                double sum = tri_area(p, c[0], c[1]) + tri_area(p, c[1], c[2]) + tri_area(p, c[2], c[0]);
+                count += area > 0.0 && sum - area < area * 1e-4;
+            }
+        }
+    }
+
+    return count;
+}
+
+START_TEST(sq_house_extrude_shared_walls_once)
+{
+    /*
+     * Given multi-storey buildings whose rooms share walls
+     * When I extrude them with pb_extrude_building_contiguous_ex and PB_EXTRUDE_SHARED_WALLS_ONCE
+     * Then the rooms' walls should cover the same surfaces as without the flag, each covered by exactly one triangle,
+     *      and everything else should be unchanged
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng, 73);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        pb_contiguous_building* shared = pb_extrude_building_contiguous_ex(b, 2.f, 1.5f, 0.5f,
+                                                                           pb_simple_door_extruder,
+                                                                           pb_simple_window_extruder,
+                                                                           NULL, NULL, PB_EXTRUDE_SHARED_WALLS_ONCE);
+        size_t num_wall_tris = 0;
+        size_t num_shared_wall_tris = 0;
+        size_t j, k, l, m;
+
+        ck_assert_msg(cb != NULL && shared != NULL, "Extrusion should have succeeded");
+        ck_assert_msg(b->num_floors > 1, "House %d should have had more than one floor", i);
+        ck_assert_msg(contiguous_ranges_tile(shared), "The ranges of house %d should tile its arrays", i);
+        ck_assert_msg(shared->num_rooms == cb->num_rooms && shared->num_wall_lists == cb->num_wall_lists,
+                      "House %d should have had the same rooms and wall lists", i);
+
+        for (j = 0; j < cb->num_floors; ++j) {
+            pb_contiguous_floor const* f = cb->floors + j;
+            pb_contiguous_floor const* shared_f = shared->floors + j;
+
+            for (k = 0; k < PB_EXTRUDED_NUM_CATEGORIES; ++k) {
+                ck_assert_msg(shared_f->shapes[k].count == f->shapes[k].count,
+                              "The exterior of floor %u in house %d should not have changed", (unsigned)j, i);
+            }
+
+            for (k = f->rooms.start; k < f->rooms.start + f->rooms.count; ++k) {
+                pb_contiguous_room const* r = cb->rooms + k;
+                pb_contiguous_room const* shared_r = shared->rooms + k;
+                pb_range walls = r->shapes[PB_EXTRUDED_WALL];
+                pb_range shared_walls = shared_r->shapes[PB_EXTRUDED_WALL];
+
+                ck_assert_msg(shared_r->shapes[PB_EXTRUDED_FLOOR].count == r->shapes[PB_EXTRUDED_FLOOR].count &&
+                              shared_r->shapes[PB_EXTRUDED_CEILING].count == r->shapes[PB_EXTRUDED_CEILING].count,
+                              "The floor and ceiling of room %u in house %d should not have changed", (unsigned)k, i);
+                ck_assert_msg(shared_r->shapes[PB_EXTRUDED_DOOR].count <= r->shapes[PB_EXTRUDED_DOOR].count,
+                              "Room %u of house %d should not have gained doors", (unsigned)k, i);
+
+                /* Everything that was covered before still is, exactly once */
+                for (l = walls.start; l < walls.start + walls.count; ++l) {
+                    for (m = 0; m < cb->shapes[l].verts.count / 3; ++m) {
+                        double c[3][3];
+                        double p[3];
+                        size_t n;
+                        get_world_tri(cb, cb->shapes + l, m, c);
+
+                        /* Not the centroid, which can land on the diagonal of a quad */
+                        for (n = 0; n < 3; ++n) {
+                            p[n] = c[0][n] * 0.21 + c[1][n] * 0.33 + c[2][n] * 0.46;
+                        }
+
+                        ck_assert_msg(count_covering_walls(shared, j, p) == 1,
+                                      "A wall of room %u in house %d should have been covered once",
+                                      (unsigned)k, i);
+                    }
+                    num_wall_tris += cb->shapes[l].verts.count / 3;
+                }
+
+                for (l = shared_walls.start; l < shared_walls.start + shared_walls.count; ++l) {
+                    num_shared_wall_tris += shared->shapes[l].verts.count / 3;
+                }
+            }
+        }
+
+        ck_assert_msg(num_shared_wall_tris < num_wall_tris,
+                      "House %d should have had fewer wall triangles (%u vs %u)",
+                      i, (unsigned)num_shared_wall_tris, (unsigned)num_wall_tris);
+
+        pb_contiguous_building_free(shared);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Checks that an instance matches one of the door or window quads of its part. */
+static int instance_matches_quad(pb_contiguous_building const* cb, pb_wall_structure_instance const* instance,
+                                 pb_extruded_category category) {
+    pb_contiguous_floor const* f = cb->floors + instance->floor;
+    pb_range shapes = instance->room == PB_EXTRUDED_EXTERIOR ? f->shapes[category]
+                                                             : cb->rooms[f->rooms.start + instance->room].shapes[category];
+    size_t i, j;
+
+    for (i = shapes.start; i < shapes.start + shapes.count; ++i) {
+        pb_contiguous_shape const* shape = cb->shapes + i;
+        pb_vert3D const* verts = cb->verts + shape->verts.start;
+        float min_y = INFINITY, max_y = -INFINITY, max_xz = 0.f;
+
+        if (fabsf(shape->pos.x - instance->pos.x) > 1e-4f ||
+            fabsf(shape->pos.y - instance->pos.y) > 1e-4f ||
+            fabsf(shape->pos.z - instance->pos.z) > 1e-4f) {
+            continue;
+        }
+
+        for (j = 0; j < shape->verts.count; ++j) {
+            min_y = fminf(min_y, verts[j].y);
+            max_y = fmaxf(max_y, verts[j].y);
+            max_xz = fmaxf(max_xz, sqrtf(verts[j].x * verts[j].x + verts[j].z * verts[j].z));
+        }
+
+        return fabsf(max_y - min_y - instance->height) < 1e-4f &&
+               fabsf(max_xz * 2.f - instance->width) < 1e-4f &&
+               fabsf(verts[0].nx - instance->normal.x) < 1e-4f &&
+               fabsf(verts[0].nz - instance->normal.z) < 1e-4f;
+    }
+
+    return 0;
+}
+
+static size_t count_category_shapes(pb_contiguous_building const* cb, pb_extruded_category category) {
+    size_t count = 0;
+    size_t i;
+
+    for (i = 0; i < cb->num_floors; ++i) {
+        count += cb->floors[i].shapes[category].count;
+    }
+    for (i = 0; i < cb->num_rooms; ++i) {
+        count += cb->rooms[i].shapes[category].count;
+    }
+    return count;
+}
+
+START_TEST(sq_house_extrude_instances)
+{
+    /*
+     * Given generated buildings
+     * When I invoke pb_extrude_building_instances on them, with door and window heights that the simple extruders
+     *      use as they are and ones that they cap
+     * Then there should be one instance per door and window quad of the extruded building, matching its position,
+     *      size and normal, and extruding with PB_EXTRUDE_INSTANCE_STRUCTURES should leave the quads out
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    float const heights[2][2] = {{1.5f, 0.5f}, {1.99f, 1.8f}};
+    unsigned flags, h;
+    int i;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng, 73);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+
+        for (h = 0; h < 2; ++h) {
+            for (flags = 0; flags <= PB_EXTRUDE_SHARED_WALLS_ONCE; ++flags) {
+                pb_contiguous_building* cb = pb_extrude_building_contiguous_ex(
+                    b, 2.f, heights[h][0], heights[h][1], pb_simple_door_extruder, pb_simple_window_extruder,
+                    NULL, NULL, flags);
+                pb_contiguous_building* walls_only = pb_extrude_building_contiguous_ex(
+                    b, 2.f, heights[h][0], heights[h][1], pb_simple_door_extruder, pb_simple_window_extruder,
+                    NULL, NULL, flags | PB_EXTRUDE_INSTANCE_STRUCTURES);
+                pb_wall_structure_instances* instances =
+                    pb_extrude_building_instances(b, 2.f, heights[h][0], heights[h][1], flags);
+                size_t j;
+
+                ck_assert_msg(cb != NULL && walls_only != NULL && instances != NULL,
+                              "Extrusion should have succeeded");
+                ck_assert_msg(instances->num_doors == count_category_shapes(cb, PB_EXTRUDED_DOOR) &&
+                              instances->num_windows == count_category_shapes(cb, PB_EXTRUDED_WINDOW),
+                              "House %d should have had one instance per door and window", i);
+                ck_assert_msg(instances->num_doors > 0 && instances->num_windows > 0,
+                              "House %d should have had doors and windows", i);
+
+                for (j = 0; j < instances->num_doors; ++j) {
+                    ck_assert_msg(instance_matches_quad(cb, instances->doors + j, PB_EXTRUDED_DOOR),
+                                  "Door instance %u of house %d should have matched a door", (unsigned)j, i);
+                }
+                for (j = 0; j < instances->num_windows; ++j) {
+                    ck_assert_msg(instance_matches_quad(cb, instances->windows + j, PB_EXTRUDED_WINDOW),
+                                  "Window instance %u of house %d should have matched a window", (unsigned)j, i);
+                }
+
+                ck_assert_msg(contiguous_ranges_tile(walls_only), "The ranges of house %d should tile its arrays", i);
+                ck_assert_msg(count_category_shapes(walls_only, PB_EXTRUDED_DOOR) == 0 &&
+                              count_category_shapes(walls_only, PB_EXTRUDED_WINDOW) == 0,
+                              "House %d should not have had door or window quads", i);
+                ck_assert_msg(count_category_shapes(walls_only, PB_EXTRUDED_WALL) ==
+                              count_category_shapes(cb, PB_EXTRUDED_WALL),
+                              "House %d should still have had every wall", i);
+
+                pb_wall_structure_instances_free(instances);
+                pb_contiguous_building_free(walls_only);
+                pb_contiguous_building_free(cb);
+            }
+        }
+
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+static int in_sphere(pb_bounds3D const* bounds, pb_point3D const* p) {
+    float dx = p->x - bounds->centre.x;
+    float dy = p->y - bounds->centre.y;
+    float dz = p->z - bounds->centre.z;
+    return sqrtf(dx * dx + dy * dy + dz * dz) <= bounds->radius + 1e-4f;
+}
+
+static int boxes_equal(pb_bounds3D const* b1, pb_bounds3D const* b2) {
+    return memcmp(&b1->min, &b2->min, sizeof(pb_point3D)) == 0 && memcmp(&b1->max, &b2->max, sizeof(pb_point3D)) == 0;
+}
+
+/**
+ * Checks the bounds of each shape against its vertices, and that the vertices are inside the sphere of outer (the
+ * shapes' room or floor). The vertices are also added to the box of total.
+ */
+static int shape_bounds_match(pb_shape3D const* shapes, size_t num_shapes, pb_bounds3D const* outer,
+                              pb_bounds3D* total) {
+    size_t i, j;
+    for (i = 0; i < num_shapes; ++i) {
+        pb_bounds3D box;
+        pb_bounds3D_clear(&box);
+
+        for (j = 0; j < shapes[i].num_tris * 3; ++j) {
+            pb_point3D p = {shapes[i].tris[j].x + shapes[i].pos.x,
+                            shapes[i].tris[j].y + shapes[i].pos.y,
+                            shapes[i].tris[j].z + shapes[i].pos.z};
+            if (!in_sphere(&shapes[i].bounds, &p) || !in_sphere(outer, &p)) {
+                return 0;
+            }
+            pb_bounds3D_add_point(&box, &p);
+            pb_bounds3D_add_point(total, &p);
+        }
+
+        if (!boxes_equal(&box, &shapes[i].bounds)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int wall_list_bounds_match(pb_shape3D* const* walls, size_t const* wall_counts, size_t num_wall_lists,
+                                  pb_bounds3D const* outer, pb_bounds3D* total) {
+    size_t i;
+    for (i = 0; i < num_wall_lists; ++i) {
+        if (walls[i] && !shape_bounds_match(walls[i], wall_counts[i], outer, total)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int room_bounds_match(pb_extruded_room const* r, pb_bounds3D const* floor_bounds, pb_bounds3D* floor_total) {
+    pb_bounds3D total;
+    pb_bounds3D_clear(&total);
+
+    if (!wall_list_bounds_match(r->walls, r->wall_counts, r->num_wall_lists, &r->bounds, &total) ||
+        !shape_bounds_match(r->windows, r->num_windows, &r->bounds, &total) ||
+        !shape_bounds_match(r->doors, r->num_doors, &r->bounds, &total) ||
+        !shape_bounds_match(r->floor, r->num_floor_shapes, &r->bounds, &total) ||
+        !shape_bounds_match(r->ceiling, r->num_ceiling_shapes, &r->bounds, &total) ||
+        !boxes_equal(&total, &r->bounds)) {
+        return 0;
+    }
+
+    /* Every vertex of the room was inside the room's sphere, so the room's sphere has to be inside the floor's */
+    if (!in_sphere(floor_bounds, &r->bounds.centre) ||
+        r->bounds.radius > floor_bounds->radius + 1e-4f) {
+        return 0;
+    }
+
+    pb_bounds3D_add_point(floor_total, &total.min);
+    pb_bounds3D_add_point(floor_total, &total.max);
+    return 1;
+}
+
+/* Checks the bounds of every shape, room and floor of an extruded building against their vertices. */
+static int building_bounds_match(pb_extruded_floor* const* m, size_t num_floors) {
+    size_t i, j;
+
+    for (i = 0; i < num_floors; ++i) {
+        pb_extruded_floor const* f = m[i];
+        pb_bounds3D total;
+        pb_bounds3D_clear(&total);
+
+        if (!wall_list_bounds_match(f->walls, f->wall_counts, f->num_wall_lists, &f->bounds, &total) ||
+            !shape_bounds_match(f->windows, f->num_windows, &f->bounds, &total) ||
+            !shape_bounds_match(f->doors, f->num_doors, &f->bounds, &total)) {
+            return 0;
+        }
+        for (j = 0; j < f->num_rooms; ++j) {
+            if (!room_bounds_match(f->rooms[j], &f->bounds, &total)) {
+                return 0;
+            }
+        }
+        if (!boxes_equal(&total, &f->bounds) || f->bounds.radius <= 0.f) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int bounds_equal(pb_bounds3D const* b1, pb_bounds3D const* b2) {
+    return boxes_equal(b1, b2) && memcmp(&b1->centre, &b2->centre, sizeof(pb_point3D)) == 0 &&
+           b1->radius == b2->radius;
+}
+
+/* Checks that two extrusions of a building have the same room and floor bounds. */
+static int building_bounds_equal(pb_extruded_floor* const* m1, pb_extruded_floor* const* m2, size_t num_floors) {
+    size_t i, j;
+    for (i = 0; i < num_floors; ++i) {
+        if (!bounds_equal(&m1[i]->bounds, &m2[i]->bounds)) {
+            return 0;
+        }
+        for (j = 0; j < m1[i]->num_rooms; ++j) {
+            if (!bounds_equal(&m1[i]->rooms[j]->bounds, &m2[i]->rooms[j]->bounds)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void clear_shape_bounds(pb_shape3D* shapes, size_t num_shapes) {
+    size_t i;
+    for (i = 0; i < num_shapes; ++i) {
+        pb_bounds3D_clear(&shapes[i].bounds);
+    }
+}
+
+/* Extrudes like the given extruder, but leaves the shapes' bounds cleared like an extruder that doesn't know of them. */
+static int extrude_without_bounds(pb_wall_structure_extruder const* extruder,
+                                  pb_line2D const* wall, pb_line2D const* wall_structure, pb_point2D const* normal,
+                                  pb_point2D const* bottom_floor_centre, float floor_height,
+                                  float struct_height, float start_height,
+                                  void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
+    size_t num_walls, num_structures;
+
+    extruder->count(wall, wall_structure, normal, bottom_floor_centre, floor_height, struct_height, start_height,
+                    param, &num_walls, &num_structures);
+    if (extruder->extrude(wall, wall_structure, normal, bottom_floor_centre, floor_height, struct_height,
+                          start_height, param, walls_out, structures_out) == -1) {
+        return -1;
+    }
+
+    clear_shape_bounds(*walls_out, num_walls);
+    clear_shape_bounds(*structures_out, num_structures);
+    return 0;
+}
+
+static int PB_CALL extrude_door_without_bounds(pb_line2D const* wall, pb_line2D const* wall_structure,
+                                               pb_point2D const* normal, pb_point2D const* bottom_floor_centre,
+                                               float floor_height, float struct_height, float start_height,
+                                               void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
+    return extrude_without_bounds(pb_simple_door_extruder, wall, wall_structure, normal, bottom_floor_centre,
+                                  floor_height, struct_height, start_height, param, walls_out, structures_out);
+}
+
+static int PB_CALL extrude_window_without_bounds(pb_line2D const* wall, pb_line2D const* wall_structure,
+                                                 pb_point2D const* normal, pb_point2D const* bottom_floor_centre,
+                                                 float floor_height, float struct_height, float start_height,
+                                                 void* param, pb_shape3D** walls_out, pb_shape3D** structures_out) {
+    return extrude_without_bounds(pb_simple_window_extruder, wall, wall_structure, normal, bottom_floor_centre,
+                                  floor_height, struct_height, start_height, param, walls_out, structures_out);
+}
+
+START_TEST(sq_house_extrude_bounds)
+{
+    /*
+     * Given generated buildings
+     * When I invoke pb_extrude_building_ex with PB_EXTRUDE_BOUNDS
+     * Then each shape, room and floor's box should exactly fit its vertices and its sphere should contain them, and
+     *      the shapes should be the same as without the flag
+     * And pb_extrude_building_parallel_ex should produce the same bounds
+     * And extruders that leave their shapes' bounds cleared should still have them bounded
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_thread_pool* pool = pb_thread_pool_create(4);
+    pb_wall_structure_extruder door_extruder = {0};
+    pb_wall_structure_extruder window_extruder = {0};
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    door_extruder.count = pb_simple_door_extruder->count;
+    door_extruder.extrude = extrude_door_without_bounds;
+    window_extruder.count = pb_simple_window_extruder->count;
+    window_extruder.extrude = extrude_window_without_bounds;
+
+    init_house_spec(&hspec);
+    hspec.width = 8.f;
+    hspec.height = 8.f;
+    pb_rng_seed(&rng, 73);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** m = pb_extrude_building(b, 2.f, 1.5f, 0.5f,
+                                                    pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL);
+        pb_extruded_floor** bounded = pb_extrude_building_ex(b, 2.f, 1.5f, 0.5f,
+                                                             pb_simple_door_extruder, pb_simple_window_extruder,
+                                                             NULL, NULL, PB_EXTRUDE_BOUNDS);
+        pb_extruded_floor** parallel = pb_extrude_building_parallel_ex(b, 2.f, 1.5f, 0.5f,
+                                                                       pb_simple_door_extruder,
+                                                                       pb_simple_window_extruder,
+                                                                       NULL, NULL, PB_EXTRUDE_BOUNDS, pool);
+        pb_extruded_floor** unaware = pb_extrude_building_ex(b, 2.f, 1.5f, 0.5f, &door_extruder, &window_extruder,
+                                                             NULL, NULL, PB_EXTRUDE_BOUNDS);
+
+        ck_assert_msg(m != NULL && bounded != NULL && parallel != NULL && unaware != NULL,
+                      "Extrusion should have succeeded");
+        ck_assert_msg(meshes_equal(m, bounded, b->num_floors), "House %d should have had the same shapes", i);
+        ck_assert_msg(building_bounds_match(bounded, b->num_floors), "The bounds of house %d should have matched", i);
+
+        ck_assert_msg(meshes_equal(m, parallel, b->num_floors) &&
+                      building_bounds_equal(bounded, parallel, b->num_floors),
+                      "House %d should have had the same bounds when extruded in parallel", i);
+        ck_assert_msg(meshes_equal(m, unaware, b->num_floors) && building_bounds_match(unaware, b->num_floors),
+                      "House %d should have been bounded without the extruders' help", i);
+
+        pb_extruded_building_free(unaware, b->num_floors);
+        pb_extruded_building_free(parallel, b->num_floors);
+        pb_extruded_building_free(bounded, b->num_floors);
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_thread_pool_free(pool);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* Checks that the shapes in a range of a contiguous building have the same bounds as a list of shapes. */
+static int contiguous_shape_bounds_equal(pb_contiguous_building const* cb, pb_range range,
+                                         pb_shape3D const* l, size_t n) {
+    size_t i;
+    if (range.count != n) {
+        return 0;
+    }
+    for (i = 0; i < n; ++i) {
+        if (!bounds_equal(&cb->shapes[range.start + i].bounds, &l[i].bounds)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int contiguous_wall_list_bounds_equal(pb_contiguous_building const* cb, pb_range wall_lists,
+                                             pb_shape3D* const* w, size_t const* c, size_t n) {
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        if (!contiguous_shape_bounds_equal(cb, cb->wall_lists[wall_lists.start + i], w[i], c[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Checks that a contiguous building has the same bounds everywhere as the tree it was compared with. */
+static int contiguous_bounds_equal(pb_contiguous_building const* cb, pb_extruded_floor* const* m) {
+    size_t i, j;
+
+    for (i = 0; i < cb->num_floors; ++i) {
+        pb_contiguous_floor const* cf = cb->floors + i;
+        pb_extruded_floor const* f = m[i];
+
+        if (!bounds_equal(&cf->bounds, &f->bounds) ||
+            !contiguous_wall_list_bounds_equal(cb, cf->wall_lists, f->walls, f->wall_counts, f->num_wall_lists) ||
+            !contiguous_shape_bounds_equal(cb, cf->shapes[PB_EXTRUDED_DOOR], f->doors, f->num_doors) ||
+            !contiguous_shape_bounds_equal(cb, cf->shapes[PB_EXTRUDED_WINDOW], f->windows, f->num_windows)) {
+            return 0;
+        }
+
+        for (j = 0; j < f->num_rooms; ++j) {
+            pb_contiguous_room const* cr = cb->rooms + cf->rooms.start + j;
+            pb_extruded_room const* r = f->rooms[j];
+
+            if (!bounds_equal(&cr->bounds, &r->bounds) ||
+                !contiguous_wall_list_bounds_equal(cb, cr->wall_lists, r->walls, r->wall_counts, r->num_wall_lists) ||
+                !contiguous_shape_bounds_equal(cb, cr->shapes[PB_EXTRUDED_DOOR], r->doors, r->num_doors) ||
+                !contiguous_shape_bounds_equal(cb, cr->shapes[PB_EXTRUDED_WINDOW], r->windows, r->num_windows) ||
+                !contiguous_shape_bounds_equal(cb, cr->shapes[PB_EXTRUDED_FLOOR], r->floor, r->num_floor_shapes) ||
+                !contiguous_shape_bounds_equal(cb, cr->shapes[PB_EXTRUDED_CEILING], r->ceiling,
+                                               r->num_ceiling_shapes)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* Checks that nothing in a contiguous building was bounded. */
+static int contiguous_bounds_cleared(pb_contiguous_building const* cb) {
+    size_t i;
+    for (i = 0; i < cb->num_shapes; ++i) {
+        if (cb->shapes[i].bounds.min.x <= cb->shapes[i].bounds.max.x) {
+            return 0;
+        }
+    }
+    for (i = 0; i < cb->num_rooms; ++i) {
+        if (cb->rooms[i].bounds.min.x <= cb->rooms[i].bounds.max.x) {
+            return 0;
+        }
+    }
+    for (i = 0; i < cb->num_floors; ++i) {
+        if (cb->floors[i].bounds.min.x <= cb->floors[i].bounds.max.x) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+START_TEST(sq_house_extrude_contiguous_bounds)
+{
+    /*
+     * Given generated buildings
+     * When I invoke pb_extrude_building_contiguous_ex and pb_extrude_building_into_layout_ex with PB_EXTRUDE_BOUNDS
+     * Then every shape, room and floor should have the same bounds as with pb_extrude_building_ex
+     * And without the flag, nothing should be bounded
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 79);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** m = pb_extrude_building_ex(b, 2.f, 1.5f, 0.5f,
+                                                       pb_simple_door_extruder, pb_simple_window_extruder,
+                                                       NULL, NULL, PB_EXTRUDE_BOUNDS);
+        pb_contiguous_building* plain = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                       pb_simple_door_extruder,
+                                                                       pb_simple_window_extruder, NULL, NULL);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous_ex(b, 2.f, 1.5f, 0.5f,
+                                                                       pb_simple_door_extruder,
+                                                                       pb_simple_window_extruder,
+                                                                       NULL, NULL, PB_EXTRUDE_BOUNDS);
+
+        ck_assert_msg(m && plain && cb, "Every extrusion should have succeeded");
+        ck_assert_msg(contiguous_mesh_equal(cb, m, b->num_floors) && contiguous_bounds_equal(cb, m),
+                      "The contiguous bounds of house %d should have matched the tree's", i);
+        ck_assert_msg(contiguous_bounds_cleared(plain), "House %d shouldn't have been bounded without the flag", i);
+
+        /* Shapes written straight into a layout are bounded without their vertices */
+        float* positions = malloc(sizeof(float) * 3 * cb->num_verts);
+        pb_vertex_layout layout = {
+            {positions, 0, sizeof(float) * 3, PB_VERTEX_FLOAT32},
+            {NULL, 0, 0, PB_VERTEX_FLOAT32},
+            {NULL, 0, 0, PB_VERTEX_FLOAT32}
+        };
+        pb_contiguous_building out = *cb;
+        out.verts = NULL;
+        out.shapes = malloc(sizeof(pb_contiguous_shape) * cb->num_shapes);
+        out.wall_lists = malloc(sizeof(pb_range) * cb->num_wall_lists);
+        out.rooms = malloc(sizeof(pb_contiguous_room) * cb->num_rooms);
+        out.floors = malloc(sizeof(pb_contiguous_floor) * cb->num_floors);
+
+        ck_assert_msg(pb_extrude_building_into_layout_ex(b, 2.f, 1.5f, 0.5f,
+                                                         pb_simple_door_extruder, pb_simple_window_extruder,
+                                                         NULL, NULL, PB_EXTRUDE_BOUNDS, &layout, &out) == 0,
+                      "Extruding into a layout should have succeeded");
+        ck_assert_msg(contiguous_bounds_equal(&out, m),
+                      "The bounds of house %d in a layout should have matched the tree's", i);
+
+        free(out.shapes);
+        free(out.wall_lists);
+        free(out.rooms);
+        free(out.floors);
+        free(positions);
+        pb_contiguous_building_free(cb);
+        pb_contiguous_building_free(plain);
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_ex_unsupported_flags)
+{
+    /*
+     * Given a generated building
+     * When I invoke pb_extrude_building_ex with flags that only the contiguous extrusion functions support
+     * Then extrusion should fail rather than ignore the flag
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 73);
+
+    pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+    ck_assert_msg(pb_extrude_building_ex(b, 2.f, 1.5f, 0.5f, pb_simple_door_extruder, pb_simple_window_extruder,
+                                         NULL, NULL, PB_EXTRUDE_SHARED_WALLS_ONCE | PB_EXTRUDE_BOUNDS) == NULL,
+                  "PB_EXTRUDE_SHARED_WALLS_ONCE should have been rejected");
+    ck_assert_msg(pb_extrude_building_ex(b, 2.f, 1.5f, 0.5f, pb_simple_door_extruder, pb_simple_window_extruder,
+                                         NULL, NULL, PB_EXTRUDE_INSTANCE_STRUCTURES) == NULL,
+                  "PB_EXTRUDE_INSTANCE_STRUCTURES should have been rejected");
+
+    pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+    free(b);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_into)
+{
+    /*
+     * Given generated buildings and one set of buffers that is reused for all of them
+     * When I measure each building and invoke pb_extrude_building_into with the buffers
+     * Then the measured sizes should match what was written, and every shape should match pb_extrude_building
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    pb_contiguous_building buffers;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 23);
+    memset(&buffers, 0, sizeof(pb_contiguous_building));
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** m = pb_extrude_building(b, 2.f, 1.5f, 0.5f,
+                                                    pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL);
+        pb_contiguous_building sizes;
+        pb_contiguous_building out;
+
+        ck_assert_msg(pb_extrude_building_measure(b, 2.f, 1.5f, 0.5f,
+                                                  pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                                  NULL, NULL, &sizes) == 0, "Measuring should have succeeded");
+
+        /* Only grow the buffers when a building doesn't fit */
+        if (sizes.num_verts > buffers.num_verts) {
+            buffers.verts = realloc(buffers.verts, sizeof(pb_vert3D) * sizes.num_verts);
+            buffers.num_verts = sizes.num_verts;
+        }
+        if (sizes.num_shapes > buffers.num_shapes) {
+            buffers.shapes = realloc(buffers.shapes, sizeof(pb_contiguous_shape) * sizes.num_shapes);
+            buffers.num_shapes = sizes.num_shapes;
+        }
+        if (sizes.num_wall_lists > buffers.num_wall_lists) {
+            buffers.wall_lists = realloc(buffers.wall_lists, sizeof(pb_range) * sizes.num_wall_lists);
+            buffers.num_wall_lists = sizes.num_wall_lists;
+        }
+        if (sizes.num_rooms > buffers.num_rooms) {
+            buffers.rooms = realloc(buffers.rooms, sizeof(pb_contiguous_room) * sizes.num_rooms);
+            buffers.num_rooms = sizes.num_rooms;
+        }
+        if (sizes.num_floors > buffers.num_floors) {
+            buffers.floors = realloc(buffers.floors, sizeof(pb_contiguous_floor) * sizes.num_floors);
+            buffers.num_floors = sizes.num_floors;
+        }
+
+        out = buffers;
+        ck_assert_msg(pb_extrude_building_into(b, 2.f, 1.5f, 0.5f,
+                                               pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                               &out) == 0, "Extruding into the buffers should have succeeded");
+        ck_assert_msg(out.num_verts == sizes.num_verts && out.num_shapes == sizes.num_shapes &&
+                      out.num_wall_lists == sizes.num_wall_lists && out.num_rooms == sizes.num_rooms &&
+                      out.num_floors == sizes.num_floors, "Building %d didn't match its measurements", i);
+        ck_assert_msg(contiguous_mesh_equal(&out, m, b->num_floors), "Mesh %d differed from the tree", i);
+        ck_assert_msg(contiguous_ranges_tile(&out), "Mesh %d had gaps or overlaps", i);
+
+        /* One vertex short */
+        out = buffers;
+        out.num_verts = sizes.num_verts - 1;
+        ck_assert_msg(pb_extrude_building_into(b, 2.f, 1.5f, 0.5f,
+                                               pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                               &out) == -1, "Extruding into a buffer that's too small should fail");
+
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    free(buffers.verts);
+    free(buffers.shapes);
+    free(buffers.wall_lists);
+    free(buffers.rooms);
+    free(buffers.floors);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+/* An engine's interleaved vertex format */
+typedef struct {
+    float pos[3];
+    int8_t normal[3];
+    int8_t pad;
+    uint16_t uv[2];
+} interleaved_vert;
+
+static float half_to_float(uint16_t h) {
+    float mantissa = (float)(h & 0x3FF);
+    int exponent = (h >> 10) & 0x1F;
+    float magnitude = exponent == 0 ? ldexpf(mantissa, -24) : ldexpf(mantissa + 1024.f, exponent - 25);
+    return h & 0x8000 ? -magnitude : magnitude;
+}
+
+START_TEST(sq_house_extrude_into_layout)
+{
+    /*
+     * Given a generated building
+     * When I invoke pb_extrude_building_into_layout with an interleaved layout and a separate (SoA) layout
+     * Then the shapes should match pb_extrude_building_contiguous, and the vertices should match to within the
+     *      precision of each attribute's format
+     * And extruders that can't write to a layout themselves should have their vertices converted to the same bytes
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 67);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        size_t n = cb->num_verts;
+        interleaved_vert* interleaved = calloc(n, sizeof(interleaved_vert));
+        float* positions = malloc(sizeof(float) * 3 * n);
+        int16_t* normals = malloc(sizeof(int16_t) * 3 * n);
+        float* uvs = malloc(sizeof(float) * 2 * n);
+        pb_vertex_layout interleaved_layout = {
+            {interleaved, offsetof(interleaved_vert, pos), sizeof(interleaved_vert), PB_VERTEX_FLOAT32},
+            {interleaved, offsetof(interleaved_vert, normal), sizeof(interleaved_vert), PB_VERTEX_SNORM8},
+            {interleaved, offsetof(interleaved_vert, uv), sizeof(interleaved_vert), PB_VERTEX_FLOAT16}
+        };
+        pb_vertex_layout separate_layout = {
+            {positions, 0, sizeof(float) * 3, PB_VERTEX_FLOAT32},
+            {normals, 0, sizeof(int16_t) * 3, PB_VERTEX_SNORM16},
+            {uvs, 0, sizeof(float) * 2, PB_VERTEX_FLOAT32}
+        };
+        pb_contiguous_building out = *cb;
+        size_t j, k;
+
+        out.verts = NULL;
+        out.shapes = malloc(sizeof(pb_contiguous_shape) * cb->num_shapes);
+        out.wall_lists = malloc(sizeof(pb_range) * cb->num_wall_lists);
+        out.rooms = malloc(sizeof(pb_contiguous_room) * cb->num_rooms);
+        out.floors = malloc(sizeof(pb_contiguous_floor) * cb->num_floors);
+
+        ck_assert_msg(pb_extrude_building_into_layout(b, 2.f, 1.5f, 0.5f,
+                                                      pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                                      &interleaved_layout, &out) == 0,
+                      "Extruding into an interleaved layout should have succeeded");
+        ck_assert_msg(out.num_verts == cb->num_verts && out.num_shapes == cb->num_shapes &&
+                      memcmp(out.floors, cb->floors, sizeof(pb_contiguous_floor) * cb->num_floors) == 0,
+                      "Mesh %d differed from the contiguous mesh", i);
+        for (j = 0; j < cb->num_shapes; ++j) {
+            ck_assert_msg(out.shapes[j].verts.start == cb->shapes[j].verts.start &&
+                          out.shapes[j].verts.count == cb->shapes[j].verts.count &&
+                          memcmp(&out.shapes[j].pos, &cb->shapes[j].pos, sizeof(pb_point3D)) == 0,
+                          "Shape %lu of mesh %d differed from the contiguous mesh", (unsigned long)j, i);
+        }
+
+        out.num_verts = n;
+        ck_assert_msg(pb_extrude_building_into_layout(b, 2.f, 1.5f, 0.5f,
+                                                      pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                                      &separate_layout, &out) == 0,
+                      "Extruding into a separate layout should have succeeded");
+
+        for (j = 0; j < n; ++j) {
+            pb_vert3D const* v = cb->verts + j;
+            float const* normal = &v->nx;
+
+            ck_assert_msg(memcmp(interleaved[j].pos, &v->x, sizeof(float) * 3) == 0 &&
+                          memcmp(positions + j * 3, &v->x, sizeof(float) * 3) == 0 &&
+                          memcmp(uvs + j * 2, &v->u, sizeof(float) * 2) == 0,
+                          "Vertex %lu of mesh %d should have been copied exactly", (unsigned long)j, i);
+            for (k = 0; k < 3; ++k) {
+                ck_assert_msg(fabsf(interleaved[j].normal[k] / 127.f - normal[k]) <= 0.5f / 127.f &&
+                              fabsf(normals[j * 3 + k] / 32767.f - normal[k]) <= 0.5f / 32767.f,
+                              "Normal of vertex %lu of mesh %d was out of tolerance", (unsigned long)j, i);
+            }
+            ck_assert_msg(fabsf(half_to_float(interleaved[j].uv[0]) - v->u) <= fabsf(v->u) / 2048.f + 1e-6f &&
+                          fabsf(half_to_float(interleaved[j].uv[1]) - v->v) <= fabsf(v->v) / 2048.f + 1e-6f,
+                          "Half-precision uv of vertex %lu of mesh %d was out of tolerance", (unsigned long)j, i);
+        }
+
+        pb_wall_structure_extruder door_extruder = *pb_simple_door_extruder;
+        pb_wall_structure_extruder window_extruder = *pb_simple_window_extruder;
+        interleaved_vert* converted = calloc(n, sizeof(interleaved_vert));
+        pb_vertex_layout converted_layout = interleaved_layout;
+
+        door_extruder.fill_layout = NULL;
+        window_extruder.fill_layout = NULL;
+        converted_layout.position.data = converted;
+        converted_layout.normal.data = converted;
+        converted_layout.uv.data = converted;
+
+        ck_assert_msg(pb_extrude_building_into_layout(b, 2.f, 1.5f, 0.5f, &door_extruder, &window_extruder,
+                                                      NULL, NULL, &converted_layout, &out) == 0,
+                      "Extruding with converted doors and windows should have succeeded");
+        ck_assert_msg(memcmp(converted, interleaved, sizeof(interleaved_vert) * n) == 0,
+                      "The converted vertices of mesh %d should have matched", i);
+
+        free(converted);
+        free(interleaved);
+        free(positions);
+        free(normals);
+        free(uvs);
+        free(out.shapes);
+        free(out.wall_lists);
+        free(out.rooms);
+        free(out.floors);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_into_layout_ex)
+{
+    /*
+     * Given generated buildings
+     * When I invoke pb_extrude_building_into_layout_ex with flags and a layout holding full-precision attributes
+     * Then the shapes and vertices should exactly match pb_extrude_building_contiguous_ex with the same flags
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    unsigned const flags = PB_EXTRUDE_SHARED_WALLS_ONCE | PB_EXTRUDE_INSTANCE_STRUCTURES;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 67);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous_ex(b, 2.f, 1.5f, 0.5f,
+                                                                       pb_simple_door_extruder,
+                                                                       pb_simple_window_extruder,
+                                                                       NULL, NULL, flags);
+        ck_assert_msg(cb != NULL, "Extrusion should have succeeded");
+
+        pb_vert3D* verts = malloc(sizeof(pb_vert3D) * cb->num_verts);
+        pb_vertex_layout layout = {
+            {verts, offsetof(pb_vert3D, x), sizeof(pb_vert3D), PB_VERTEX_FLOAT32},
+            {verts, offsetof(pb_vert3D, nx), sizeof(pb_vert3D), PB_VERTEX_FLOAT32},
+            {verts, offsetof(pb_vert3D, u), sizeof(pb_vert3D), PB_VERTEX_FLOAT32}
+        };
+        pb_contiguous_building out = *cb;
+        size_t j;
+
+        out.verts = NULL;
+        out.shapes = malloc(sizeof(pb_contiguous_shape) * cb->num_shapes);
+        out.wall_lists = malloc(sizeof(pb_range) * cb->num_wall_lists);
+        out.rooms = malloc(sizeof(pb_contiguous_room) * cb->num_rooms);
+        out.floors = malloc(sizeof(pb_contiguous_floor) * cb->num_floors);
+
+        ck_assert_msg(pb_extrude_building_into_layout_ex(b, 2.f, 1.5f, 0.5f,
+                                                         pb_simple_door_extruder, pb_simple_window_extruder,
+                                                         NULL, NULL, flags, &layout, &out) == 0,
+                      "Extruding into a layout with flags should have succeeded");
+        ck_assert_msg(out.num_verts == cb->num_verts && out.num_shapes == cb->num_shapes &&
+                      memcmp(out.floors, cb->floors, sizeof(pb_contiguous_floor) * cb->num_floors) == 0 &&
+                      memcmp(verts, cb->verts, sizeof(pb_vert3D) * cb->num_verts) == 0,
+                      "Mesh %d differed from the contiguous mesh", i);
+        for (j = 0; j < cb->num_shapes; ++j) {
+            ck_assert_msg(out.shapes[j].verts.start == cb->shapes[j].verts.start &&
+                          out.shapes[j].verts.count == cb->shapes[j].verts.count &&
+                          memcmp(&out.shapes[j].pos, &cb->shapes[j].pos, sizeof(pb_point3D)) == 0,
+                          "Shape %lu of mesh %d differed from the contiguous mesh", (unsigned long)j, i);
+        }
+
+        free(verts);
+        free(out.shapes);
+        free(out.wall_lists);
+        free(out.rooms);
+        free(out.floors);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_contiguous_without_fill)
+{
+    /*
+     * Given door and window extruders that only provide count and extrude functions
+     * When I invoke pb_extrude_building_contiguous with them
+     * Then the result should be the same as with the full extruders
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    pb_wall_structure_extruder door_extruder = {0};
+    pb_wall_structure_extruder window_extruder = {0};
+    int i;
+
+    door_extruder.count = pb_simple_door_extruder->count;
+    door_extruder.extrude = pb_simple_door_extruder->extrude;
+    window_extruder.count = pb_simple_window_extruder->count;
+    window_extruder.extrude = pb_simple_window_extruder->extrude;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 29);
+
+    for (i = 0; i < 5; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** m = pb_extrude_building(b, 2.f, 1.5f, 0.5f,
+                                                    pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    &door_extruder, &window_extruder, NULL, NULL);
+
+        ck_assert_msg(m && cb, "Both extrusions should have succeeded");
+        ck_assert_msg(contiguous_mesh_equal(cb, m, b->num_floors), "Contiguous mesh %d differed from the tree", i);
+
+        pb_contiguous_building_free(cb);
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+typedef struct {
+    size_t floor;
+    size_t room;
+    pb_extruded_category category;
+    pb_vert3D vert;
+} streamed_vert;
+
+typedef struct {
+    streamed_vert* verts;
+    size_t num_verts;
+    size_t cap;
+    int bad_batch;
+    size_t stop_after;
+    int check_bounds;
+} stream_collector;
+
+static int PB_CALL collect_batch(pb_extrusion_batch const* batch, void* user) {
+    stream_collector* c = (stream_collector*)user;
+    size_t i;
+
+    if (batch->num_verts == 0 || batch->num_verts % 3 != 0) {
+        c->bad_batch = 1;
+    }
+
+    /* The batch's box should exactly fit its vertices and its sphere should contain them, or else be cleared */
+    pb_bounds3D box;
+    pb_bounds3D_clear(&box);
+    for (i = 0; i < batch->num_verts && c->check_bounds; ++i) {
+        pb_point3D p = {batch->verts[i].x, batch->verts[i].y, batch->verts[i].z};
+        if (!in_sphere(&batch->bounds, &p)) {
+            c->bad_batch = 1;
+        }
+        pb_bounds3D_add_point(&box, &p);
+    }
+    if (!boxes_equal(&box, &batch->bounds)) {
+        c->bad_batch = 1;
+    }
+
+    if (c->num_verts + batch->num_verts > c->cap) {
+        c->cap = (c->num_verts + batch->num_verts) * 2;
+        c->verts = realloc(c->verts, sizeof(streamed_vert) * c->cap);
+    }
+
+    for (i = 0; i < batch->num_verts; ++i) {
+        streamed_vert* v = c->verts + c->num_verts++;
+        v->floor = batch->floor;
+        v->room = batch->room;
+        v->category = batch->category;
+        v->vert = batch->verts[i];
+    }
+
+    return c->num_verts >= c->stop_after ? -1 : 0;
+}
+
+/* Checks that the streamed vertices for one part and category are the part's shapes moved into place, in order. */
+static int streamed_part_equal(stream_collector const* c, pb_contiguous_building const* cb,
+                               size_t floor, size_t room, pb_range const* shapes) {
+    size_t cur = 0;
+    int category;
+
+    for (category = 0; category < PB_EXTRUDED_NUM_CATEGORIES; ++category) {
+        size_t s, v;
+        cur = 0;
+
+        for (s = shapes[category].start; s < shapes[category].start + shapes[category].count; ++s) {
+            pb_contiguous_shape const* shape = cb->shapes + s;
+
+            for (v = 0; v < shape->verts.count; ++v) {
+                pb_vert3D expected = cb->verts[shape->verts.start + v];
+                expected.x += shape->pos.x;
+                expected.y += shape->pos.y;
+                expected.z += shape->pos.z;
+
+                /* Find the next streamed vertex for this part and category */
+                while (cur < c->num_verts &&
+                       (c->verts[cur].floor != floor || c->verts[cur].room != room ||
+                        c->verts[cur].category != category)) {
+                    ++cur;
+                }
+                if (cur == c->num_verts || memcmp(&c->verts[cur].vert, &expected, sizeof(pb_vert3D)) != 0) {
+                    return 0;
+                }
+                ++cur;
+            }
+        }
+    }
+
+    return 1;
+}
+
+START_TEST(sq_house_extrude_stream)
+{
+    /*
+     * Given a generated building
+     * When I invoke pb_extrude_building_stream on it
+     * Then the sink should receive every triangle of pb_extrude_building_contiguous exactly once, moved into place
+     * And pb_extrude_building_stream_ex should match pb_extrude_building_contiguous_ex with the same flags
+     * And each batch should be bounded when PB_EXTRUDE_BOUNDS is passed
+     * And the stream should stop when the sink asks it to
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 31);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_contiguous_building* cb = pb_extrude_building_contiguous(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL);
+        stream_collector c = {0};
+        size_t f, r;
+
+        c.stop_after = (size_t)-1;
+        ck_assert_msg(pb_extrude_building_stream(b, 2.f, 1.5f, 0.5f,
+                                                 pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                                 collect_batch, &c) == 0, "Streaming should have succeeded");
+        ck_assert_msg(!c.bad_batch, "Every batch should hold a whole number of triangles");
+        ck_assert_msg(c.num_verts == cb->num_verts, "Building %d streamed %lu vertices instead of %lu",
+                      i, (unsigned long)c.num_verts, (unsigned long)cb->num_verts);
+
+        for (f = 0; f < cb->num_floors; ++f) {
+            pb_contiguous_floor const* cf = cb->floors + f;
+            ck_assert_msg(streamed_part_equal(&c, cb, f, PB_EXTRUDED_EXTERIOR, cf->shapes),
+                          "Exterior of floor %lu differed", (unsigned long)f);
+
+            for (r = 0; r < cf->rooms.count; ++r) {
+                ck_assert_msg(streamed_part_equal(&c, cb, f, r, cb->rooms[cf->rooms.start + r].shapes),
+                              "Room %lu of floor %lu differed", (unsigned long)r, (unsigned long)f);
+            }
+        }
+
+        unsigned const flags = PB_EXTRUDE_SHARED_WALLS_ONCE | PB_EXTRUDE_INSTANCE_STRUCTURES;
+        pb_contiguous_building* cb_ex = pb_extrude_building_contiguous_ex(b, 2.f, 1.5f, 0.5f,
+                                                                          pb_simple_door_extruder,
+                                                                          pb_simple_window_extruder,
+                                                                          NULL, NULL, flags);
+        c.num_verts = 0;
+        c.check_bounds = 1;
+        ck_assert_msg(cb_ex != NULL && pb_extrude_building_stream_ex(b, 2.f, 1.5f, 0.5f,
+                                                                     pb_simple_door_extruder,
+                                                                     pb_simple_window_extruder, NULL, NULL,
+                                                                     flags | PB_EXTRUDE_BOUNDS, collect_batch,
+                                                                     &c) == 0,
+                      "Streaming with flags should have succeeded");
+        ck_assert_msg(!c.bad_batch, "Every batch should have been bounded");
+        c.check_bounds = 0;
+        ck_assert_msg(c.num_verts == cb_ex->num_verts, "Building %d streamed %lu vertices with flags instead of %lu",
+                      i, (unsigned long)c.num_verts, (unsigned long)cb_ex->num_verts);
+        for (f = 0; f < cb_ex->num_floors; ++f) {
+            pb_contiguous_floor const* cf = cb_ex->floors + f;
+            ck_assert_msg(streamed_part_equal(&c, cb_ex, f, PB_EXTRUDED_EXTERIOR, cf->shapes),
+                          "Exterior of floor %lu differed with flags", (unsigned long)f);
+
+            for (r = 0; r < cf->rooms.count; ++r) {
+                ck_assert_msg(streamed_part_equal(&c, cb_ex, f, r, cb_ex->rooms[cf->rooms.start + r].shapes),
+                              "Room %lu of floor %lu differed with flags", (unsigned long)r, (unsigned long)f);
+            }
+        }
+        pb_contiguous_building_free(cb_ex);
+
+        /* Stop as soon as the sink has seen anything */
+        c.num_verts = 0;
+        c.stop_after = 1;
+        ck_assert_msg(pb_extrude_building_stream(b, 2.f, 1.5f, 0.5f,
+                                                 pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL,
+                                                 collect_batch, &c) == -1, "Streaming should have stopped");
+
+        free(c.verts);
+        pb_contiguous_building_free(cb);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_extrude_parallel)
+{
+    /*
+     * Given generated buildings
+     * When I invoke pb_extrude_building_parallel on them with and without a thread pool
+     * Then the result should be identical to pb_extrude_building's
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_thread_pool* pool = pb_thread_pool_create(4);
+    pb_sq_house_house_spec hspec;
+    pb_rng rng;
+    int i;
+
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 37);
+
+    for (i = 0; i < 10; ++i) {
+        pb_building* b = pb_sq_house_ex(&hspec, room_specs, &rng);
+        pb_extruded_floor** serial = pb_extrude_building(b, 2.f, 1.5f, 0.5f,
+                                                         pb_simple_door_extruder, pb_simple_window_extruder,
+                                                         NULL, NULL);
+        pb_extruded_floor** parallel = pb_extrude_building_parallel(b, 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL, pool);
+        pb_extruded_floor** no_pool = pb_extrude_building_parallel(b, 2.f, 1.5f, 0.5f,
+                                                                   pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                   NULL, NULL, NULL);
+
+        ck_assert_msg(serial && parallel && no_pool, "Every extrusion should have succeeded");
+        ck_assert_msg(meshes_equal(serial, parallel, b->num_floors), "Parallel mesh %d differed from serial", i);
+        ck_assert_msg(meshes_equal(serial, no_pool, b->num_floors), "Mesh %d without a pool differed from serial", i);
+
+        pb_extruded_building_free(serial, b->num_floors);
+        pb_extruded_building_free(parallel, b->num_floors);
+        pb_extruded_building_free(no_pool, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+    }
+
+    pb_thread_pool_free(pool);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_batch_matches_serial)
+{
+    /*
+     * Given a list of seeds
+     * When I invoke pb_sq_house_batch with the seeds
+     * Then each building and mesh should be identical to the one produced by pb_sq_house_ex and pb_extrude_building
+     *      with a generator seeded with the same seed
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    size_t const n = 64;
+    pb_sq_house_house_spec hspecs[64];
+    uint64_t seeds[64];
+    pb_building* buildings[64];
+    pb_extruded_floor** meshes[64];
+    pb_sq_house_batch_extrusion extrusion;
+    size_t i;
+
+    extrusion.floor_height = 2.f;
+    extrusion.door_height = 1.5f;
+    extrusion.window_height = 0.5f;
+    extrusion.door_extruder = pb_simple_door_extruder;
+    extrusion.window_extruder = pb_simple_window_extruder;
+    extrusion.door_extruder_param = NULL;
+    extrusion.window_extruder_param = NULL;
+
+    for (i = 0; i < n; ++i) {
+        init_house_spec(hspecs + i);
+        seeds[i] = i * 7919;
+    }
+
+    ck_assert_msg(pb_sq_house_batch(hspecs, room_specs, seeds, n, &extrusion, buildings, meshes) == 0,
+                  "pb_sq_house_batch should have generated every house");
+
+    for (i = 0; i < n; ++i) {
+        pb_rng rng;
+        pb_building* b;
+        pb_extruded_floor** m;
+
+        pb_rng_seed(&rng, seeds[i]);
+        b = pb_sq_house_ex(hspecs + i, room_specs, &rng);
+        m = pb_extrude_building(b, 2.f, 1.5f, 0.5f, pb_simple_door_extruder, pb_simple_window_extruder, NULL, NULL);
+
+        ck_assert_msg(buildings_equal(b, buildings[i]), "Building %lu differed from the serial result", (unsigned long)i);
+        ck_assert_msg(meshes_equal(m, meshes[i], b->num_floors), "Mesh %lu differed from the serial result", (unsigned long)i);
+
+        pb_extruded_building_free(m, b->num_floors);
+        pb_building_free(b, pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(b);
+
+        pb_extruded_building_free(meshes[i], buildings[i]->num_floors);
+        pb_building_free(buildings[i], pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(buildings[i]);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(sq_house_batch_no_meshes)
+{
+    /*
+     * Given a list of seeds
+     * When I invoke pb_sq_house_batch without requesting meshes
+     * Then each building should be generated, and asking for meshes without extrusion settings should fail
+     */
+    pb_sq_house_room_spec specs[NUM_TEST_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_sq_house_house_spec hspecs[3];
+    uint64_t seeds[3] = { 1, 2, 3 };
+    pb_building* buildings[3];
+    pb_extruded_floor** meshes[3];
+    size_t i;
+
+    for (i = 0; i < 3; ++i) {
+        init_house_spec(hspecs + i);
+    }
+
+    ck_assert_msg(pb_sq_house_batch(hspecs, room_specs, seeds, 3, NULL, buildings, meshes) == -1,
+                  "pb_sq_house_batch should have failed without extrusion settings");
+
+    ck_assert_msg(pb_sq_house_batch(hspecs, room_specs, seeds, 3, NULL, buildings, NULL) == 0,
+                  "pb_sq_house_batch should have generated every house");
+
+    for (i = 0; i < 3; ++i) {
+        ck_assert_msg(buildings[i] != NULL, "Building %lu should have been generated", (unsigned long)i);
+        pb_building_free(buildings[i], pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(buildings[i]);
+    }
+
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+Suite *make_pb_sq_house_suite(void)
+{
+    Suite* s;
+    TCase* tc_sq_house_seeding;
+    TCase* tc_sq_house_batch;
+    TCase* tc_sq_house_extrusion;
+
+    s = suite_create("Squarified house generation");
+
+    tc_sq_house_seeding = tcase_create("Seeded generation tests");
+    suite_add_tcase(s, tc_sq_house_seeding);
+    tcase_add_test(tc_sq_house_seeding, sq_house_ex_same_seed);
+    tcase_add_test(tc_sq_house_seeding, sq_house_parallel_same_seed);
+    tcase_add_test(tc_sq_house_seeding, sq_house_arena_building);
+    tcase_add_test(tc_sq_house_seeding, sq_house_pack_building);
+
+    tc_sq_house_batch = tcase_create("Batch generation tests");
+    suite_add_tcase(s, tc_sq_house_batch);
+    tcase_add_test(tc_sq_house_batch, sq_house_batch_matches_serial);
+    tcase_add_test(tc_sq_house_batch, sq_house_batch_no_meshes);
+
+    tc_sq_house_extrusion = tcase_create("Extrusion tests");
+    suite_add_tcase(s, tc_sq_house_extrusion);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_contiguous);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_into);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_into_layout);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_into_layout_ex);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_contiguous_without_fill);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_stream);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_parallel);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_indexed);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_optimized);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_quantized);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_merge_walls);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_merge_walls_uvs);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_shared_walls_once);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_instances);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_bounds);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_contiguous_bounds);
+    tcase_add_test(tc_sq_house_extrusion, sq_house_extrude_ex_unsupported_flags);
+
+    return s;
+}
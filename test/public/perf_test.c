@@ -22,11 +22,16 @@
 #
 #endif /* _WIN32 */
 
-START_TEST(sq_house_performance_test)
-{
-    pb_sq_house_room_spec specs[8] = {0};
+#define PERF_NUM_ROOM_SPECS 8
 
-    char const* living_adj[] = {
+/**
+ * Fills in the room specifications used by the performance tests.
+ *
+ * @param specs The specifications to fill in (PERF_NUM_ROOM_SPECS elements, zero-initialised).
+ * @return A map of room names => specifications.
+ */
+static pb_hashmap* create_room_specs(pb_sq_house_room_spec* specs) {
+    static char const* living_adj[] = {
             PB_SQ_HOUSE_OUTSIDE,
             PB_SQ_HOUSE_STAIRS,
             "Laundry room",
@@ -43,7 +48,7 @@ START_TEST(sq_house_performance_test)
     specs[0].max_instances = 1;
     specs[0].area = 20.f;
 
-    char const* kitchen_adj[] = {
+    static char const* kitchen_adj[] = {
             PB_SQ_HOUSE_OUTSIDE,
             "Pantry",
             "Laundry room",
@@ -57,7 +62,7 @@ START_TEST(sq_house_performance_test)
     specs[1].max_instances = 1;
     specs[1].area = 15.f;
 
-    char const* pantry_adj[] = {
+    static char const* pantry_adj[] = {
             "Laundry room",
             "Kitchen"
     };
@@ -68,7 +73,7 @@ START_TEST(sq_house_performance_test)
     specs[2].max_instances = 1;
     specs[2].area = 5.f;
 
-    char const* laundry_adj[] = {
+    static char const* laundry_adj[] = {
             PB_SQ_HOUSE_STAIRS,
             "Kitchen",
             "Pantry",
@@ -80,7 +85,7 @@ START_TEST(sq_house_performance_test)
     specs[3].max_instances = 1;
     specs[3].area = 9.f;
 
-    char const* dining_adj[] = {
+    static char const* dining_adj[] = {
             "Kitchen",
             "Living room",
             "Bathroom",
@@ -94,7 +99,7 @@ START_TEST(sq_house_performance_test)
     specs[4].max_instances = 1;
     specs[4].area = 15.f;
 
-    char const* bathroom_adj[] = {
+    static char const* bathroom_adj[] = {
             PB_SQ_HOUSE_STAIRS,
             "Living room",
             "Dining room",
@@ -108,7 +113,7 @@ START_TEST(sq_house_performance_test)
     specs[5].max_instances = 5;
     specs[5].area = 7.f;
 
-    char const* bedroom_adj[] = {
+    static char const* bedroom_adj[] = {
             PB_SQ_HOUSE_STAIRS,
             "Living room",
             "Dining room",
@@ -121,7 +126,7 @@ START_TEST(sq_house_performance_test)
     specs[6].max_instances = 5;
     specs[6].area = 10.f;
 
-    char const* master_adj[] = {
+    static char const* master_adj[] = {
             PB_SQ_HOUSE_STAIRS,
             "Living room",
             "Dining room",
@@ -136,18 +141,53 @@ START_TEST(sq_house_performance_test)
 
     size_t i;
     pb_hashmap* room_specs = pb_hashmap_create(pb_str_hash, pb_str_eq);
-    for (i = 0; i < 8; ++i) {
+    for (i = 0; i < PERF_NUM_ROOM_SPECS; ++i) {
         pb_hashmap_put(room_specs, specs[i].name, &specs[i]);
     }
 
+    return room_specs;
+}
+
+static void init_house_spec(pb_sq_house_house_spec* hspec) {
+    hspec->num_rooms = 15;
+    hspec->door_size = 0.75f;
+    hspec->window_size = 0.5f;
+    hspec->hallway_width = 0.75f;
+    hspec->stair_room_width = 3.f;
+    hspec->width = 15.f;
+    hspec->height = 10.f;
+}
+
+/* Wall-clock time in milliseconds. The batch tests can't use process CPU time since it counts every worker thread. */
+static double wall_clock_ms(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return now.QuadPart * 1000.0 / freq.QuadPart;
+#elif defined(__MACH__)
+    clock_serv_t cclock;
+    mach_timespec_t mts;
+    host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
+    clock_get_time(cclock, &mts);
+    mach_port_deallocate(mach_task_self(), cclock);
+    return mts.tv_sec * 1000.0 + mts.tv_nsec / 1000000.0;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#endif
+}
+
+START_TEST(sq_house_performance_test)
+{
+    pb_sq_house_room_spec specs[PERF_NUM_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    size_t i;
+
     pb_sq_house_house_spec hspec;
-    hspec.num_rooms = 15;
-    hspec.door_size = 0.75f;
-    hspec.window_size = 0.5f;
-    hspec.hallway_width = 0.75f;
-    hspec.stair_room_width = 3.f;
-    hspec.width = 15.f;
-    hspec.height = 10.f;
+    init_house_spec(&hspec);
 
 #ifdef _WIN32
     LARGE_INTEGER freq;
@@ -217,6 +257,103 @@ START_TEST(sq_house_performance_test)
 }
 END_TEST
 
+START_TEST(sq_house_batch_performance_test)
+{
+    pb_sq_house_room_spec specs[PERF_NUM_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    size_t const n = 10000;
+    size_t i;
+
+    pb_sq_house_house_spec* hspecs = malloc(sizeof(pb_sq_house_house_spec) * n);
+    uint64_t* seeds = malloc(sizeof(uint64_t) * n);
+    pb_building** buildings = malloc(sizeof(pb_building*) * n);
+    pb_extruded_floor*** meshes = malloc(sizeof(pb_extruded_floor**) * n);
+
+    pb_sq_house_batch_extrusion extrusion;
+    extrusion.floor_height = 2.f;
+    extrusion.door_height = 1.5f;
+    extrusion.window_height = 0.5f;
+    extrusion.door_extruder = pb_simple_door_extruder;
+    extrusion.window_extruder = pb_simple_window_extruder;
+    extrusion.door_extruder_param = NULL;
+    extrusion.window_extruder_param = NULL;
+
+    for (i = 0; i < n; ++i) {
+        init_house_spec(hspecs + i);
+        seeds[i] = i;
+    }
+
+    double start = wall_clock_ms();
+    int result = pb_sq_house_batch(hspecs, room_specs, seeds, n, &extrusion, buildings, meshes);
+    double elapsed = wall_clock_ms() - start;
+
+    ck_assert_msg(result == 0, "pb_sq_house_batch should have generated every house");
+    printf("Batch of %lu houses: %.2f ms total, %.4f ms per house\n", (unsigned long)n, elapsed, elapsed / n);
+
+    for (i = 0; i < n; ++i) {
+        pb_extruded_building_free(meshes[i], buildings[i]->num_floors);
+        pb_building_free(buildings[i], pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(buildings[i]);
+    }
+
+    free(hspecs);
+    free(seeds);
+    free(buildings);
+    free(meshes);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
+START_TEST(extrude_building_parallel_performance_test)
+{
+    pb_sq_house_room_spec specs[PERF_NUM_ROOM_SPECS] = {0};
+    pb_hashmap* room_specs = create_room_specs(specs);
+    pb_thread_pool* pool = pb_thread_pool_create(0);
+    pb_rng rng;
+    size_t const n = 200;
+    size_t i;
+
+    pb_sq_house_house_spec hspec;
+    init_house_spec(&hspec);
+    pb_rng_seed(&rng, 0);
+
+    pb_building** buildings = malloc(sizeof(pb_building*) * n);
+    for (i = 0; i < n; ++i) {
+        buildings[i] = pb_sq_house_ex(&hspec, room_specs, &rng);
+        ck_assert_msg(buildings[i] != NULL, "House %lu should have been generated", (unsigned long)i);
+    }
+
+    double serial_ms = 0.0;
+    double parallel_ms = 0.0;
+    for (i = 0; i < n; ++i) {
+        double start = wall_clock_ms();
+        pb_extruded_floor** serial = pb_extrude_building(buildings[i], 2.f, 1.5f, 0.5f,
+                                                         pb_simple_door_extruder, pb_simple_window_extruder,
+                                                         NULL, NULL);
+        double mid = wall_clock_ms();
+        pb_extruded_floor** parallel = pb_extrude_building_parallel(buildings[i], 2.f, 1.5f, 0.5f,
+                                                                    pb_simple_door_extruder, pb_simple_window_extruder,
+                                                                    NULL, NULL, pool);
+        double end = wall_clock_ms();
+
+        serial_ms += mid - start;
+        parallel_ms += end - mid;
+
+        pb_extruded_building_free(serial, buildings[i]->num_floors);
+        pb_extruded_building_free(parallel, buildings[i]->num_floors);
+        pb_building_free(buildings[i], pb_sq_house_free_building, pb_sq_house_free_floor, pb_sq_house_free_room);
+        free(buildings[i]);
+    }
+
+    printf("Extruding %lu houses: %.4f ms serial, %.4f ms on %lu workers per house\n", (unsigned long)n,
+           serial_ms / n, parallel_ms / n, (unsigned long)pb_thread_pool_num_workers(pool));
+
+    free(buildings);
+    pb_thread_pool_free(pool);
+    pb_hashmap_free(room_specs);
+}
+END_TEST
+
 Suite *make_pb_perf_suite(void) {
     Suite *s;
     TCase *tc_sq_house_performance;
@@ -226,6 +363,8 @@ Suite *make_pb_perf_suite(void) {
     tc_sq_house_performance = tcase_create("Performance test");
     suite_add_tcase(s, tc_sq_house_performance);
     tcase_add_test(tc_sq_house_performance, sq_house_performance_test);
+    tcase_add_test(tc_sq_house_performance, sq_house_batch_performance_test);
+    tcase_add_test(tc_sq_house_performance, extrude_building_parallel_performance_test);
 
     return s;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "../test_util.h"
+#include <check.h>
+#include <pb/util/arena/arena.h>
+#include <stdint.h>
+#include <string.h>
+
+START_TEST(alloc_aligned)
+{
+    pb_arena* arena = pb_arena_create(256);
+    size_t sizes[] = { 1, 3, 16, 17, 40 };
+    size_t i;
+
+    for (i = 0; i < sizeof(sizes) / sizeof(size_t); ++i) {
+        void* p = pb_arena_alloc(arena, sizes[i]);
+        ck_assert_msg(p != NULL, "Allocation %lu should have succeeded", (unsigned long)i);
+        ck_assert_msg((uintptr_t)p % PB_ARENA_ALIGNMENT == 0, "Allocation %lu wasn't aligned", (unsigned long)i);
+    }
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(alloc_grows)
+{
+    /* Allocate far more than the first block holds and make sure earlier allocations are left intact */
+    pb_arena* arena = pb_arena_create(64);
+    int* allocs[100];
+    int i;
+
+    for (i = 0; i < 100; ++i) {
+        allocs[i] = pb_arena_alloc(arena, sizeof(int) * 10);
+        ck_assert_msg(allocs[i] != NULL, "Allocation %d should have succeeded", i);
+        allocs[i][0] = i;
+        allocs[i][9] = -i;
+    }
+
+    for (i = 0; i < 100; ++i) {
+        ck_assert_msg(allocs[i][0] == i && allocs[i][9] == -i, "Allocation %d was overwritten", i);
+    }
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(alloc_larger_than_block)
+{
+    pb_arena* arena = pb_arena_create(64);
+    char* big = pb_arena_alloc(arena, 10000);
+
+    ck_assert_msg(big != NULL, "Allocation larger than a block should have succeeded");
+    memset(big, 1, 10000);
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(reset_reuses_first_block)
+{
+    pb_arena* arena = pb_arena_create(128);
+    void* first = pb_arena_alloc(arena, 32);
+    int i;
+
+    for (i = 0; i < 20; ++i) {
+        pb_arena_alloc(arena, 64);
+    }
+
+    pb_arena_reset(arena);
+    ck_assert_msg(pb_arena_alloc(arena, 32) == first, "The first allocation after a reset should reuse the first block");
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(realloc_last_in_place)
+{
+    pb_arena* arena = pb_arena_create(256);
+    int* first = pb_arena_alloc(arena, sizeof(int) * 4);
+    int* grown;
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        first[i] = i;
+    }
+
+    grown = pb_arena_realloc(arena, first, sizeof(int) * 4, sizeof(int) * 16);
+    ck_assert_msg(grown == first, "The most recent allocation should have been grown in place");
+    for (i = 0; i < 4; ++i) {
+        ck_assert_msg(grown[i] == i, "Element %d was changed by growing the allocation", i);
+    }
+
+    /* The next allocation must start after the grown one */
+    ck_assert_msg((char*)pb_arena_alloc(arena, 1) >= (char*)(grown + 16), "The grown allocation was handed out again");
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(realloc_copies)
+{
+    /* Neither an earlier allocation nor one that no longer fits in its block can be grown in place */
+    pb_arena* arena = pb_arena_create(64);
+    int* first = pb_arena_alloc(arena, sizeof(int) * 4);
+    int* grown;
+    int i;
+
+    for (i = 0; i < 4; ++i) {
+        first[i] = i;
+    }
+    pb_arena_alloc(arena, 16);
+
+    grown = pb_arena_realloc(arena, first, sizeof(int) * 4, sizeof(int) * 8);
+    ck_assert_msg(grown != NULL && grown != first, "An earlier allocation should have been copied");
+    for (i = 0; i < 4; ++i) {
+        ck_assert_msg(grown[i] == i, "Element %d wasn't copied", i);
+    }
+
+    first = grown;
+    grown = pb_arena_realloc(arena, first, sizeof(int) * 8, 1000);
+    ck_assert_msg(grown != NULL && grown != first, "An allocation that doesn't fit in its block should have been copied");
+    for (i = 0; i < 4; ++i) {
+        ck_assert_msg(grown[i] == i, "Element %d wasn't copied", i);
+    }
+
+    ck_assert_msg(pb_arena_realloc(arena, grown, 1000, 10) == grown, "Shrinking should return the same allocation");
+
+    pb_arena_free(arena);
+}
+END_TEST
+
+START_TEST(merge_keeps_allocations)
+{
+    /* Both arenas span several blocks; freeing dst must release all of them (checked by the leak sanitizer) */
+    pb_arena* dst = pb_arena_create(64);
+    pb_arena* src = pb_arena_create(64);
+    int* dst_allocs[20];
+    int* src_allocs[20];
+    int i;
+
+    for (i = 0; i < 20; ++i) {
+        dst_allocs[i] = pb_arena_alloc(dst, sizeof(int) * 10);
+        src_allocs[i] = pb_arena_alloc(src, sizeof(int) * 10);
+        dst_allocs[i][0] = i;
+        src_allocs[i][0] = -i;
+    }
+
+    pb_arena_merge(dst, src);
+    for (i = 0; i < 20; ++i) {
+        int* p = pb_arena_alloc(dst, sizeof(int) * 10);
+        ck_assert_msg(p != NULL, "Allocation %d after merging should have succeeded", i);
+        p[0] = 100;
+    }
+
+    for (i = 0; i < 20; ++i) {
+        ck_assert_msg(dst_allocs[i][0] == i && src_allocs[i][0] == -i, "Allocation %d was overwritten", i);
+    }
+
+    pb_arena_reset(dst);
+    ck_assert_msg(pb_arena_alloc(dst, 32) != NULL, "Allocation after a reset should have succeeded");
+    pb_arena_free(dst);
+}
+END_TEST
+
+Suite* make_pb_arena_suite(void) {
+    Suite* s = suite_create("pb_arena suite");
+    TCase* tc_arena_tests;
+
+    tc_arena_tests = tcase_create("pb_arena tests");
+    suite_add_tcase(s, tc_arena_tests);
+    tcase_add_test(tc_arena_tests, alloc_aligned);
+    tcase_add_test(tc_arena_tests, alloc_grows);
+    tcase_add_test(tc_arena_tests, alloc_larger_than_block);
+    tcase_add_test(tc_arena_tests, reset_reuses_first_block);
+    tcase_add_test(tc_arena_tests, realloc_last_in_place);
+    tcase_add_test(tc_arena_tests, realloc_copies);
+    tcase_add_test(tc_arena_tests, merge_keeps_allocations);
+
+    return s;
+}
@@ -2,6 +2,10 @@
 #include <pb/util/geom/types.h>
 #include <pb/util/geom/rect_utils.h>
 #include <pb/util/geom/shape_utils.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 START_TEST(rect_to_shape)
 {
@@ -74,9 +78,189 @@ START_TEST(shape_to_rect_bad_shape) {
 }
 END_TEST
 
+START_TEST(weld_verts_quad)
+{
+    /* Two triangles forming a quad, where the shared vertices differ only in the last bits of their mantissas and in
+     * the sign of zero */
+    pb_vert3D verts[6] = {
+        {0.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f},
+        {1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 0.f},
+        {1.f, 1.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f},
+        {1.f, 1.f, 0.f, -0.f, 0.f, 1.f, 1.f, 1.f},
+        {0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f, 1.f},
+        {0.f, 0.f, 0.f, 0.f, 0.f, 1.00000012f, 0.f, 0.f}
+    };
+    uint16_t expected_indices[6] = {0, 1, 2, 2, 3, 0};
+    pb_vert3D out_verts[6];
+    uint16_t indices16[6];
+    uint32_t indices32[6];
+    size_t num_verts;
+    int i;
+
+    ck_assert_msg(pb_weld_verts(verts, 6, 5, out_verts, indices16, 2, &num_verts) == 0, "Welding should have succeeded");
+    ck_assert_msg(num_verts == 4, "Quad should have had 4 unique vertices, had %lu", (unsigned long)num_verts);
+    for (i = 0; i < 6; ++i) {
+        ck_assert_msg(indices16[i] == expected_indices[i], "Index %d should have been %u, was %u",
+            i, expected_indices[i], indices16[i]);
+    }
+    ck_assert_msg(memcmp(out_verts + 2, verts + 2, sizeof(pb_vert3D)) == 0,
+        "Unique vertices should have been copied from their first occurrence");
+
+    ck_assert_msg(pb_weld_verts(verts, 6, 5, out_verts, indices32, 4, &num_verts) == 0, "Welding should have succeeded");
+    for (i = 0; i < 6; ++i) {
+        ck_assert_msg(indices32[i] == expected_indices[i], "32-bit index %d should have been %u, was %u",
+            i, expected_indices[i], indices32[i]);
+    }
+
+    ck_assert_msg(pb_weld_verts(verts, 6, 0, out_verts, indices16, 2, &num_verts) == 0, "Welding should have succeeded");
+    ck_assert_msg(num_verts == 5, "Without fuzz, only exactly equal vertices should have been welded, had %lu",
+        (unsigned long)num_verts);
+
+    ck_assert_msg(pb_weld_verts(verts, 6, 5, out_verts, indices16, 3, &num_verts) == -1,
+        "Welding should have failed with an invalid index size");
+}
+END_TEST
+
+#define GRID_SIZE 16
+#define GRID_VERTS ((GRID_SIZE + 1) * (GRID_SIZE + 1))
+#define GRID_TRIS (GRID_SIZE * GRID_SIZE * 2)
+
+/**
+ * Builds a grid of GRID_SIZE x GRID_SIZE quads whose triangles are scrambled, so that consecutive triangles rarely
+ * share vertices.
+ */
+static void make_scrambled_grid(pb_vert3D* verts, uint32_t* indices) {
+    uint32_t ordered[GRID_TRIS * 3];
+    size_t x, y, i;
+
+    for (y = 0; y <= GRID_SIZE; ++y) {
+        for (x = 0; x <= GRID_SIZE; ++x) {
+            pb_vert3D v = {(float)x, (float)y, 0.f, 0.f, 0.f, 1.f, (float)x, (float)y};
+            verts[y * (GRID_SIZE + 1) + x] = v;
+        }
+    }
+
+    for (y = 0; y < GRID_SIZE; ++y) {
+        for (x = 0; x < GRID_SIZE; ++x) {
+            uint32_t bottom_left = (uint32_t)(y * (GRID_SIZE + 1) + x);
+            uint32_t* quad = ordered + (y * GRID_SIZE + x) * 6;
+            quad[0] = bottom_left;
+            quad[1] = bottom_left + 1;
+            quad[2] = bottom_left + GRID_SIZE + 2;
+            quad[3] = bottom_left + GRID_SIZE + 2;
+            quad[4] = bottom_left + GRID_SIZE + 1;
+            quad[5] = bottom_left;
+        }
+    }
+
+    /* 97 is coprime with GRID_TRIS, so this visits every triangle once */
+    for (i = 0; i < GRID_TRIS; ++i) {
+        memcpy(indices + i * 3, ordered + ((i * 97) % GRID_TRIS) * 3, sizeof(uint32_t) * 3);
+    }
+}
+
+static int compare_tris(void const* a, void const* b) {
+    return memcmp(a, b, sizeof(pb_vert3D) * 3);
+}
+
+/* Expands an indexed triangle list and sorts its triangles so that two lists can be compared regardless of order. */
+static void sorted_tris(pb_vert3D const* verts, uint32_t const* indices, pb_vert3D* out) {
+    size_t i;
+    for (i = 0; i < GRID_TRIS * 3; ++i) {
+        out[i] = verts[indices[i]];
+    }
+    qsort(out, GRID_TRIS, sizeof(pb_vert3D) * 3, compare_tris);
+}
+
+START_TEST(optimize_vertex_cache_grid)
+{
+    static pb_vert3D verts[GRID_VERTS];
+    static uint32_t indices[GRID_TRIS * 3];
+    static pb_vert3D before[GRID_TRIS * 3];
+    static pb_vert3D after[GRID_TRIS * 3];
+    size_t misses_before;
+    size_t misses_after;
+
+    make_scrambled_grid(verts, indices);
+    sorted_tris(verts, indices, before);
+
+    ck_assert_msg(pb_vertex_cache_misses(indices, GRID_TRIS * 3, 4, GRID_VERTS, 16, &misses_before) == 0,
+        "Counting misses should have succeeded");
+    ck_assert_msg(pb_optimize_vertex_cache(indices, GRID_TRIS * 3, 4, GRID_VERTS, 16) == 0,
+        "Optimising should have succeeded");
+    ck_assert_msg(pb_vertex_cache_misses(indices, GRID_TRIS * 3, 4, GRID_VERTS, 16, &misses_after) == 0,
+        "Counting misses should have succeeded");
+
+    ck_assert_msg((float)misses_before / GRID_TRIS > 2.f, "Scrambled grid should have had an ACMR above 2, had %f",
+        (float)misses_before / GRID_TRIS);
+    ck_assert_msg((float)misses_after / GRID_TRIS < 1.f, "Optimised grid should have had an ACMR below 1, had %f",
+        (float)misses_after / GRID_TRIS);
+
+    sorted_tris(verts, indices, after);
+    ck_assert_msg(memcmp(before, after, sizeof(before)) == 0, "Optimising should only have reordered triangles");
+}
+END_TEST
+
+START_TEST(optimize_vertex_fetch_grid)
+{
+    static pb_vert3D verts[GRID_VERTS];
+    static uint32_t indices[GRID_TRIS * 3];
+    static pb_vert3D before[GRID_TRIS * 3];
+    static pb_vert3D after[GRID_TRIS * 3];
+    uint32_t next = 0;
+    size_t i;
+
+    make_scrambled_grid(verts, indices);
+    sorted_tris(verts, indices, before);
+
+    ck_assert_msg(pb_optimize_vertex_fetch(verts, GRID_VERTS, indices, GRID_TRIS * 3, 4) == 0,
+        "Optimising should have succeeded");
+
+    for (i = 0; i < GRID_TRIS * 3; ++i) {
+        ck_assert_msg(indices[i] <= next, "Index %lu referred to vertex %u before vertex %u was used",
+            (unsigned long)i, indices[i], next);
+        if (indices[i] == next) {
+            ++next;
+        }
+    }
+    ck_assert_msg(next == GRID_VERTS, "Every vertex should have been used, only %u were", next);
+
+    sorted_tris(verts, indices, after);
+    ck_assert_msg(memcmp(before, after, sizeof(before)) == 0, "Optimising should only have reordered vertices");
+}
+END_TEST
+
+START_TEST(shape3D_bounds)
+{
+    /*
+     * Given a shape made of a unit quad that is offset from the origin
+     * When I invoke pb_shape3D_get_bounds
+     * Then the box should be offset by the shape's position and the sphere should just reach the corners
+     */
+    pb_vert3D tris[6] = {{0.f, 0.f, 0.f}, {1.f, 1.f, 0.f}, {0.f, 1.f, 0.f},
+                         {0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {1.f, 1.f, 0.f}};
+    pb_shape3D shape = {tris, 2, {2.f, 3.f, 4.f}};
+    pb_bounds3D bounds;
+
+    pb_shape3D_get_bounds(&shape, &bounds);
+    ck_assert_msg(bounds.min.x == 2.f && bounds.min.y == 3.f && bounds.min.z == 4.f, "Min should have been (2, 3, 4)");
+    ck_assert_msg(bounds.max.x == 3.f && bounds.max.y == 4.f && bounds.max.z == 4.f, "Max should have been (3, 4, 4)");
+    ck_assert_msg(bounds.centre.x == 2.5f && bounds.centre.y == 3.5f && bounds.centre.z == 4.f,
+        "Centre should have been (2.5, 3.5, 4)");
+    ck_assert_msg(fabsf(bounds.radius - sqrtf(0.5f)) < 1e-6f, "Radius should have been sqrt(0.5), was %f",
+        bounds.radius);
+
+    shape.num_tris = 0;
+    pb_shape3D_get_bounds(&shape, &bounds);
+    ck_assert_msg(bounds.min.x > bounds.max.x && bounds.radius == 0.f, "An empty shape should have had empty bounds");
+}
+END_TEST
+
 Suite *make_pb_geom_suite(void) {
     Suite *s;
     TCase *tc_pb_rect_conversion;
+    TCase *tc_pb_weld;
+    TCase *tc_pb_bounds;
 
     s = suite_create("libpb Geometry");
 
@@ -86,5 +270,15 @@ Suite *make_pb_geom_suite(void) {
     tcase_add_test(tc_pb_rect_conversion, shape_to_rect_basic);
     tcase_add_test(tc_pb_rect_conversion, shape_to_rect_bad_shape);
 
+    tc_pb_weld = tcase_create("Indexed meshes");
+    suite_add_tcase(s, tc_pb_weld);
+    tcase_add_test(tc_pb_weld, weld_verts_quad);
+    tcase_add_test(tc_pb_weld, optimize_vertex_cache_grid);
+    tcase_add_test(tc_pb_weld, optimize_vertex_fetch_grid);
+
+    tc_pb_bounds = tcase_create("Bounds");
+    suite_add_tcase(s, tc_pb_bounds);
+    tcase_add_test(tc_pb_bounds, shape3D_bounds);
+
     return s;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "../test_util.h"
 #include <check.h>
 #include <pb/util/graph/graph.h>
+#include <pb/util/graph/graph_csr.h>
 #include <pb/util/hashmap/hash_utils.h>
 
 /* Simple hash functions to use for vertices (data will just be an integer) */
@@ -108,7 +109,7 @@ START_TEST(remove_edge)
     pb_vertex const* v1 = pb_graph_get_vertex(graph, (void*)((size_t)1));
 
     ck_assert_msg(result == 0, "Incorrect return value (should have been 0, was %d).", result);
-    ck_assert_msg(graph->edges->size == 0, "graph->edges->size should have been 0, was %lu", graph->edges->size);
+    ck_assert_msg(graph->edges.size == 0, "graph->edges.size should have been 0, was %lu", graph->edges.size);
     ck_assert_msg(v0->edges_size == 0, "v0->edges_size should have been 0, was %lu", v0->edges_size);
     ck_assert_msg(v1->in_degree == 0, "v1->in_degree should have been 0, was $lu", v1->in_degree);
 }
@@ -128,7 +129,7 @@ START_TEST(remove_vertex_with_edge)
 
     pb_graph_remove_vertex(graph, (void*)((size_t)0));
     
-    ck_assert_msg(graph->edges->size == 0, "graph->edges->size should have been 0, was %lu", graph->edges->size);
+    ck_assert_msg(graph->edges.size == 0, "graph->edges.size should have been 0, was %lu", graph->edges.size);
     ck_assert_msg(v1->edges_size == 0, "v1->edges_size should have been 0, was %lu", v1->edges_size);
     ck_assert_msg(v2->in_degree == 0, "v2->in_degree should have been 0, was %lu", v2->in_degree);
 }
@@ -195,12 +196,131 @@ START_TEST(graph_for_each_edge)
 }
 END_TEST
 
+static void sum_csr_edge_weights(pb_graph_csr const* csr, size_t from, size_t edge, void* param) {
+    *(float*)param += csr->edge_weights[edge] * (float)(from + 1);
+}
+
+START_TEST(freeze_graph)
+{
+    /*
+     * Given a graph with 5 vertices, one of which has been removed, and some edges between them
+     * When I freeze it
+     * Then the frozen graph's vertices should be numbered in the order they were added, and each vertex's edges should
+     * be the ones that it had in the original graph
+     */
+    pb_graph* g = pb_graph_create(test_hash, test_eq);
+    pb_graph_csr* csr;
+    size_t i;
+    float weights = 0.f;
+
+    for (i = 1; i <= 5; ++i) {
+        pb_graph_add_vertex(g, (void*)i, (void*)(i * 10));
+    }
+    pb_graph_add_edge(g, (void*)1, (void*)3, 1.f, (void*)13);
+    pb_graph_add_edge(g, (void*)1, (void*)4, 2.f, (void*)14);
+    pb_graph_add_edge(g, (void*)2, (void*)1, 3.f, (void*)21);
+    pb_graph_add_edge(g, (void*)4, (void*)5, 4.f, (void*)45);
+    pb_graph_add_edge(g, (void*)5, (void*)4, 5.f, (void*)54);
+    pb_graph_add_edge(g, (void*)3, (void*)2, 6.f, (void*)32);
+    pb_graph_remove_vertex(g, (void*)2);
+
+    csr = pb_graph_freeze(g);
+    ck_assert_msg(csr != NULL, "Freezing should have succeeded");
+    ck_assert_msg(csr->num_vertices == 4 && csr->num_edges == 4, "Should have had 4 vertices and 4 edges, had %u and %u",
+                  (unsigned)csr->num_vertices, (unsigned)csr->num_edges);
+
+    /* Vertices 1, 3, 4, 5 => 0, 1, 2, 3 */
+    ck_assert_msg(pb_graph_csr_get_index(csr, (void*)1) == 0 && pb_graph_csr_get_index(csr, (void*)3) == 1 &&
+                  pb_graph_csr_get_index(csr, (void*)4) == 2 && pb_graph_csr_get_index(csr, (void*)5) == 3,
+                  "Vertices should have been numbered in the order they were added");
+    ck_assert_msg(pb_graph_csr_get_index(csr, (void*)2) == PB_GRAPH_CSR_NONE, "Vertex 2 should have been removed");
+    ck_assert_msg(csr->vert_ids[2] == (void*)4 && csr->vert_data[2] == (void*)40, "Vertex 4 had the wrong ID or data");
+
+    ck_assert_msg(csr->edge_offsets[0] == 0 && csr->edge_offsets[1] == 2 && csr->edge_offsets[2] == 2 &&
+                  csr->edge_offsets[3] == 3 && csr->edge_offsets[4] == 4, "The edge offsets were wrong");
+    ck_assert_msg(csr->edge_targets[0] == 1 && csr->edge_targets[1] == 2 && csr->edge_targets[2] == 3 &&
+                  csr->edge_targets[3] == 2, "The edge targets were wrong");
+    ck_assert_msg(csr->edge_data[1] == (void*)14 && csr->edge_weights[3] == 5.f, "The edges had the wrong data");
+    ck_assert_msg(pb_graph_csr_get_edge(csr, 3, 2) == 3 && pb_graph_csr_get_edge(csr, 1, 0) == PB_GRAPH_CSR_NONE,
+                  "pb_graph_csr_get_edge found the wrong edges");
+
+    pb_graph_csr_for_each_edge(csr, sum_csr_edge_weights, &weights);
+    ck_assert_msg(weights == 1.f + 2.f + 4.f * 3 + 5.f * 4, "Every edge should have been visited once");
+
+    pb_graph_csr_free(csr);
+    pb_graph_free(g);
+}
+END_TEST
+
+#define POOLED_GRAPH_SIZE 20
+
+START_TEST(pooled_graph)
+{
+    /*
+     * Given a pooled graph in which every vertex has an edge to every other vertex
+     * When I remove vertices and edges, add them back, and then clear the graph and rebuild it
+     * Then the graph should have the same vertices and edges as a graph built with separate allocations, and the
+     * removed vertices and edges should have been reused
+     */
+    pb_graph* g = pb_graph_create_pooled(test_hash, test_eq);
+    pb_vertex const* removed;
+    pb_edge const* removed_edge;
+    size_t i, j, pass;
+
+    ck_assert_msg(g != NULL, "Out of memory");
+
+    for (pass = 0; pass < 2; ++pass) {
+        for (i = 1; i <= POOLED_GRAPH_SIZE; ++i) {
+            ck_assert_msg(pb_graph_add_vertex(g, (void*)i, (void*)(i * 10)) == 0, "Out of memory");
+        }
+        for (i = 1; i <= POOLED_GRAPH_SIZE; ++i) {
+            for (j = 1; j <= POOLED_GRAPH_SIZE; ++j) {
+                if (i != j) {
+                    ck_assert_msg(pb_graph_add_edge(g, (void*)i, (void*)j, (float)(i * j), (void*)(i * 100 + j)) == 0,
+                                  "Out of memory");
+                }
+            }
+        }
+
+        for (i = 1; i <= POOLED_GRAPH_SIZE; ++i) {
+            pb_vertex const* vert = pb_graph_get_vertex(g, (void*)i);
+            ck_assert_msg(vert->data == (void*)(i * 10) && vert->edges_size == POOLED_GRAPH_SIZE - 1 &&
+                          vert->in_degree == POOLED_GRAPH_SIZE - 1, "Vertex %u was wrong", (unsigned)i);
+            for (j = 0; j < vert->edges_size; ++j) {
+                size_t to = j + 1 < i ? j + 1 : j + 2;
+                ck_assert_msg(vert->edges[j]->data == (void*)(i * 100 + to) && vert->edges[j]->weight == (float)(i * to),
+                              "Edge %u of vertex %u was wrong", (unsigned)j, (unsigned)i);
+            }
+        }
+
+        /* Removed vertices and edges should be handed out again */
+        removed = pb_graph_get_vertex(g, (void*)3);
+        pb_graph_remove_vertex(g, (void*)3);
+        ck_assert_msg(g->edges.size == (POOLED_GRAPH_SIZE - 1) * (POOLED_GRAPH_SIZE - 2),
+                      "The removed vertex's edges should have been removed");
+        pb_graph_add_vertex(g, (void*)3, NULL);
+        ck_assert_msg(pb_graph_get_vertex(g, (void*)3) == removed, "The removed vertex should have been reused");
+
+        removed_edge = pb_graph_get_edge(g, (void*)1, (void*)2);
+        pb_graph_remove_edge(g, (void*)1, (void*)2);
+        pb_graph_add_edge(g, (void*)3, (void*)1, 0.f, NULL);
+        ck_assert_msg(pb_graph_get_edge(g, (void*)3, (void*)1) == removed_edge, "The removed edge should have been reused");
+
+        pb_graph_clear(g);
+        ck_assert_msg(g->vertices->size == 0 && g->edges.size == 0, "The graph should have been empty");
+        ck_assert_msg(pb_graph_get_vertex(g, (void*)1) == NULL, "The graph shouldn't have contained vertex 1");
+    }
+
+    pb_graph_free(g);
+}
+END_TEST
+
 Suite *make_pb_graph_suite(void) {
 	/* Life test case tests lifetime events (create and destroy);
 	* Adjacency test case tests all functions related to the adjacency list
 	*/
 	Suite *s;
-	TCase *tc_vertices, *tc_edges, *tc_iterator;
+	TCase *tc_vertices, *tc_edges, *tc_iterator, *tc_frozen, *tc_pooled;
 
 	s = suite_create("Graph");
 
@@ -226,6 +346,14 @@ Suite *make_pb_graph_suite(void) {
     tcase_add_test(tc_iterator, graph_for_each_vertex);
     tcase_add_test(tc_iterator, graph_for_each_edge);
 
+    tc_frozen = tcase_create("Frozen graphs");
+    suite_add_tcase(s, tc_frozen);
+    tcase_add_test(tc_frozen, freeze_graph);
+
+    tc_pooled = tcase_create("Pooled graphs");
+    suite_add_tcase(s, tc_pooled);
+    tcase_add_test(tc_pooled, pooled_graph);
+
     /* This is pretty hacky now. Should probably think about these tests a bit more... */
     tcase_add_unchecked_fixture(tc_vertices, pb_graph_test_setup, NULL);
     tcase_add_unchecked_fixture(tc_edges, NULL, pb_graph_test_teardown);
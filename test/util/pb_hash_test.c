@@ -1,6 +1,9 @@
 #include "../test_util.h"
 #include <pb/util/hashmap/hashmap.h>
 #include <pb/util/hashmap/hash_utils.h>
+#include <pb/util/hashmap/typed_map.h>
+#include <pb/util/hashmap/ordered_map.h>
+#include <stdio.h>
 
 /* Hash map to use for the tests. */
 static pb_hashmap* map;
@@ -17,16 +20,18 @@ START_TEST(create_test)
     unsigned int i;
     map = pb_hashmap_create(pb_str_hash, pb_str_eq);
 
-    ck_assert_msg(map->cap == 7, "Map's capacity was %u, should be 7.", map->cap);
+    ck_assert_msg(map->cap == 16, "Map's capacity was %u, should be 16.", map->cap);
     ck_assert_msg(map->size == 0, "Map's size should be 0, was %u", map->size);
+    ck_assert_msg(map->num_deleted == 0, "Map shouldn't have had any deleted entries, had %u", map->num_deleted);
     
-    for(i = 0; i < map->cap; ++i)
-        ck_assert_msg(map->states[i] == EMPTY, "Map entry wasn't initially EMPTY.");
+    /* The control bytes are followed by a copy of the first group */
+    for(i = 0; i < map->cap + PB_HASHMAP_GROUP_WIDTH; ++i)
+        ck_assert_msg(map->ctrl[i] == 0x80, "Map entry wasn't initially empty.");
     
     ck_assert_msg(map->hash == pb_str_hash, "Map's hash function wasn't initialised correctly.");
     ck_assert_msg(map->key_eq == pb_str_eq, "Map's key equality function wasn't initialised correctly.");
     
-    ck_assert_msg(map->expand_num == 5, "Map's expansion threshold was %u, should be 5", map->expand_num);
+    ck_assert_msg(map->expand_num == 14, "Map's expansion threshold was %u, should be 14", map->expand_num);
 }
 END_TEST
 
@@ -82,30 +87,28 @@ END_TEST
  */
 START_TEST(expand_test)
 {
-    int all_contained;
-    int out;
+    static char const* keys[] = { "test0", "test1", "test2", "test3", "test4", "test5", "test6", "test7",
+                                  "test8", "test9", "test10", "test11", "test12", "test13", "test14" };
+    int all_contained = 1;
+    size_t out;
+    size_t i;
     
-    /* Load factor is hard-coded to 0.75, and since we're starting at 7, 6 will definitely exceed this */
-    pb_hashmap_put(map, (void*)"test0", (void*)((size_t)0));
-    pb_hashmap_put(map, (void*)"test1", (void*)((size_t)1));
-    pb_hashmap_put(map, (void*)"test2", (void*)((size_t)2));
-    pb_hashmap_put(map, (void*)"test3", (void*)((size_t)3));
+    /* Load factor is hard-coded to 7/8, and since we're starting at 16, 15 will definitely exceed this */
+    for (i = 0; i < 14; ++i) {
+        pb_hashmap_put(map, (void*)keys[i], (void*)i);
+    }
     
     /* Check that the map hasn't yet expanded since we haven't reached the threshold */
-    ck_assert_msg(map->cap == 7, "Capacity should have been 7, was %u", map->cap);
+    ck_assert_msg(map->cap == 16, "Capacity should have been 16, was %u", map->cap);
 
     /* Check that the map did expand now that we've exceeded the threshold */
-    pb_hashmap_put(map, (void*)"test4", (void*)((size_t)4));
-    pb_hashmap_put(map, (void*)"test5", (void*)((size_t)5));
-    ck_assert_msg(map->cap == 11 /* Next prime >= 1.5 * cap */, "Capacity should have been 11, was %u", map->cap);
-    ck_assert_msg(map->size == 6, "Map's size should have been 6, was %u", map->size);
-
-    all_contained = pb_hashmap_get(map, (void*)"test0", (void**)&out) == 0 &&
-		            pb_hashmap_get(map, (void*)"test1", (void**)&out) == 0 &&
-                    pb_hashmap_get(map, (void*)"test2", (void**)&out) == 0 &&
-                    pb_hashmap_get(map, (void*)"test3", (void**)&out) == 0 &&
-                    pb_hashmap_get(map, (void*)"test4", (void**)&out) == 0 &&
-                    pb_hashmap_get(map, (void*)"test5", (void**)&out) == 0;
+    pb_hashmap_put(map, (void*)keys[14], (void*)(size_t)14);
+    ck_assert_msg(map->cap == 32 /* Next power of two */, "Capacity should have been 32, was %u", map->cap);
+    ck_assert_msg(map->size == 15, "Map's size should have been 15, was %u", map->size);
+
+    for (i = 0; i < 15; ++i) {
+        all_contained = all_contained && pb_hashmap_get(map, (void*)keys[i], (void**)&out) == 0 && out == i;
+    }
 
     ck_assert_msg(all_contained, "Values were not properly transferred to new array.");
 }
@@ -137,10 +140,294 @@ START_TEST(for_each_test)
 }
 END_TEST
 
+static void count_entries(pb_hashmap_entry* entry, void* param) {
+    ++*(size_t*)param;
+}
+
+START_TEST(churn_test)
+{
+    /*
+     * Given a map of pointer keys (whose hashes have their low bits clear)
+     * When I repeatedly put and remove keys so that the map grows, fills up with deleted entries and shrinks
+     * Then every key that's in the map should be found and every removed key should be gone
+     */
+    static size_t keys[4096];
+    pb_hashmap* map2 = pb_hashmap_create(pb_pointer_hash, pb_pointer_eq);
+    size_t num_entries;
+    size_t max_cap = 0;
+    size_t round, i;
+    void* out;
+
+    for (round = 0; round < 4; ++round) {
+        for (i = 0; i < 4096; ++i) {
+            ck_assert_msg(pb_hashmap_put(map2, keys + i, (void*)i) == 0, "Put should have succeeded");
+        }
+        max_cap = map2->cap > max_cap ? map2->cap : max_cap;
+
+        /* Remove every other key so that the removed keys are spread through the map */
+        for (i = 0; i < 4096; i += 2) {
+            ck_assert_msg(pb_hashmap_remove(map2, keys + i) == 0, "Key %u should have been removed", (unsigned)i);
+        }
+        for (i = 0; i < 4096; ++i) {
+            int found = pb_hashmap_get(map2, keys + i, &out) == 0;
+            ck_assert_msg(found == (int)(i % 2), "Key %u should%s have been found", (unsigned)i, i % 2 ? "" : " not");
+            ck_assert_msg(!found || out == (void*)i, "Key %u had the wrong value", (unsigned)i);
+        }
+
+        num_entries = 0;
+        pb_hashmap_for_each(map2, count_entries, &num_entries);
+        ck_assert_msg(num_entries == 2048 && map2->size == 2048, "There should have been 2048 entries, were %u",
+                      (unsigned)num_entries);
+        ck_assert_msg(map2->size + map2->num_deleted <= map2->expand_num,
+                      "Deleted entries should have been cleared out before using up the map");
+    }
+    ck_assert_msg(max_cap <= 8192, "The map should have reused its deleted entries, capacity was %u",
+                  (unsigned)max_cap);
+
+    for (i = 1; i < 4096; i += 2) {
+        pb_hashmap_remove(map2, keys + i);
+    }
+    ck_assert_msg(map2->size == 0 && map2->cap == 16, "The map should have shrunk back to 16, was %u",
+                  (unsigned)map2->cap);
+
+    pb_hashmap_free(map2);
+}
+END_TEST
+
+START_TEST(reserve_test)
+{
+    /*
+     * Given an empty map
+     * When I reserve space for 1000 items and then put them in
+     * Then the map should not be rehashed, and clearing it should keep its capacity
+     */
+    static size_t keys[1000];
+    pb_hashmap* map2 = pb_hashmap_create(pb_pointer_hash, pb_pointer_eq);
+    pb_hashmap_entry* entries;
+    size_t i;
+    void* out;
+
+    ck_assert_msg(pb_hashmap_reserve(map2, 1000) == 0, "Reserving should have succeeded");
+    ck_assert_msg(map2->cap == 2048 && map2->expand_num >= 1000, "Capacity should have been 2048, was %u",
+                  (unsigned)map2->cap);
+
+    entries = map2->entries;
+    for (i = 0; i < 1000; ++i) {
+        pb_hashmap_put(map2, keys + i, keys + i);
+    }
+    ck_assert_msg(map2->entries == entries && map2->cap == 2048, "The map should not have been rehashed");
+
+    ck_assert_msg(pb_hashmap_reserve(map2, 10) == 0 && map2->cap == 2048, "Reserving less should do nothing");
+
+    pb_hashmap_clear(map2);
+    ck_assert_msg(map2->size == 0 && map2->cap == 2048, "Clearing should have kept the capacity");
+    ck_assert_msg(pb_hashmap_get(map2, keys, &out) == -1, "Clearing should have removed every key");
+
+    pb_hashmap_free(map2);
+}
+END_TEST
+
+START_TEST(ptr_map_test)
+{
+    /*
+     * Given a pointer map
+     * When I put, overwrite and remove keys until it grows and shrinks again
+     * Then every key that's in the map should be found with its latest value and every removed key should be gone
+     */
+    static size_t keys[4096];
+    pb_ptr_map m;
+    size_t num_full;
+    size_t round, i;
+    void** out;
+
+    ck_assert_msg(pb_ptr_map_init(&m) == 0, "Init should have succeeded");
+    ck_assert_msg(m.cap == PB_MAP_MIN_CAP && m.size == 0, "The map should have started empty");
+    ck_assert_msg(pb_ptr_map_get(&m, keys) == NULL, "An empty map shouldn't have had any keys");
+
+    for (round = 0; round < 3; ++round) {
+        for (i = 0; i < 4096; ++i) {
+            ck_assert_msg(pb_ptr_map_put(&m, keys + i, keys + i + round) == 0, "Put should have succeeded");
+        }
+        for (i = 0; i < 4096; i += 2) {
+            ck_assert_msg(pb_ptr_map_remove(&m, keys + i) == 0, "Key %u should have been removed", (unsigned)i);
+        }
+        ck_assert_msg(pb_ptr_map_remove(&m, keys) == -1, "Removing a missing key should have failed");
+
+        num_full = 0;
+        for (i = 0; i < m.cap; ++i) {
+            num_full += pb_map_ctrl_is_full(m.ctrl[i]);
+        }
+        ck_assert_msg(m.size == 2048 && num_full == 2048, "There should have been 2048 entries, were %u",
+                      (unsigned)num_full);
+
+        for (i = 0; i < 4096; ++i) {
+            out = pb_ptr_map_get(&m, keys + i);
+            ck_assert_msg((out != NULL) == (int)(i % 2), "Key %u should%s have been found", (unsigned)i,
+                          i % 2 ? "" : " not");
+            ck_assert_msg(!out || *out == keys + i + round, "Key %u had the wrong value", (unsigned)i);
+        }
+    }
+
+    for (i = 1; i < 4096; i += 2) {
+        pb_ptr_map_remove(&m, keys + i);
+    }
+    ck_assert_msg(m.size == 0 && m.cap == PB_MAP_MIN_CAP, "The map should have shrunk back to %u, was %u",
+                  (unsigned)PB_MAP_MIN_CAP, (unsigned)m.cap);
+
+    pb_ptr_map_destroy(&m);
+}
+END_TEST
+
+START_TEST(ptr_index_map_test)
+{
+    /*
+     * Given a pointer to index map with space reserved for 1000 items
+     * When I put 1000 items in, update their indices through get and then clear it
+     * Then the map shouldn't have been rehashed and the indices should have been updated
+     */
+    static int keys[1000];
+    pb_ptr_index_map m;
+    size_t* entries;
+    size_t i;
+
+    ck_assert_msg(pb_ptr_index_map_init(&m) == 0, "Init should have succeeded");
+    ck_assert_msg(pb_ptr_index_map_reserve(&m, 1000) == 0 && m.expand_num >= 1000, "Reserving should have succeeded");
+
+    entries = (size_t*)m.entries;
+    for (i = 0; i < 1000; ++i) {
+        pb_ptr_index_map_put(&m, keys + i, i);
+    }
+    ck_assert_msg((size_t*)m.entries == entries, "The map should not have been rehashed");
+
+    for (i = 0; i < 1000; ++i) {
+        *pb_ptr_index_map_get(&m, keys + i) *= 2;
+    }
+    for (i = 0; i < 1000; ++i) {
+        ck_assert_msg(*pb_ptr_index_map_get(&m, keys + i) == i * 2, "Index %u should have been doubled",
+                      (unsigned)i);
+    }
+
+    pb_ptr_index_map_clear(&m);
+    ck_assert_msg(m.size == 0 && pb_ptr_index_map_get(&m, keys) == NULL, "Clearing should have removed every key");
+
+    pb_ptr_index_map_destroy(&m);
+}
+END_TEST
+
+START_TEST(str_map_test)
+{
+    /*
+     * Given a string map
+     * When I put names in and look them up with copies of the names
+     * Then the copies should find the same entries as the originals
+     */
+    static char names[100][16];
+    char copy[16];
+    pb_str_map m;
+    size_t i;
+    void** out;
+
+    ck_assert_msg(pb_str_map_init(&m) == 0, "Init should have succeeded");
+    for (i = 0; i < 100; ++i) {
+        sprintf(names[i], "Room %u", (unsigned)i);
+        pb_str_map_put(&m, names[i], names[i]);
+    }
+
+    for (i = 0; i < 100; ++i) {
+        sprintf(copy, "Room %u", (unsigned)i);
+        out = pb_str_map_get(&m, copy);
+        ck_assert_msg(out && *out == names[i], "%s should have been found", copy);
+    }
+    ck_assert_msg(pb_str_map_get(&m, "Room 100") == NULL, "Room 100 shouldn't have been found");
+
+    ck_assert_msg(pb_str_map_remove(&m, "Room 7") == 0 && pb_str_map_get(&m, names[7]) == NULL,
+                  "Room 7 should have been removed");
+
+    pb_str_map_destroy(&m);
+}
+END_TEST
+
+typedef struct {
+    size_t const* keys;
+    size_t next;
+    int in_order;
+} ordered_map_check;
+
+/* Checks that the keys come in the same order as ordered_map_check.keys. */
+static void check_key_order(pb_hashmap_entry* entry, void* param) {
+    ordered_map_check* check = (ordered_map_check*)param;
+    if (entry->key != check->keys + check->next || entry->val != (void*)check->next) {
+        check->in_order = 0;
+    }
+    check->next += 2;
+}
+
+START_TEST(ordered_map_order_test)
+{
+    /*
+     * Given an ordered map of pointer keys
+     * When I put keys in, remove every other one and put in enough more that the index is rebuilt several times
+     * Then for_each should visit the remaining keys in the order in which they were put into the map
+     */
+    static size_t keys[3000];
+    pb_ordered_map* omap = pb_ordered_map_create(pb_pointer_hash, pb_pointer_eq);
+    ordered_map_check check;
+    size_t i;
+    void* out;
+
+    ck_assert_msg(omap && omap->cap == PB_MAP_MIN_CAP && omap->size == 0, "The map should have started empty");
+
+    for (i = 0; i < 1000; ++i) {
+        pb_ordered_map_put(omap, keys + i, (void*)i);
+    }
+    for (i = 1; i < 1000; i += 2) {
+        ck_assert_msg(pb_ordered_map_remove(omap, keys + i) == 0, "Key %u should have been removed", (unsigned)i);
+    }
+    for (i = 1000; i < 3000; ++i) {
+        pb_ordered_map_put(omap, keys + i, (void*)i);
+        if (i % 2) {
+            pb_ordered_map_remove(omap, keys + i);
+        }
+    }
+
+    /* Over-writing a value should keep its place */
+    pb_ordered_map_put(omap, keys + 2, (void*)2);
+    ck_assert_msg(omap->size == 1500, "There should have been 1500 items, were %u", (unsigned)omap->size);
+
+    check.keys = keys;
+    check.next = 0;
+    check.in_order = 1;
+    pb_ordered_map_for_each(omap, check_key_order, &check);
+    ck_assert_msg(check.in_order && check.next == 3000, "The keys should have been visited in insertion order");
+
+    for (i = 0; i < 3000; ++i) {
+        int found = pb_ordered_map_get(omap, keys + i, &out) == 0;
+        ck_assert_msg(found == !(i % 2), "Key %u should%s have been found", (unsigned)i, i % 2 ? " not" : "");
+        ck_assert_msg(!found || out == (void*)i, "Key %u had the wrong value", (unsigned)i);
+    }
+
+    for (i = 0; i < 3000; i += 2) {
+        pb_ordered_map_remove(omap, keys + i);
+    }
+    ck_assert_msg(omap->size == 0 && omap->cap == PB_MAP_MIN_CAP, "The map should have shrunk back to %u, was %u",
+                  (unsigned)PB_MAP_MIN_CAP, (unsigned)omap->cap);
+
+    pb_ordered_map_clear(omap);
+    ck_assert_msg(pb_ordered_map_reserve(omap, 1000) == 0 && omap->expand_num >= 1000,
+                  "Reserving should have succeeded");
+    ck_assert_msg(pb_ordered_map_get(omap, keys, &out) == -1 && omap->num_items == 0,
+                  "Clearing should have removed every key");
+
+    pb_ordered_map_free(omap);
+}
+END_TEST
+
 Suite *make_pb_hash_suite(void)
 {
 	Suite *s;
 	TCase *tc_hashmap;
+    TCase *tc_typed_map;
+    TCase *tc_ordered_map;
 
 	s = suite_create("Hash map");
 
@@ -154,7 +441,20 @@ Suite *make_pb_hash_suite(void)
     tcase_add_test(tc_hashmap, expand_test);
     tcase_add_test(tc_hashmap, for_each_test);
 
+    tcase_add_test(tc_hashmap, churn_test);
+    tcase_add_test(tc_hashmap, reserve_test);
+
     tcase_add_unchecked_fixture(tc_hashmap, NULL, pb_hash_test_teardown);
+
+    tc_typed_map = tcase_create("Typed maps");
+    suite_add_tcase(s, tc_typed_map);
+    tcase_add_test(tc_typed_map, ptr_map_test);
+    tcase_add_test(tc_typed_map, ptr_index_map_test);
+    tcase_add_test(tc_typed_map, str_map_test);
+
+    tc_ordered_map = tcase_create("Ordered map");
+    suite_add_tcase(s, tc_ordered_map);
+    tcase_add_test(tc_ordered_map, ordered_map_order_test);
     
 	return s;
 }
@@ -1,6 +1,8 @@
 #include "../test_util.h"
 #include <check.h>
 #include <pb/util/heap/heap.h>
+#include <pb/util/heap/handle_heap.h>
+#include <stdlib.h>
 
 /* Heap to use for the tests. */
 pb_heap* heap;
@@ -91,10 +93,60 @@ START_TEST(decrease_test)
 }
 END_TEST
 
+START_TEST(handle_heap_sort_test)
+{
+    /*
+     * Given a handle heap with many random priorities, some of which have been decreased
+     * When I remove every item
+     * Then the items should come out in order of priority, and removed items' handles should no longer be in the heap
+     */
+    static float priorities[1000];
+    pb_handle_heap h;
+    pb_heap_handle handles[1000];
+    float last = -1.f;
+    size_t i;
+
+    ck_assert_msg(pb_handle_heap_init(&h, 0) == 0, "Init should have succeeded");
+    ck_assert_msg(pb_handle_heap_get_min(&h) == NULL && pb_handle_heap_peek_min(&h) == NULL,
+                  "An empty heap shouldn't have had a minimum");
+
+    srand(11);
+    for (i = 0; i < 1000; ++i) {
+        priorities[i] = (float)(rand() % 10000);
+        handles[i] = pb_handle_heap_insert(&h, priorities + i, priorities[i]);
+        ck_assert_msg(handles[i] == i, "Handle %u should have been given out in order", (unsigned)i);
+    }
+
+    for (i = 0; i < 1000; i += 3) {
+        priorities[i] /= 2.f;
+        pb_handle_heap_decrease_key(&h, handles[i], priorities[i]);
+    }
+    ck_assert_msg(h.size == 1000, "The heap should have had 1000 items, had %u", (unsigned)h.size);
+
+    for (i = 0; i < 1000; ++i) {
+        float* min = (float*)pb_handle_heap_get_min(&h);
+        ck_assert_msg(min && *min >= last, "Item %u came out of order", (unsigned)i);
+        ck_assert_msg(!pb_handle_heap_contains(&h, handles[min - priorities]), "The item should have been removed");
+        last = *min;
+    }
+    ck_assert_msg(pb_handle_heap_get_min(&h) == NULL, "The heap should have been empty");
+
+    /* Decreasing a removed item's key shouldn't put it back */
+    pb_handle_heap_decrease_key(&h, handles[0], 0.f);
+    ck_assert_msg(h.size == 0, "Decreasing a removed item's key should have done nothing");
+
+    pb_handle_heap_clear(&h);
+    ck_assert_msg(pb_handle_heap_insert(&h, priorities, 1.f) == 0, "Handles should have restarted after clearing");
+
+    pb_handle_heap_free(&h);
+}
+END_TEST
+
 Suite *make_pb_heap_suite(void)
 {
 	Suite *s;
 	TCase *tc_heap;
+    TCase *tc_handle_heap;
 
 	s = suite_create("Heap");
 
@@ -108,6 +160,10 @@ Suite *make_pb_heap_suite(void)
     tcase_add_test(tc_heap, decrease_test);
 
     tcase_add_unchecked_fixture(tc_heap, pb_heap_test_setup, pb_heap_test_teardown);
+
+    tc_handle_heap = tcase_create("Handle heap");
+    suite_add_tcase(s, tc_handle_heap);
+    tcase_add_test(tc_handle_heap, handle_heap_sort_test);
     
 	return s;
 }
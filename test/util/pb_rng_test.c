@@ -0,0 +1,102 @@
+#include "../test_util.h"
+#include <check.h>
+#include <pb/util/rng/rng.h>
+
+START_TEST(seed_repeatable)
+{
+    pb_rng a;
+    pb_rng b;
+    int i;
+
+    pb_rng_seed(&a, 1234);
+    pb_rng_seed(&b, 1234);
+
+    for (i = 0; i < 100; ++i) {
+        uint64_t val_a = pb_rng_next64(&a);
+        uint64_t val_b = pb_rng_next64(&b);
+        ck_assert_msg(val_a == val_b, "Value %d differed between generators with the same seed", i);
+    }
+}
+END_TEST
+
+START_TEST(seeds_differ)
+{
+    pb_rng a;
+    pb_rng b;
+
+    pb_rng_seed(&a, 1);
+    pb_rng_seed(&b, 2);
+
+    ck_assert_msg(pb_rng_next64(&a) != pb_rng_next64(&b), "Generators with different seeds produced the same first value");
+}
+END_TEST
+
+START_TEST(range_bounds)
+{
+    pb_rng rng;
+    unsigned counts[5] = { 0 };
+    int i;
+
+    pb_rng_seed(&rng, 42);
+    for (i = 0; i < 5000; ++i) {
+        uint32_t val = pb_rng_range(&rng, 5);
+        ck_assert_msg(val < 5, "pb_rng_range(5) returned %u", val);
+        ++counts[val];
+    }
+
+    for (i = 0; i < 5; ++i) {
+        ck_assert_msg(counts[i] > 800 && counts[i] < 1200, "Value %d was drawn %u times out of 5000", i, counts[i]);
+    }
+}
+END_TEST
+
+START_TEST(split_ignores_parent_counter)
+{
+    /* A child stream depends only on the parent's key and the stream id, not on how far the parent has advanced */
+    pb_rng parent;
+    pb_rng child1;
+    pb_rng child2;
+    int i;
+
+    pb_rng_seed(&parent, 7);
+    pb_rng_split(&parent, 3, &child1);
+    for (i = 0; i < 10; ++i) {
+        pb_rng_next(&parent);
+    }
+    pb_rng_split(&parent, 3, &child2);
+
+    for (i = 0; i < 10; ++i) {
+        ck_assert_msg(pb_rng_next64(&child1) == pb_rng_next64(&child2), "Value %d differed between identical splits", i);
+    }
+}
+END_TEST
+
+START_TEST(split_streams_differ)
+{
+    pb_rng parent;
+    pb_rng child1;
+    pb_rng child2;
+
+    pb_rng_seed(&parent, 7);
+    pb_rng_split(&parent, 0, &child1);
+    pb_rng_split(&parent, 1, &child2);
+
+    ck_assert_msg(pb_rng_next64(&child1) != pb_rng_next64(&child2), "Different streams produced the same first value");
+    ck_assert_msg(pb_rng_next64(&child1) != pb_rng_next64(&parent), "Child stream produced the same value as its parent");
+}
+END_TEST
+
+Suite* make_pb_rng_suite(void) {
+    Suite* s = suite_create("pb_rng suite");
+    TCase* tc_rng_tests;
+
+    tc_rng_tests = tcase_create("pb_rng tests");
+    suite_add_tcase(s, tc_rng_tests);
+    tcase_add_test(tc_rng_tests, seed_repeatable);
+    tcase_add_test(tc_rng_tests, seeds_differ);
+    tcase_add_test(tc_rng_tests, range_bounds);
+    tcase_add_test(tc_rng_tests, split_ignores_parent_counter);
+    tcase_add_test(tc_rng_tests, split_streams_differ);
+
+    return s;
+}
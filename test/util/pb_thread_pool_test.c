@@ -0,0 +1,98 @@
+#include "../test_util.h"
+#include <check.h>
+#include <pb/util/thread_pool/thread_pool.h>
+#include <string.h>
+
+typedef struct {
+    unsigned* counts;      /* The number of times each task ran */
+    size_t num_workers;
+    int bad_worker;        /* Set if a task received an out-of-range worker index */
+} count_param;
+
+static void PB_UTIL_CALL count_task(size_t index, size_t worker, void* param) {
+    count_param* p = (count_param*)param;
+    if (worker >= p->num_workers) {
+        p->bad_worker = 1;
+    }
+
+    /* Each task index is handed out exactly once, so this doesn't need to be atomic */
+    ++p->counts[index];
+}
+
+static void run_counted(size_t num_workers, size_t num_tasks) {
+    pb_thread_pool* pool = pb_thread_pool_create(num_workers);
+    count_param param;
+    size_t i;
+    int batch;
+
+    ck_assert_msg(pool != NULL, "Pool with %lu workers should have been created", (unsigned long)num_workers);
+    ck_assert_msg(pb_thread_pool_num_workers(pool) == num_workers, "Pool should have had %lu workers, had %lu",
+                  (unsigned long)num_workers, (unsigned long)pb_thread_pool_num_workers(pool));
+
+    param.counts = calloc(num_tasks, sizeof(unsigned));
+    param.num_workers = num_workers;
+    param.bad_worker = 0;
+
+    /* Run a few batches to make sure the pool can be reused */
+    for (batch = 0; batch < 3; ++batch) {
+        memset(param.counts, 0, sizeof(unsigned) * num_tasks);
+        pb_thread_pool_run(pool, num_tasks, count_task, &param);
+
+        for (i = 0; i < num_tasks; ++i) {
+            ck_assert_msg(param.counts[i] == 1, "Task %lu ran %u times in batch %d", (unsigned long)i, param.counts[i], batch);
+        }
+        ck_assert_msg(!param.bad_worker, "A task received an out-of-range worker index");
+    }
+
+    free(param.counts);
+    pb_thread_pool_free(pool);
+}
+
+START_TEST(single_worker)
+{
+    run_counted(1, 100);
+}
+END_TEST
+
+START_TEST(multiple_workers)
+{
+    run_counted(4, 1000);
+}
+END_TEST
+
+START_TEST(more_workers_than_tasks)
+{
+    run_counted(8, 3);
+}
+END_TEST
+
+START_TEST(no_tasks)
+{
+    run_counted(4, 0);
+}
+END_TEST
+
+START_TEST(default_workers)
+{
+    pb_thread_pool* pool = pb_thread_pool_create(0);
+    ck_assert_msg(pool != NULL, "Pool should have been created");
+    ck_assert_msg(pb_thread_pool_num_workers(pool) == pb_thread_pool_hardware_threads(),
+                  "Pool should have had one worker per hardware thread");
+    pb_thread_pool_free(pool);
+}
+END_TEST
+
+Suite* make_pb_thread_pool_suite(void) {
+    Suite* s = suite_create("pb_thread_pool suite");
+    TCase* tc_thread_pool_tests;
+
+    tc_thread_pool_tests = tcase_create("pb_thread_pool tests");
+    suite_add_tcase(s, tc_thread_pool_tests);
+    tcase_add_test(tc_thread_pool_tests, single_worker);
+    tcase_add_test(tc_thread_pool_tests, multiple_workers);
+    tcase_add_test(tc_thread_pool_tests, more_workers_than_tasks);
+    tcase_add_test(tc_thread_pool_tests, no_tasks);
+    tcase_add_test(tc_thread_pool_tests, default_workers);
+
+    return s;
+}
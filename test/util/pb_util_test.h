@@ -11,5 +11,8 @@ Suite* make_pb_heap_suite(void);
 Suite* make_pb_geom_suite(void);
 Suite* make_pb_vector_suite(void);
 Suite* make_triangulate_suite(void);
+Suite* make_pb_rng_suite(void);
+Suite* make_pb_thread_pool_suite(void);
+Suite* make_pb_arena_suite(void);
 
 #endif /* PB_UTIL_TEST_H */
\ No newline at end of file
@@ -22,6 +22,9 @@ int main(void)
     srunner_add_suite(sr, make_pb_geom_suite());
     srunner_add_suite(sr, make_pb_vector_suite());
     srunner_add_suite(sr, make_triangulate_suite());
+    srunner_add_suite(sr, make_pb_rng_suite());
+    srunner_add_suite(sr, make_pb_thread_pool_suite());
+    srunner_add_suite(sr, make_pb_arena_suite());
 	srunner_set_tap(sr, "util_test_results.tap"); /* Write the test results to a TAP (Test Anything Protocol) file for test harness analysis */
 
     srunner_run_all(sr, CK_ENV);